@@ -0,0 +1,132 @@
+#include "BandLayout.hpp"
+#include "LoopbackLink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Compressed (YUV440) frames from the start of the readback copy to the last row uploaded on the
+// receiver, sent whole or in bands over a loopback link. Copy and upload are real memcpys with the
+// row pitches a mapped staging texture and UpdateSubresource() would have.
+struct Planes {
+    Planes(unsigned short height, size_t pitch) :
+        yPitch(pitch), uvPitch(pitch * 2), y(pitch * height), uv(pitch * 2 * (height / 2)) {}
+
+    size_t yPitch;
+    size_t uvPitch;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> uv;
+};
+
+static void CopyBandOut(const Planes& src, unsigned short width, const FrameCodec::Band& band, uint8_t* dst) {
+    for (unsigned int row = 0; row < band.rows; ++row) {
+        memcpy(dst + static_cast<size_t>(row) * width, src.y.data() + (band.firstRow + row) * src.yPitch, width);
+    }
+
+    uint8_t* uvDst = dst + band.ySize;
+    for (unsigned int row = 0; row < band.uvRows; ++row) {
+        memcpy(uvDst + static_cast<size_t>(row) * width * 2, src.uv.data() + (band.uvRow + row) * src.uvPitch, static_cast<size_t>(width) * 2);
+    }
+}
+
+static void UploadBand(const uint8_t* src, unsigned short width, const FrameCodec::Band& band, Planes& dst) {
+    for (unsigned int row = 0; row < band.rows; ++row) {
+        memcpy(dst.y.data() + (band.firstRow + row) * dst.yPitch, src + static_cast<size_t>(row) * width, width);
+    }
+
+    const uint8_t* uvSrc = src + band.ySize;
+    for (unsigned int row = 0; row < band.uvRows; ++row) {
+        memcpy(dst.uv.data() + (band.uvRow + row) * dst.uvPitch, uvSrc + static_cast<size_t>(row) * width * 2, static_cast<size_t>(width) * 2);
+    }
+}
+
+static std::chrono::microseconds Percentile(std::vector<std::chrono::microseconds> samples, double q) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(q * (samples.size() - 1))];
+}
+
+static std::chrono::microseconds RunBands(unsigned short width, unsigned short height, unsigned int bandCount, double gbps,
+                                          std::chrono::microseconds baseline) {
+    const unsigned int frames = 200;
+    const size_t pitch = (width + 255) / 256 * 256;
+
+    FrameCodec::PlanarBands bands(width, height, bandCount);
+
+    Planes mapped(height, pitch);
+    Planes texture(height, pitch);
+    std::mt19937 rng(42);
+    for (uint8_t& v : mapped.y) v = static_cast<uint8_t>(rng());
+    for (uint8_t& v : mapped.uv) v = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> sendBuffer(bands.GetPayloadSize());
+    std::vector<uint8_t> recvBuffer(bands.GetPayloadSize());
+
+    LoopbackLink link(gbps, std::chrono::microseconds(3));
+    std::atomic<unsigned int> arrived = 0;
+    std::vector<std::chrono::microseconds> latencies;
+    latencies.reserve(frames);
+
+    for (unsigned int frame = 0; frame < frames; ++frame) {
+        arrived.store(0);
+
+        // Receiver: uploads every band as soon as its signal is in
+        std::thread receiver([&] {
+            for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+                while (arrived.load(std::memory_order_acquire) <= i) std::this_thread::yield();
+                UploadBand(recvBuffer.data() + bands[i].offset, width, bands[i], texture);
+            }
+        });
+        const auto start = std::chrono::steady_clock::now();
+
+        // Sender: copies band i + 1 while band i is on the wire
+        for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+            const FrameCodec::Band& band = bands[i];
+            CopyBandOut(mapped, width, band, sendBuffer.data() + band.offset);
+            link.Post(recvBuffer.data() + band.offset, sendBuffer.data() + band.offset, band.size, [&] {
+                arrived.fetch_add(1, std::memory_order_release);
+            });
+        }
+
+        receiver.join();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+        link.Drain();
+    }
+
+    bool mismatch = false;
+    for (unsigned int row = 0; row < height; ++row) {
+        if (memcmp(texture.y.data() + row * pitch, mapped.y.data() + row * pitch, width) != 0) mismatch = true;
+    }
+    for (unsigned int row = 0; row < height / 2u; ++row) {
+        if (memcmp(texture.uv.data() + row * pitch * 2, mapped.uv.data() + row * pitch * 2, static_cast<size_t>(width) * 2) != 0) mismatch = true;
+    }
+
+    const auto p50 = Percentile(latencies, 0.50);
+    const auto p99 = Percentile(latencies, 0.99);
+    std::cout << width << "x" << height << " " << gbps << "Gb/s bands " << bands.GetCount()
+              << " | p50: " << p50.count() << "us"
+              << " | p99: " << p99.count() << "us";
+    if (baseline.count() > 0) std::cout << " | " << (100.0 * p50.count() / baseline.count()) << "% of whole frame";
+    std::cout << (mismatch ? " | MISMATCH" : "") << std::endl;
+    return p50;
+}
+
+int main() {
+    const unsigned short resolutions[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    const double links[] = { 25.0, 100.0 };
+    const unsigned int bandCounts[] = { 2, 4, 8, 16 };
+
+    for (const auto& res : resolutions) {
+        for (double gbps : links) {
+            auto whole = RunBands(res[0], res[1], 1, gbps, std::chrono::microseconds::zero());
+            for (unsigned int count : bandCounts) {
+                RunBands(res[0], res[1], count, gbps, whole);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef BENCHHARNESS_HPP
+#define BENCHHARNESS_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal harness for bench_suite. Micro benchmarks repeat a body in timed batches and report the median batch;
+// loop benchmarks measure themselves and report named metrics. Results go to the console and, with --json, to a
+// file holding one result per line, which --baseline reads back to print the change against an earlier run.
+//
+//   bench_suite [--json <file>] [--baseline <file>] [--filter <text>] [--label <text>] [--quick]
+class BenchHarness {
+    public:
+    using Clock = std::chrono::steady_clock;
+    using Metrics = std::vector<std::pair<std::string, double>>;
+
+    BenchHarness(int argc, char* argv[]) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--json" && hasValue) m_JsonPath = argv[++i];
+            else if (arg == "--baseline" && hasValue) LoadBaseline(argv[++i]);
+            else if (arg == "--filter" && hasValue) m_Filter = argv[++i];
+            else if (arg == "--label" && hasValue) m_Label = argv[++i];
+            else if (arg == "--quick") m_BatchTime = std::chrono::milliseconds(2);
+            else {
+                std::cerr << "Unknown option " << arg << std::endl;
+                m_Failed = true;
+            }
+        }
+    }
+
+    bool Selected(const std::string& group, const std::string& name) const {
+        return m_Filter.empty() || (group + "/" + name).find(m_Filter) != std::string::npos;
+    }
+
+    // `body` runs once per operation; `bytes` is what one operation reads or produces, 0 when throughput is meaningless
+    template <typename Body>
+    void Micro(const std::string& group, const std::string& name, size_t bytes, Body&& body) {
+        if (!Selected(group, name)) return;
+
+        // Grow the batch until it takes long enough to time, then keep the median of a few batches
+        body();
+        uint64_t iterations = 1;
+        while (true) {
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) body();
+            if (Clock::now() - start >= m_BatchTime || iterations >= (1ULL << 30)) break;
+            iterations *= 2;
+        }
+
+        std::vector<double> batches;
+        for (unsigned int b = 0; b < BATCHES; ++b) {
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) body();
+            batches.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+        }
+        std::sort(batches.begin(), batches.end());
+        const double ns = batches[BATCHES / 2];
+
+        Metrics metrics = { { "ns_per_op", ns } };
+        if (bytes) metrics.push_back({ "gb_per_s", bytes / ns });
+        Report(group, name, "micro", metrics);
+    }
+
+    void Loop(const std::string& group, const std::string& name, const Metrics& metrics) {
+        if (Selected(group, name)) Report(group, name, "loop", metrics);
+    }
+
+    // A correctness check that should fail the run, e.g. a round trip that came back different
+    void Fail(const std::string& what) {
+        std::cerr << "FAILED: " << what << std::endl;
+        m_Failed = true;
+    }
+
+    // Writes the JSON file; the process exit code
+    int Finish() {
+        if (!m_JsonPath.empty()) {
+            std::ofstream out(m_JsonPath);
+            out << "{\n  \"label\": \"" << m_Label << "\",\n  \"results\": [\n";
+            for (size_t i = 0; i < m_Lines.size(); ++i) out << "    " << m_Lines[i] << (i + 1 < m_Lines.size() ? ",\n" : "\n");
+            out << "  ]\n}\n";
+            if (!out) {
+                std::cerr << "Failed to write " << m_JsonPath << std::endl;
+                return 1;
+            }
+            std::cout << "Wrote " << m_Lines.size() << " results to " << m_JsonPath << std::endl;
+        }
+        return m_Failed ? 1 : 0;
+    }
+
+    private:
+    static constexpr unsigned int BATCHES = 5;
+
+    void Report(const std::string& group, const std::string& name, const char* kind, const Metrics& metrics) {
+        const std::string id = group + "/" + name;
+        char value[64];
+
+        std::string line = "{\"name\": \"" + id + "\", \"kind\": \"" + kind + "\"";
+        std::cout << id << std::string(id.size() < 36 ? 36 - id.size() : 1, ' ');
+        for (size_t i = 0; i < metrics.size(); ++i) {
+            const auto& [key, v] = metrics[i];
+            snprintf(value, sizeof(value), "%.6g", v);
+            line += ", \"" + key + "\": " + value;
+            std::cout << " " << key << "=" << value;
+
+            // The first metric is the headline one; say how it moved since the baseline
+            auto it = m_Baseline.find(id + "/" + key);
+            if (i == 0 && it != m_Baseline.end() && it->second != 0) {
+                snprintf(value, sizeof(value), " (%+.1f%%)", (v / it->second - 1) * 100);
+                std::cout << value;
+            }
+        }
+        std::cout << std::endl;
+        m_Lines.push_back(line + "}");
+    }
+
+    // Reads back what Finish() wrote: one result object per line
+    void LoadBaseline(const char* path) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Failed to read baseline " << path << std::endl;
+            m_Failed = true;
+            return;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            const size_t nameStart = line.find("\"name\": \"");
+            if (nameStart == std::string::npos) continue;
+            const size_t nameEnd = line.find('"', nameStart + 9);
+            const std::string id = line.substr(nameStart + 9, nameEnd - nameStart - 9);
+
+            // Every `"key": number` after the kind
+            size_t pos = line.find("\"kind\"");
+            while ((pos = line.find(", \"", pos)) != std::string::npos) {
+                const size_t keyEnd = line.find('"', pos + 3);
+                const std::string key = line.substr(pos + 3, keyEnd - pos - 3);
+                m_Baseline[id + "/" + key] = strtod(line.c_str() + keyEnd + 2, nullptr);
+                pos = keyEnd;
+            }
+        }
+    }
+
+    std::chrono::nanoseconds m_BatchTime = std::chrono::milliseconds(20);
+    std::string m_JsonPath;
+    std::string m_Filter;
+    std::string m_Label;
+    bool m_Failed = false;
+
+    std::vector<std::string> m_Lines;
+    std::map<std::string, double> m_Baseline;
+};
+
+// Keeps a result the compiler could otherwise prove unused
+template <typename T>
+inline void KeepResult(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    // MSVC has no inline asm on x64; a read through a volatile pointer is just as opaque to it
+    const volatile T* escape = &value;
+    (void)*escape;
+#endif
+}
+
+#endif
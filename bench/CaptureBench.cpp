@@ -0,0 +1,94 @@
+#include "CaptureFile.hpp"
+#include "CaptureRegion.hpp"
+#include "SyntheticSource.hpp"
+#include "TileDelta.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Records synthetic sessions into capture files, raw and delta-coded, and plays them back through the copy and
+// codec stages at full speed: what Append() costs a capture thread, file size, and replay rate.
+// tests/CaptureFileTest.cpp checks the frames come back exact, and after a cut.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t WIDTH = 1920;
+constexpr uint16_t HEIGHT = 1080;
+constexpr uint16_t REFRESH_RATE = 60;
+constexpr unsigned int FRAMES = 150;
+
+struct Recording {
+    uint64_t appended = 0;
+    std::vector<double> appendUs;
+    uint64_t dropped = 0;
+    uint64_t bytes = 0;
+};
+
+Recording Record(const std::filesystem::path& path, FrameCodec::CaptureEncoding encoding) {
+    Recording recording;
+    FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::ScrollingText, 41);
+    FrameCodec::CaptureWriter writer(WIDTH, HEIGHT, REFRESH_RATE, encoding);
+    if (!writer.Open(path.string())) return recording;
+
+    // Paced like a 60Hz capture thread, so the writer can keep up on an ordinary disk
+    auto next = Clock::now();
+    for (unsigned int n = 0; n < FRAMES; ++n) {
+        FrameCodec::SourceFrame frame;
+        if (source.Acquire(0, frame) != FrameCodec::AcquireResult::Frame) break;
+
+        const auto start = Clock::now();
+        if (writer.Append(frame.pixels, frame.pitch, frame.captureTime)) recording.appended++;
+        recording.appendUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+        next += std::chrono::microseconds(1000000 / REFRESH_RATE);
+        std::this_thread::sleep_until(next);
+    }
+    writer.Close();
+    recording.dropped = writer.GetDropped();
+    recording.bytes = writer.GetBytes();
+    return recording;
+}
+
+// Plays `path` once through pack and delta encode; frames per second
+double Replay(const std::filesystem::path& path) {
+    FrameCodec::CaptureReader reader(false, false);
+    if (!reader.Open(path.string())) return 0;
+
+    FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+    std::vector<uint8_t> packed(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+    std::vector<uint8_t> delta(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+
+    const auto start = Clock::now();
+    FrameCodec::SourceFrame frame;
+    while (reader.Acquire(0, frame) == FrameCodec::AcquireResult::Frame) {
+        FrameCodec::PackRegion(frame.pixels, frame.pitch, { 0, 0, WIDTH, HEIGHT }, packed.data());
+        encoder.Encode(packed.data(), delta.data());
+        reader.Release();
+    }
+    return reader.GetFrameCount() / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "capture_bench.ndrc";
+
+    std::cout << WIDTH << "x" << HEIGHT << " scrolling text, " << FRAMES << " frames at " << REFRESH_RATE << "Hz" << std::endl;
+    for (FrameCodec::CaptureEncoding encoding : { FrameCodec::CaptureEncoding::Raw, FrameCodec::CaptureEncoding::Delta }) {
+        Recording recording = Record(path, encoding);
+        std::sort(recording.appendUs.begin(), recording.appendUs.end());
+        const double p50 = recording.appendUs.empty() ? 0 : recording.appendUs[recording.appendUs.size() / 2];
+        const double p99 = recording.appendUs.empty() ? 0 : recording.appendUs[recording.appendUs.size() * 99 / 100];
+        const double fps = Replay(path);
+
+        std::cout << (encoding == FrameCodec::CaptureEncoding::Raw ? "raw  " : "delta")
+                  << " | recorded: " << recording.appended << ", dropped: " << recording.dropped
+                  << " | file: " << recording.bytes / (1024 * 1024) << "MB (" << recording.bytes / std::max<uint64_t>(recording.appended, 1) / 1024 << "KB/frame)"
+                  << " | append p50/p99: " << p50 << "/" << p99 << "us"
+                  << " | replay: " << static_cast<int>(fps) << " fps" << std::endl;
+    }
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "ColorConvert.hpp"
+#include "TileChroma.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// YUVAdaptive, the per-tile chroma mode, on frames drawn to look like its targets: coloured text, vertical UI rules,
+// grey text and photo-like noise. Reports where the classifier sent the tiles and the chroma bytes against 4:4:0,
+// then times the adaptive encode and decode at 1080p and 4K against the fixed full-chroma path, which is the
+// conversion without the classifier and the packers. tests/AdaptiveChromaTest.cpp checks the bytes and the decode.
+using Clock = std::chrono::steady_clock;
+
+constexpr FrameCodec::SimdLevel LEVELS[] = {
+    FrameCodec::SimdLevel::Scalar, FrameCodec::SimdLevel::SSE41, FrameCodec::SimdLevel::AVX2, FrameCodec::SimdLevel::AVX512
+};
+
+constexpr FrameCodec::PixelFormat ADAPTIVE = FrameCodec::PixelFormat::YUVAdaptive;
+
+enum class Content {
+    ColouredText, // Saturated strokes both ways on white, like syntax highlighting
+    Rules,        // One-pixel coloured vertical lines, like table and panel borders
+    GreyText,     // Black strokes on white: no chroma at all
+    Photo,        // Smooth colour fields under grain
+    Mixed,        // A third of each of the above, as a desktop might be
+};
+
+const char* ContentName(Content content) {
+    switch (content) {
+        case Content::ColouredText: return "coloured text";
+        case Content::Rules: return "vertical rules";
+        case Content::GreyText: return "grey text";
+        case Content::Photo: return "photo";
+        default: return "mixed";
+    }
+}
+
+void Fill(std::vector<uint8_t>& bgra, size_t pitch, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t colour) {
+    for (unsigned int row = y; row < y + height; ++row) {
+        for (unsigned int col = x; col < x + width; ++col) memcpy(bgra.data() + row * pitch + col * 4, &colour, 4);
+    }
+}
+
+// Columns [left, right) of the frame in `content`
+void Draw(std::vector<uint8_t>& bgra, size_t pitch, unsigned int left, unsigned int right, unsigned int height, Content content, std::mt19937& rng) {
+    constexpr uint32_t COLOURS[] = { 0xFFD02020, 0xFF2050E0, 0xFF10A040, 0xFFA020C0, 0xFFE08000 };
+    const unsigned int width = right - left;
+    if (content == Content::Photo) {
+        for (unsigned int row = 0; row < height; ++row) {
+            for (unsigned int col = left; col < right; ++col) {
+                uint8_t* pixel = bgra.data() + row * pitch + col * 4;
+                const int grain = static_cast<int>(rng() % 48) - 24;
+                pixel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(col * 255 / (left + width)) + grain, 0, 255));
+                pixel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(row * 255 / height) + grain / 2, 0, 255));
+                pixel[2] = static_cast<uint8_t>(std::clamp(static_cast<int>((col + row) * 255 / (left + width + height)) - grain, 0, 255));
+                pixel[3] = 255;
+            }
+        }
+        return;
+    }
+
+    Fill(bgra, pitch, left, 0, width, height, 0xFFFFFFFF);
+    if (content == Content::Rules) {
+        for (unsigned int col = left + 5; col < right; col += 23) Fill(bgra, pitch, col, 0, 1, height, COLOURS[col % std::size(COLOURS)]);
+        return;
+    }
+
+    // Lines of glyph-sized strokes, a gap between words
+    for (unsigned int line = 2; line + 14 <= height; line += 18) {
+        for (unsigned int col = left + 4; col + 8 <= right; col += 9) {
+            if (rng() % 6 == 0) continue;
+            const uint32_t colour = content == Content::GreyText ? 0xFF000000 : COLOURS[rng() % std::size(COLOURS)];
+            Fill(bgra, pitch, col + rng() % 6, line, 1 + rng() % 2, 10, colour);
+            Fill(bgra, pitch, col, line + rng() % 10, 6, 1, colour);
+        }
+    }
+}
+
+std::vector<uint8_t> Frame(unsigned int width, unsigned int height, Content content, uint32_t seed) {
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> bgra(pitch * height);
+    std::mt19937 rng(seed);
+    if (content != Content::Mixed) {
+        Draw(bgra, pitch, 0, width, height, content, rng);
+    } else {
+        Draw(bgra, pitch, 0, width / 3, height, Content::ColouredText, rng);
+        Draw(bgra, pitch, width / 3, width * 2 / 3, height, Content::Photo, rng);
+        Draw(bgra, pitch, width * 2 / 3, width, height, Content::GreyText, rng);
+    }
+    return bgra;
+}
+
+// A whole frame as one band: the Y plane, then the chroma section
+struct Encoded {
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> chroma;
+};
+
+Encoded Encode(const std::vector<uint8_t>& bgra, unsigned int width, unsigned int height, unsigned int threads, FrameCodec::SimdLevel level) {
+    Encoded out;
+    out.y.resize(static_cast<size_t>(width) * height);
+    out.chroma.resize(FrameCodec::AdaptiveChromaMaxSize(width, height));
+    FrameCodec::YuvEncoder encoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, threads, level);
+    out.chroma.resize(encoder.EncodeAdaptiveRows(bgra.data(), static_cast<size_t>(width) * 4, 0, height, out.y.data(), width, out.chroma.data()));
+    return out;
+}
+
+// Where the tiles went, and the chroma bytes against 4:4:0's (one byte per pixel) and full chroma's
+void Report(Content content, unsigned int width, unsigned int height) {
+    const Encoded scalar = Encode(Frame(width, height, content, width * 31 + height), width, height, 1, FrameCodec::SimdLevel::Scalar);
+    const unsigned int tiles = FrameCodec::ChromaTilesX(width) * FrameCodec::ChromaTilesY(height);
+    unsigned int counts[FrameCodec::TILE_CHROMA_COUNT] = {};
+    for (unsigned int i = 0; i < tiles; ++i) counts[scalar.chroma[i]]++;
+    const double pixels = static_cast<double>(width) * height;
+    std::cout << "Adaptive " << ContentName(content) << " " << width << "x" << height << ": " << counts[0] << " full, " << counts[1] << " 4:4:0, "
+              << counts[2] << " 4:2:0 tiles; chroma " << scalar.chroma.size() << " bytes, " << 100.0 * scalar.chroma.size() / pixels << "% of 4:4:0, "
+              << 50.0 * scalar.chroma.size() / pixels << "% of full" << std::endl;
+}
+
+// GB/s counts the BGRA side, as color_bench does. The fixed path is the same conversion writing every pair at full
+// resolution, so the difference is what the classifier and the packers (or the unpackers) cost.
+void Time(unsigned int width, unsigned int height) {
+    constexpr unsigned int FRAMES = 20;
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    const std::vector<uint8_t> bgra = Frame(width, height, Content::Mixed, 49);
+    std::vector<uint8_t> decoded(pitch * height);
+    std::vector<uint8_t> y(static_cast<size_t>(width) * height), uv(static_cast<size_t>(width) * height * 2);
+    std::vector<uint8_t> chroma(FrameCodec::AdaptiveChromaMaxSize(width, height));
+    const double bytes = static_cast<double>(pitch) * height;
+
+    auto ms = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES; };
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 0u }) {
+            FrameCodec::YuvEncoder encoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, threads, level);
+            FrameCodec::YuvDecoder decoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, threads, level);
+            const size_t used = encoder.EncodeAdaptiveRows(bgra.data(), pitch, 0, height, y.data(), width, chroma.data());
+
+            auto start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) encoder.EncodeAdaptiveRows(bgra.data(), pitch, 0, height, y.data(), width, chroma.data());
+            const double adaptiveEncode = ms(start);
+            start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) decoder.DecodeAdaptiveRows(y.data(), width, chroma.data(), used, 0, height, decoded.data(), pitch);
+            const double adaptiveDecode = ms(start);
+
+            std::vector<uint8_t> fixedBgra = bgra;
+            start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) encoder.Encode(fixedBgra.data(), pitch, y.data(), width, uv.data(), static_cast<size_t>(width) * 2);
+            const double fixedEncode = ms(start);
+            start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) decoder.Decode(y.data(), width, uv.data(), static_cast<size_t>(width) * 2, decoded.data(), pitch);
+            const double fixedDecode = ms(start);
+
+            const unsigned int cores = encoder.GetThreadCount();
+            std::cout << "  " << width << "x" << height << " " << FrameCodec::SimdLevelName(level) << ", " << cores << " thread(s): encode "
+                      << adaptiveEncode << "ms (" << bytes / adaptiveEncode / 1e6 / cores << "GB/s per core; full chroma " << fixedEncode
+                      << "ms), decode " << adaptiveDecode << "ms (" << bytes / adaptiveDecode / 1e6 / cores << "GB/s per core; full chroma "
+                      << fixedDecode << "ms), " << used << " chroma bytes" << std::endl;
+            if (std::thread::hardware_concurrency() <= 1) break; // 0 threads is 1 again
+        }
+    }
+}
+
+int main() {
+    std::cout << "Detected: " << FrameCodec::SimdLevelName(FrameCodec::DetectSimdLevel()) << std::endl;
+    for (Content content : { Content::ColouredText, Content::Rules, Content::GreyText, Content::Photo, Content::Mixed }) Report(content, 1920, 1080);
+
+    std::cout << "Timing (mixed content):" << std::endl;
+    Time(1920, 1080);
+    Time(3840, 2160);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "ColorConvert.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+
+// The CPU YUV encoder and decoder at every SIMD level the machine has, timed for each planar format on one core and
+// on all of them at 1080p, 1440p and 4K, and for each colour space at 1080p. tests/ColorConvertTest.cpp checks the
+// kernels against each other and the shader references.
+using Clock = std::chrono::steady_clock;
+
+constexpr FrameCodec::SimdLevel LEVELS[] = {
+    FrameCodec::SimdLevel::Scalar, FrameCodec::SimdLevel::SSE41, FrameCodec::SimdLevel::AVX2, FrameCodec::SimdLevel::AVX512
+};
+
+constexpr FrameCodec::PixelFormat FORMATS[] = {
+    FrameCodec::PixelFormat::YUV440, FrameCodec::PixelFormat::YUV420, FrameCodec::PixelFormat::YUV422
+};
+
+constexpr FrameCodec::ColorSpace SPACES[] = {
+    FrameCodec::ColorSpace::BT601Full, FrameCodec::ColorSpace::BT601Limited, FrameCodec::ColorSpace::BT709Full, FrameCodec::ColorSpace::BT709Limited
+};
+
+const char* FormatName(FrameCodec::PixelFormat format) {
+    switch (format) {
+        case FrameCodec::PixelFormat::YUV420: return "YUV420";
+        case FrameCodec::PixelFormat::YUV422: return "YUV422";
+        default: return "YUV440";
+    }
+}
+
+struct Planes {
+    size_t uvPitch;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> uv;
+
+    Planes(unsigned int width, unsigned int height, FrameCodec::PixelFormat format)
+        : uvPitch(static_cast<size_t>(FrameCodec::ChromaWidth(FrameCodec::GetChromaLayout(format), width)) * 2),
+          y(static_cast<size_t>(width) * height), uv(uvPitch * FrameCodec::ChromaHeight(FrameCodec::GetChromaLayout(format), height)) {}
+};
+
+// GB/s counts the BGRA side both ways, the frame the capture produces and the viewer shows
+void Time(unsigned int width, unsigned int height, FrameCodec::PixelFormat format, FrameCodec::ColorSpace space = FrameCodec::ColorSpace::BT601Full) {
+    constexpr unsigned int FRAMES = 20;
+    const size_t pitch = static_cast<size_t>(width) * 4 + 256;
+    std::vector<uint8_t> bgra(pitch * height);
+    std::mt19937 rng(45);
+    for (uint8_t& byte : bgra) byte = static_cast<uint8_t>(rng());
+    Planes planes(width, height, format);
+    const double bytes = static_cast<double>(width) * height * 4;
+
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 0u }) {
+            FrameCodec::YuvEncoder encoder(width, height, format, space, threads, level);
+            FrameCodec::YuvDecoder decoder(width, height, format, space, threads, level);
+            encoder.Encode(bgra.data(), pitch, planes.y.data(), width, planes.uv.data(), planes.uvPitch);
+            auto start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) encoder.Encode(bgra.data(), pitch, planes.y.data(), width, planes.uv.data(), planes.uvPitch);
+            const double encodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES;
+
+            decoder.Decode(planes.y.data(), width, planes.uv.data(), planes.uvPitch, bgra.data(), pitch);
+            start = Clock::now();
+            for (unsigned int i = 0; i < FRAMES; ++i) decoder.Decode(planes.y.data(), width, planes.uv.data(), planes.uvPitch, bgra.data(), pitch);
+            const double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / FRAMES;
+
+            const unsigned int cores = encoder.GetThreadCount();
+            std::cout << "  " << width << "x" << height << " " << FormatName(format) << " " << FrameCodec::GetYuvMatrix(space).name << " " << FrameCodec::SimdLevelName(level) << ", " << cores << " thread(s): encode "
+                      << encodeMs << "ms (" << bytes / encodeMs / 1e6 / cores << "GB/s per core), decode " << decodeMs << "ms ("
+                      << bytes / decodeMs / 1e6 / cores << "GB/s per core)" << std::endl;
+            if (std::thread::hardware_concurrency() <= 1) break; // 0 threads is 1 again
+        }
+    }
+}
+
+int main() {
+    std::cout << "Detected: " << FrameCodec::SimdLevelName(FrameCodec::DetectSimdLevel()) << std::endl;
+    std::cout << "Time per frame:" << std::endl;
+    for (FrameCodec::PixelFormat format : FORMATS) {
+        Time(1920, 1080, format);
+        Time(2560, 1440, format);
+        Time(3840, 2160, format);
+    }
+    for (size_t i = 1; i < std::size(SPACES); ++i) Time(1920, 1080, FrameCodec::PixelFormat::YUV420, SPACES[i]);
+    return 0;
+}
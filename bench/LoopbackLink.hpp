@@ -0,0 +1,106 @@
+#ifndef LOOPBACKLINK_HPP
+#define LOOPBACKLINK_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// In-process stand-in for an RDMA connection. Posted operations are carried out in order by a
+// "wire" thread that charges bytes / bandwidth of serialisation plus a fixed one-way latency,
+// then copies the bytes and runs the completion. Like a NIC, serialisation of the next operation
+// overlaps the latency of the previous one. Yields instead of sleeping so microsecond timings hold.
+class LoopbackLink {
+    public:
+    using Clock = std::chrono::steady_clock;
+
+    LoopbackLink(double gbitPerSecond, std::chrono::nanoseconds latency) :
+        m_NsPerByte(8.0 / gbitPerSecond), m_Latency(latency), m_Wire(&LoopbackLink::Run, this) {}
+
+    ~LoopbackLink() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Cv.notify_all();
+        m_Wire.join();
+    }
+
+    // RDMA write or read alike: `bytes` move from `src` to `dst`, then `done` runs on the wire thread
+    void Post(void* dst, const void* src, size_t bytes, std::function<void()> done = {}) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.push_back({ dst, src, bytes, std::move(done), Clock::now() });
+        }
+        m_Cv.notify_one();
+    }
+
+    // Blocks until every posted operation has completed
+    void Drain() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Cv.wait(lock, [this] { return m_Queue.empty() && !m_Busy; });
+    }
+
+    // Wire time of `bytes` alone, without latency
+    std::chrono::nanoseconds SerialisationTime(size_t bytes) const {
+        return std::chrono::nanoseconds(static_cast<long long>(bytes * m_NsPerByte));
+    }
+
+    private:
+    struct Operation {
+        void* dst;
+        const void* src;
+        size_t bytes;
+        std::function<void()> done;
+        Clock::time_point posted;
+    };
+
+    void Run() {
+        Clock::time_point wireFree = Clock::now();
+
+        while (true) {
+            Operation op;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Cv.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+                if (m_Queue.empty()) return;
+                op = std::move(m_Queue.front());
+                m_Queue.pop_front();
+                m_Busy = true;
+            }
+
+            const Clock::time_point start = std::max(op.posted, wireFree);
+            wireFree = start + SerialisationTime(op.bytes);
+            const Clock::time_point arrival = wireFree + m_Latency;
+            while (Clock::now() < arrival) std::this_thread::yield();
+
+            memcpy(op.dst, op.src, op.bytes);
+            if (op.done) op.done();
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Busy = false;
+            }
+            m_Cv.notify_all();
+        }
+    }
+
+    double m_NsPerByte;
+    std::chrono::nanoseconds m_Latency;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Cv;
+    std::deque<Operation> m_Queue;
+    bool m_Busy = false;
+    bool m_Stop = false;
+
+    std::thread m_Wire;
+};
+
+#endif
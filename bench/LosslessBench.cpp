@@ -0,0 +1,210 @@
+#include "CaptureFile.hpp"
+#include "CaptureRegion.hpp"
+#include "SyntheticSource.hpp"
+#include "TileCodec.hpp"
+#include "TileDelta.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The lossless tile codec on recorded desktop captures. Synthetic sessions are recorded into capture files first,
+// as a capture would; capture files given on the command line are played instead. Every frame is coded as a
+// keyframe, one tile at a time on one thread, for the ratio and GB/s per core, then run through the lossless tile
+// deltas at every thread count against the plain ones. tests/LosslessTileTest.cpp checks the streams come back
+// exact, corrupt ones are refused, and the thread count changes no byte.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t WIDTH = 1920;
+constexpr uint16_t HEIGHT = 1080;
+constexpr uint16_t REFRESH_RATE = 60;
+constexpr unsigned int FRAMES = 60;
+constexpr unsigned int THREAD_COUNTS[] = { 1, 2, 4, 8 };
+
+bool Record(const std::filesystem::path& path, FrameCodec::SyntheticContent content) {
+    FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, content, 43);
+    FrameCodec::CaptureWriter writer(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::CaptureEncoding::Delta);
+    if (!writer.Open(path.string())) return false;
+
+    auto next = Clock::now();
+    for (unsigned int n = 0; n < FRAMES; ++n) {
+        // A static desktop has nothing new after its first frame, as the duplication would report it
+        FrameCodec::SourceFrame frame;
+        if (source.Acquire(0, frame) == FrameCodec::AcquireResult::Frame) writer.Append(frame.pixels, frame.pitch, frame.captureTime);
+        next += std::chrono::microseconds(1000000 / REFRESH_RATE);
+        std::this_thread::sleep_until(next);
+    }
+    return writer.Close() && writer.GetWritten() > 0;
+}
+
+// Calls body(frame) with every frame of `path`, tightly packed
+template <typename Body>
+size_t Replay(const std::string& path, uint16_t& width, uint16_t& height, const Body& body) {
+    FrameCodec::CaptureReader reader(false, false);
+    if (!reader.Open(path)) return 0;
+    width = reader.GetWidth();
+    height = reader.GetHeight();
+
+    std::vector<uint8_t> packed(static_cast<size_t>(width) * height * 4);
+    size_t frames = 0;
+    FrameCodec::SourceFrame frame;
+    while (reader.Acquire(0, frame) == FrameCodec::AcquireResult::Frame) {
+        FrameCodec::PackRegion(frame.pixels, frame.pitch, { 0, 0, width, height }, packed.data());
+        reader.Release();
+        body(packed.data());
+        frames++;
+    }
+    return frames;
+}
+
+struct Keyframes {
+    size_t raw = 0;
+    size_t coded = 0;
+    size_t stored = 0; // Tiles that didn't code smaller
+    size_t tiles = 0;
+    double encodeSeconds = 0;
+    double decodeSeconds = 0;
+
+    std::vector<uint8_t> streams; // One worst-case slot per tile
+    std::vector<size_t> sizes;
+    std::vector<uint8_t> decoded;
+};
+
+// Every tile of the frame, coded on its own as the first frame of a session would be
+void CodeKeyframe(const uint8_t* frame, uint16_t width, uint16_t height, Keyframes& result) {
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    const unsigned int tilesX = FrameCodec::TilesX(width);
+    const unsigned int tilesY = FrameCodec::TilesY(height);
+    std::vector<uint8_t>& streams = result.streams;
+    std::vector<size_t>& sizes = result.sizes;
+    std::vector<uint8_t>& decoded = result.decoded;
+    streams.resize(FrameCodec::MaxLosslessTileSize(FrameCodec::TILE_SIZE, FrameCodec::TILE_SIZE) * tilesX * tilesY);
+    sizes.resize(static_cast<size_t>(tilesX) * tilesY);
+    decoded.assign(pitch * height, 0);
+
+    auto Tile = [&](unsigned int index, unsigned int& x0, unsigned int& y0, unsigned int& w, unsigned int& h) {
+        x0 = (index % tilesX) * FrameCodec::TILE_SIZE;
+        y0 = (index / tilesX) * FrameCodec::TILE_SIZE;
+        w = std::min<unsigned int>(FrameCodec::TILE_SIZE, width - x0);
+        h = std::min<unsigned int>(FrameCodec::TILE_SIZE, height - y0);
+    };
+    const size_t slot = FrameCodec::MaxLosslessTileSize(FrameCodec::TILE_SIZE, FrameCodec::TILE_SIZE);
+
+    const auto encodeStart = Clock::now();
+    for (unsigned int i = 0; i < sizes.size(); ++i) {
+        unsigned int x0, y0, w, h;
+        Tile(i, x0, y0, w, h);
+        sizes[i] = FrameCodec::EncodeLosslessTile(frame + y0 * pitch + x0 * 4, pitch, w, h, streams.data() + i * slot);
+    }
+    const auto decodeStart = Clock::now();
+    for (unsigned int i = 0; i < sizes.size(); ++i) {
+        unsigned int x0, y0, w, h;
+        Tile(i, x0, y0, w, h);
+        FrameCodec::DecodeLosslessTile(streams.data() + i * slot, sizes[i], w, h, decoded.data() + y0 * pitch + x0 * 4, pitch);
+    }
+    const auto end = Clock::now();
+
+    result.encodeSeconds += std::chrono::duration<double>(decodeStart - encodeStart).count();
+    result.decodeSeconds += std::chrono::duration<double>(end - decodeStart).count();
+    result.raw += pitch * height;
+    result.tiles += sizes.size();
+    for (unsigned int i = 0; i < sizes.size(); ++i) {
+        unsigned int x0, y0, w, h;
+        Tile(i, x0, y0, w, h);
+        result.coded += sizes[i];
+        if (sizes[i] == FrameCodec::MaxLosslessTileSize(w, h)) result.stored++;
+    }
+}
+
+struct Session {
+    size_t bytes = 0;
+    double encodeSeconds = 0;
+    double decodeSeconds = 0;
+};
+
+// The recording through a DeltaEncoder and DeltaDecoder pair, as a raw push session sends it
+Session RunSession(const std::string& path, bool lossless, unsigned int threads) {
+    Session session;
+    uint16_t width = 0, height = 0;
+    std::unique_ptr<FrameCodec::DeltaEncoder> encoder;
+    std::unique_ptr<FrameCodec::DeltaDecoder> decoder;
+    std::vector<uint8_t> payload;
+
+    Replay(path, width, height, [&](const uint8_t* frame) {
+        if (!encoder) {
+            encoder = std::make_unique<FrameCodec::DeltaEncoder>(width, height);
+            decoder = std::make_unique<FrameCodec::DeltaDecoder>(width, height);
+            encoder->SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+            decoder->SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+            encoder->EnableLossless(lossless, threads);
+            decoder->EnableLossless(lossless, threads);
+            payload.resize(FrameCodec::MaxDeltaSize(width, height, lossless));
+        }
+        const auto encodeStart = Clock::now();
+        const size_t length = encoder->Encode(frame, payload.data());
+        const auto decodeStart = Clock::now();
+        decoder->Decode(payload.data(), length);
+        session.decodeSeconds += std::chrono::duration<double>(Clock::now() - decodeStart).count();
+        session.encodeSeconds += std::chrono::duration<double>(decodeStart - encodeStart).count();
+        session.bytes += length;
+    });
+    return session;
+}
+
+int main(int argc, char* argv[]) {
+    // Recordings to play: the ones given, or synthetic sessions recorded here
+    std::vector<std::string> paths;
+    std::vector<std::string> names;
+    std::vector<std::filesystem::path> recorded;
+    for (int i = 1; i < argc; ++i) {
+        paths.push_back(argv[i]);
+        names.push_back(std::filesystem::path(argv[i]).filename().string());
+    }
+    if (paths.empty()) {
+        // CursorOnly is left out: the pointer is not in the frames, so it records as StaticDesktop does
+        for (FrameCodec::SyntheticContent content : { FrameCodec::SyntheticContent::StaticDesktop, FrameCodec::SyntheticContent::ScrollingText,
+                                                      FrameCodec::SyntheticContent::VideoNoise }) {
+            const std::filesystem::path path = std::filesystem::temp_directory_path() / (std::string("lossless_bench_") + FrameCodec::SyntheticContentName(content) + ".ndrc");
+            if (!Record(path, content)) {
+                std::cout << "could not record " << path << std::endl;
+                return 1;
+            }
+            recorded.push_back(path);
+            paths.push_back(path.string());
+            names.push_back(FrameCodec::SyntheticContentName(content));
+        }
+    }
+
+    std::cout << "lossless tile codec, " << THREAD_COUNTS[0] << " thread for the per-core figures, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    for (size_t n = 0; n < paths.size(); ++n) {
+        Keyframes keyframes;
+        uint16_t width = 0, height = 0;
+        const size_t frames = Replay(paths[n], width, height, [&](const uint8_t* frame) { CodeKeyframe(frame, width, height, keyframes); });
+        if (frames == 0) {
+            std::cout << names[n] << " | could not play " << paths[n] << std::endl;
+            continue;
+        }
+
+        std::cout << names[n] << " | " << frames << " frames at " << width << "x" << height << std::endl;
+        std::cout << "  keyframes | ratio " << static_cast<double>(keyframes.raw) / keyframes.coded << "x, "
+                  << keyframes.stored * 100 / std::max<size_t>(keyframes.tiles, 1) << "% of tiles stored"
+                  << " | encode " << keyframes.raw / keyframes.encodeSeconds / 1e9 << " GB/s, decode " << keyframes.raw / keyframes.decodeSeconds / 1e9 << " GB/s per core" << std::endl;
+
+        const Session plain = RunSession(paths[n], false, 0);
+        std::cout << "  deltas    | raw tiles " << plain.bytes / frames / 1024 << "KB/frame, encode " << plain.encodeSeconds * 1000 / frames << "ms" << std::endl;
+
+        for (unsigned int threads : THREAD_COUNTS) {
+            const Session lossless = RunSession(paths[n], true, threads);
+            std::cout << "            | lossless " << threads << "t " << lossless.bytes / frames / 1024 << "KB/frame ("
+                      << static_cast<double>(plain.bytes) / std::max<size_t>(lossless.bytes, 1) << "x smaller), encode "
+                      << lossless.encodeSeconds * 1000 / frames << "ms, decode " << lossless.decodeSeconds * 1000 / frames << "ms" << std::endl;
+        }
+    }
+
+    for (const std::filesystem::path& path : recorded) std::filesystem::remove(path);
+    return 0;
+}
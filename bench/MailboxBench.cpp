@@ -0,0 +1,80 @@
+#include "BenchHarness.hpp"
+
+#include "FrameMailbox.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// FrameMailbox under load: a producer publishes as fast as it can while the consumer takes frames at different
+// paces. Reports what a publish costs and how many frames the consumer gets; the handoff's correctness is
+// tests/FrameMailboxTest.cpp's job.
+using Clock = std::chrono::steady_clock;
+
+struct Pace {
+    const char* name;
+    size_t words;                        // Slot size in 64-bit words
+    std::chrono::microseconds consumerWork;
+    bool producerYields;                 // Forces interleaving when both threads share a core
+};
+
+static void Run(const Pace& pace, uint64_t frames) {
+    std::array<std::vector<uint64_t>, FrameCodec::FrameMailbox::SLOTS> slots;
+    for (auto& slot : slots) slot.assign(pace.words, 0);
+
+    FrameCodec::FrameMailbox mailbox;
+    uint64_t taken = 0;
+
+    std::thread consumer([&] {
+        while (mailbox.WaitAndTake()) {
+            // Reads the whole slot, as the network stage would
+            const std::vector<uint64_t>& slot = slots[mailbox.GetReadSlot()];
+            KeepResult(std::accumulate(slot.begin(), slot.end(), uint64_t(0)));
+            taken++;
+
+            if (pace.consumerWork.count() > 0) std::this_thread::sleep_for(pace.consumerWork);
+        }
+    });
+
+    std::vector<uint32_t> publishNs;
+    publishNs.reserve(frames);
+    const auto start = Clock::now();
+    for (uint64_t sequence = 1; sequence <= frames; ++sequence) {
+        std::vector<uint64_t>& slot = slots[mailbox.GetWriteSlot()];
+        std::fill(slot.begin(), slot.end(), sequence);
+
+        const auto publishStart = Clock::now();
+        mailbox.Publish();
+        publishNs.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - publishStart).count()));
+        if (pace.producerYields) std::this_thread::yield();
+    }
+    mailbox.Close();
+    consumer.join();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+
+    std::sort(publishNs.begin(), publishNs.end());
+
+    std::cout << pace.name << " | " << frames << " frames in " << elapsed.count() << "ms"
+              << " | taken: " << taken << " | dropped: " << mailbox.GetDropped()
+              << " | publish p50: " << publishNs[publishNs.size() / 2] << "ns"
+              << " p99.9: " << publishNs[publishNs.size() * 999 / 1000] << "ns"
+              << " max: " << publishNs.back() << "ns" << std::endl;
+}
+
+int main() {
+    const Pace paces[] = {
+        { "tiny slots, free-running          ", 8, std::chrono::microseconds(0), false },
+        { "tiny slots, interleaved           ", 8, std::chrono::microseconds(0), true },
+        { "64KB slots, interleaved           ", 8192, std::chrono::microseconds(0), true },
+        { "64KB slots, slow consumer (200us) ", 8192, std::chrono::microseconds(200), false },
+        { "8MB slots, slow consumer (2ms)    ", 1 << 20, std::chrono::microseconds(2000), false },
+    };
+    const uint64_t frames[] = { 2000000, 500000, 100000, 200000, 2000 };
+
+    for (size_t i = 0; i < std::size(paces); ++i) Run(paces[i], frames[i]);
+    return 0;
+}
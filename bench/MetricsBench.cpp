@@ -0,0 +1,98 @@
+#include "Metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Hammers the metrics registry from several threads the way the capture, send and receive loops do, against a
+// mutex-guarded and a shared-atomic counter, with the exporter publishing and a monitor reading its segment.
+// tests/MetricsTest.cpp checks no update is lost and the segment and JSON file read back exact.
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned int THREADS = 4;
+constexpr uint64_t UPDATES = 2000000; // Per thread
+constexpr uint64_t RECORD_RANGE = 1000; // Histogram values cycle through [0, RECORD_RANGE)
+
+// ns per update with `threads` threads each running `body` UPDATES times
+template <typename Body>
+double Hammer(unsigned int threads, Body body) {
+    std::vector<std::thread> workers;
+    const auto start = Clock::now();
+    for (unsigned int t = 0; t < threads; ++t) {
+        workers.emplace_back([&body]() {
+            for (uint64_t i = 0; i < UPDATES; ++i) body(i);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (static_cast<double>(UPDATES) * threads);
+}
+
+int main() {
+    const FrameCodec::Counter counter("bench.updates");
+    const FrameCodec::Histogram histogram("bench.latency_us");
+    const FrameCodec::Gauge gauge("bench.threads");
+
+    const std::string segment = "ndrc-metrics-bench-" + std::to_string(getpid());
+    const std::filesystem::path jsonPath = std::filesystem::temp_directory_path() / (segment + ".json");
+    FrameCodec::MetricsExporter exporter(segment, jsonPath.string(), std::chrono::milliseconds(10));
+    if (!exporter.Start()) return 1;
+
+    FrameCodec::SharedMetricsReader reader;
+    if (!reader.Open(segment)) return 1;
+
+    // A monitor reading the segment the whole time, as a dashboard would
+    std::atomic<bool> stop = false;
+    uint64_t reads = 0;
+    uint64_t failedReads = 0;
+    std::thread monitor([&]() {
+        FrameCodec::SharedMetricsHeader header;
+        std::vector<FrameCodec::SharedMetric> metrics;
+        while (!stop.load()) {
+            if (!reader.Read(header, metrics)) {
+                failedReads++;
+                continue;
+            }
+            reads++;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+
+    gauge.Set(THREADS);
+    const double registryNs = Hammer(THREADS, [&](uint64_t i) {
+        counter.Add();
+        histogram.Record(i % RECORD_RANGE);
+    });
+
+    std::mutex mutex;
+    uint64_t locked = 0;
+    const double mutexNs = Hammer(THREADS, [&](uint64_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        locked++;
+    });
+
+    std::atomic<uint64_t> shared = 0;
+    const double atomicNs = Hammer(THREADS, [&](uint64_t) { shared.fetch_add(1, std::memory_order_relaxed); });
+    const double singleNs = Hammer(1, [&](uint64_t) { counter.Add(0); });
+
+    stop.store(true);
+    monitor.join();
+    exporter.Stop();
+    std::filesystem::remove(jsonPath);
+
+    std::cout << "Per update, " << THREADS << " threads: registry " << registryNs << "ns (counter + histogram), mutex " << mutexNs
+              << "ns, shared atomic " << atomicNs << "ns; registry on one thread " << singleNs << "ns" << std::endl;
+    std::cout << "Monitor: " << reads << " consistent reads, " << failedReads << " gave up while the exporter wrote" << std::endl;
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "OutputLayout.hpp"
+#include "OutputScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Several outputs at their own refresh rates sharing one link, simulated in discrete time: each source captures on
+// its own clock into a latest-wins mailbox, and the link sends one frame at a time for as long as that output's
+// frames take. OutputScheduler's earliest-deadline pick is compared against always sending the fastest output first;
+// tests/OutputSchedulerTest.cpp holds it to not starving any output.
+constexpr uint64_t MS = 1000000;
+constexpr uint64_t RUN = 10000 * MS;
+
+struct Source {
+    uint16_t refreshRate;
+    uint64_t cost; // Link time per frame
+};
+
+struct Result {
+    std::vector<uint64_t> captured;
+    std::vector<uint64_t> delivered;
+    std::vector<uint64_t> dropped;
+    std::vector<uint64_t> late;
+};
+
+// Sends the lowest-numbered ready output, i.e. the one listed with the highest rate
+class FixedPriority {
+    public:
+    explicit FixedPriority(unsigned int count) : m_ReadySince(count, 0) {}
+
+    void MarkReady(unsigned int output, uint64_t time) {
+        if (m_ReadySince[output] == 0) m_ReadySince[output] = time;
+    }
+
+    int TakeNext(uint64_t) {
+        for (unsigned int i = 0; i < m_ReadySince.size(); ++i) {
+            if (m_ReadySince[i] == 0) continue;
+            m_ReadySince[i] = 0;
+            return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    private:
+    std::vector<uint64_t> m_ReadySince;
+};
+
+template <typename Policy>
+static Result Simulate(const std::vector<Source>& sources, Policy& policy) {
+    const size_t count = sources.size();
+    Result result = { std::vector<uint64_t>(count), std::vector<uint64_t>(count), std::vector<uint64_t>(count), std::vector<uint64_t>(count) };
+    std::vector<uint64_t> nextCapture(count);
+    std::vector<uint64_t> readySince(count, 0);
+    for (size_t i = 0; i < count; ++i) nextCapture[i] = 1 + i * MS; // Out of phase, and never 0, which means "nothing ready"
+
+    uint64_t now = 1;
+    uint64_t busyUntil = 1;
+    while (now < RUN) {
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t interval = 1000000000ULL / sources[i].refreshRate;
+            while (nextCapture[i] <= now) {
+                if (readySince[i]) result.dropped[i]++;
+                else readySince[i] = nextCapture[i];
+                policy.MarkReady(static_cast<unsigned int>(i), nextCapture[i]);
+                result.captured[i]++;
+                nextCapture[i] += interval;
+            }
+        }
+
+        if (now >= busyUntil) {
+            const int next = policy.TakeNext(now);
+            if (next >= 0) {
+                if (now > readySince[next] + 1000000000ULL / sources[next].refreshRate) result.late[next]++;
+                readySince[next] = 0;
+                result.delivered[next]++;
+                busyUntil = now + sources[next].cost;
+            }
+        }
+
+        uint64_t nextEvent = *std::min_element(nextCapture.begin(), nextCapture.end());
+        if (busyUntil > now) nextEvent = std::min(nextEvent, busyUntil);
+        now = nextEvent;
+    }
+    return result;
+}
+
+static void Report(const char* name, const std::vector<Source>& sources, const Result& result) {
+    std::cout << "  " << name << std::endl;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const double seconds = static_cast<double>(RUN) / 1e9;
+        std::cout << "    output " << i << " @ " << sources[i].refreshRate << "Hz"
+                  << " | delivered: " << static_cast<int>(result.delivered[i] / seconds) << " fps"
+                  << " | dropped: " << result.dropped[i]
+                  << " | late: " << result.late[i] << std::endl;
+    }
+}
+
+// The real thing with threads: sources sleeping out their refresh interval, one sender waiting on the scheduler
+static void Threaded(const std::vector<Source>& sources) {
+    FrameCodec::OutputScheduler scheduler(static_cast<unsigned int>(sources.size()));
+    for (unsigned int i = 0; i < sources.size(); ++i) scheduler.SetRefreshRate(i, sources[i].refreshRate);
+
+    std::vector<uint64_t> sent(sources.size(), 0);
+    std::thread sender([&]() {
+        int next;
+        while ((next = scheduler.WaitNext()) >= 0) sent[next]++;
+    });
+
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> captures;
+    for (unsigned int i = 0; i < sources.size(); ++i) {
+        captures.emplace_back([&, i]() {
+            const auto interval = std::chrono::nanoseconds(1000000000LL / sources[i].refreshRate);
+            auto next = std::chrono::steady_clock::now();
+            while (!stop.load()) {
+                next += interval;
+                std::this_thread::sleep_until(next);
+                scheduler.MarkReady(i, FrameCodec::FrameClockNow());
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop.store(true);
+    for (std::thread& capture : captures) capture.join();
+    scheduler.Close();
+    sender.join();
+
+    std::cout << "  threaded, 500ms:";
+    for (unsigned int i = 0; i < sources.size(); ++i) {
+        std::cout << " output " << i << " sent " << sent[i] << ", " << scheduler.GetLate(i) << " late" << (i + 1 < sources.size() ? "," : "");
+    }
+    std::cout << std::endl;
+}
+
+int main() {
+    // Link time per frame as a mostly static desktop's tile deltas would take it; 85% of the link in total
+    const std::vector<Source> underloaded = { { 144, 3 * MS }, { 60, 5 * MS }, { 30, 4 * MS } };
+    // Half as much again: the link can't keep up with all three
+    std::vector<Source> overloaded = underloaded;
+    for (Source& source : overloaded) source.cost = source.cost * 3 / 2;
+
+    for (const auto& [name, sources] : { std::make_pair("Underloaded", underloaded), std::make_pair("Overloaded", overloaded) }) {
+        double load = 0;
+        for (const Source& source : sources) load += static_cast<double>(source.cost) * source.refreshRate / 1e9;
+        std::cout << name << " link (" << static_cast<int>(load * 100) << "%)" << std::endl;
+
+        FrameCodec::OutputScheduler edf(static_cast<unsigned int>(sources.size()));
+        for (unsigned int i = 0; i < sources.size(); ++i) edf.SetRefreshRate(i, sources[i].refreshRate);
+        const Result scheduled = Simulate(sources, edf);
+        Report("earliest deadline", sources, scheduled);
+
+        FixedPriority fixed(static_cast<unsigned int>(sources.size()));
+        const Result prioritized = Simulate(sources, fixed);
+        Report("fixed priority", sources, prioritized);
+    }
+
+    Threaded(underloaded);
+    return 0;
+}
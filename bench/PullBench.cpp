@@ -0,0 +1,228 @@
+#include "FrameHeader.hpp"
+#include "PullProtocol.hpp"
+#include "LoopbackLink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Push (the client writes each frame once the server's flag says it is ready) against pull (the server
+// RDMA-reads the newest published frame whenever it can present) over a loopback link. The capture side
+// produces frames at a fixed refresh rate; the viewer's render time is slept, as a GPU-bound present would be.
+// Latency is capture to present, so frames that waited behind a slow render show up directly.
+using Clock = std::chrono::steady_clock;
+
+struct Scenario {
+    const char* name;
+    std::chrono::microseconds render;
+    std::chrono::microseconds jitter;
+};
+
+struct Result {
+    std::vector<std::chrono::microseconds> latencies;
+    unsigned long long published = 0;
+    unsigned long long torn = 0;
+};
+
+constexpr unsigned short WIDTH = 2560;
+constexpr unsigned short HEIGHT = 1440;
+constexpr unsigned int REFRESH_RATE = 144;
+constexpr double LINK_GBPS = 25.0;
+constexpr auto RUN_TIME = std::chrono::seconds(3);
+
+static const size_t PAYLOAD_SIZE = static_cast<size_t>(WIDTH) * HEIGHT * 2; // YUV440
+static const size_t SLOT_SIZE = FrameCodec::FrameSlotSize(PAYLOAD_SIZE);
+
+static std::chrono::microseconds Percentile(std::vector<std::chrono::microseconds> samples, double q) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(q * (samples.size() - 1))];
+}
+
+// Posts and waits for completion, like TestServer::ReadRemote() and TestClient::AsyncWrite()
+static void Transfer(LoopbackLink& link, void* dst, const void* src, size_t bytes) {
+    std::atomic<bool> done = false;
+    link.Post(dst, src, bytes, [&] { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+// Sleeps to the next refresh like AcquireNextFrame(); refreshes missed while busy are skipped
+static Clock::time_point NextVSync(Clock::time_point& vsync) {
+    const auto period = std::chrono::nanoseconds(1000000000 / REFRESH_RATE);
+    const auto now = Clock::now();
+    while (vsync <= now) vsync += period;
+    std::this_thread::sleep_until(vsync);
+    return vsync;
+}
+
+static void Render(const Scenario& scenario, std::mt19937& rng) {
+    std::uniform_int_distribution<long long> jitter(-scenario.jitter.count(), scenario.jitter.count());
+    std::this_thread::sleep_for(scenario.render + std::chrono::microseconds(jitter(rng)));
+}
+
+static uint64_t Present(const FrameCodec::FrameHeader& header) {
+    return FrameCodec::FrameClockNow() - header.captureTime;
+}
+
+static Result RunPush(const Scenario& scenario, const std::vector<uint8_t>& frame) {
+    Result result;
+    LoopbackLink link(LINK_GBPS, std::chrono::microseconds(3));
+
+    std::vector<uint8_t> sendBuffers[2] = { std::vector<uint8_t>(SLOT_SIZE), std::vector<uint8_t>(SLOT_SIZE) };
+    std::vector<uint8_t> recvBuffer(SLOT_SIZE);
+    std::vector<uint8_t> texture(PAYLOAD_SIZE);
+
+    std::atomic<bool> ready = false;        // The server's flag
+    std::atomic<uint64_t> arrived = 0;      // Last sequence whose write completed
+    std::atomic<bool> stop = false;
+
+    std::thread receiver([&] {
+        std::mt19937 rng(7);
+        uint64_t shown = 0;
+        while (!stop.load()) {
+            ready.store(true, std::memory_order_release);
+            while (arrived.load(std::memory_order_acquire) == shown && !stop.load()) std::this_thread::yield();
+            if (stop.load()) break;
+
+            const auto* header = reinterpret_cast<const FrameCodec::FrameHeader*>(recvBuffer.data() + FrameCodec::FRAME_HEADER_OFFSET);
+            shown = header->sequence;
+            memcpy(texture.data(), FrameCodec::GetFramePayload(header), PAYLOAD_SIZE);
+            Render(scenario, rng);
+            result.latencies.push_back(std::chrono::microseconds(Present(*header) / 1000));
+        }
+    });
+
+    // Mirrors TestClient::CompressLoop(): capture and copy the next frame while the previous write waits for the flag
+    bool index = 0;
+    uint64_t sequence = 1;
+    std::future<void> write;
+    Clock::time_point vsync = Clock::now();
+    const auto end = Clock::now() + RUN_TIME;
+
+    while (Clock::now() < end) {
+        NextVSync(vsync);
+        uint8_t* buffer = sendBuffers[index].data();
+        FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, sequence++,
+                                                                       FrameCodec::PixelFormat::YUV440, FrameCodec::PayloadEncoding::Planar, WIDTH, HEIGHT);
+        header->captureTime = FrameCodec::FrameClockNow();
+        memcpy(buffer + FrameCodec::FRAME_PAYLOAD_OFFSET, frame.data(), PAYLOAD_SIZE);
+        FrameCodec::SealFrameHeader(header, static_cast<uint32_t>(PAYLOAD_SIZE), false);
+
+        if (write.valid()) write.get();
+        write = std::async(std::launch::async, [&, buffer, seq = header->sequence] {
+            while (!ready.load(std::memory_order_acquire)) {
+                if (stop.load()) return;
+                std::this_thread::yield();
+            }
+            ready.store(false);
+            Transfer(link, recvBuffer.data(), buffer, FrameCodec::FRAME_PAYLOAD_OFFSET + PAYLOAD_SIZE);
+            arrived.store(seq, std::memory_order_release);
+        });
+        result.published++;
+        index = !index;
+    }
+
+    stop.store(true);
+    if (write.valid()) write.get();
+    receiver.join();
+    link.Drain();
+    return result;
+}
+
+static Result RunPull(const Scenario& scenario, const std::vector<uint8_t>& frame) {
+    Result result;
+    LoopbackLink link(LINK_GBPS, std::chrono::microseconds(3));
+
+    // Stands in for the client's registered buffer; the wire thread copies out of it while the publisher writes
+    std::vector<uint8_t> sendBuffer(FrameCodec::PullBufferSize(SLOT_SIZE));
+    std::vector<uint8_t> recvBuffer(SLOT_SIZE);
+    std::vector<uint8_t> texture(PAYLOAD_SIZE);
+    auto* control = reinterpret_cast<FrameCodec::PullControl*>(sendBuffer.data() + FrameCodec::PullControlOffset(SLOT_SIZE));
+    std::atomic<bool> stop = false;
+
+    // Mirrors TestServer::PullLoop()
+    std::thread receiver([&] {
+        std::mt19937 rng(7);
+        FrameCodec::PullControl seen = {};
+        uint64_t shown = 0;
+        while (!stop.load()) {
+            Transfer(link, &seen, control, sizeof(seen));
+            const uint64_t sequence = FrameCodec::LatestSequence(seen.latest);
+            const uint32_t slot = FrameCodec::LatestSlot(seen.latest);
+            if (sequence == 0 || sequence == shown) continue;
+
+            const size_t offset = FrameCodec::PullSlotOffset(slot, SLOT_SIZE) + FrameCodec::FRAME_HEADER_OFFSET;
+            Transfer(link, recvBuffer.data() + FrameCodec::FRAME_HEADER_OFFSET, sendBuffer.data() + offset,
+                     sizeof(FrameCodec::FrameHeader) + PAYLOAD_SIZE);
+            Transfer(link, &seen, control, sizeof(seen));
+            const auto* header = reinterpret_cast<const FrameCodec::FrameHeader*>(recvBuffer.data() + FrameCodec::FRAME_HEADER_OFFSET);
+            if (!FrameCodec::PullSlotIntact(seen, slot, sequence) || header->sequence != sequence) {
+                result.torn++;
+                continue;
+            }
+
+            shown = sequence;
+            memcpy(texture.data(), FrameCodec::GetFramePayload(header), PAYLOAD_SIZE);
+            Render(scenario, rng);
+            result.latencies.push_back(std::chrono::microseconds(Present(*header) / 1000));
+        }
+    });
+
+    FrameCodec::PullPublisher publisher(control);
+    uint64_t sequence = 1;
+    Clock::time_point vsync = Clock::now();
+    const auto end = Clock::now() + RUN_TIME;
+
+    while (Clock::now() < end) {
+        NextVSync(vsync);
+        const uint32_t slot = publisher.BeginSlot();
+        uint8_t* buffer = sendBuffer.data() + FrameCodec::PullSlotOffset(slot, SLOT_SIZE);
+        FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, sequence++,
+                                                                       FrameCodec::PixelFormat::YUV440, FrameCodec::PayloadEncoding::Planar, WIDTH, HEIGHT);
+        header->captureTime = FrameCodec::FrameClockNow();
+        memcpy(buffer + FrameCodec::FRAME_PAYLOAD_OFFSET, frame.data(), PAYLOAD_SIZE);
+        FrameCodec::SealFrameHeader(header, static_cast<uint32_t>(PAYLOAD_SIZE), false);
+        publisher.Publish(slot, header->sequence);
+        result.published++;
+    }
+
+    stop.store(true);
+    receiver.join();
+    link.Drain();
+    return result;
+}
+
+static void Print(const char* mode, const Scenario& scenario, const Result& result) {
+    const double seconds = std::chrono::duration<double>(RUN_TIME).count();
+    std::cout << scenario.name << " " << mode
+              << " | presented: " << static_cast<int>(result.latencies.size() / seconds) << "fps"
+              << " of " << static_cast<int>(result.published / seconds)
+              << " | p50: " << Percentile(result.latencies, 0.50).count() << "us"
+              << " | p99: " << Percentile(result.latencies, 0.99).count() << "us";
+    if (result.torn > 0) std::cout << " | torn: " << result.torn;
+    std::cout << std::endl;
+}
+
+int main() {
+    const Scenario scenarios[] = {
+        { "fast viewer  (3ms render)", std::chrono::microseconds(3000), std::chrono::microseconds(0) },
+        { "slow viewer (12ms render)", std::chrono::microseconds(12000), std::chrono::microseconds(0) },
+        { "busy viewer (12+-8ms)    ", std::chrono::microseconds(12000), std::chrono::microseconds(8000) },
+    };
+
+    std::vector<uint8_t> frame(PAYLOAD_SIZE);
+    std::mt19937 rng(42);
+    for (uint8_t& v : frame) v = static_cast<uint8_t>(rng());
+
+    std::cout << WIDTH << "x" << HEIGHT << " YUV440 @ " << REFRESH_RATE << "Hz over " << LINK_GBPS << "Gb/s" << std::endl;
+    for (const Scenario& scenario : scenarios) {
+        Print("push", scenario, RunPush(scenario, frame));
+        Print("pull", scenario, RunPull(scenario, frame));
+    }
+    return 0;
+}
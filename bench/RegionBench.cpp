@@ -0,0 +1,58 @@
+#include "BandLayout.hpp"
+#include "CaptureRegion.hpp"
+#include "ColorSpace.hpp"
+#include "SessionMode.hpp"
+#include "TileDelta.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Crops regions of a 4K output the way the client reads back a region or a window, and shows that copy time and the
+// delta stream follow the region's size rather than the output's. tests/CaptureRegionTest.cpp checks the kernel.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t OUTPUT_WIDTH = 3840;
+constexpr uint16_t OUTPUT_HEIGHT = 2160;
+constexpr size_t PITCH = OUTPUT_WIDTH * 4 + 256; // Staging textures pad their rows
+constexpr unsigned int FRAMES = 30;
+
+int main() {
+    std::mt19937 rng(39);
+    std::vector<uint8_t> output(PITCH * OUTPUT_HEIGHT);
+    for (uint8_t& byte : output) byte = static_cast<uint8_t>(rng());
+
+    const FrameCodec::CaptureRegion regions[] = {
+        { 0, 0, 0, 0 },             // The whole output
+        { 640, 360, 2560, 1440 },
+        { 1000, 500, 1280, 720 },
+        { 3, 7, 801, 599 },         // Odd origin and size, as a window may have
+        { 3500, 2000, 800, 600 },   // Dragged partly off the output
+    };
+
+    std::cout << "PackRegion, " << FRAMES << " frames each" << std::endl;
+    for (const FrameCodec::CaptureRegion& requested : regions) {
+        const FrameCodec::CaptureRegion region = FrameCodec::ClampRegion(requested, OUTPUT_WIDTH, OUTPUT_HEIGHT);
+
+        const size_t bytes = static_cast<size_t>(region.width) * region.height * 4;
+        std::vector<uint8_t> packed(bytes);
+
+        auto start = Clock::now();
+        for (unsigned int i = 0; i < FRAMES; ++i) FrameCodec::PackRegion(output.data(), PITCH, region, packed.data());
+        const double packUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / FRAMES;
+
+        // What the session lays out for the region, and the first frame's delta, which sends every tile
+        const FrameCodec::SessionMode mode = { region.width, region.height, 60, static_cast<uint16_t>(FrameCodec::PixelFormat::BGRA32),
+                                               FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, static_cast<uint16_t>(FrameCodec::ColorSpace::BT601Full) };
+        FrameCodec::DeltaEncoder encoder(region.width, region.height);
+        std::vector<uint8_t> delta(FrameCodec::MaxDeltaSize(region.width, region.height));
+        const size_t deltaBytes = encoder.Encode(packed.data(), delta.data());
+
+        std::cout << region.width << "x" << region.height << " at " << region.left << "," << region.top
+                  << " | copy: " << packUs << "us (" << bytes * 1e-3 / packUs << " GB/s)"
+                  << " | buffer: " << FrameCodec::SenderBufferSize(mode) / 1024 << "KB"
+                  << " | first frame: " << deltaBytes / 1024 << "KB" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "BandLayout.hpp"
+#include "BufferArena.hpp"
+#include "ColorSpace.hpp"
+#include "FrameHeader.hpp"
+#include "SessionMode.hpp"
+#include "TileDelta.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Replays a sequence of mode changes the way both ends apply them mid-session and times each switch: the
+// mode-change frame is encoded and parsed, each side's buffer is laid out through its BufferArena, and the codec
+// state is rebuilt. Registration itself needs an adapter, so a fresh allocation that is touched page by page
+// stands in for it. tests/RenegotiateTest.cpp checks that frames survive each switch.
+using Clock = std::chrono::steady_clock;
+
+struct Registration {
+    std::vector<uint8_t> storage;
+    uint8_t* base = nullptr;
+
+    void Register(size_t capacity) {
+        storage.assign(capacity + FrameCodec::FRAME_CACHE_LINE, 0);
+        const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+        base = storage.data() + (FrameCodec::FRAME_CACHE_LINE - address % FrameCodec::FRAME_CACHE_LINE) % FrameCodec::FRAME_CACHE_LINE;
+    }
+};
+
+struct Side {
+    FrameCodec::BufferArena arena;
+    Registration buffer;
+
+    // Returns whether the registration had to grow
+    bool Layout(size_t bytes) {
+        const size_t capacity = arena.Reserve(bytes);
+        if (capacity) buffer.Register(capacity);
+        else memset(buffer.base, 0, arena.GetCapacity());
+        return capacity != 0;
+    }
+};
+
+static const char* ModeName(const FrameCodec::SessionMode& mode) {
+    switch (static_cast<FrameCodec::PixelFormat>(mode.format)) {
+        case FrameCodec::PixelFormat::YUV440: return "YUV440";
+        case FrameCodec::PixelFormat::YUV420: return "YUV420";
+        case FrameCodec::PixelFormat::YUV422: return "YUV422";
+        default: return "raw";
+    }
+}
+
+// The sender's announcement, written into its slot and read back the way the receiver does
+static bool SendModeChange(Side& sender, Side& receiver, const FrameCodec::SessionMode& mode, uint64_t sequence) {
+    FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(sender.buffer.base + FrameCodec::FRAME_HEADER_OFFSET, sequence,
+                                                                   FrameCodec::PixelFormat::BGRA32, FrameCodec::PayloadEncoding::TileDelta, mode.width, mode.height);
+    header->flags = FrameCodec::FRAME_FLAG_MODE_CHANGE;
+    memcpy(sender.buffer.base + FrameCodec::FRAME_PAYLOAD_OFFSET, &mode, sizeof(mode));
+    FrameCodec::SealFrameHeader(header, sizeof(mode), true);
+    memcpy(receiver.buffer.base, sender.buffer.base, FrameCodec::FRAME_PAYLOAD_OFFSET + sizeof(mode));
+
+    FrameCodec::FrameHeaderStatus status;
+    const FrameCodec::FrameHeader* parsed = FrameCodec::ParseFrameHeader(receiver.buffer.base + FrameCodec::FRAME_HEADER_OFFSET,
+                                                                         FrameCodec::FRAME_HEADER_OFFSET + sizeof(mode), status);
+    if (!parsed || !(parsed->flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) || parsed->payloadSize != sizeof(mode)) return false;
+
+    FrameCodec::SessionMode received;
+    memcpy(&received, FrameCodec::GetFramePayload(parsed), sizeof(received));
+    return received == mode;
+}
+
+int main() {
+    constexpr uint16_t RAW = static_cast<uint16_t>(FrameCodec::PixelFormat::BGRA32);
+    constexpr uint16_t YUV440 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV440);
+    constexpr uint16_t YUV420 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV420);
+    constexpr uint16_t YUV422 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV422);
+    constexpr uint16_t BT601 = static_cast<uint16_t>(FrameCodec::ColorSpace::BT601Full);
+    constexpr uint16_t BT709 = static_cast<uint16_t>(FrameCodec::ColorSpace::BT709Limited);
+    const FrameCodec::SessionMode modes[] = {
+        { 1920, 1080, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 144, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 144, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT601 },
+        { 2560, 1440, 144, YUV420, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT709 },
+        { 1280, 720, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT601 },
+        { 2560, 1440, 60, YUV422, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT601 },
+        { 3840, 2160, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 3840, 2160, 60, YUV420, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+    };
+
+    Side sender;
+    Side receiver;
+    std::unique_ptr<FrameCodec::DeltaEncoder> encoder;
+    std::unique_ptr<FrameCodec::DeltaDecoder> decoder;
+    std::unique_ptr<FrameCodec::PlanarBands> bands;
+    uint64_t sequence = 0;
+
+    for (const FrameCodec::SessionMode& mode : modes) {
+        if (!FrameCodec::IsValidSessionMode(mode)) {
+            std::cout << "Invalid mode in the sequence" << std::endl;
+            return 1;
+        }
+
+        // The first mode is the handshake's; every later one is announced by the sender's last frame in the old mode
+        auto start = Clock::now();
+        if (sequence > 0 && !SendModeChange(sender, receiver, mode, sequence)) {
+            std::cout << "Mode change frame lost in the sequence" << std::endl;
+            return 1;
+        }
+        sequence++;
+
+        const bool senderGrew = sender.Layout(FrameCodec::SenderBufferSize(mode));
+        const bool receiverGrew = receiver.Layout(FrameCodec::ReceiverBufferSize(mode));
+
+        encoder.reset();
+        decoder.reset();
+        bands.reset();
+        const FrameCodec::PixelFormat format = static_cast<FrameCodec::PixelFormat>(mode.format);
+        if (FrameCodec::IsPlanarYuv(format)) {
+            bands = std::make_unique<FrameCodec::PlanarBands>(mode.width, mode.height, mode.bandCount, format);
+        } else {
+            encoder = std::make_unique<FrameCodec::DeltaEncoder>(mode.width, mode.height);
+            encoder->SetTileCache(mode.tileCacheSize);
+            decoder = std::make_unique<FrameCodec::DeltaDecoder>(mode.width, mode.height);
+            decoder->SetTileCache(mode.tileCacheSize);
+        }
+        const double switchMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::cout << mode.width << "x" << mode.height << " @ " << mode.refreshRate << "Hz " << ModeName(mode)
+                  << " | switch: " << switchMs << "ms"
+                  << " | sender " << (senderGrew ? "grown to " : "reused at ") << sender.arena.GetCapacity() / 1024 << "KB"
+                  << " | receiver " << (receiverGrew ? "grown to " : "reused at ") << receiver.arena.GetCapacity() / 1024 << "KB" << std::endl;
+    }
+
+    std::cout << "Registrations: sender " << sender.arena.GetRegistrations() << ", receiver " << receiver.arena.GetRegistrations()
+              << " | Reused: sender " << sender.arena.GetReuses() << ", receiver " << receiver.arena.GetReuses() << std::endl;
+    return 0;
+}
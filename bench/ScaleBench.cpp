@@ -0,0 +1,85 @@
+#include "AdaptiveScaler.hpp"
+#include "Downscale.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// BGRA downscale kernels against the scalar reference at the adaptive levels, then the level the
+// AdaptiveScaler settles on when a simulated link loses and regains bandwidth. tests/DownscaleTest.cpp checks both.
+using Clock = std::chrono::steady_clock;
+
+static void RunKernel(unsigned short width, unsigned short height, FrameCodec::ScaleLevel level, FrameCodec::ScaleFilter filter,
+                      const std::vector<uint8_t>& frame) {
+    const unsigned int dstWidth = FrameCodec::ScaledDimension(width, level);
+    const unsigned int dstHeight = FrameCodec::ScaledDimension(height, level);
+    const size_t srcPitch = static_cast<size_t>(width) * 4;
+    const size_t dstPitch = static_cast<size_t>(dstWidth) * 4;
+
+    FrameCodec::Downscaler scaler(width, height, dstWidth, dstHeight, filter);
+    std::vector<uint8_t> simd(dstPitch * dstHeight);
+    std::vector<uint8_t> reference(dstPitch * dstHeight);
+
+    const unsigned int runs = 20;
+    auto start = Clock::now();
+    for (unsigned int i = 0; i < runs; ++i) scaler.ScaleReference(frame.data(), srcPitch, reference.data(), dstPitch);
+    const double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / runs;
+
+    start = Clock::now();
+    for (unsigned int i = 0; i < runs; ++i) scaler.Scale(frame.data(), srcPitch, simd.data(), dstPitch);
+    const double simdMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / runs;
+
+    const double megapixels = static_cast<double>(width) * height / 1e6;
+    std::cout << width << "x" << height << " -> " << dstWidth << "x" << dstHeight
+              << (filter == FrameCodec::ScaleFilter::Box ? " box     " : " bilinear")
+              << " | scalar: " << referenceMs << "ms"
+              << " | " << FrameCodec::Downscaler::KernelName() << ": " << simdMs << "ms (" << static_cast<int>(megapixels / simdMs * 1000) << " Mpx/s)"
+              << " | x" << referenceMs / simdMs << std::endl;
+}
+
+// Raw frames cost roughly bytes / bandwidth on the wire; the link degrades in two steps and then recovers
+static void RunAdaptive() {
+    const unsigned short width = 2560;
+    const unsigned short height = 1440;
+    const uint16_t refreshRate = 60;
+    const double dirtyShare = 0.35; // Of each frame's tiles that change
+
+    FrameCodec::AdaptiveScaler scaler(refreshRate);
+    FrameCodec::ScaleLevel shown = scaler.GetLevel();
+    std::cout << "Adaptive, " << width << "x" << height << " @ " << refreshRate << "Hz, " << dirtyShare * 100 << "% of tiles dirty per frame" << std::endl;
+
+    for (unsigned int frame = 0; frame < 1800; ++frame) {
+        const double gbps = frame < 300 ? 25.0 : frame < 900 ? 2.0 : frame < 1200 ? 1.0 : 25.0;
+        const FrameCodec::ScaleLevel level = scaler.GetLevel();
+        const double bytes = FrameCodec::ScaledDimension(width, level) * static_cast<double>(FrameCodec::ScaledDimension(height, level)) * 4 * dirtyShare;
+        const double costNs = bytes * 8.0 / gbps + 1.5e6; // Wire time plus a fixed encode and flag round trip
+
+        scaler.Update(static_cast<uint64_t>(bytes), static_cast<uint64_t>(costNs));
+        if (frame == 300 || frame == 900 || frame == 1200) std::cout << "  frame " << frame << ": link now " << gbps << "Gb/s" << std::endl;
+        if (scaler.GetLevel() != shown) {
+            shown = scaler.GetLevel();
+            std::cout << "  frame " << frame << ": scale " << FrameCodec::ScaleLevelName(shown)
+                      << " (" << static_cast<int>(scaler.GetAverageCostNs() / 1000) << "us per frame expected)" << std::endl;
+        }
+    }
+    std::cout << "  switches: " << scaler.GetSwitches() << std::endl;
+}
+
+int main() {
+    const unsigned short resolutions[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    const FrameCodec::ScaleLevel levels[] = { FrameCodec::ScaleLevel::ThreeQuarter, FrameCodec::ScaleLevel::Half };
+    const FrameCodec::ScaleFilter filters[] = { FrameCodec::ScaleFilter::Box, FrameCodec::ScaleFilter::Bilinear };
+
+    std::mt19937 rng(42);
+    for (const auto& res : resolutions) {
+        std::vector<uint8_t> frame(static_cast<size_t>(res[0]) * res[1] * 4);
+        for (uint8_t& v : frame) v = static_cast<uint8_t>(rng());
+        for (FrameCodec::ScaleLevel level : levels) {
+            for (FrameCodec::ScaleFilter filter : filters) RunKernel(res[0], res[1], level, filter, frame);
+        }
+    }
+
+    RunAdaptive();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "TileDelta.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Synthetic browser-like page: static toolbar on top, scrollbar on the right, text lines in between.
+// Every frame scrolls the document by `step` rows, which is what a wheel scroll looks like on the wire.
+// tests/TileDeltaTest.cpp checks scrolled pages come back exact and malformed payloads are refused.
+class ScrollingPage {
+    public:
+    ScrollingPage(unsigned short width, unsigned short height, unsigned int documentHeight) :
+        m_Width(width), m_Height(height), m_Document(static_cast<size_t>(width) * documentHeight * 4), m_DocumentHeight(documentHeight)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> glyph(0, 3);
+
+        for (unsigned int y = 0; y < documentHeight; ++y) {
+            uint32_t* row = reinterpret_cast<uint32_t*>(m_Document.data() + static_cast<size_t>(y) * width * 4);
+            bool textLine = (y % 24) < 16;
+            for (unsigned int x = 0; x < width; ++x) {
+                uint32_t color = 0xFFFFFFFF;
+                if (textLine && (x % 9) < 7 && glyph(rng) == 0) color = 0xFF202020 + (y & 0x0F);
+                row[x] = color;
+            }
+        }
+    }
+
+    void Render(unsigned int scroll, uint8_t* frame) const {
+        const unsigned int toolbar = 80;
+        const unsigned int scrollbar = 16;
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(frame);
+
+        for (unsigned int y = 0; y < m_Height; ++y) {
+            uint32_t* row = pixels + static_cast<size_t>(y) * m_Width;
+            if (y < toolbar) {
+                std::fill(row, row + m_Width, 0xFF3C3C3C);
+                continue;
+            }
+            unsigned int docY = (scroll + y - toolbar) % m_DocumentHeight;
+            memcpy(row, m_Document.data() + static_cast<size_t>(docY) * m_Width * 4, (m_Width - scrollbar) * 4);
+
+            unsigned int thumb = toolbar + (scroll * (m_Height - toolbar)) / m_DocumentHeight;
+            uint32_t bar = (y >= thumb && y < thumb + 60) ? 0xFF909090 : 0xFFE0E0E0;
+            std::fill(row + m_Width - scrollbar, row + m_Width, bar);
+        }
+    }
+
+    private:
+    unsigned short m_Width;
+    unsigned short m_Height;
+    std::vector<uint8_t> m_Document;
+    unsigned int m_DocumentHeight;
+};
+
+static void RunSequence(unsigned short width, unsigned short height, unsigned int step, bool scroll) {
+    const unsigned int frames = 120;
+    const size_t rawSize = static_cast<size_t>(width) * height * 4;
+
+    ScrollingPage page(width, height, height * 8);
+    FrameCodec::DeltaEncoder encoder(width, height);
+    FrameCodec::DeltaDecoder decoder(width, height);
+    encoder.EnableScrollDetection(scroll);
+
+    std::vector<uint8_t> frame(rawSize);
+    std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(width, height));
+
+    // Prime both sides with the first frame so only steady-state scrolling is measured
+    page.Render(0, frame.data());
+    decoder.Decode(payload.data(), encoder.Encode(frame.data(), payload.data()));
+
+    auto encodeTotal = std::chrono::microseconds::zero();
+    auto decodeTotal = std::chrono::microseconds::zero();
+    unsigned long long bytes = 0;
+
+    for (unsigned int i = 1; i <= frames; ++i) {
+        page.Render(i * step, frame.data());
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        size_t length = encoder.Encode(frame.data(), payload.data());
+        auto encodeEnd = std::chrono::steady_clock::now();
+        decoder.Decode(payload.data(), length);
+        auto decodeEnd = std::chrono::steady_clock::now();
+
+        encodeTotal += std::chrono::duration_cast<std::chrono::microseconds>(encodeEnd - encodeStart);
+        decodeTotal += std::chrono::duration_cast<std::chrono::microseconds>(decodeEnd - encodeEnd);
+        bytes += length;
+    }
+
+    std::cout << width << "x" << height << " step " << step << "px " << (scroll ? "scroll " : "tiles  ")
+              << "| Encode: " << encodeTotal.count() / frames << "us"
+              << " | Decode: " << decodeTotal.count() / frames << "us"
+              << " | Bytes/frame: " << bytes / frames
+              << " (" << (100.0 * bytes / frames / rawSize) << "% of raw)"
+              << " | Rects: " << encoder.GetCopiedRects() << std::endl;
+}
+
+// Alt-tab between two windows: every frame replaces the whole screen with content seen two frames ago.
+// tests/TileCacheTest.cpp checks the receiver's cache stays in step with the sender's index.
+static void RunAltTab(unsigned short width, unsigned short height, uint32_t cacheSize) {
+    const unsigned int frames = 120;
+    const size_t rawSize = static_cast<size_t>(width) * height * 4;
+
+    ScrollingPage page(width, height, height * 8);
+    FrameCodec::DeltaEncoder encoder(width, height);
+    FrameCodec::DeltaDecoder decoder(width, height);
+    encoder.SetTileCache(cacheSize);
+    decoder.SetTileCache(cacheSize);
+
+    std::vector<uint8_t> frame(rawSize);
+    std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(width, height));
+
+    auto encodeTotal = std::chrono::microseconds::zero();
+    unsigned long long bytes = 0;
+
+    for (unsigned int i = 0; i < frames; ++i) {
+        page.Render((i % 2) ? height * 4 : 0, frame.data());
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        size_t length = encoder.Encode(frame.data(), payload.data());
+        encodeTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - encodeStart);
+        bytes += length;
+        decoder.Decode(payload.data(), length);
+    }
+
+    const FrameCodec::TileCacheStats& stats = encoder.GetTileCacheStats();
+    std::cout << width << "x" << height << " alt-tab cache " << cacheSize
+              << " | Encode: " << encodeTotal.count() / frames << "us"
+              << " | Bytes/frame: " << bytes / frames
+              << " (" << (100.0 * bytes / frames / rawSize) << "% of raw)"
+              << " | Hit rate: " << (100.0 * stats.HitRate()) << "%"
+              << " | Saved: " << stats.savedBytes / (1024 * 1024) << "MB" << std::endl;
+}
+
+int main() {
+    const unsigned short resolutions[][2] = { { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+    const unsigned int steps[] = { 3, 40, 120 };
+
+    for (const auto& res : resolutions) {
+        for (unsigned int step : steps) {
+            RunSequence(res[0], res[1], step, false);
+            RunSequence(res[0], res[1], step, true);
+        }
+    }
+
+    // A cache smaller than both screens together thrashes under LRU (two 4K screens are 2 * 2040 tiles)
+    for (const auto& res : resolutions) {
+        RunAltTab(res[0], res[1], 0);
+        RunAltTab(res[0], res[1], 1024);
+        RunAltTab(res[0], res[1], FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+        RunAltTab(res[0], res[1], 8192);
+    }
+    return 0;
+}
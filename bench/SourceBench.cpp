@@ -0,0 +1,92 @@
+#include "CaptureRegion.hpp"
+#include "ReplaySource.hpp"
+#include "SyntheticSource.hpp"
+#include "TileDelta.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Drives the capture-side stages from FrameSources instead of a desktop: every synthetic content through the
+// pack, delta encode and decode, then a recording of one replayed through ReplaySource. tests/FrameSourceTest.cpp
+// checks the viewer's frames and the playback.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t WIDTH = 1920;
+constexpr uint16_t HEIGHT = 1080;
+constexpr uint16_t REFRESH_RATE = 60;
+constexpr unsigned int ACQUIRES = 120;
+constexpr unsigned int RECORDED_FRAMES = 20;
+
+int main() {
+    const size_t frameBytes = static_cast<size_t>(WIDTH) * HEIGHT * 4;
+    const FrameCodec::CaptureRegion whole = { 0, 0, WIDTH, HEIGHT };
+
+    std::cout << WIDTH << "x" << HEIGHT << ", " << ACQUIRES << " acquires per content, unpaced" << std::endl;
+    for (unsigned int i = 0; i < FrameCodec::SYNTHETIC_CONTENT_COUNT; ++i) {
+        const FrameCodec::SyntheticContent content = static_cast<FrameCodec::SyntheticContent>(i);
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, content);
+        unsigned long long pointerMoves = 0;
+        source.SetPointerCallback([&](const FrameCodec::CursorState&) { pointerMoves++; });
+
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        std::vector<uint8_t> packed(frameBytes);
+        std::vector<uint8_t> delta(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+
+        unsigned int frames = 0, unchanged = 0, timeouts = 0;
+        size_t deltaBytes = 0;
+        const auto start = Clock::now();
+        for (unsigned int n = 0; n < ACQUIRES; ++n) {
+            FrameCodec::SourceFrame frame;
+            switch (source.Acquire(0, frame)) {
+                case FrameCodec::AcquireResult::Frame: break;
+                case FrameCodec::AcquireResult::Unchanged: unchanged++; continue;
+                case FrameCodec::AcquireResult::Timeout: timeouts++; continue;
+                case FrameCodec::AcquireResult::Failed: continue;
+            }
+            FrameCodec::PackRegion(frame.pixels, frame.pitch, whole, packed.data());
+            source.Release();
+
+            const size_t length = encoder.Encode(packed.data(), delta.data());
+            decoder.Decode(delta.data(), length);
+            // Every frame after the first pays only for what changed
+            if (frames > 0) deltaBytes += length;
+            frames++;
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << FrameCodec::SyntheticContentName(content)
+                  << " | frames: " << frames << " (" << static_cast<int>(frames / seconds) << " fps)"
+                  << " | unchanged: " << unchanged << " | timeouts: " << timeouts << " | pointer: " << pointerMoves
+                  << " | delta: " << (frames > 1 ? deltaBytes / (frames - 1) / 1024 : 0) << "KB/frame" << std::endl;
+    }
+
+    // Record scrolling text, then time playing the recording back
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "source_bench.raw";
+    {
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::ScrollingText, 40);
+        std::ofstream out(path, std::ios::binary);
+        for (unsigned int n = 0; n < RECORDED_FRAMES; ++n) {
+            FrameCodec::SourceFrame frame;
+            if (source.Acquire(0, frame) != FrameCodec::AcquireResult::Frame) return 1;
+            out.write(reinterpret_cast<const char*>(frame.pixels), static_cast<std::streamsize>(frameBytes));
+            source.Release();
+        }
+    }
+
+    FrameCodec::ReplaySource replay(WIDTH, HEIGHT, REFRESH_RATE, false, true);
+    if (!replay.Open(path.string())) return 1;
+    const auto start = Clock::now();
+    for (unsigned int n = 0; n < RECORDED_FRAMES * 2; ++n) { // Twice through, so the loop is timed too
+        FrameCodec::SourceFrame frame;
+        if (replay.Acquire(0, frame) == FrameCodec::AcquireResult::Frame) replay.Release();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::filesystem::remove(path);
+
+    std::cout << "replay | " << RECORDED_FRAMES << " frames looped twice (" << static_cast<int>(RECORDED_FRAMES * 2 / seconds) << " fps)" << std::endl;
+    return 0;
+}
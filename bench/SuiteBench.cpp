@@ -0,0 +1,387 @@
+#include "BenchHarness.hpp"
+#include "LoopbackLink.hpp"
+
+#include "BandLayout.hpp"
+#include "CaptureRegion.hpp"
+#include "ColorConvert.hpp"
+#include "CursorCodec.hpp"
+#include "Downscale.hpp"
+#include "FrameHash.hpp"
+#include "FrameHeader.hpp"
+#include "FrameMailbox.hpp"
+#include "PullProtocol.hpp"
+#include "ScrollDetector.hpp"
+#include "SyntheticSource.hpp"
+#include "TileDelta.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Every CPU kernel and wire-format encoder of the pipeline on its own, then the video, input and audio loops end to
+// end over LoopbackLink. `cmake --build <dir> --target bench` runs it and writes bench.json into the build tree.
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t WIDTH = 1920;
+constexpr uint16_t HEIGHT = 1080;
+constexpr size_t PITCH = WIDTH * 4 + 256; // Staging textures pad their rows
+constexpr size_t FRAME_BYTES = static_cast<size_t>(WIDTH) * HEIGHT * 4;
+
+// The link the loops run over: a 25 Gbit/s adapter with a few microseconds each way
+constexpr double LINK_GBIT = 25.0;
+constexpr std::chrono::nanoseconds LINK_LATENCY = std::chrono::microseconds(3);
+
+// Same layout as InputNDSession's Packet: one mouse and one key event per message
+struct InputPacket {
+    int16_t x;
+    int16_t y;
+    int16_t wheel;
+    bool absolute;
+    uint32_t buttonFlags;
+    uint16_t scanCode;
+    uint8_t down;
+    bool isE0;
+};
+
+// AudioNDSession's period: 10ms of 48kHz stereo 32-bit samples
+constexpr size_t AUDIO_PERIOD_BYTES = 48000 * 2 * 4 / 100;
+
+double Percentile(std::vector<double>& values, unsigned int percent) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+// Frame buffers must start on a cache line; vectors only promise less
+uint8_t* CacheLineAligned(std::vector<uint8_t>& buffer) {
+    const size_t misalignment = reinterpret_cast<uintptr_t>(buffer.data()) % FrameCodec::FRAME_CACHE_LINE;
+    return buffer.data() + (misalignment ? FrameCodec::FRAME_CACHE_LINE - misalignment : 0);
+}
+
+// Scrolling text frames with the same content every run
+std::vector<std::vector<uint8_t>> MakeFrames(unsigned int count) {
+    FrameCodec::SyntheticSource source(WIDTH, HEIGHT, 60, FrameCodec::SyntheticContent::ScrollingText, 42);
+    std::vector<std::vector<uint8_t>> frames;
+    for (unsigned int i = 0; i < count; ++i) {
+        FrameCodec::SourceFrame frame;
+        source.Acquire(0, frame);
+        frames.emplace_back(frame.pixels, frame.pixels + FRAME_BYTES);
+    }
+    return frames;
+}
+
+void PixelKernels(BenchHarness& bench) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> staged(PITCH * HEIGHT);
+    for (uint8_t& byte : staged) byte = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> packed(FRAME_BYTES);
+    const FrameCodec::CaptureRegion whole = { 0, 0, WIDTH, HEIGHT };
+
+    // The readback copy: pitched staging texture into a tightly packed frame
+    bench.Micro("pixel", "pack_region_1080p", FRAME_BYTES, [&] { FrameCodec::PackRegion(staged.data(), PITCH, whole, packed.data()); });
+    bench.Micro("pixel", "pack_region_reference_1080p", FRAME_BYTES, [&] { FrameCodec::PackRegionReference(staged.data(), PITCH, whole, packed.data()); });
+
+    // Compressed frames: Y and UV planes into the banded payload, as CompressLoop copies them
+    const FrameCodec::PlanarBands bands(WIDTH, HEIGHT, FrameCodec::DEFAULT_BAND_COUNT);
+    const size_t yPitch = WIDTH + 256;
+    const size_t uvPitch = WIDTH * 2 + 256;
+    std::vector<uint8_t> yPlane(yPitch * HEIGHT, 0x80);
+    std::vector<uint8_t> uvPlane(uvPitch * HEIGHT / 2, 0x40);
+    std::vector<uint8_t> payload(bands.GetPayloadSize());
+    bench.Micro("pixel", "yuv440_band_copy_1080p", bands.GetPayloadSize(), [&] {
+        for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+            const FrameCodec::Band& band = bands[i];
+            uint8_t* yDst = payload.data() + band.offset;
+            uint8_t* uvDst = yDst + band.ySize;
+            for (unsigned int row = 0; row < band.rows; ++row) memcpy(yDst + row * WIDTH, yPlane.data() + (band.firstRow + row) * yPitch, WIDTH);
+            for (unsigned int row = 0; row < band.uvRows; ++row) memcpy(uvDst + row * WIDTH * 2, uvPlane.data() + (band.uvRow + row) * uvPitch, WIDTH * 2);
+        }
+    });
+
+    for (FrameCodec::ScaleLevel level : { FrameCodec::ScaleLevel::ThreeQuarter, FrameCodec::ScaleLevel::Half }) {
+        const uint16_t width = FrameCodec::ScaledDimension(WIDTH, level);
+        const uint16_t height = FrameCodec::ScaledDimension(HEIGHT, level);
+        FrameCodec::Downscaler scaler(WIDTH, HEIGHT, width, height, FrameCodec::ScaleFilter::Box);
+        std::vector<uint8_t> scaled(static_cast<size_t>(width) * height * 4);
+        const std::string name = std::string("downscale_") + FrameCodec::ScaleLevelName(level);
+        bench.Micro("pixel", name, FRAME_BYTES, [&] { scaler.Scale(packed.data(), WIDTH * 4, scaled.data(), width * 4); });
+        bench.Micro("pixel", name + "_reference", FRAME_BYTES, [&] { scaler.ScaleReference(packed.data(), WIDTH * 4, scaled.data(), width * 4); });
+    }
+
+    // One 1080p row, what scroll detection and the tile cache hash over and over
+    bench.Micro("pixel", "hash_row", WIDTH * 4, [&] { KeepResult(FrameCodec::HashBytes(packed.data(), WIDTH * 4)); });
+}
+
+// The CPU colour conversion on scrolling text at every SIMD level this CPU has, on one thread for the per-core cost.
+// The adaptive entries add the tile classifier and the chroma packers (or unpackers) to the same conversion.
+void ColourKernels(BenchHarness& bench, const std::vector<std::vector<uint8_t>>& frames) {
+    constexpr FrameCodec::SimdLevel LEVELS[] = {
+        FrameCodec::SimdLevel::Scalar, FrameCodec::SimdLevel::SSE41, FrameCodec::SimdLevel::AVX2, FrameCodec::SimdLevel::AVX512
+    };
+    const uint8_t* bgra = frames[0].data();
+    std::vector<uint8_t> decoded(FRAME_BYTES);
+    std::vector<uint8_t> y(static_cast<size_t>(WIDTH) * HEIGHT), uv(static_cast<size_t>(WIDTH) * HEIGHT / 2);
+    std::vector<uint8_t> chroma(FrameCodec::AdaptiveChromaMaxSize(WIDTH, HEIGHT));
+
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        const std::string suffix = std::string("_") + FrameCodec::SimdLevelName(level);
+
+        FrameCodec::YuvEncoder encoder(WIDTH, HEIGHT, FrameCodec::PixelFormat::YUV420, FrameCodec::ColorSpace::BT601Full, 1, level);
+        FrameCodec::YuvDecoder decoder(WIDTH, HEIGHT, FrameCodec::PixelFormat::YUV420, FrameCodec::ColorSpace::BT601Full, 1, level);
+        bench.Micro("pixel", "yuv420_encode_1080p" + suffix, FRAME_BYTES, [&] { encoder.Encode(bgra, WIDTH * 4, y.data(), WIDTH, uv.data(), WIDTH); });
+        bench.Micro("pixel", "yuv420_decode_1080p" + suffix, FRAME_BYTES, [&] { decoder.Decode(y.data(), WIDTH, uv.data(), WIDTH, decoded.data(), WIDTH * 4); });
+
+        FrameCodec::YuvEncoder adaptiveEncoder(WIDTH, HEIGHT, FrameCodec::PixelFormat::YUVAdaptive, FrameCodec::ColorSpace::BT601Full, 1, level);
+        FrameCodec::YuvDecoder adaptiveDecoder(WIDTH, HEIGHT, FrameCodec::PixelFormat::YUVAdaptive, FrameCodec::ColorSpace::BT601Full, 1, level);
+        bench.Micro("pixel", "adaptive_encode_1080p" + suffix, FRAME_BYTES, [&] {
+            KeepResult(adaptiveEncoder.EncodeAdaptiveRows(bgra, WIDTH * 4, 0, HEIGHT, y.data(), WIDTH, chroma.data()));
+        });
+        const size_t used = adaptiveEncoder.EncodeAdaptiveRows(bgra, WIDTH * 4, 0, HEIGHT, y.data(), WIDTH, chroma.data());
+        bench.Micro("pixel", "adaptive_decode_1080p" + suffix, FRAME_BYTES, [&] {
+            KeepResult(adaptiveDecoder.DecodeAdaptiveRows(y.data(), WIDTH, chroma.data(), used, 0, HEIGHT, decoded.data(), WIDTH * 4));
+        });
+    }
+}
+
+void CodecKernels(BenchHarness& bench, const std::vector<std::vector<uint8_t>>& frames) {
+    std::vector<uint8_t> delta(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+
+    FrameCodec::ScrollDetector detector(WIDTH, HEIGHT);
+    std::vector<FrameCodec::CopyRect> rects;
+    bench.Micro("codec", "scroll_detect_1080p", FRAME_BYTES, [&] {
+        rects.clear();
+        detector.Detect(frames[0].data(), frames[1].data(), WIDTH * 4, rects);
+    });
+
+    // Alternating two scrolled frames keeps every encode a real scroll plus a few new rows
+    for (uint32_t cache : { 0u, static_cast<uint32_t>(FrameCodec::DEFAULT_TILE_CACHE_SIZE) }) {
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        encoder.SetTileCache(cache);
+        size_t index = 0;
+        bench.Micro("codec", cache ? "delta_encode_scroll_cached" : "delta_encode_scroll", FRAME_BYTES, [&] {
+            KeepResult(encoder.Encode(frames[index].data(), delta.data()));
+            index = (index + 1) % frames.size();
+        });
+    }
+
+    FrameCodec::DeltaEncoder still(WIDTH, HEIGHT);
+    still.Encode(frames[0].data(), delta.data());
+    bench.Micro("codec", "delta_encode_unchanged", FRAME_BYTES, [&] { KeepResult(still.Encode(frames[0].data(), delta.data())); });
+
+    // The same step applied over and over: the pixels drift, the moves and tile writes stay the same
+    FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+    encoder.Encode(frames[0].data(), delta.data());
+    const size_t length = encoder.Encode(frames[1].data(), delta.data());
+    FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+    bench.Micro("codec", "delta_decode_scroll", length, [&] { KeepResult(decoder.Decode(delta.data(), length)); });
+    decoder.Reset(frames[0].data());
+    if (!decoder.Decode(delta.data(), length) || memcmp(decoder.GetFrame(), frames[1].data(), FRAME_BYTES) != 0) bench.Fail("delta round trip");
+
+    // The same with lossless tiles on one thread, the per-core cost
+    std::vector<uint8_t> lossless(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT, true));
+    FrameCodec::DeltaEncoder losslessEncoder(WIDTH, HEIGHT);
+    losslessEncoder.EnableLossless(true, 1);
+    size_t index = 0;
+    bench.Micro("codec", "delta_encode_scroll_lossless", FRAME_BYTES, [&] {
+        KeepResult(losslessEncoder.Encode(frames[index].data(), lossless.data()));
+        index = (index + 1) % frames.size();
+    });
+
+    losslessEncoder.Reset(frames[0].data());
+    const size_t losslessLength = losslessEncoder.Encode(frames[1].data(), lossless.data());
+    FrameCodec::DeltaDecoder losslessDecoder(WIDTH, HEIGHT);
+    losslessDecoder.EnableLossless(true, 1);
+    bench.Micro("codec", "delta_decode_scroll_lossless", losslessLength, [&] { KeepResult(losslessDecoder.Decode(lossless.data(), losslessLength)); });
+    losslessDecoder.Reset(frames[0].data());
+    if (!losslessDecoder.Decode(lossless.data(), losslessLength) || memcmp(losslessDecoder.GetFrame(), frames[1].data(), FRAME_BYTES) != 0) {
+        bench.Fail("lossless delta round trip");
+    }
+}
+
+void WireFormats(BenchHarness& bench) {
+    // Header in front of a typical delta payload, as SendLoop seals it, with and without the checksum
+    const size_t payloadSize = 256 * 1024;
+    std::vector<uint8_t> slot(FrameCodec::FrameSlotSize(payloadSize) + FrameCodec::FRAME_CACHE_LINE);
+    uint8_t* buffer = CacheLineAligned(slot);
+    uint64_t sequence = 0;
+    for (bool checksum : { false, true }) {
+        bench.Micro("wire", checksum ? "frame_header_checksum_256k" : "frame_header", checksum ? payloadSize : 0, [&] {
+            FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, ++sequence,
+                FrameCodec::PixelFormat::BGRA32, FrameCodec::PayloadEncoding::TileDelta, WIDTH, HEIGHT);
+            FrameCodec::SealFrameHeader(header, static_cast<uint32_t>(payloadSize), checksum);
+        });
+    }
+    // Without the checksum, which would only time the hash again
+    FrameCodec::SealFrameHeader(FrameCodec::BeginFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, ++sequence,
+        FrameCodec::PixelFormat::BGRA32, FrameCodec::PayloadEncoding::TileDelta, WIDTH, HEIGHT), static_cast<uint32_t>(payloadSize), false);
+    FrameCodec::FrameHeaderStatus status;
+    bench.Micro("wire", "frame_header_parse", 0, [&] {
+        KeepResult(FrameCodec::ParseFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, FrameCodec::FrameSlotSize(payloadSize), status));
+    });
+
+    // Pointer moves name a shape the receiver already has; a new shape carries its pixels once
+    FrameCodec::CursorState pointer;
+    pointer.visible = true;
+    pointer.shapeId = 1;
+    pointer.width = pointer.height = 32;
+    pointer.pixels.assign(32 * 32 * 4, 0xFF);
+    std::vector<uint8_t> message(FrameCodec::MAX_CURSOR_MESSAGE_SIZE);
+    FrameCodec::CursorEncoder cursor;
+    bench.Micro("wire", "cursor_move", 0, [&] {
+        pointer.x = (pointer.x + 1) % WIDTH;
+        KeepResult(cursor.Encode(pointer, message.data()));
+    });
+    bench.Micro("wire", "cursor_shape_32px", pointer.pixels.size(), [&] {
+        pointer.shapeId++;
+        KeepResult(cursor.Encode(pointer, message.data()));
+    });
+
+    FrameCodec::PullControl control = {};
+    FrameCodec::PullPublisher publisher(&control);
+    bench.Micro("wire", "pull_publish", 0, [&] { publisher.Publish(publisher.BeginSlot(), ++sequence); });
+}
+
+// Capture, delta encode, header, write over the link, parse and decode: frames per second and capture-to-decoded latency
+void VideoLoop(BenchHarness& bench, const std::vector<std::vector<uint8_t>>& frames) {
+    if (!bench.Selected("loop", "video_scroll_1080p")) return;
+    constexpr unsigned int COUNT = 120;
+    LoopbackLink link(LINK_GBIT, LINK_LATENCY);
+    const size_t slotSize = FrameCodec::FrameSlotSize(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+    std::vector<uint8_t> send(slotSize + FrameCodec::FRAME_CACHE_LINE), receive(slotSize + FrameCodec::FRAME_CACHE_LINE);
+    uint8_t* sendSlot = CacheLineAligned(send);
+    uint8_t* receiveSlot = CacheLineAligned(receive);
+
+    std::vector<uint8_t> staged(PITCH * HEIGHT), packed(FRAME_BYTES);
+    FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+    FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+    std::vector<double> latencies;
+    size_t bytes = 0;
+    bool intact = true;
+
+    const auto start = Clock::now();
+    for (unsigned int i = 0; i < COUNT; ++i) {
+        const std::vector<uint8_t>& frame = frames[i % frames.size()];
+        for (unsigned int row = 0; row < HEIGHT; ++row) memcpy(staged.data() + row * PITCH, frame.data() + row * WIDTH * 4, WIDTH * 4);
+        const auto captured = Clock::now();
+
+        FrameCodec::PackRegion(staged.data(), PITCH, { 0, 0, WIDTH, HEIGHT }, packed.data());
+        FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(sendSlot + FrameCodec::FRAME_HEADER_OFFSET, i + 1,
+            FrameCodec::PixelFormat::BGRA32, FrameCodec::PayloadEncoding::TileDelta, WIDTH, HEIGHT);
+        const size_t length = encoder.Encode(packed.data(), sendSlot + FrameCodec::FRAME_PAYLOAD_OFFSET);
+        FrameCodec::SealFrameHeader(header, static_cast<uint32_t>(length), false);
+
+        std::atomic<bool> landed = false;
+        link.Post(receiveSlot, sendSlot, FrameCodec::FRAME_PAYLOAD_OFFSET + length, [&] { landed.store(true, std::memory_order_release); });
+        while (!landed.load(std::memory_order_acquire)) std::this_thread::yield();
+
+        FrameCodec::FrameHeaderStatus status;
+        const FrameCodec::FrameHeader* received = FrameCodec::ParseFrameHeader(receiveSlot + FrameCodec::FRAME_HEADER_OFFSET,
+            FrameCodec::FRAME_PAYLOAD_OFFSET - FrameCodec::FRAME_HEADER_OFFSET + length, status);
+        intact = intact && received && decoder.Decode(FrameCodec::GetFramePayload(received), received->payloadSize);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - captured).count());
+        bytes += length;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!intact || memcmp(decoder.GetFrame(), frames[(COUNT - 1) % frames.size()].data(), FRAME_BYTES) != 0) bench.Fail("video loop frame");
+
+    bench.Loop("loop", "video_scroll_1080p", {
+        { "fps", COUNT / seconds },
+        { "latency_p50_us", Percentile(latencies, 50) },
+        { "latency_p99_us", Percentile(latencies, 99) },
+        { "kb_per_frame", bytes / 1024.0 / COUNT },
+    });
+}
+
+// Input messages to the captured machine and back, one at a time, as mouse moves arrive
+void InputLoop(BenchHarness& bench) {
+    if (!bench.Selected("loop", "input_round_trip")) return;
+    constexpr unsigned int COUNT = 2000;
+    LoopbackLink link(LINK_GBIT, LINK_LATENCY);
+    InputPacket sent = {}, received = {}, echoed = {};
+    std::vector<double> latencies;
+    bool intact = true;
+
+    for (unsigned int i = 0; i < COUNT; ++i) {
+        sent.x = static_cast<int16_t>(i % WIDTH);
+        sent.y = static_cast<int16_t>(i / WIDTH);
+        sent.scanCode = static_cast<uint16_t>(i & 0xFF);
+        sent.down = i & 1;
+
+        std::atomic<bool> back = false;
+        const auto start = Clock::now();
+        link.Post(&received, &sent, sizeof(sent), [&] { link.Post(&echoed, &received, sizeof(received), [&] { back.store(true, std::memory_order_release); }); });
+        while (!back.load(std::memory_order_acquire)) std::this_thread::yield();
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        intact = intact && memcmp(&echoed, &sent, sizeof(sent)) == 0;
+    }
+    if (!intact) bench.Fail("input loop packet");
+
+    bench.Loop("loop", "input_round_trip", {
+        { "round_trip_p50_us", Percentile(latencies, 50) },
+        { "round_trip_p99_us", Percentile(latencies, 99) },
+        { "packet_bytes", static_cast<double>(sizeof(InputPacket)) },
+    });
+}
+
+// Audio periods through a mailbox to the network side and over the link, as fast as they can go
+void AudioLoop(BenchHarness& bench) {
+    if (!bench.Selected("loop", "audio_10ms_periods")) return;
+    constexpr unsigned int COUNT = 2000;
+    LoopbackLink link(LINK_GBIT, LINK_LATENCY);
+    std::array<std::vector<uint8_t>, FrameCodec::FrameMailbox::SLOTS> periods;
+    for (auto& period : periods) period.resize(AUDIO_PERIOD_BYTES);
+    std::vector<uint8_t> received(AUDIO_PERIOD_BYTES);
+    FrameCodec::FrameMailbox mailbox;
+    std::vector<double> latencies;
+    std::atomic<unsigned int> delivered = 0;
+
+    std::thread network([&] {
+        while (mailbox.WaitAndTake()) {
+            std::atomic<bool> landed = false;
+            link.Post(received.data(), periods[mailbox.GetReadSlot()].data(), AUDIO_PERIOD_BYTES, [&] { landed.store(true, std::memory_order_release); });
+            while (!landed.load(std::memory_order_acquire)) std::this_thread::yield();
+            delivered.fetch_add(1, std::memory_order_release);
+        }
+    });
+
+    const auto start = Clock::now();
+    for (unsigned int i = 0; i < COUNT; ++i) {
+        memset(periods[mailbox.GetWriteSlot()].data(), static_cast<int>(i), AUDIO_PERIOD_BYTES);
+        const unsigned int before = delivered.load(std::memory_order_acquire);
+        const auto posted = Clock::now();
+        mailbox.Publish();
+        // One period in flight at a time, as with a real 10ms clock; only the wait is skipped
+        while (delivered.load(std::memory_order_acquire) == before) std::this_thread::yield();
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - posted).count());
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    mailbox.Close();
+    network.join();
+    if (mailbox.GetDropped() != 0) bench.Fail("audio loop dropped a period");
+
+    bench.Loop("loop", "audio_10ms_periods", {
+        { "periods_per_s", COUNT / seconds },
+        { "latency_p50_us", Percentile(latencies, 50) },
+        { "latency_p99_us", Percentile(latencies, 99) },
+    });
+}
+
+int main(int argc, char* argv[]) {
+    BenchHarness bench(argc, argv);
+    const std::vector<std::vector<uint8_t>> frames = MakeFrames(8);
+
+    PixelKernels(bench);
+    ColourKernels(bench, frames);
+    CodecKernels(bench, frames);
+    WireFormats(bench);
+    VideoLoop(bench, frames);
+    InputLoop(bench);
+    AudioLoop(bench);
+
+    return bench.Finish();
+}
@@ -0,0 +1,83 @@
+#include "TraceRecorder.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// What a trace point costs disabled and enabled, then pipeline-like threads (capture, copy, write, completion waits)
+// recording nested stages: how long paced threads take with the flusher keeping up, and how much a burst into small
+// rings drops. tests/TraceRecorderTest.cpp checks the written files.
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned int THREADS = 4;
+constexpr const char* THREAD_NAMES[THREADS] = { "capture", "copy", "write", "cq" };
+
+// A paced thread blocks between frames like a stage waiting on a completion, which is when the flusher gets to run
+constexpr auto PACE = std::chrono::microseconds(100);
+
+// Events each thread recorded: frame begin/end, a nested stage begin/end and an instant per iteration
+void Run(uint64_t iterations, bool paced) {
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([t, iterations, paced]() {
+            FrameCodec::TraceRecorder::Instance().SetThreadName(THREAD_NAMES[t]);
+            for (uint64_t i = 0; i < iterations; ++i) {
+                FrameCodec::TraceScope frame("Frame", THREAD_NAMES[t]);
+                {
+                    FrameCodec::TraceScope stage("Stage", THREAD_NAMES[t]);
+                    if (paced) std::this_thread::sleep_for(PACE);
+                }
+                FrameCodec::TraceInstant("Mark", THREAD_NAMES[t]);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+}
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ndrc_trace_bench.json";
+    FrameCodec::TraceRecorder& recorder = FrameCodec::TraceRecorder::Instance();
+
+    // Disabled: one relaxed load per trace point
+    constexpr uint64_t COST_ITERATIONS = 10000000;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < COST_ITERATIONS; ++i) FrameCodec::TraceScope scope("Off", "bench");
+    const double disabledNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / COST_ITERATIONS;
+
+    // Enabled, one thread into a ring that holds the whole run. Wall time, so with few cores it includes the
+    // flusher formatting events on the same core.
+    if (!recorder.Start(path.string(), 1 << 21)) return 1;
+    FrameCodec::TraceInstant("Warm", "bench"); // Allocates this thread's ring
+    start = Clock::now();
+    for (uint64_t i = 0; i < COST_ITERATIONS / 10; ++i) FrameCodec::TraceScope scope("On", "bench");
+    const double enabledNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (COST_ITERATIONS / 10 * 2);
+    recorder.Stop();
+
+    // Paced threads: the default rings hold less than a thread records, so the flusher must keep up
+    constexpr uint64_t PACED_ITERATIONS = 5000;
+    if (!recorder.Start(path.string())) return 1;
+    start = Clock::now();
+    Run(PACED_ITERATIONS, true);
+    const double pacedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    recorder.Stop();
+
+    const uint64_t pacedEvents = PACED_ITERATIONS * 5 * THREADS;
+    std::cout << "Paced: " << recorder.GetWritten() << " of " << pacedEvents << " events in " << pacedMs << "ms, " << recorder.GetDropped() << " dropped" << std::endl;
+
+    // Bursts into small rings: the flusher falls behind and events are dropped
+    constexpr uint64_t BURST_ITERATIONS = 400000;
+    if (!recorder.Start(path.string(), 1 << 10)) return 1;
+    start = Clock::now();
+    Run(BURST_ITERATIONS, false);
+    const double burstMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    recorder.Stop();
+
+    const uint64_t burstEvents = BURST_ITERATIONS * 5 * THREADS;
+    std::cout << "Burst: " << recorder.GetWritten() << " written, " << recorder.GetDropped() << " dropped of " << burstEvents << " in " << burstMs << "ms" << std::endl;
+    std::filesystem::remove(path);
+
+    std::cout << "Per trace event: " << disabledNs << "ns disabled, " << enabledNs << "ns enabled" << std::endl;
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "AudioNDSession.hpp"
+#include "Metrics.hpp"
+#include "TraceRecorder.hpp"
 
 #include <emmintrin.h>
 #include <windows.h>
@@ -146,9 +148,14 @@ void AudioNDSessionServer::Loop() {
         std::cerr << "AUDIO: " << "Buffer size mismatch: " << bufferFrameCount << std::endl;
     }
     pAudioClient->Start();
+
+    static const FrameCodec::Counter periodsReceived("audio.periods_received");
+    static const FrameCodec::Counter periodsSkipped("audio.periods_skipped");
+    FrameCodec::TraceRecorder::Instance().SetThreadName("audio");
     
     while (m_isRunning && !g_shouldQuit.load()) {
         WaitForSingleObject(hEvent, INFINITE);
+        FrameCodec::TraceScope period("Render period", "audio"); // WASAPI signalled the next buffer
 
         UINT32 padding = 0;
         UINT32 nBufferToWrite = bufferFrameCount;
@@ -157,6 +164,7 @@ void AudioNDSessionServer::Loop() {
 
         if (nBufferToWrite < SAMPLE_RATE / 1000 * 10) {
             std::cerr << "AUDIO: " << "Buffer is full, skipping frame." << std::endl;
+            periodsSkipped.Add();
             continue;
         }
 
@@ -190,6 +198,7 @@ void AudioNDSessionServer::Loop() {
             std::cerr << "AUDIO: " << "ReleaseBuffer failed: " << std::hex << hr << std::endl;
             break;
         }
+        periodsReceived.Add();
     }
     pAudioClient->Stop();
     g_shouldQuit.store(true);
@@ -373,9 +382,14 @@ void AudioNDSessionClient::Loop() {
     
     pAudioClient->Start();
 
+    static const FrameCodec::Counter periodsSent("audio.periods_sent");
+    static const FrameCodec::Histogram flagWait("audio.flag_wait_us");
+    FrameCodec::TraceRecorder::Instance().SetThreadName("audio");
+
     while (m_isRunning && !g_shouldQuit.load()) {
         DWORD waitResult = WaitForSingleObject(hEvent, INFINITE);
         if (waitResult != WAIT_OBJECT_0) continue;
+        FrameCodec::TraceScope period("Capture period", "audio"); // WASAPI signalled a captured packet
 
         UINT32 frames = 0;
         m_audioCaptureClient->GetNextPacketSize(&frames);
@@ -396,6 +410,7 @@ void AudioNDSessionClient::Loop() {
         }
 
         flag[0] = 0;
+        const auto flagWaitStart = std::chrono::steady_clock::now();
         while (flag[0] != 1) {
             if (FAILED(Read(&flagSge, 1, remoteInfo.remoteAddr, remoteInfo.remoteToken, 0, READ_CTXT))) {
                 std::cerr << "AUDIO: " << "Read failed." << std::endl;
@@ -407,6 +422,8 @@ void AudioNDSessionClient::Loop() {
             }
         }
 
+        flagWait.RecordMicroseconds(std::chrono::steady_clock::now() - flagWaitStart);
+
         // Send audio data
         memcpy(data, buffer, AUDIO_BUFFER_SIZE);
         if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
@@ -417,6 +434,7 @@ void AudioNDSessionClient::Loop() {
             std::cerr << "AUDIO: " << "WaitForCompletion for audio send failed." << std::endl;
             return;
         }
+        periodsSent.Add();
 
         memset(m_Buf, 0, BUFFER_ALLOC_SIZE);
 
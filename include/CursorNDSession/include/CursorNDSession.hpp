@@ -0,0 +1,110 @@
+#ifndef CURSORNDSESSION_HPP
+#define CURSORNDSESSION_HPP
+
+#pragma once
+
+#include "NDSession.hpp"
+#include "CursorCodec.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// [uint32_t ready][cursor message]. `ready` counts the receives the server has posted;
+// the client reads it over RDMA and only sends while it is ahead of what was already sent.
+constexpr size_t CURSOR_BUFFER_SIZE = sizeof(uint32_t) + FrameCodec::MAX_CURSOR_MESSAGE_SIZE;
+
+// Receives cursor position/shape messages on the viewer and hands them to the presenter.
+class CursorNDSessionServer : private NDSessionServerBase {
+    public:
+    bool Setup(char* localAddr);
+    void OpenListener(const char* localAddr);
+    void ExchangePeerInfo();
+
+    // Called on the session thread after every message
+    void RegisterCallback(std::function<void(const FrameCodec::CursorDecoder&)> callback) {
+        std::lock_guard<std::mutex> lock(m_CallbackMutex);
+        m_Callback = std::move(callback);
+    }
+
+    private:
+    void Loop();
+
+    public:
+    void Start(char* localAddr) {
+        Setup(localAddr);
+        OpenListener(localAddr);
+        ExchangePeerInfo();
+
+        m_isRunning = true;
+        m_thread = std::thread(&CursorNDSessionServer::Loop, this);
+    }
+
+    void Stop() {
+        m_isRunning = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    private:
+    PeerInfo remoteInfo;
+    std::atomic<bool> m_isRunning = true;
+    std::thread m_thread;
+
+    FrameCodec::CursorDecoder m_Decoder;
+    std::vector<uint8_t> m_Message;
+
+    std::mutex m_CallbackMutex;
+    std::function<void(const FrameCodec::CursorDecoder&)> m_Callback;
+
+    bool WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag = ND_CQ_NOTIFY_ANY, ULONG* bytesTransferred = nullptr);
+};
+
+// Sends the captured machine's cursor. Post() only records the latest state, so a burst of
+// mouse moves collapses into whatever is current when the session thread gets to it.
+class CursorNDSessionClient : private NDSessionClientBase {
+    public:
+    bool Setup(const char* localAddr);
+    void OpenConnector(const char* localAddr, const char* serverAddr);
+    void ExchangePeerInfo();
+
+    // Thread-safe; called by the capture thread whenever the pointer moves or changes shape
+    void Post(const FrameCodec::CursorState& state);
+
+    private:
+    void Loop();
+
+    public:
+    void Start(char* localAddr, const char* serverAddr) {
+        Setup(localAddr);
+        OpenConnector(localAddr, serverAddr);
+        ExchangePeerInfo();
+
+        m_isRunning = true;
+        m_thread = std::thread(&CursorNDSessionClient::Loop, this);
+    }
+    void Stop() {
+        m_isRunning = false;
+        m_StateCv.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    private:
+    std::atomic<bool> m_isRunning = true;
+    PeerInfo remoteInfo;
+    std::thread m_thread;
+
+    std::mutex m_StateMutex;
+    std::condition_variable m_StateCv;
+    FrameCodec::CursorState m_State;
+    bool m_Pending = false;
+
+    FrameCodec::CursorEncoder m_Encoder;
+
+    bool WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag = ND_CQ_NOTIFY_ANY);
+};
+
+#endif
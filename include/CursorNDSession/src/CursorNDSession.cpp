@@ -0,0 +1,310 @@
+#include "CursorNDSession.hpp"
+
+#include <windows.h>
+
+#ifdef _DEBUG
+#undef FAILED
+    #define FAILED(hr) \
+        ((hr) < 0 ? (std::cout << std::hex << hr, throw std::exception(), true) : false)
+#endif
+
+extern std::atomic<bool> g_shouldQuit;
+
+constexpr char TEST_PORT[] = "54324";
+
+// MARK: CursorNDSessionServer
+bool CursorNDSessionServer::Setup(char* localAddr) {
+    if (!Initialize(localAddr)) std::terminate();
+
+    ND2_ADAPTER_INFO info = GetAdapterInfo();
+    if (info.AdapterId == 0) std::terminate();
+
+    if (FAILED(CreateCQ(info.MaxCompletionQueueDepth))) std::terminate();
+    if (FAILED(CreateQP(info.MaxReceiveQueueDepth, info.MaxInitiatorQueueDepth, info.MaxReceiveSge, info.MaxInitiatorSge))) std::terminate();
+    if (FAILED(CreateMR())) std::terminate();
+
+    ULONG flags = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
+    if (FAILED(RegisterDataBuffer(CURSOR_BUFFER_SIZE, flags))) std::terminate();
+
+    if (FAILED(CreateListener())) std::terminate();
+    if (FAILED(CreateConnector())) std::terminate();
+
+    m_Message.resize(FrameCodec::MAX_CURSOR_MESSAGE_SIZE);
+    return true;
+}
+
+void CursorNDSessionServer::OpenListener(const char* localAddr) {
+    char fullAddress[INET_ADDRSTRLEN + 6];
+    sprintf_s(fullAddress, "%s:%s", localAddr, TEST_PORT);
+
+    std::cout << "CURSOR: Listening on " << fullAddress << std::endl;
+    if (FAILED(Listen(fullAddress))) std::terminate();
+
+    if (FAILED(GetConnectionRequest())) {
+        std::cerr << "CURSOR: " << "GetConnectionRequest failed. Reason: " << std::hex << GetResult() << std::endl;
+        return;
+    }
+
+    if (FAILED(Accept(1, 1, nullptr, 0))) std::terminate();
+    std::cout << "CURSOR: Connection established." << std::endl;
+
+    CreateMW();
+    Bind(m_Buf, CURSOR_BUFFER_SIZE, ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ);
+}
+
+void CursorNDSessionServer::ExchangePeerInfo() {
+    PeerInfo myInfo = { reinterpret_cast<UINT64>(m_Buf), m_pMw->GetRemoteToken() };
+
+    ND2_SGE sge = {m_Buf, sizeof(PeerInfo), m_pMr->GetLocalToken()};
+    if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+        std::cerr << "CURSOR: " << "PostReceive for PeerInfo failed." << std::endl;
+        return;
+    }
+
+    if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
+        std::cerr << "CURSOR: " << "WaitForCompletion for PeerInfo failed." << std::endl;
+        return;
+    }
+
+    remoteInfo.remoteAddr = reinterpret_cast<PeerInfo*>(m_Buf)->remoteAddr;
+    remoteInfo.remoteToken = reinterpret_cast<PeerInfo*>(m_Buf)->remoteToken;
+
+    memset(m_Buf, 0, CURSOR_BUFFER_SIZE);
+    memcpy(m_Buf, &myInfo, sizeof(PeerInfo));
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
+        std::cerr << "CURSOR: " << "Send for PeerInfo failed." << std::endl;
+        return;
+    }
+    if (!WaitForCompletionAndCheckContext(SEND_CTXT)) {
+        std::cerr << "CURSOR: " << "WaitForCompletion for PeerInfo send failed." << std::endl;
+        return;
+    }
+
+    memset(m_Buf, 0, CURSOR_BUFFER_SIZE);
+}
+
+void CursorNDSessionServer::Loop() {
+    uint32_t* ready = reinterpret_cast<uint32_t*>(m_Buf);
+    uint8_t* message = reinterpret_cast<uint8_t*>(m_Buf) + sizeof(uint32_t);
+    ND2_SGE sge = { message, static_cast<ULONG>(FrameCodec::MAX_CURSOR_MESSAGE_SIZE), m_pMr->GetLocalToken() };
+
+    uint32_t posted = 0;
+    if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+        std::cerr << "CURSOR: " << "PostReceive for cursor message failed." << std::endl;
+        return;
+    }
+    *reinterpret_cast<volatile uint32_t*>(ready) = ++posted;
+
+    while (m_isRunning && !g_shouldQuit.load()) {
+        ULONG length = 0;
+        if (!WaitForCompletionAndCheckContext(RECV_CTXT, ND_CQ_NOTIFY_ANY, &length)) {
+            std::cerr << "CURSOR: " << "WaitForCompletion for cursor message failed." << std::endl;
+            break;
+        }
+
+        // Take the message out and re-arm right away; the client may already be polling `ready`
+        memcpy(m_Message.data(), message, length);
+        if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+            std::cerr << "CURSOR: " << "PostReceive for cursor message failed." << std::endl;
+            break;
+        }
+        *reinterpret_cast<volatile uint32_t*>(ready) = ++posted;
+
+        if (!m_Decoder.Decode(m_Message.data(), length)) {
+            std::cerr << "CURSOR: " << "Malformed cursor message." << std::endl;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_CallbackMutex);
+        if (m_Callback) m_Callback(m_Decoder);
+    }
+}
+
+bool CursorNDSessionServer::WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag, ULONG* bytesTransferred) {
+    ND2_RESULT ndRes = WaitForCompletion(notifyFlag, true);
+
+    if (ndRes.Status == ND_CANCELED) {
+        std::cout << "CURSOR: " << "Remote has closed the connection." << std::endl;
+        return false;
+    }
+
+    if (ND_SUCCESS != ndRes.Status) {
+        std::cerr << "CURSOR: " << "Operation failed with status: " << std::hex << ndRes.Status << std::endl;
+        #ifdef _DEBUG
+        std::terminate();
+        #endif
+        return false;
+    }
+    if (expectedContext != ndRes.RequestContext) {
+        std::cerr << "CURSOR: " << "Unexpected completion. Check for missing WaitForCompletion() call." << std::endl;
+        throw std::exception();
+        return false;
+    }
+
+    if (bytesTransferred) *bytesTransferred = ndRes.BytesTransferred;
+    return true;
+}
+
+// MARK: CursorNDSessionClient
+bool CursorNDSessionClient::Setup(const char* localAddr) {
+    if (!Initialize(const_cast<char*>(localAddr))) std::terminate();
+
+    ND2_ADAPTER_INFO info = GetAdapterInfo();
+    if (info.AdapterId == 0) std::terminate();
+
+    if (FAILED(CreateCQ(info.MaxCompletionQueueDepth))) std::terminate();
+    if (FAILED(CreateQP(info.MaxReceiveQueueDepth, info.MaxInitiatorQueueDepth, info.MaxReceiveSge, info.MaxInitiatorSge))) std::terminate();
+    if (FAILED(CreateMR())) std::terminate();
+
+    ULONG flags = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
+    if (FAILED(RegisterDataBuffer(CURSOR_BUFFER_SIZE, flags))) std::terminate();
+    if (FAILED(CreateConnector())) std::terminate();
+
+    return true;
+}
+
+void CursorNDSessionClient::OpenConnector(const char* localAddr, const char* serverAddr) {
+    char fullServerAddress[INET_ADDRSTRLEN + 6];
+    sprintf_s(fullServerAddress, "%s:%s", serverAddr, TEST_PORT);
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (FAILED(Connect(localAddr, fullServerAddress, 1, 1, nullptr, 0))) {
+        std::cerr << "CURSOR: " << "Connect failed." << std::endl;
+        return;
+    }
+    if (FAILED(CompleteConnect())) {
+        std::cerr << "CURSOR: " << "CompleteConnect failed." << std::endl;
+        return;
+    }
+
+    CreateMW();
+    Bind(m_Buf, CURSOR_BUFFER_SIZE, ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ);
+}
+
+void CursorNDSessionClient::ExchangePeerInfo() {
+    PeerInfo* myInfo = reinterpret_cast<PeerInfo*>(m_Buf);
+    myInfo->remoteAddr = reinterpret_cast<UINT64>(m_Buf);
+    myInfo->remoteToken = m_pMw->GetRemoteToken();
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    ND2_SGE sge = {m_Buf, sizeof(PeerInfo), m_pMr->GetLocalToken()};
+    if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
+        std::cerr << "CURSOR: " << "Send failed." << std::endl;
+        return;
+    }
+    if (!WaitForCompletionAndCheckContext(SEND_CTXT)) {
+        std::cerr << "CURSOR: " << "WaitForCompletion for PeerInfo send failed." << std::endl;
+        return;
+    }
+
+    memset(m_Buf, 0, CURSOR_BUFFER_SIZE);
+    sge = {m_Buf, sizeof(PeerInfo), m_pMr->GetLocalToken()};
+    if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+        std::cerr << "CURSOR: " << "PostReceive for PeerInfo failed." << std::endl;
+        return;
+    }
+    if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
+        std::cerr << "CURSOR: " << "WaitForCompletion for PeerInfo receive failed." << std::endl;
+        return;
+    }
+
+    remoteInfo.remoteAddr = reinterpret_cast<PeerInfo*>(m_Buf)->remoteAddr;
+    remoteInfo.remoteToken = reinterpret_cast<PeerInfo*>(m_Buf)->remoteToken;
+
+    memset(m_Buf, 0, CURSOR_BUFFER_SIZE);
+}
+
+void CursorNDSessionClient::Post(const FrameCodec::CursorState& state) {
+    {
+        std::lock_guard<std::mutex> lock(m_StateMutex);
+        if (state.shapeId != m_State.shapeId) {
+            m_State = state;
+        } else {
+            m_State.visible = state.visible;
+            m_State.x = state.x;
+            m_State.y = state.y;
+        }
+        m_Pending = true;
+    }
+    m_StateCv.notify_one();
+}
+
+void CursorNDSessionClient::Loop() {
+    volatile uint32_t* ready = reinterpret_cast<uint32_t*>(m_Buf);
+    uint8_t* message = reinterpret_cast<uint8_t*>(m_Buf) + sizeof(uint32_t);
+    ND2_SGE readySge = { m_Buf, sizeof(uint32_t), m_pMr->GetLocalToken() };
+
+    FrameCodec::CursorState state;
+    uint32_t sent = 0;
+
+    while (m_isRunning && !g_shouldQuit.load()) {
+        {
+            std::unique_lock<std::mutex> lock(m_StateMutex);
+            m_StateCv.wait_for(lock, std::chrono::milliseconds(100), [this] { return m_Pending || !m_isRunning; });
+            if (!m_Pending) continue;
+
+            if (m_State.shapeId != state.shapeId) {
+                state = m_State;
+            } else {
+                state.visible = m_State.visible;
+                state.x = m_State.x;
+                state.y = m_State.y;
+            }
+            m_Pending = false;
+        }
+
+        size_t length = m_Encoder.Encode(state, message);
+
+        // Wait for the server to post a receive for this message
+        while (static_cast<int32_t>(*ready - sent) <= 0) {
+            if (FAILED(Read(&readySge, 1, remoteInfo.remoteAddr, remoteInfo.remoteToken, 0, READ_CTXT))) {
+                std::cerr << "CURSOR: " << "Read failed." << std::endl;
+                return;
+            }
+            if (!WaitForCompletionAndCheckContext(READ_CTXT)) {
+                std::cerr << "CURSOR: " << "WaitForCompletion for ready read failed." << std::endl;
+                return;
+            }
+            if (!m_isRunning) return;
+        }
+
+        ND2_SGE sge = { message, static_cast<ULONG>(length), m_pMr->GetLocalToken() };
+        if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
+            std::cerr << "CURSOR: " << "Send failed." << std::endl;
+            return;
+        }
+        if (!WaitForCompletionAndCheckContext(SEND_CTXT)) {
+            std::cerr << "CURSOR: " << "WaitForCompletion for cursor send failed." << std::endl;
+            return;
+        }
+        sent++;
+    }
+}
+
+bool CursorNDSessionClient::WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag) {
+    ND2_RESULT ndRes = WaitForCompletion(notifyFlag, true);
+
+    if (ndRes.Status == ND_CANCELED) {
+        std::cout << "CURSOR: " << "Remote has closed the connection." << std::endl;
+        return false;
+    }
+
+    if (ND_SUCCESS != ndRes.Status) {
+        std::cerr << "CURSOR: " << "Operation failed with status: " << std::hex << ndRes.Status << std::endl;
+        #ifdef _DEBUG
+        std::terminate();
+        #endif
+        return false;
+    }
+    if (expectedContext != ndRes.RequestContext) {
+        std::cerr << "CURSOR: " << "Unexpected completion. Check for missing WaitForCompletion() call." << std::endl;
+        throw std::exception();
+        return false;
+    }
+
+    return true;
+}
@@ -9,6 +9,7 @@
 #include <dxgi1_6.h>
 #include <wrl/client.h>
 #include <cstdint>
+#include <mutex>
 
 /*
 * ======================================================================
@@ -43,7 +44,9 @@ namespace D2DPresentation {
 
         HRESULT Initialize(IDXGIAdapter* pAdapter, HWND hwnd, UINT width, UINT height, const D3D11_TEXTURE2D_DESC* ptextureDesc = nullptr);
         
-        void SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface);
+        // width/height pick the top-left region of sourceSurface holding the frame, for frames sent below the
+        // negotiated size; it is stretched over the same area a full-size frame would cover. 0 means the whole surface.
+        void SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface, UINT width = 0, UINT height = 0);
 
         void Render();
 
@@ -55,6 +58,16 @@ namespace D2DPresentation {
         ComPtr<ID3D11DeviceContext> GetD3DContext() const { return m_d3dContext; }
 
         bool DecompressTexture(ID3D11Texture2D* yPlane, ID3D11Texture2D* uvPlane, ID3D11Texture2D* outputTexture);
+        // Compute shader DecompressTexture() runs, one of the shaders/4xx_2BGRA.hlsl files for the session's pixel format,
+        // with `defines` setting shaders/YuvMatrix.hlsli's matrix and range. Initialize() loads the 4:4:0 one in BT.601 full range.
+        HRESULT SetDecompressShader(const wchar_t* path, const D3D_SHADER_MACRO* defines = nullptr);
+
+        // Pointer drawn over the frame, in source pixels. The bitmap is only rebuilt when shapeId changes.
+        void SetCursorShape(uint64_t shapeId, const uint8_t* pixels, UINT width, UINT height);
+        void SetCursorPosition(int x, int y, bool visible);
+
+        // Render() may run on the cursor thread too; hold this around any other use of the D3D context
+        std::mutex& GetContextMutex() { return m_contextMutex; }
 
         private:
         HRESULT createD3DDeviceAndSwapChain(IDXGIAdapter* pAdapter);
@@ -81,6 +94,8 @@ namespace D2DPresentation {
 
         ComPtr<ID3D11Texture2D> m_sharedTexture;
         ComPtr<ID2D1Bitmap1> m_d2dSourceBitmap;
+        UINT m_sourceWidth = 0;  // Region of m_sharedTexture holding the frame, 0 when it is all of it
+        UINT m_sourceHeight = 0;
 
         ComPtr<ID3D11ComputeShader> m_DecompressShader;
 
@@ -89,6 +104,14 @@ namespace D2DPresentation {
         ComPtr<ID3D11UnorderedAccessView> m_outputUAV;
 
         HANDLE m_frameWaitableObject = nullptr;
+
+        std::mutex m_contextMutex;
+
+        ComPtr<ID2D1Bitmap> m_cursorBitmap;
+        uint64_t m_cursorShapeId = 0;
+        int m_cursorX = 0;
+        int m_cursorY = 0;
+        bool m_cursorVisible = false;
     };
 }
 
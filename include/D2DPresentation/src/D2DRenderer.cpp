@@ -121,29 +121,41 @@ HRESULT D2DRenderer::Initialize(IDXGIAdapter* pAdapter, HWND hwnd, UINT width, U
         return hr;
     }
 
+    hr = SetDecompressShader(L"shaders/440_2BGRA.hlsl");
+    if (FAILED(hr)) {
+        abort();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT D2DRenderer::SetDecompressShader(const wchar_t* path, const D3D_SHADER_MACRO* defines) {
     // Compile shader
     ComPtr<ID3DBlob> shaderBlob;
     ComPtr<ID3DBlob> errorBlob;
-    hr = D3DCompileFromFile(L"shaders/440_2BGRA.hlsl", nullptr, nullptr, "main", "cs_5_0", 0, 0, &shaderBlob, &errorBlob);
+    HRESULT hr = D3DCompileFromFile(path, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "cs_5_0", 0, 0, &shaderBlob, &errorBlob);
     if (FAILED(hr)) {
         if (errorBlob) {
             std::cerr << "Shader compilation error: " << static_cast<const char*>(errorBlob->GetBufferPointer()) << std::endl;
         }
-        abort();
         return hr;
     }
 
-    hr = m_d3dDevice->CreateComputeShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, m_DecompressShader.GetAddressOf());
+    ComPtr<ID3D11ComputeShader> shader;
+    hr = m_d3dDevice->CreateComputeShader(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize(), nullptr, shader.GetAddressOf());
     if (hr == S_FALSE || FAILED(hr)) {
         std::cerr << "Failed to create compute shader: " << std::hex << hr << std::endl;
-        abort();
-        return hr;
+        return FAILED(hr) ? hr : E_FAIL;
     }
 
+    std::lock_guard<std::mutex> lock(m_contextMutex);
+    m_DecompressShader = shader;
     return S_OK;
 }
 
-void D2DRenderer::SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface) {
+void D2DRenderer::SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface, UINT width, UINT height) {
+    std::lock_guard<std::mutex> lock(m_contextMutex);
     m_d2dSourceBitmap.Reset();
 
     if (!sourceSurface) {
@@ -154,8 +166,33 @@ void D2DRenderer::SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface)
     D3D11_TEXTURE2D_DESC desc;
     sourceSurface->GetDesc(&desc);
 
-    m_d3dContext->CopyResource(m_sharedTexture.Get(), sourceSurface.Get());
+    // Sources follow the session's mode, which can change mid-session; the copy target follows them
+    D3D11_TEXTURE2D_DESC sharedDesc = {};
+    if (m_sharedTexture) m_sharedTexture->GetDesc(&sharedDesc);
+    if (!m_sharedTexture || sharedDesc.Width != desc.Width || sharedDesc.Height != desc.Height) {
+        sharedDesc.Width = desc.Width;
+        sharedDesc.Height = desc.Height;
+        sharedDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        sharedDesc.SampleDesc.Count = 1;
+        sharedDesc.MipLevels = 1;
+        sharedDesc.ArraySize = 1;
+        sharedDesc.Usage = D3D11_USAGE_DEFAULT;
+        sharedDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+        m_sharedTexture.Reset();
+        if (FAILED(m_d3dDevice->CreateTexture2D(&sharedDesc, nullptr, m_sharedTexture.GetAddressOf()))) return;
+    }
 
+    if (width == 0 || height == 0 || (width >= desc.Width && height >= desc.Height)) {
+        m_d3dContext->CopyResource(m_sharedTexture.Get(), sourceSurface.Get());
+        m_sourceWidth = 0;
+        m_sourceHeight = 0;
+    } else {
+        D3D11_BOX box = { 0, 0, 0, std::min(width, desc.Width), std::min(height, desc.Height), 1 };
+        m_d3dContext->CopySubresourceRegion(m_sharedTexture.Get(), 0, 0, 0, 0, sourceSurface.Get(), 0, &box);
+        m_sourceWidth = box.right;
+        m_sourceHeight = box.bottom;
+    }
 
     D2D1_BITMAP_PROPERTIES1 bitmapProperties = D2D1::BitmapProperties1(
         D2D1_BITMAP_OPTIONS_NONE,
@@ -176,6 +213,7 @@ void D2DRenderer::SetSourceSurface(const ComPtr<ID3D11Texture2D>& sourceSurface)
 }
 
 bool D2DRenderer::DecompressTexture(ID3D11Texture2D* yPlane, ID3D11Texture2D* uvPlane, ID3D11Texture2D* outputTexture) {
+    std::lock_guard<std::mutex> lock(m_contextMutex);
     D3D11_QUERY_DESC queryDesc = {};
     queryDesc.Query = D3D11_QUERY_EVENT;
     queryDesc.MiscFlags = 0;
@@ -221,9 +259,11 @@ bool D2DRenderer::DecompressTexture(ID3D11Texture2D* yPlane, ID3D11Texture2D* uv
     ID3D11UnorderedAccessView* uavs[] = { outputUAV.Get() };
     m_d3dContext->CSSetUnorderedAccessViews(0, 1, uavs, nullptr);
     
-    // Dispatch compute shader (assuming 1920x1080 resolution)
-    UINT dispatchX = (m_width + 15) / 16;  // Round up for 16x16 thread groups
-    UINT dispatchY = (m_height + 15) / 16;
+    // One thread per output pixel; the output follows the session's mode, not the window
+    D3D11_TEXTURE2D_DESC outputDesc;
+    outputTexture->GetDesc(&outputDesc);
+    UINT dispatchX = (outputDesc.Width + 15) / 16;  // Round up for 16x16 thread groups
+    UINT dispatchY = (outputDesc.Height + 15) / 16;
     m_d3dContext->Dispatch(dispatchX, dispatchY, 1);
     
     m_d3dContext->End(query.Get());
@@ -247,6 +287,9 @@ void D2DRenderer::Render() {
 
     WaitForSingleObjectEx(m_frameWaitableObject, 100, true);
 
+    std::lock_guard<std::mutex> lock(m_contextMutex);
+    if (!m_isRunning) return;
+
     m_d2dContext->BeginDraw();
     m_d2dContext->SetTarget(m_d2dTargetBitmap.Get());
     m_d2dContext->Clear(D2D1::ColorF(D2D1::ColorF::Black));
@@ -286,7 +329,26 @@ void D2DRenderer::Render() {
             interpolationMode = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR;
         }
 
-        m_d2dContext->DrawBitmap(m_d2dSourceBitmap.Get(), destRect, 1.0f, interpolationMode);
+        if (m_sourceWidth && m_sourceHeight) {
+            // Downscaled frame: stretch its region over the full-size layout so the window and cursor mapping stay put
+            D2D1_RECT_F sourceRect = D2D1::RectF(0.0f, 0.0f, static_cast<float>(m_sourceWidth), static_cast<float>(m_sourceHeight));
+            m_d2dContext->DrawBitmap(m_d2dSourceBitmap.Get(), destRect, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, &sourceRect);
+        } else {
+            m_d2dContext->DrawBitmap(m_d2dSourceBitmap.Get(), destRect, 1.0f, interpolationMode);
+        }
+
+        if (m_cursorVisible && m_cursorBitmap) {
+            float cursorScale = (destRect.right - destRect.left) / sourceWidth;
+            D2D1_SIZE_F cursorSize = m_cursorBitmap->GetSize();
+            float left = destRect.left + m_cursorX * cursorScale;
+            float top = destRect.top + m_cursorY * cursorScale;
+
+            m_d2dContext->PushAxisAlignedClip(destRect, D2D1_ANTIALIAS_MODE_ALIASED);
+            m_d2dContext->DrawBitmap(m_cursorBitmap.Get(),
+                D2D1::RectF(left, top, left + cursorSize.width * cursorScale, top + cursorSize.height * cursorScale),
+                1.0f, interpolationMode);
+            m_d2dContext->PopAxisAlignedClip();
+        }
     }
 
     HRESULT hr = m_d2dContext->EndDraw();
@@ -304,6 +366,33 @@ void D2DRenderer::Render() {
     }
 }
 
+void D2DRenderer::SetCursorShape(uint64_t shapeId, const uint8_t* pixels, UINT width, UINT height) {
+    std::lock_guard<std::mutex> lock(m_contextMutex);
+    if (!m_d2dContext || (shapeId == m_cursorShapeId && m_cursorBitmap)) return;
+
+    m_cursorBitmap.Reset();
+    m_cursorShapeId = shapeId;
+    if (!pixels || width == 0 || height == 0) return;
+
+    HRESULT hr = m_d2dContext->CreateBitmap(
+        D2D1::SizeU(width, height),
+        pixels,
+        width * 4,
+        D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+        m_cursorBitmap.GetAddressOf()
+    );
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create cursor bitmap: " << std::hex << hr << std::endl;
+    }
+}
+
+void D2DRenderer::SetCursorPosition(int x, int y, bool visible) {
+    std::lock_guard<std::mutex> lock(m_contextMutex);
+    m_cursorX = x;
+    m_cursorY = y;
+    m_cursorVisible = visible;
+}
+
 // Not in use && Do not use
 HRESULT D2DRenderer::Resize(UINT width, UINT height) {
     if (width == 0 || height == 0) {
@@ -508,6 +597,7 @@ HRESULT D2DRenderer::createSwapChainRenderTarget() {
 }
 
 void D2DRenderer::cleanup() {
+    std::lock_guard<std::mutex> lock(m_contextMutex);
     m_isRunning = false;
 
     if (m_d2dContext) {
@@ -524,4 +614,5 @@ void D2DRenderer::cleanup() {
     m_d2dTargetBitmap.Reset();
     m_d2dSourceBitmap.Reset();
     m_sharedTexture.Reset();
+    m_cursorBitmap.Reset();
 }
\ No newline at end of file
@@ -3,20 +3,34 @@
 #include <dxgi1_6.h>
 #include <wrl/client.h>
 #include <string>
+#include <vector>
 #include <SetupAPI.h>
 #include <devguid.h>
 #include <filesystem>
 #include <d2d1_3.h>
+#include <functional>
+
+#include "BandLayout.hpp"
+#include "CaptureRegion.hpp"
+#include "ColorSpace.hpp"
+#include "CursorCodec.hpp"
+#include "FrameSource.hpp"
+#include "OutputLayout.hpp"
 
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "SetupAPI.lib")
 #pragma comment(lib, "windowscodecs.lib")
 #pragma comment(lib, "d2d1.lib")
+#pragma comment(lib, "dwmapi.lib")
 
 using Microsoft::WRL::ComPtr;
 
 namespace DesktopDuplication {
+    // GetFrame() returns -1 on timeout, 1 on failure, 0 for a new frame, or this when nothing on screen
+    // changed since the previous frame (only the pointer moved, and the pointer is not drawn into frames).
+    constexpr int FRAME_UNCHANGED = 2;
+
     template <typename T>
     class Singleton {
         public:
@@ -42,6 +56,8 @@ namespace DesktopDuplication {
         ID3D11DeviceContext4* GetContext() { return m_Context.Get(); }
 
         void SetOutput(UINT adapterIndex, UINT outputIndex);
+        UINT GetAdapterIndex() const { return m_AdapterIndex; }
+        UINT GetOutputIndex() const { return m_Output; }
         void GetTelemetry(_Out_ unsigned long long& frameCount, _Out_ unsigned int& framePerUnit);
 
         bool InitDuplication();
@@ -53,8 +69,40 @@ namespace DesktopDuplication {
 
         int GetFrame(_Out_ ID3D11Texture2D*& frame, _In_ unsigned long timemout = 16);
 
+        // True when the last GetStagedTexture() call returned false because the frame had no new content.
+        // The caller's staged texture still holds the previous frame, so there is nothing to read back or send.
+        bool WasFrameUnchanged() const { return m_LastFrameUnchanged; }
+
+        // FrameCodec::FrameClockNow() at the moment the last AcquireNextFrame() returned a frame
+        uint64_t GetLastAcquireTime() const { return m_LastAcquireTime; }
+
         void ReleaseFrame();
 
+        // Mode of the duplicated output. The generation moves on every time duplication had to be recreated
+        // (a display mode switch, the secure desktop), so callers only need to query the mode when it did.
+        bool GetMode(_Out_ unsigned short& width, _Out_ unsigned short& height, _Out_ unsigned short& refreshRate);
+        unsigned int GetModeGeneration() const { return m_ModeGeneration; }
+
+        // With a callback set, the pointer is no longer drawn into frames. Position and shape changes
+        // are reported to `callback` from GetFrame() instead, for the viewer to draw on its own.
+        void SetPointerCallback(std::function<void(const FrameCodec::CursorState&)> callback) { m_PointerCallback = std::move(callback); }
+
+        // GetStagedTexture(dst, timeout) copies only `region` of each frame, clamped into the output, so `dst` must
+        // have the region's size. A region of width 0 stages the whole output again.
+        void SetRegion(const FrameCodec::CaptureRegion& region);
+        const FrameCodec::CaptureRegion& GetRegion() const { return m_Region; }
+
+        // The part of `window` on this output, in the output's pixels. False when it is minimized, closed or elsewhere.
+        bool GetWindowRegion(HWND window, _Out_ FrameCodec::CaptureRegion& region);
+
+        // Planar YUV format GetStagedTexture(YPlane, UVPlane) produces, YUV440 until set. The UV plane is sized by
+        // FrameCodec::GetChromaLayout(), and so must the caller's staged UV texture be.
+        bool SetPixelFormat(FrameCodec::PixelFormat format);
+        FrameCodec::PixelFormat GetPixelFormat() const { return m_PixelFormat; }
+        // Matrix and range the compress shader converts with, BT.601 full range until set
+        bool SetColorSpace(FrameCodec::ColorSpace space);
+        FrameCodec::ColorSpace GetColorSpace() const { return m_ColorSpace; }
+
         private:
         int GetAndCompressTexture(unsigned long timeout);
         bool RecreateOutputDuplication();
@@ -70,6 +118,11 @@ namespace DesktopDuplication {
         UINT m_Output;
         UINT m_AdapterIndex;
         bool m_IsDuplRunning;
+        bool m_HasFrame = false;           // m_CompositionTexture holds a real desktop image
+        bool m_LastFrameUnchanged = false;
+        uint64_t m_LastAcquireTime = 0;
+        unsigned int m_ModeGeneration = 0;
+        FrameCodec::CaptureRegion m_Region = {}; // Width 0: the whole output
 
         ComPtr<ID2D1Factory3> m_D2DFactory;
         ComPtr<ID2D1Device2> m_D2DDevice;
@@ -80,11 +133,17 @@ namespace DesktopDuplication {
         std::vector<uint8_t> m_CursorShape;
         DXGI_OUTDUPL_POINTER_SHAPE_INFO m_CursorShapeInfo;
 
+        std::function<void(const FrameCodec::CursorState&)> m_PointerCallback;
+        FrameCodec::CursorState m_PointerState;
+
         void CompressTexture(ID3D11Texture2D* inputTexture);
+        bool CreateCompressShader();
 
         ComPtr<ID3D11Texture2D> m_YPlaneTexture;  // Stores the Y (luminance) plane
         ComPtr<ID3D11Texture2D> m_UVPlaneTexture; // Stores the UV (chroma) plane
-        ComPtr<ID3D11ComputeShader> m_CompressShader;   // Shader for 4:4:0 compression
+        ComPtr<ID3D11ComputeShader> m_CompressShader;   // Shader for m_PixelFormat's subsampling
+        FrameCodec::PixelFormat m_PixelFormat = FrameCodec::PixelFormat::YUV440;
+        FrameCodec::ColorSpace m_ColorSpace = FrameCodec::ColorSpace::BT601Full;
         ComPtr<ID3D11Buffer> m_ConstantsBuffer; // Buffer for shader constants (e.g., width, height)
 
         ComPtr<ID3D11Texture2D> m_SRTexture;
@@ -97,7 +156,46 @@ namespace DesktopDuplication {
         unsigned short counter = 0;
     };
 
+    // A Duplication as a FrameCodec::FrameSource: frames are staged into `staging` and stay mapped until Release().
+    // `staging` must have the size of the duplication's region, or of the whole output without one.
+    class DuplicationSource : public FrameCodec::FrameSource {
+        public:
+        DuplicationSource(Duplication& dupl, ComPtr<ID3D11Texture2D> staging);
+        ~DuplicationSource();
+
+        uint16_t GetWidth() const override { return static_cast<uint16_t>(m_Desc.Width); }
+        uint16_t GetHeight() const override { return static_cast<uint16_t>(m_Desc.Height); }
+        uint16_t GetRefreshRate() const override;
+
+        FrameCodec::AcquireResult Acquire(unsigned long timeoutMs, FrameCodec::SourceFrame& frame) override;
+        void Release() override;
+
+        void SetPointerCallback(std::function<void(const FrameCodec::CursorState&)> callback) override { m_Dupl.SetPointerCallback(std::move(callback)); }
+
+        private:
+        Duplication& m_Dupl;
+        ComPtr<ID3D11Texture2D> m_Staging;
+        D3D11_TEXTURE2D_DESC m_Desc = {};
+        bool m_Mapped = false;
+    };
+
     void ChooseOutput(_Out_ unsigned short& width, _Out_ unsigned short& height, _Out_ unsigned short& refreshRate);
+
+    // An output that can be duplicated, with its place on the desktop and its current mode
+    struct OutputInfo {
+        UINT adapterIndex;
+        UINT outputIndex;
+        std::wstring name;
+        FrameCodec::OutputDesc desc;
+    };
+    std::vector<OutputInfo> EnumerateOutputs(UINT adapterIndex);
+
+    // First visible top-level window whose title contains `title`, nullptr if there is none
+    HWND FindWindowByTitle(const std::wstring& title);
+
+    // ChooseOutput() for the first output, then up to `maxOutputs` - 1 more on the same adapter. The first one
+    // is set on the Singleton; each of the others needs a Duplication of its own.
+    bool ChooseOutputs(_Out_ std::vector<OutputInfo>& outputs, unsigned int maxOutputs);
     int enumOutputs(IDXGIAdapter* adapter, unsigned short& width, unsigned short& height, unsigned short& refreshRate);
     std::wstring GetMonitorFriendlyName(const DXGI_OUTPUT_DESC1& desc);
     std::wstring GetMonitorNameFromEDID(const std::wstring& deviceName);
@@ -1,10 +1,12 @@
 #define UNICODE
 
 #include "./DesktopDuplication.hpp"
+#include "FrameHeader.hpp"
 
 #include <iostream> 
 #include <conio.h>
 #include <vector>
+#include <algorithm>
 #include <initguid.h>
 #include <Ntddvdeo.h>
 #include <SetupAPI.h>
@@ -14,6 +16,7 @@
 #include <d3dcompiler.h>
 #include <thread>
 #include <WtsApi32.h>
+#include <dwmapi.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "Wtsapi32.lib")
@@ -331,9 +334,26 @@ bool Duplication::InitDuplication() {
         return false;
     }
 
+    if (!CreateCompressShader()) return false;
+
+    m_IsDuplRunning = true;
+    return true;
+}
+
+bool Duplication::CreateCompressShader() {
+    const wchar_t* path = L"shaders/BGRA2_440.hlsl";
+    if (m_PixelFormat == FrameCodec::PixelFormat::YUV420) path = L"shaders/BGRA2_420.hlsl";
+    else if (m_PixelFormat == FrameCodec::PixelFormat::YUV422) path = L"shaders/BGRA2_422.hlsl";
+
+    // shaders/YuvMatrix.hlsli's KR, KB and LIMITED
+    const FrameCodec::YuvMatrix& matrix = FrameCodec::GetYuvMatrix(m_ColorSpace);
+    const std::string kr = std::to_string(matrix.kr);
+    const std::string kb = std::to_string(matrix.kb);
+    const D3D_SHADER_MACRO defines[] = { { "KR", kr.c_str() }, { "KB", kb.c_str() }, { "LIMITED", matrix.limited ? "1" : "0" }, { nullptr, nullptr } };
+
     ComPtr<ID3DBlob> compressBlob;
     ComPtr<ID3DBlob> errorBlob;
-    hr = D3DCompileFromFile(L"shaders/BGRA2_440.hlsl", nullptr, nullptr, "main", "cs_5_0", 0, 0, &compressBlob, &errorBlob);
+    HRESULT hr = D3DCompileFromFile(path, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, "main", "cs_5_0", 0, 0, &compressBlob, &errorBlob);
     
     if (FAILED(hr)) {
         std::cerr << "Failed to compile shader. Reason: 0x" << std::hex << hr << std::endl;
@@ -344,15 +364,37 @@ bool Duplication::InitDuplication() {
         return false;
     }
     
+    m_CompressShader.Reset();
     if (FAILED(m_Device->CreateComputeShader(compressBlob->GetBufferPointer(), compressBlob->GetBufferSize(), nullptr, m_CompressShader.GetAddressOf()))) {
         std::cerr << "Failed to create compute shader for texture compression." << std::endl;
         return false;
     }
-
-    m_IsDuplRunning = true;
     return true;
 }
 
+bool Duplication::SetPixelFormat(FrameCodec::PixelFormat format) {
+    if (!FrameCodec::IsPlanarYuv(format)) return false;
+    if (format == m_PixelFormat) return true;
+
+    // The planes are rebuilt at the new UV size on the next frame
+    m_PixelFormat = format;
+    m_YPlaneTexture.Reset();
+    m_UVPlaneTexture.Reset();
+    inputSRV.Reset();
+    yPlaneUAV.Reset();
+    uvPlaneUAV.Reset();
+    return !m_Device || CreateCompressShader();
+}
+
+bool Duplication::SetColorSpace(FrameCodec::ColorSpace space) {
+    if (static_cast<size_t>(space) >= FrameCodec::COLOR_SPACE_COUNT) return false;
+    if (space == m_ColorSpace) return true;
+
+    // Same planes, another shader
+    m_ColorSpace = space;
+    return !m_Device || CreateCompressShader();
+}
+
 bool Duplication::SaveFrame(const std::filesystem::path& path) {
     if (!m_IsDuplRunning) {
         std::cerr << "Desktop Duplication is not running. Call DesktopDuplication::InitDuplication() to start the duplication." << std::endl;
@@ -528,12 +570,77 @@ bool Duplication::RecreateOutputDuplication() {
     //RevertToSelf();
     //CloseHandle(userToken);
 
+    // Lost access may have been a display mode switch; textures sized for the old mode are rebuilt on first use
+    DXGI_OUTDUPL_DESC duplDesc;
+    m_DesktopDupl->GetDesc(&duplDesc);
+    if (m_CompositionTexture) {
+        D3D11_TEXTURE2D_DESC desc;
+        m_CompositionTexture->GetDesc(&desc);
+        if (desc.Width != duplDesc.ModeDesc.Width || desc.Height != duplDesc.ModeDesc.Height) {
+            m_CompositionTexture.Reset();
+            m_LastCleanTexture.Reset();
+            m_YPlaneTexture.Reset();
+            m_UVPlaneTexture.Reset();
+            inputSRV.Reset();
+            yPlaneUAV.Reset();
+            uvPlaneUAV.Reset();
+            m_HasFrame = false;
+        }
+    }
+    // Keep the crop inside a smaller mode until the caller sizes it again
+    SetRegion(m_Region);
+    m_ModeGeneration++;
+
+    return true;
+}
+
+bool Duplication::GetMode(unsigned short& width, unsigned short& height, unsigned short& refreshRate) {
+    width = height = refreshRate = 0;
+    if (!m_DesktopDupl) return false;
+
+    DXGI_OUTDUPL_DESC desc;
+    m_DesktopDupl->GetDesc(&desc);
+    width = static_cast<unsigned short>(desc.ModeDesc.Width);
+    height = static_cast<unsigned short>(desc.ModeDesc.Height);
+    // Truncated like DEVMODE's dmDisplayFrequency, which ChooseOutput() reports: 59.94Hz is 59
+    const DXGI_RATIONAL rate = desc.ModeDesc.RefreshRate;
+    refreshRate = static_cast<unsigned short>(rate.Denominator ? rate.Numerator / rate.Denominator : 0);
+    return true;
+}
+
+void Duplication::SetRegion(const FrameCodec::CaptureRegion& region) {
+    unsigned short width, height, refreshRate;
+    if (region.width == 0 || !GetMode(width, height, refreshRate)) {
+        m_Region = {};
+        return;
+    }
+    m_Region = FrameCodec::ClampRegion(region, width, height);
+}
+
+bool Duplication::GetWindowRegion(HWND window, FrameCodec::CaptureRegion& region) {
+    region = {};
+    if (!IsWindow(window) || IsIconic(window) || !m_DXGIOutput) return false;
+
+    // The extended frame bounds leave out the invisible resize borders GetWindowRect() includes
+    RECT bounds;
+    if (FAILED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &bounds, sizeof(bounds))) && !GetWindowRect(window, &bounds)) return false;
+
+    DXGI_OUTPUT_DESC desc;
+    if (FAILED(m_DXGIOutput->GetDesc(&desc))) return false;
+    RECT visible;
+    if (!IntersectRect(&visible, &bounds, &desc.DesktopCoordinates)) return false;
+
+    region.left = static_cast<uint16_t>(visible.left - desc.DesktopCoordinates.left);
+    region.top = static_cast<uint16_t>(visible.top - desc.DesktopCoordinates.top);
+    region.width = static_cast<uint16_t>(visible.right - visible.left);
+    region.height = static_cast<uint16_t>(visible.bottom - visible.top);
     return true;
 }
 
 int Duplication::GetFrame(ID3D11Texture2D*& frame, unsigned long timeout) {
     ComPtr<IDXGIResource> desktopResource;
     DXGI_OUTDUPL_FRAME_INFO frameInfo;
+    m_LastFrameUnchanged = false;
 
     HRESULT hr = m_DesktopDupl->AcquireNextFrame(timeout, &frameInfo, &desktopResource);
     if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
@@ -550,6 +657,7 @@ int Duplication::GetFrame(ID3D11Texture2D*& frame, unsigned long timeout) {
         std::cerr << "Failed to acquire next frame. Reason: 0x" << std::hex << hr << std::endl;
         return 1;
     }
+    m_LastAcquireTime = FrameCodec::FrameClockNow();
 
     if (m_AcquiredDesktopImage) {
         m_AcquiredDesktopImage.Reset();
@@ -615,11 +723,48 @@ int Duplication::GetFrame(ID3D11Texture2D*& frame, unsigned long timeout) {
     // I doubt that fence will help now, but I'm too bothered to test it.
     // Just resetting BindFlags is fine for now, and being honest I think that's the best solution, at least what I can think of. 
 
+    // No present since the last frame: the desktop is the same. Unless the pointer has to be redrawn into it,
+    // the composition texture already holds exactly what the caller got last time.
+    bool unchanged = false;
     if (frameInfo.LastPresentTime.QuadPart == 0) {
-        m_Context->CopyResource(m_CompositionTexture.Get(), m_LastCleanTexture.Get());
+        unchanged = m_HasFrame && (m_PointerCallback || frameInfo.LastMouseUpdateTime.QuadPart == 0);
+        if (!unchanged) m_Context->CopyResource(m_CompositionTexture.Get(), m_LastCleanTexture.Get());
     } else {
         m_Context->CopyResource(m_CompositionTexture.Get(), m_AcquiredDesktopImage.Get());
         m_Context->CopyResource(m_LastCleanTexture.Get(), m_AcquiredDesktopImage.Get());
+        m_HasFrame = true;
+    }
+
+    // Pointer travels on its own channel: keep the frame clean and report what changed
+    if (m_PointerCallback) {
+        if (frameInfo.LastMouseUpdateTime.QuadPart != 0) {
+            if (frameInfo.PointerShapeBufferSize != 0) {
+                m_CursorShape.resize(frameInfo.PointerShapeBufferSize);
+                UINT requiredSize = 0;
+                hr = m_DesktopDupl->GetFramePointerShape(frameInfo.PointerShapeBufferSize, m_CursorShape.data(), &requiredSize, &m_CursorShapeInfo);
+                if (FAILED(hr)) {
+                    std::cerr << "Failed to get pointer shape. Reason: 0x" << std::hex << hr << std::endl;
+                } else {
+                    FrameCodec::ConvertCursorShape(static_cast<FrameCodec::CursorShapeType>(m_CursorShapeInfo.Type),
+                        m_CursorShapeInfo.Width, m_CursorShapeInfo.Height, m_CursorShapeInfo.Pitch, m_CursorShape.data(), m_PointerState);
+                }
+            }
+
+            m_PointerState.visible = frameInfo.PointerPosition.Visible != FALSE;
+            m_PointerState.x = frameInfo.PointerPosition.Position.x;
+            m_PointerState.y = frameInfo.PointerPosition.Position.y;
+            m_PointerCallback(m_PointerState);
+        }
+
+        ReleaseFrame();
+        frame = m_CompositionTexture.Get();
+        return unchanged ? FRAME_UNCHANGED : 0;
+    }
+
+    if (unchanged) {
+        ReleaseFrame();
+        frame = m_CompositionTexture.Get();
+        return FRAME_UNCHANGED;
     }
 
     // Draw cursor if visible
@@ -752,8 +897,10 @@ void Duplication::CompressTexture(ID3D11Texture2D* inputTexture) {
         desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
         m_Device->CreateTexture2D(&desc, nullptr, m_YPlaneTexture.GetAddressOf());
 
-        // UV plane - half height for 4:4:0 subsampling
-        desc.Height = desc.Height / 2;
+        // UV plane - halved along the axes m_PixelFormat subsamples
+        const FrameCodec::ChromaLayout chroma = FrameCodec::GetChromaLayout(m_PixelFormat);
+        desc.Width = FrameCodec::ChromaWidth(chroma, desc.Width);
+        desc.Height = FrameCodec::ChromaHeight(chroma, desc.Height);
         desc.Format = DXGI_FORMAT_R8G8_UNORM;
         m_Device->CreateTexture2D(&desc, nullptr, m_UVPlaneTexture.GetAddressOf());
     
@@ -856,6 +1003,9 @@ bool Duplication::GetStagedTexture(_Out_ ID3D11Texture2D*& dst, _In_ unsigned lo
             return false;
         case -1:
             return false;
+        case FRAME_UNCHANGED:
+            m_LastFrameUnchanged = true;
+            return false;
     }
 
     /*
@@ -871,12 +1021,62 @@ bool Duplication::GetStagedTexture(_Out_ ID3D11Texture2D*& dst, _In_ unsigned lo
     m_Device->CreateTexture2D(&desc, nullptr, &dst);
     */
     
-    m_Context->CopyResource(dst, frame);
+    if (m_Region.width) {
+        // Only the region leaves the desktop image, so the readback and everything after it scale with the region
+        const D3D11_BOX box = { m_Region.left, m_Region.top, 0, static_cast<UINT>(m_Region.left + m_Region.width),
+                                static_cast<UINT>(m_Region.top + m_Region.height), 1 };
+        m_Context->CopySubresourceRegion(dst, 0, 0, 0, 0, frame, 0, &box);
+    } else {
+        m_Context->CopyResource(dst, frame);
+    }
     ReleaseFrame();
 
     return true;
 }
 
+DuplicationSource::DuplicationSource(Duplication& dupl, ComPtr<ID3D11Texture2D> staging) : m_Dupl(dupl), m_Staging(std::move(staging)) {
+    if (m_Staging) m_Staging->GetDesc(&m_Desc);
+}
+
+DuplicationSource::~DuplicationSource() {
+    Release();
+}
+
+uint16_t DuplicationSource::GetRefreshRate() const {
+    unsigned short width, height, refreshRate;
+    return m_Dupl.GetMode(width, height, refreshRate) ? refreshRate : 0;
+}
+
+FrameCodec::AcquireResult DuplicationSource::Acquire(unsigned long timeoutMs, FrameCodec::SourceFrame& frame) {
+    if (!m_Staging) return FrameCodec::AcquireResult::Failed;
+    Release();
+
+    ID3D11Texture2D* staging = m_Staging.Get();
+    if (!m_Dupl.GetStagedTexture(staging, timeoutMs)) {
+        // Failures recreate the duplication inside GetFrame(); to the caller they look like a missed frame
+        return m_Dupl.WasFrameUnchanged() ? FrameCodec::AcquireResult::Unchanged : FrameCodec::AcquireResult::Timeout;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = m_Dupl.GetContext()->Map(staging, 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to map the staged frame. Reason: 0x" << std::hex << hr << std::dec << std::endl;
+        return FrameCodec::AcquireResult::Failed;
+    }
+    m_Mapped = true;
+
+    frame.pixels = reinterpret_cast<const uint8_t*>(mapped.pData);
+    frame.pitch = mapped.RowPitch;
+    frame.captureTime = m_Dupl.GetLastAcquireTime();
+    return FrameCodec::AcquireResult::Frame;
+}
+
+void DuplicationSource::Release() {
+    if (!m_Mapped) return;
+    m_Dupl.GetContext()->Unmap(m_Staging.Get(), 0);
+    m_Mapped = false;
+}
+
 bool Duplication::GetStagedTexture(_Out_ ID3D11Texture2D*& YPlane, _Out_ ID3D11Texture2D*& UVPlane, unsigned long timeout) {
     ID3D11Texture2D* frame = nullptr;
     int result = GetFrame(frame, timeout);
@@ -889,6 +1089,9 @@ bool Duplication::GetStagedTexture(_Out_ ID3D11Texture2D*& YPlane, _Out_ ID3D11T
             return false;
         case -1:
             return false;
+        case FRAME_UNCHANGED:
+            m_LastFrameUnchanged = true;
+            return false;
     }
 
     CompressTexture(frame);
@@ -1184,6 +1387,101 @@ std::wstring DesktopDuplication::GetMonitorNameFromEDID(const std::wstring& devi
     return monitorName;
 }
 
+std::vector<DesktopDuplication::OutputInfo> DesktopDuplication::EnumerateOutputs(UINT adapterIndex) {
+    std::vector<OutputInfo> outputs;
+
+    ComPtr<IDXGIFactory1> factory;
+    HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(factory.GetAddressOf()));
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create DXGI Factory. Reason: 0x" << std::hex << hr << std::endl;
+        return outputs;
+    }
+
+    ComPtr<IDXGIAdapter> adapter;
+    if (FAILED(factory->EnumAdapters(adapterIndex, adapter.GetAddressOf()))) return outputs;
+
+    ComPtr<IDXGIOutput> output;
+    for (UINT i = 0; adapter->EnumOutputs(i, output.ReleaseAndGetAddressOf()) != DXGI_ERROR_NOT_FOUND; ++i) {
+        ComPtr<IDXGIOutput6> output6;
+        DXGI_OUTPUT_DESC1 desc;
+        if (FAILED(output.As(&output6)) || FAILED(output6->GetDesc1(&desc))) continue;
+
+        DEVMODE devMode = {};
+        devMode.dmSize = sizeof(DEVMODE);
+        if (!EnumDisplaySettings(desc.DeviceName, ENUM_CURRENT_SETTINGS, &devMode)) continue;
+
+        OutputInfo info = { adapterIndex, i, GetMonitorFriendlyName(desc), {} };
+        info.desc.left = desc.DesktopCoordinates.left;
+        info.desc.top = desc.DesktopCoordinates.top;
+        info.desc.width = static_cast<uint16_t>(devMode.dmPelsWidth);
+        info.desc.height = static_cast<uint16_t>(devMode.dmPelsHeight);
+        info.desc.refreshRate = static_cast<uint16_t>(devMode.dmDisplayFrequency);
+        outputs.push_back(info);
+    }
+    return outputs;
+}
+
+HWND DesktopDuplication::FindWindowByTitle(const std::wstring& title) {
+    struct Search {
+        const std::wstring& title;
+        HWND found;
+    } search = { title, nullptr };
+
+    EnumWindows([](HWND window, LPARAM param) -> BOOL {
+        Search& search = *reinterpret_cast<Search*>(param);
+        if (!IsWindowVisible(window) || GetWindow(window, GW_OWNER) != nullptr) return TRUE;
+
+        wchar_t text[256];
+        if (GetWindowTextW(window, text, 256) == 0 || std::wstring(text).find(search.title) == std::wstring::npos) return TRUE;
+        search.found = window;
+        return FALSE;
+    }, reinterpret_cast<LPARAM>(&search));
+    return search.found;
+}
+
+bool DesktopDuplication::ChooseOutputs(_Out_ std::vector<OutputInfo>& outputs, unsigned int maxOutputs) {
+    outputs.clear();
+
+    unsigned short width = 0, height = 0, refreshRate = 0;
+    ChooseOutput(width, height, refreshRate);
+    Duplication& primary = Singleton<Duplication>::Instance();
+    if (!primary.IsOutputSet()) return false;
+
+    std::vector<OutputInfo> available = EnumerateOutputs(primary.GetAdapterIndex());
+    for (const OutputInfo& info : available) {
+        if (info.outputIndex == primary.GetOutputIndex()) outputs.push_back(info);
+    }
+    if (outputs.empty()) {
+        std::cerr << "The chosen output is gone." << std::endl;
+        return false;
+    }
+    if (maxOutputs <= 1 || available.size() <= 1) return true;
+
+    #ifndef NDR_SERVICE
+    while (outputs.size() < maxOutputs) {
+        system("cls");
+        for (const OutputInfo& info : available) {
+            const bool chosen = std::any_of(outputs.begin(), outputs.end(), [&](const OutputInfo& o) { return o.outputIndex == info.outputIndex; });
+            std::wcout << (chosen ? L"* " : L"  ") << L"Output " << info.outputIndex << L": " << info.name << L" ("
+                       << info.desc.width << L"x" << info.desc.height << L"@" << info.desc.refreshRate << L"Hz at "
+                       << info.desc.left << L"," << info.desc.top << L")" << std::endl;
+        }
+        std::cout << std::endl << "Choose another output to capture as well (Press Enter to start): " << std::endl;
+
+        char input = _getch();
+        if (input == '\r' || input == '\n') break;
+
+        const UINT choice = input - '0';
+        auto it = std::find_if(available.begin(), available.end(), [&](const OutputInfo& info) { return info.outputIndex == choice; });
+        const bool chosen = std::any_of(outputs.begin(), outputs.end(), [&](const OutputInfo& o) { return o.outputIndex == choice; });
+        if (it != available.end() && !chosen) outputs.push_back(*it);
+    }
+    system("cls");
+    #endif
+
+    return true;
+}
+
 std::wstring DesktopDuplication::GetMonitorFriendlyName(const DXGI_OUTPUT_DESC1& desc) {
     // Generic PnP Monitor
 
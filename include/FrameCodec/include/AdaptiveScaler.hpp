@@ -0,0 +1,45 @@
+#ifndef ADAPTIVESCALER_HPP
+#define ADAPTIVESCALER_HPP
+
+#pragma once
+
+#include "Downscale.hpp"
+
+#include <cstdint>
+
+namespace FrameCodec {
+    constexpr unsigned int SCALE_DOWN_FRAMES = 8;  // Consecutive late frames before dropping a level
+    constexpr unsigned int SCALE_UP_FRAMES = 120;  // Consecutive comfortable frames before trying a level up
+    constexpr double SCALE_UP_HEADROOM = 0.7;      // A level up must be predicted to fit in this much of the frame time
+
+    // Picks the transmit scale from what each frame actually cost the sending stage: scale, encode and write up to
+    // its completion, which includes waiting for the receiver's flag, so both a slow link and a slow viewer count.
+    // Drops a level quickly once frames stop fitting in the refresh interval, and comes back up only when the cost,
+    // scaled by the pixel count of the next level, would still fit with headroom.
+    class AdaptiveScaler {
+        public:
+        explicit AdaptiveScaler(uint16_t refreshRate);
+
+        // One sample per sent frame; returns the level for the next one
+        ScaleLevel Update(uint64_t bytes, uint64_t costNs);
+
+        ScaleLevel GetLevel() const { return m_Level; }
+        unsigned long long GetSwitches() const { return m_Switches; }
+        double GetAverageCostNs() const { return m_AverageCost; }
+        double GetThroughput() const { return m_Throughput; } // Bytes per second over the send, smoothed
+
+        private:
+        static double PixelShare(ScaleLevel level);
+
+        double m_FrameNs;
+        ScaleLevel m_Level = ScaleLevel::Full;
+
+        double m_AverageCost = 0.0;
+        double m_Throughput = 0.0;
+        unsigned int m_Late = 0;
+        unsigned int m_Comfortable = 0;
+        unsigned long long m_Switches = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef BANDLAYOUT_HPP
+#define BANDLAYOUT_HPP
+
+#pragma once
+
+#include "FrameHeader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int MAX_BANDS = 16;
+    constexpr unsigned int DEFAULT_BAND_COUNT = 4;
+    constexpr unsigned int BAND_ROW_ALIGN = 16; // Keeps the UV rows and chroma tiles of a band whole and the copies long
+
+    // How a planar YUV format samples chroma: one U,V byte pair per (1 << xShift) by (1 << yShift) pixels
+    struct ChromaLayout {
+        unsigned int xShift;
+        unsigned int yShift;
+    };
+
+    bool IsPlanarYuv(PixelFormat format);
+    // YUV440 for anything that isn't planar YUV. YUVAdaptive reports full chroma: its planes before the tiles are
+    // packed, and the most a band can carry.
+    ChromaLayout GetChromaLayout(PixelFormat format);
+
+    // U,V pairs in a UV row; an odd width's last column gets a pair of its own
+    inline unsigned int ChromaWidth(ChromaLayout layout, unsigned int width) {
+        return (width + (1u << layout.xShift) - 1) >> layout.xShift;
+    }
+    // UV rows; an odd height's last row has none, as 4:4:0 always had it
+    inline unsigned int ChromaHeight(ChromaLayout layout, unsigned int height) {
+        return height >> layout.yShift;
+    }
+    // Both planes, tightly packed; for YUVAdaptive the most its bands can carry
+    size_t PlanarFrameSize(PixelFormat format, unsigned int width, unsigned int height);
+
+    struct Band {
+        unsigned int firstRow;
+        unsigned int rows;
+        unsigned int uvRow;  // First UV row of the band
+        unsigned int uvRows;
+        size_t offset;       // Into the payload
+        size_t ySize;        // Y rows, then (size - ySize) bytes of UV rows, or for YUVAdaptive room for its chroma section
+        size_t size;
+    };
+
+    // Planar YUV payload cut into horizontal bands, each laid out as [Y rows][UV rows] so it can go out
+    // in one write and be uploaded as soon as it lands. With one band this is the plain
+    // [Y plane][UV plane] layout.
+    class PlanarBands {
+        public:
+        PlanarBands(unsigned short width, unsigned short height, unsigned int count, PixelFormat format = PixelFormat::YUV440);
+
+        unsigned int GetCount() const { return static_cast<unsigned int>(m_Bands.size()); }
+        const Band& operator[](unsigned int index) const { return m_Bands[index]; }
+
+        size_t GetPayloadSize() const { return m_PayloadSize; }
+        PixelFormat GetFormat() const { return m_Format; }
+        // Bytes in one UV row of the payload
+        size_t GetUVPitch() const { return m_UVPitch; }
+
+        private:
+        std::vector<Band> m_Bands;
+        size_t m_PayloadSize = 0;
+        PixelFormat m_Format;
+        size_t m_UVPitch;
+    };
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef BUFFERARENA_HPP
+#define BUFFERARENA_HPP
+
+#pragma once
+
+#include <cstddef>
+
+namespace FrameCodec {
+    // Sizing policy for registered memory that outlives the modes laid out in it. Registering pins pages and
+    // hands the peer a new token, so a mode that fits keeps the current registration untouched. A bigger one
+    // grows it with headroom, so switching back and forth between two modes re-registers at most once.
+    class BufferArena {
+        public:
+        static constexpr size_t GRANULARITY = 64 * 1024; // VirtualAlloc's allocation granularity
+        static constexpr size_t GROWTH_NUMERATOR = 3;    // Grow to at least 3/2 of the old capacity
+        static constexpr size_t GROWTH_DENOMINATOR = 2;
+
+        // Lays out `bytes` from the start of the arena. Returns the capacity to register when the current
+        // one is too small, 0 when it can be reused as is.
+        size_t Reserve(size_t bytes);
+
+        size_t GetCapacity() const { return m_Capacity; }
+        size_t GetUsed() const { return m_Used; }
+        unsigned long long GetRegistrations() const { return m_Registrations; }
+        unsigned long long GetReuses() const { return m_Reuses; }
+
+        private:
+        size_t m_Capacity = 0;
+        size_t m_Used = 0;
+        unsigned long long m_Registrations = 0;
+        unsigned long long m_Reuses = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef CAPTUREFILE_HPP
+#define CAPTUREFILE_HPP
+
+#pragma once
+
+#include "FrameSource.hpp"
+#include "TileDelta.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FrameCodec {
+    // Capture file layout, all little-endian:
+    //   CaptureFileHeader
+    //   per frame: CaptureRecord, then its payload, padded to CAPTURE_ALIGNMENT
+    //   CaptureIndexEntry[frameCount], at indexOffset
+    // Records are only ever appended. The index and the final count are written on Close(), so a file cut short
+    // by a crash still reads: the reader walks the records instead.
+    constexpr char CAPTURE_MAGIC[8] = { 'N', 'D', 'R', 'C', 'A', 'P', 'T', '\0' };
+    constexpr uint16_t CAPTURE_VERSION = 1;
+    constexpr size_t CAPTURE_ALIGNMENT = 64; // Raw payloads are read in place, so keep them aligned for the SIMD copies
+    constexpr uint32_t CAPTURE_KEYFRAME_INTERVAL = 60;
+
+    enum class CaptureEncoding : uint8_t {
+        Raw,   // Every frame as tightly packed BGRA32
+        Delta, // DeltaEncoder payloads, no tile cache, with a raw keyframe every CAPTURE_KEYFRAME_INTERVAL frames
+    };
+
+    enum class RecordKind : uint8_t {
+        Raw,
+        Delta, // Against the previous frame
+    };
+
+    struct CaptureFileHeader {
+        char magic[8];
+        uint16_t version;
+        uint16_t width;
+        uint16_t height;
+        uint16_t refreshRate;
+        uint8_t encoding;     // CaptureEncoding
+        uint8_t reserved0[3];
+        uint32_t frameCount;  // 0 until Close()
+        uint64_t indexOffset; // 0 until Close()
+        uint8_t reserved[32];
+    };
+    static_assert(sizeof(CaptureFileHeader) == 64, "CaptureFileHeader must stay 64 bytes");
+
+    struct CaptureRecord {
+        uint32_t length;      // Payload bytes, without the padding
+        uint8_t kind;         // RecordKind
+        uint8_t reserved[3];
+        uint64_t captureTime; // FrameClockNow() on the recording machine
+        uint8_t padding[CAPTURE_ALIGNMENT - 16];
+    };
+    static_assert(sizeof(CaptureRecord) == CAPTURE_ALIGNMENT, "CaptureRecord must keep payloads aligned");
+
+    struct CaptureIndexEntry {
+        uint64_t offset;      // Of the payload
+        uint64_t captureTime;
+        uint32_t length;
+        uint8_t kind;
+        uint8_t reserved[3];
+    };
+    static_assert(sizeof(CaptureIndexEntry) == 24, "CaptureIndexEntry must stay 24 bytes");
+
+    // Streams frames into a capture file from a thread of its own. Append() only copies the frame into a free
+    // buffer; when the disk falls behind and none is free, the frame is dropped and counted rather than waited for.
+    class CaptureWriter {
+        public:
+        static constexpr unsigned int DEFAULT_QUEUE_DEPTH = 8;
+
+        CaptureWriter(uint16_t width, uint16_t height, uint16_t refreshRate, CaptureEncoding encoding,
+                      unsigned int queueDepth = DEFAULT_QUEUE_DEPTH);
+        ~CaptureWriter();
+
+        bool Open(const std::string& path);
+        // Writes what is still queued, then the index. Called by the destructor too.
+        bool Close();
+
+        // Capture side. `pixels` is a width x height BGRA32 frame with rows `pitch` bytes apart.
+        // False when the frame was dropped.
+        bool Append(const uint8_t* pixels, size_t pitch, uint64_t captureTime);
+
+        uint16_t GetWidth() const { return m_Width; }
+        uint16_t GetHeight() const { return m_Height; }
+        uint64_t GetWritten() const { return m_Written.load(std::memory_order_relaxed); }
+        uint64_t GetDropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+        uint64_t GetBytes() const { return m_Bytes.load(std::memory_order_relaxed); }
+
+        private:
+        struct Pending {
+            unsigned int buffer;
+            uint64_t captureTime;
+        };
+
+        void WriteLoop();
+        bool WriteRecord(RecordKind kind, const uint8_t* payload, size_t length, uint64_t captureTime);
+
+        uint16_t m_Width;
+        uint16_t m_Height;
+        uint16_t m_RefreshRate;
+        CaptureEncoding m_Encoding;
+        size_t m_FrameBytes;
+
+        std::ofstream m_File;
+        uint64_t m_Offset = 0;
+        std::vector<CaptureIndexEntry> m_Index; // Writer thread only
+        bool m_Failed = false;
+
+        std::vector<std::vector<uint8_t>> m_Buffers;
+        std::vector<unsigned int> m_Free;
+        std::deque<Pending> m_Pending;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        bool m_Stop = false;
+        std::thread m_Thread;
+
+        std::unique_ptr<DeltaEncoder> m_Encoder;
+        std::vector<uint8_t> m_Delta;
+
+        std::atomic<uint64_t> m_Written = 0;
+        std::atomic<uint64_t> m_Dropped = 0;
+        std::atomic<uint64_t> m_Bytes = 0;
+    };
+
+    // Plays a capture file from a read-only mapping. Raw frames are handed out in place, without a copy; delta
+    // frames are decoded into a frame of the reader's own. Paced playback keeps the recorded frame intervals.
+    class CaptureReader : public FrameSource {
+        public:
+        explicit CaptureReader(bool paced = false, bool loop = true);
+        ~CaptureReader();
+
+        CaptureReader(const CaptureReader&) = delete;
+        CaptureReader& operator=(const CaptureReader&) = delete;
+
+        bool Open(const std::string& path);
+
+        uint16_t GetWidth() const override { return m_Header.width; }
+        uint16_t GetHeight() const override { return m_Header.height; }
+        uint16_t GetRefreshRate() const override { return m_Header.refreshRate; }
+
+        // Failed at the end of a file that doesn't loop, or on a damaged record
+        AcquireResult Acquire(unsigned long timeoutMs, SourceFrame& frame) override;
+
+        size_t GetFrameCount() const { return m_IndexCount; }
+        bool WasIndexRebuilt() const { return m_IndexRebuilt; } // The file was never closed
+        const CaptureIndexEntry& GetEntry(size_t frame) const { return m_Index[frame]; }
+
+        private:
+        void Unmap();
+        bool RebuildIndex();
+
+        bool m_Paced;
+        bool m_Loop;
+
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+
+        CaptureFileHeader m_Header = {};
+        const CaptureIndexEntry* m_Index = nullptr; // Into the mapping, or m_RebuiltIndex
+        size_t m_IndexCount = 0;
+        std::vector<CaptureIndexEntry> m_RebuiltIndex;
+        bool m_IndexRebuilt = false;
+
+        size_t m_Next = 0;
+        std::unique_ptr<DeltaDecoder> m_Decoder;
+        std::chrono::steady_clock::time_point m_PlayStart;
+        uint64_t m_FirstCaptureTime = 0;
+    };
+}
+
+#endif
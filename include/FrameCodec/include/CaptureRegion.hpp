@@ -0,0 +1,32 @@
+#ifndef CAPTUREREGION_HPP
+#define CAPTUREREGION_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Part of an output streamed instead of all of it, in the output's pixels. The session mode's width and height
+    // are the region's; every frame's header carries where the region sat on the output when it was captured.
+    struct CaptureRegion {
+        uint16_t left;
+        uint16_t top;
+        uint16_t width;  // 0: the whole output
+        uint16_t height;
+
+        bool operator==(const CaptureRegion&) const = default;
+    };
+
+    // Fits `region` into an output of outputWidth x outputHeight. The size is kept where it fits and the origin
+    // moved in instead, so a window dragged partly off the output keeps its size on the wire. Sizes round down to
+    // even like every other frame size; an empty result has width 0.
+    CaptureRegion ClampRegion(const CaptureRegion& region, uint16_t outputWidth, uint16_t outputHeight);
+
+    // Copies `region` of a BGRA32 image whose rows are `srcPitch` bytes apart into `dst`, tightly packed. With the
+    // whole image as the region this is the readback out of a mapped staging texture.
+    void PackRegion(const uint8_t* src, size_t srcPitch, const CaptureRegion& region, uint8_t* dst);
+    void PackRegionReference(const uint8_t* src, size_t srcPitch, const CaptureRegion& region, uint8_t* dst);
+}
+
+#endif
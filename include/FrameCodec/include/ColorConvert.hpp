@@ -0,0 +1,105 @@
+#ifndef COLORCONVERT_HPP
+#define COLORCONVERT_HPP
+
+#pragma once
+
+#include "BandLayout.hpp"
+#include "ColorSpace.hpp"
+#include "CpuFeatures.hpp"
+#include "FrameHeader.hpp"
+#include "RowPool.hpp"
+#include "TileChroma.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrameCodec {
+    // CPU version of the shaders/BGRA2_4xx.hlsl shaders, for machines whose GPU is busier than their CPU. Produces
+    // the same planes: a full-size Y plane and a UV plane of interleaved U,V bytes laid out by GetChromaLayout(),
+    // in the given ColorSpace. 4:4:0 takes its chroma from the even rows as it always has; 4:2:0 and 4:2:2 average
+    // each block. The kernels work in 15-bit fixed point and stay within 1 of the shaders' float math.
+    class YuvEncoder {
+        public:
+        static constexpr unsigned int MAX_THREADS = RowPool::MAX_THREADS;
+
+        // `format` is one of the planar YUV formats; `threads` as for RowPool; `level` is lowered to what the CPU supports
+        YuvEncoder(unsigned int width, unsigned int height, PixelFormat format = PixelFormat::YUV440, ColorSpace space = ColorSpace::BT601Full,
+                   unsigned int threads = 0, SimdLevel level = DetectSimdLevel());
+
+        // The whole frame
+        void Encode(const uint8_t* bgra, size_t pitch, uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch);
+        // Rows [firstRow, firstRow + rows) of the frame, `firstRow` even and `rows` too unless the band ends the frame.
+        // `bgra` is still the frame's first row; `y` and `uv` are the band's own first rows, as in a PlanarBands payload.
+        void EncodeRows(const uint8_t* bgra, size_t pitch, unsigned int firstRow, unsigned int rows,
+                        uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch);
+        // YUVAdaptive: the same rows, `firstRow` on a tile row, with each tile's chroma classified and packed into
+        // `chroma` as TileChroma.hpp lays it out. Returns the bytes written there, at most AdaptiveChromaMaxSize().
+        // Encode and EncodeRows give this format's planes before packing, at full chroma.
+        size_t EncodeAdaptiveRows(const uint8_t* bgra, size_t pitch, unsigned int firstRow, unsigned int rows,
+                                  uint8_t* y, size_t yPitch, uint8_t* chroma);
+
+        // The shader's math in float, rounded the way the GPU stores UNORM; what the kernels are checked against
+        static void EncodeReference(const uint8_t* bgra, size_t pitch, unsigned int width, unsigned int height,
+                                    uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch, PixelFormat format = PixelFormat::YUV440,
+                                    ColorSpace space = ColorSpace::BT601Full);
+
+        SimdLevel GetLevel() const { return m_Level; }
+        unsigned int GetThreadCount() const { return m_Pool.GetThreadCount(); }
+
+        private:
+        unsigned int m_Width;
+        unsigned int m_Height;
+        ChromaLayout m_Chroma;
+        SimdLevel m_Level;
+        void (*m_Row)(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv);
+        void (*m_Halve)(const uint8_t* full, unsigned int width, uint8_t* uv);
+        void (*m_Quarter)(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+        void (*m_Average)(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+        void (*m_Stats)(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats);
+        std::vector<uint8_t> m_Packed;   // YUVAdaptive: each tile row's pairs, until the rows above it are sized
+        std::vector<size_t> m_TileSizes;
+        RowPool m_Pool;
+    };
+
+    // CPU version of the shaders/4xx_2BGRA.hlsl shaders: planar YUV back to opaque BGRA, for viewers whose GPU is
+    // weak or busy. Each pixel takes the U,V pair of its block, as the shaders load it. The kernels work in 14-bit
+    // fixed point (13-bit for limited range); every level gives the same bytes as the scalar one, which stays within 1
+    // of the shaders' float math.
+    class YuvDecoder {
+        public:
+        static constexpr unsigned int MAX_THREADS = RowPool::MAX_THREADS;
+
+        YuvDecoder(unsigned int width, unsigned int height, PixelFormat format = PixelFormat::YUV440, ColorSpace space = ColorSpace::BT601Full,
+                   unsigned int threads = 0, SimdLevel level = DetectSimdLevel());
+
+        void Decode(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, uint8_t* bgra, size_t pitch);
+        // Rows [firstRow, firstRow + rows), `firstRow` even: `y` and `uv` are the band's own first rows, as they
+        // arrive in a PlanarBands payload, and `bgra` is still the frame's first row
+        void DecodeRows(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, unsigned int firstRow, unsigned int rows,
+                        uint8_t* bgra, size_t pitch);
+        // YUVAdaptive rows as EncodeAdaptiveRows wrote them, `chromaSize` being what the band has room for. False,
+        // with nothing written, when the mode map is corrupt or describes more pairs than that.
+        bool DecodeAdaptiveRows(const uint8_t* y, size_t yPitch, const uint8_t* chroma, size_t chromaSize, unsigned int firstRow,
+                                unsigned int rows, uint8_t* bgra, size_t pitch);
+
+        static void DecodeReference(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, unsigned int width, unsigned int height,
+                                    uint8_t* bgra, size_t pitch, PixelFormat format = PixelFormat::YUV440, ColorSpace space = ColorSpace::BT601Full);
+
+        SimdLevel GetLevel() const { return m_Level; }
+        unsigned int GetThreadCount() const { return m_Pool.GetThreadCount(); }
+
+        private:
+        unsigned int m_Width;
+        unsigned int m_Height;
+        ChromaLayout m_Chroma;
+        SimdLevel m_Level;
+        void (*m_Row)(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra);
+        void (*m_Widen)(const uint8_t* uv, unsigned int width, uint8_t* full);
+        std::vector<uint8_t> m_ZeroUV; // An odd height's last row, which the shaders read past the UV plane as zeros
+        std::vector<size_t> m_TileOffsets;
+        RowPool m_Pool;
+    };
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef COLORSPACE_HPP
+#define COLORSPACE_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Matrix and range the planar YUV formats carry. BGRA is never touched; only how it maps to Y, U and V changes.
+    enum class ColorSpace : uint8_t {
+        BT601Full = 0, // What the shaders always used
+        BT601Limited = 1,
+        BT709Full = 2,
+        BT709Limited = 3,
+    };
+    constexpr size_t COLOR_SPACE_COUNT = 4;
+
+    // Luma weights of red and blue; green takes the rest. Limited range puts Y in 16-235 and U, V in 16-240.
+    struct YuvMatrix {
+        const char* name;
+        double kr;
+        double kb;
+        bool limited;
+    };
+
+    // Indexed by ColorSpace. A table rather than a function so that the kernels can build their coefficients from it at compile time.
+    constexpr YuvMatrix YUV_MATRICES[COLOR_SPACE_COUNT] = {
+        { "bt601", 0.299, 0.114, false },
+        { "bt601-limited", 0.299, 0.114, true },
+        { "bt709", 0.2126, 0.0722, false },
+        { "bt709-limited", 0.2126, 0.0722, true },
+    };
+
+    const YuvMatrix& GetYuvMatrix(ColorSpace space);
+    // Names as in YUV_MATRICES, any case; false leaves `space` alone
+    bool ParseColorSpace(const char* name, ColorSpace& space);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CPUFEATURES_HPP
+#define CPUFEATURES_HPP
+
+#pragma once
+
+#include <cstdint>
+
+namespace FrameCodec {
+    // Instruction sets a kernel can be compiled for, in order; each implies the ones before it
+    enum class SimdLevel : uint8_t {
+        Scalar,
+        SSE41,
+        AVX2,
+        AVX512, // F and BW
+    };
+
+    // The best level this CPU and OS support, probed once
+    SimdLevel DetectSimdLevel();
+    const char* SimdLevelName(SimdLevel level);
+}
+
+#endif
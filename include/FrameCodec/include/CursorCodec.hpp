@@ -0,0 +1,100 @@
+#ifndef CURSORCODEC_HPP
+#define CURSORCODEC_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int MAX_CURSOR_SIZE = 256;      // Largest cursor Windows hands out, in pixels per side
+    constexpr unsigned int CURSOR_SHAPE_CACHE = 32;    // Shapes both sides remember before the oldest is dropped
+
+    // Values match DXGI_OUTDUPL_POINTER_SHAPE_TYPE so the capture side can pass them straight through
+    enum class CursorShapeType : uint8_t {
+        Monochrome = 1,
+        Color = 2,
+        MaskedColor = 4
+    };
+
+    enum CursorMessageType : uint8_t {
+        CURSOR_MSG_MOVE = 1,  // Position and shape ID only
+        CURSOR_MSG_SHAPE = 2  // Followed by width * height premultiplied BGRA pixels
+    };
+
+    // Cursor message layout: CursorHeader, then the pixels for CURSOR_MSG_SHAPE.
+    // (x, y) is the top-left of the shape relative to the captured output, as DXGI reports it.
+    struct CursorHeader {
+        uint8_t type;
+        uint8_t visible;
+        uint16_t width;
+        uint16_t height;
+        uint16_t reserved;
+        int32_t x;
+        int32_t y;
+        uint64_t shapeId;
+    };
+
+    constexpr size_t MAX_CURSOR_MESSAGE_SIZE = sizeof(CursorHeader) + MAX_CURSOR_SIZE * MAX_CURSOR_SIZE * 4;
+
+    struct CursorState {
+        bool visible = false;
+        int32_t x = 0;
+        int32_t y = 0;
+        uint64_t shapeId = 0; // 0 = no shape yet
+        uint16_t width = 0;
+        uint16_t height = 0;
+        std::vector<uint8_t> pixels; // Premultiplied BGRA, tightly packed
+    };
+
+    // Turns a DXGI pointer shape into premultiplied BGRA. Monochrome shapes carry two masks stacked vertically,
+    // so the result is half as tall. Screen-inverting pixels cannot be reproduced by the presenter and become black.
+    bool ConvertCursorShape(CursorShapeType type, unsigned int width, unsigned int height, unsigned int pitch,
+                            const uint8_t* data, CursorState& state);
+
+    // Sender side. Tracks which shapes the receiver already holds, so a shape travels once and
+    // every later message only names it.
+    class CursorEncoder {
+        public:
+        // `out` must hold MAX_CURSOR_MESSAGE_SIZE bytes. Returns the number of bytes written.
+        size_t Encode(const CursorState& state, uint8_t* out);
+
+        unsigned long long GetMoveMessages() const { return m_MoveMessages; }
+        unsigned long long GetShapeMessages() const { return m_ShapeMessages; }
+
+        private:
+        std::deque<uint64_t> m_Sent; // Oldest first, mirrors CursorDecoder's eviction order
+
+        unsigned long long m_MoveMessages = 0;
+        unsigned long long m_ShapeMessages = 0;
+    };
+
+    // Receiver side. Keeps the latest position and the shapes it was sent.
+    class CursorDecoder {
+        public:
+        // Returns false on a malformed message or an unknown shape ID.
+        bool Decode(const uint8_t* in, size_t length);
+
+        bool IsVisible() const { return m_Visible; }
+        int32_t GetX() const { return m_X; }
+        int32_t GetY() const { return m_Y; }
+        uint64_t GetShapeId() const { return m_ShapeId; }
+
+        // Current shape, or nullptr when none has arrived yet
+        const CursorState* GetShape() const;
+
+        private:
+        bool m_Visible = false;
+        int32_t m_X = 0;
+        int32_t m_Y = 0;
+        uint64_t m_ShapeId = 0;
+
+        std::deque<uint64_t> m_Order;
+        std::unordered_map<uint64_t, CursorState> m_Shapes;
+    };
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DOWNSCALE_HPP
+#define DOWNSCALE_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrameCodec {
+    // Transmit size relative to the negotiated mode. The header's width/height carry it in-band.
+    enum class ScaleLevel : uint8_t {
+        Full = 0,
+        ThreeQuarter = 1,
+        Half = 2,
+    };
+    constexpr unsigned int SCALE_LEVEL_COUNT = 3;
+
+    const char* ScaleLevelName(ScaleLevel level);
+
+    // Size of one dimension at `level`, kept even so YUV planes stay whole
+    uint16_t ScaledDimension(uint16_t full, ScaleLevel level);
+
+    // Receiver side: the level a frame of width x height was sent at, false if it matches none
+    bool FindScaleLevel(uint16_t fullWidth, uint16_t fullHeight, uint16_t width, uint16_t height, ScaleLevel& level);
+
+    enum class ScaleFilter : uint8_t {
+        Box,      // Area average: every source pixel counts by how much of it the destination pixel covers
+        Bilinear, // Two nearest source pixels around the destination pixel's centre
+    };
+
+    // BGRA32 downscaler for ratios down to 1/2. Separable: a vertical pass blends up to three source rows
+    // into 8.8 fixed point, a horizontal pass blends up to three of those pixels back to 8 bits. The tap
+    // tables only depend on the sizes, so one Downscaler is built per level and reused for every frame.
+    class Downscaler {
+        public:
+        static constexpr unsigned int MAX_TAPS = 3;
+
+        Downscaler(unsigned int srcWidth, unsigned int srcHeight, unsigned int dstWidth, unsigned int dstHeight, ScaleFilter filter);
+
+        // Widest kernel compiled in; bit-identical to ScaleReference()
+        void Scale(const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch);
+        void ScaleReference(const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch);
+
+        unsigned int GetWidth() const { return m_DstWidth; }
+        unsigned int GetHeight() const { return m_DstHeight; }
+
+        // "AVX2", "SSE4.1", "SSE2" or "Scalar", by what the build enables
+        static const char* KernelName();
+
+        private:
+        struct Taps {
+            uint32_t first;
+            uint32_t count;
+            uint16_t weight[MAX_TAPS]; // Sum to 256
+        };
+
+        static std::vector<Taps> BuildTaps(unsigned int src, unsigned int dst, ScaleFilter filter);
+
+        unsigned int m_SrcWidth;
+        unsigned int m_SrcHeight;
+        unsigned int m_DstWidth;
+        unsigned int m_DstHeight;
+
+        std::vector<Taps> m_Columns;
+        std::vector<Taps> m_Rows;
+        std::vector<uint16_t> m_RowBuffer; // One vertically blended source-width row, 8.8 fixed point
+    };
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef FRAMEHASH_HPP
+#define FRAMEHASH_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace FrameCodec {
+    constexpr uint64_t HASH_PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t HASH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t HASH_PRIME3 = 0x165667B19E3779F9ULL;
+
+    inline uint64_t HashRotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t HashRound(uint64_t acc, uint64_t input) {
+        acc += input * HASH_PRIME2;
+        acc = HashRotl(acc, 31);
+        return acc * HASH_PRIME1;
+    }
+
+    inline uint64_t HashAvalanche(uint64_t h) {
+        h ^= h >> 33;
+        h *= HASH_PRIME2;
+        h ^= h >> 29;
+        h *= HASH_PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    inline uint64_t HashLoad64(const uint8_t* p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Four-lane multiply/rotate hash (xxHash64-style rounds). Not a cryptographic hash;
+    // used to compare rows and tiles, where 64 bits make accidental collisions negligible.
+    inline uint64_t HashBytes(const uint8_t* data, size_t length, uint64_t seed = 0) {
+        const uint8_t* p = data;
+        const uint8_t* end = data + length;
+        uint64_t h;
+
+        if (length >= 32) {
+            uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+            uint64_t v2 = seed + HASH_PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - HASH_PRIME1;
+
+            const uint8_t* limit = end - 32;
+            do {
+                v1 = HashRound(v1, HashLoad64(p));
+                v2 = HashRound(v2, HashLoad64(p + 8));
+                v3 = HashRound(v3, HashLoad64(p + 16));
+                v4 = HashRound(v4, HashLoad64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = HashRotl(v1, 1) + HashRotl(v2, 7) + HashRotl(v3, 12) + HashRotl(v4, 18);
+        } else {
+            h = seed + HASH_PRIME3;
+        }
+
+        h += static_cast<uint64_t>(length);
+
+        while (p + 8 <= end) {
+            h ^= HashRound(0, HashLoad64(p));
+            h = HashRotl(h, 27) * HASH_PRIME1 + HASH_PRIME3;
+            p += 8;
+        }
+
+        while (p < end) {
+            h ^= static_cast<uint64_t>(*p) * HASH_PRIME3;
+            h = HashRotl(h, 11) * HASH_PRIME1;
+            p++;
+        }
+
+        return HashAvalanche(h);
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef FRAMEHEADER_HPP
+#define FRAMEHEADER_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    constexpr uint32_t FRAME_MAGIC = 0x4652444E; // "NDRF" in memory order
+    constexpr uint16_t FRAME_HEADER_VERSION = 2; // 2: 32-bit checksum, region origin
+    constexpr size_t FRAME_CACHE_LINE = 64;
+
+    enum class PixelFormat : uint8_t {
+        Unknown = 0,
+        BGRA32 = 1,
+        YUV440 = 2, // Full-size Y plane followed by an interleaved UV plane at half height
+        YUV420 = 3, // The same with the UV plane at half width and half height, as NV12
+        YUV422 = 4, // The same with the UV plane at half width and full height
+        YUVAdaptive = 5, // Full-size Y plane, then each tile's chroma at full, 4:4:0 or 4:2:0 resolution (TileChroma.hpp)
+        BGRALossless = 6, // BGRA32 tile deltas whose tiles are coded losslessly (TileCodec.hpp)
+    };
+
+    enum class PayloadEncoding : uint8_t {
+        Planar = 0,    // Pixels as-is, tightly packed
+        TileDelta = 1, // DeltaEncoder output
+        TileDeltaLossless = 2, // DeltaEncoder output with lossless tile streams
+    };
+
+    enum FrameFlags : uint16_t {
+        FRAME_FLAG_CHECKSUM = 0x0001,  // `checksum` covers the payload
+        FRAME_FLAG_KEEPALIVE = 0x0002, // No payload; the receiver keeps showing what it has
+        FRAME_FLAG_MODE_CHANGE = 0x0004, // Payload is the SessionMode every following frame uses, see SessionMode.hpp
+    };
+
+    // Sits in its own cache line right in front of the payload. Timestamps are the sender's
+    // steady clock in nanoseconds (FrameClockNow()); only differences on the same machine are meaningful.
+    // Newer versions may only append fields: a receiver skips `headerSize` bytes to reach the payload.
+    struct alignas(FRAME_CACHE_LINE) FrameHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t headerSize;
+        uint64_t sequence;      // +1 for every message, keep-alives included
+        uint64_t captureTime;   // The frame left the capture API
+        uint64_t encodeTime;    // Readback/encode into the send buffer finished
+        uint64_t sendTime;      // Written just before the RDMA write is posted
+        uint32_t payloadSize;
+        uint16_t width;
+        uint16_t height;
+        PixelFormat format;
+        PayloadEncoding encoding;
+        uint16_t flags;
+        uint16_t bandCount;     // Signals that make up the frame, see BandLayout.hpp
+        uint16_t output;        // Captured output the frame shows, see OutputLayout.hpp
+        uint32_t checksum;      // Low half of HashBytes() over the payload when FRAME_FLAG_CHECKSUM is set
+        uint16_t regionLeft;    // Where the frame's top-left pixel sat on its output, see CaptureRegion.hpp
+        uint16_t regionTop;
+    };
+    static_assert(sizeof(FrameHeader) == FRAME_CACHE_LINE, "FrameHeader must fill exactly one cache line");
+
+    enum class FrameHeaderStatus {
+        Ok,
+        TooShort,
+        Misaligned,
+        BadMagic,
+        UnsupportedVersion,
+        BadPayloadSize,
+        ChecksumMismatch,
+    };
+
+    const char* FrameHeaderStatusString(FrameHeaderStatus status);
+
+    uint64_t FrameClockNow();
+
+    // Send buffer layout: [FrameSignal, rest of the line unused][FrameHeader][payload].
+    // Keeping the flag on its own line means the receiver's poll never shares a line with the header.
+    constexpr size_t FRAME_HEADER_OFFSET = FRAME_CACHE_LINE;
+
+    // Start of the flag line, and what the client's Send delivers once the RDMA write has completed
+    struct FrameSignal {
+        uint8_t flag;
+        uint8_t reserved;
+        uint16_t band;          // Index of the band that just landed
+        uint32_t reserved2;
+        uint64_t writeDoneTime; // Sender clock, like the header's timestamps
+    };
+    static_assert(sizeof(FrameSignal) <= FRAME_HEADER_OFFSET, "FrameSignal must fit in the flag line");
+
+    constexpr size_t FRAME_PAYLOAD_OFFSET = FRAME_HEADER_OFFSET + sizeof(FrameHeader);
+
+    // Bytes for one buffer slot with room for `maxPayload`, rounded up so the next slot stays aligned
+    constexpr size_t FrameSlotSize(size_t maxPayload) {
+        return (FRAME_PAYLOAD_OFFSET + maxPayload + FRAME_CACHE_LINE - 1) & ~(FRAME_CACHE_LINE - 1);
+    }
+
+    // Constructs a header in place at `dst` (must be cache-line aligned) with everything but the
+    // payload description filled in. The payload is then encoded directly behind it.
+    FrameHeader* BeginFrameHeader(uint8_t* dst, uint64_t sequence, PixelFormat format, PayloadEncoding encoding,
+                                  uint16_t width, uint16_t height);
+
+    // Records the payload size and, if asked, checksums the payload that follows the header
+    void SealFrameHeader(FrameHeader* header, uint32_t payloadSize, bool checksum);
+
+    // Validates the header at `src` without copying it. `length` is everything readable from `src`,
+    // header and payload. Returns nullptr and sets `status` when the frame cannot be trusted.
+    const FrameHeader* ParseFrameHeader(const uint8_t* src, size_t length, FrameHeaderStatus& status);
+
+    inline const uint8_t* GetFramePayload(const FrameHeader* header) {
+        return reinterpret_cast<const uint8_t*>(header) + header->headerSize;
+    }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FRAMEMAILBOX_HPP
+#define FRAMEMAILBOX_HPP
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Latest-wins handoff between one producer and one consumer, triple-buffer style. The caller owns three
+    // slots of storage; the mailbox only says which one each side may touch. The producer never waits: publishing
+    // over a frame the consumer hasn't taken yet drops that frame. The consumer always gets the newest one.
+    class FrameMailbox {
+        public:
+        static constexpr unsigned int SLOTS = 3;
+
+        // Producer side
+        unsigned int GetWriteSlot() const { return m_Write; }
+        void Publish();
+        bool HasFresh() const { return (m_Middle.load(std::memory_order_relaxed) & FRESH) != 0; }
+
+        // Consumer side. Take() is false, and GetReadSlot() unchanged, when nothing new has been published.
+        bool Take();
+        // Blocks until there is something to take; false once Close() was called
+        bool WaitAndTake();
+        unsigned int GetReadSlot() const { return m_Read; }
+
+        // Wakes the consumer for good
+        void Close();
+        bool IsClosed() const { return (m_Middle.load(std::memory_order_relaxed) & CLOSED) != 0; }
+        // Empty and open again, for a new pair of threads; neither side may be running. Counters carry on.
+        void Reopen();
+
+        uint64_t GetPublished() const { return m_Published.load(std::memory_order_relaxed); }
+        uint64_t GetDropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+        private:
+        // m_Middle: index of the slot between the two sides, plus whether it holds an untaken frame
+        static constexpr uint32_t INDEX_MASK = 0x3;
+        static constexpr uint32_t FRESH = 0x4;
+        static constexpr uint32_t CLOSED = 0x8;
+
+        std::atomic<uint32_t> m_Middle = 1;
+        unsigned int m_Write = 0; // Producer only
+        unsigned int m_Read = 2;  // Consumer only
+
+        std::atomic<uint64_t> m_Published = 0;
+        std::atomic<uint64_t> m_Dropped = 0;
+    };
+}
+
+#endif
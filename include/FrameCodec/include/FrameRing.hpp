@@ -0,0 +1,49 @@
+#ifndef FRAMERING_HPP
+#define FRAMERING_HPP
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Ordered handoff between one producer and one consumer. Unlike FrameMailbox nothing is ever dropped, for
+    // streams where every frame matters (tile deltas). The caller owns `capacity` slots of storage; the ring only
+    // says which one each side may touch.
+    class FrameRing {
+        public:
+        explicit FrameRing(unsigned int capacity) : m_Capacity(capacity) {}
+
+        unsigned int GetCapacity() const { return m_Capacity; }
+
+        // Producer side. WaitForSpace() blocks while the ring is full; false once closed.
+        bool WaitForSpace();
+        unsigned int GetWriteSlot() const { return static_cast<unsigned int>(Count(m_Tail.load(std::memory_order_relaxed)) % m_Capacity); }
+        void Push();
+
+        // Consumer side. WaitForFrame() blocks while the ring is empty; false once closed and drained.
+        // A Nudge() also ends the wait, so GetCount() may then be 0.
+        bool WaitForFrame();
+        unsigned int GetCount() const;
+        unsigned int GetReadSlot() const { return static_cast<unsigned int>(Count(m_Head.load(std::memory_order_relaxed)) % m_Capacity); }
+        void Pop();
+
+        // Wakes a waiting consumer once without a frame, for work it has to do between frames
+        void Nudge();
+
+        // Wakes both sides for good
+        void Close();
+
+        private:
+        // Both counters carry the closed bit so either side's wait() sees the change; the tail also carries the nudge
+        static constexpr uint64_t CLOSED = 1ULL << 63;
+        static constexpr uint64_t NUDGED = 1ULL << 62;
+        static uint64_t Count(uint64_t counter) { return counter & ~(CLOSED | NUDGED); }
+
+        unsigned int m_Capacity;
+        std::atomic<uint64_t> m_Head = 0; // Frames taken, advanced by the consumer
+        std::atomic<uint64_t> m_Tail = 0; // Frames pushed, advanced by the producer
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef FRAMESOURCE_HPP
+#define FRAMESOURCE_HPP
+
+#pragma once
+
+#include "CursorCodec.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace FrameCodec {
+    enum class AcquireResult : uint8_t {
+        Frame,     // New pixels, readable until Release()
+        Unchanged, // Nothing on screen changed; only the pointer may have moved
+        Timeout,
+        Failed,
+    };
+
+    // An acquired frame: BGRA32, rows `pitch` bytes apart
+    struct SourceFrame {
+        const uint8_t* pixels = nullptr;
+        size_t pitch = 0;
+        uint64_t captureTime = 0; // FrameClockNow() when the frame was produced
+    };
+
+    // Where captured frames come from. The desktop duplication is one; the synthetic and replayed sources run
+    // every later stage (copy, codec, transport) without a GPU or a desktop.
+    class FrameSource {
+        public:
+        virtual ~FrameSource() = default;
+
+        virtual uint16_t GetWidth() const = 0;
+        virtual uint16_t GetHeight() const = 0;
+        virtual uint16_t GetRefreshRate() const = 0;
+
+        // Waits up to `timeoutMs` for the next frame. A Frame must be released before the next Acquire().
+        virtual AcquireResult Acquire(unsigned long timeoutMs, SourceFrame& frame) = 0;
+        virtual void Release() {}
+
+        // Pointer moves and shape changes, reported from Acquire() instead of being drawn into frames
+        virtual void SetPointerCallback(std::function<void(const CursorState&)> callback) { m_PointerCallback = std::move(callback); }
+
+        protected:
+        std::function<void(const CursorState&)> m_PointerCallback;
+    };
+
+    // Delivers frames at a display's refresh rate, or back to back when unpaced. A source that fell behind
+    // starts over from now rather than delivering a burst.
+    class FramePacer {
+        public:
+        FramePacer(uint16_t refreshRate, bool paced);
+
+        // True once the next frame is due; false if it isn't due within `timeoutMs`, after waiting that long
+        bool WaitUntilDue(unsigned long timeoutMs);
+
+        private:
+        bool m_Paced;
+        std::chrono::nanoseconds m_Interval;
+        std::chrono::steady_clock::time_point m_NextDue;
+    };
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef LATENCYTRACE_HPP
+#define LATENCYTRACE_HPP
+
+#pragma once
+
+#include "FrameHeader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int CLOCK_SYNC_ROUNDS = 32;
+
+    // Maps the sender's FrameClockNow() onto the receiver's. Each round trip gives
+    // offset = remote - (localSend + localRecv) / 2; the one with the smallest round trip wins,
+    // so the error is at most half of GetRoundTrip(). Steady clocks drift a few ppm, so this is
+    // good for the length of a session, not for days.
+    class ClockSync {
+        public:
+        void AddSample(uint64_t localSend, uint64_t remote, uint64_t localRecv);
+
+        bool IsValid() const { return m_Samples > 0; }
+        int64_t GetOffset() const { return m_Offset; }
+        uint64_t GetRoundTrip() const { return m_Samples ? m_RoundTrip : 0; }
+
+        uint64_t ToLocal(uint64_t remote) const { return remote ? remote - static_cast<uint64_t>(m_Offset) : 0; }
+
+        private:
+        unsigned int m_Samples = 0;
+        int64_t m_Offset = 0;
+        uint64_t m_RoundTrip = UINT64_MAX;
+    };
+
+    // In pipeline order; the first four are stamped on the sender
+    enum class TraceStage : uint8_t {
+        Capture,     // AcquireNextFrame returned
+        Encode,      // Readback/copy into the send buffer done
+        WritePosted, // RDMA write posted
+        WriteDone,   // RDMA write completed
+        Received,    // Receive completion on the viewer
+        Uploaded,    // Frame is in the GPU texture
+        Presented,   // Present returned
+        Count
+    };
+    constexpr size_t TRACE_STAGE_COUNT = static_cast<size_t>(TraceStage::Count);
+
+    const char* TraceStageName(TraceStage stage);
+
+    struct FrameTrace {
+        uint64_t sequence = 0;
+        uint64_t times[TRACE_STAGE_COUNT] = {}; // Receiver clock, ns. 0 = not stamped
+    };
+
+    struct LatencyPercentiles {
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t max = 0; // All in ns
+    };
+
+    // Collects per-frame stage timestamps on the viewer. Keeps the last `window` frames for percentiles
+    // and, with a CSV open, writes every frame's breakdown as it completes.
+    class LatencyTracer {
+        public:
+        explicit LatencyTracer(size_t window = 4096);
+
+        bool OpenCsv(const std::string& path);
+        void SetClock(const ClockSync& clock) { m_Clock = clock; }
+        const ClockSync& GetClock() const { return m_Clock; }
+
+        // Starts a frame from its header; the sender's stamps are moved into the local clock
+        void Begin(const FrameHeader& header, uint64_t writeDoneTime);
+        void Stamp(TraceStage stage) { Stamp(stage, FrameClockNow()); }
+        void Stamp(TraceStage stage, uint64_t time);
+        // Closes the frame Begin() started. False when none was open, e.g. after a keep-alive was presented again.
+        bool End();
+
+        size_t GetFrameCount() const { return m_Count; }
+
+        // Capture -> Presented
+        LatencyPercentiles GetTotal() const;
+        // Capture -> Presented of the frame End() last closed, in ns; 0 if either wasn't stamped
+        uint64_t GetLastTotal() const;
+        // From the previous stage to `stage`
+        LatencyPercentiles GetStep(TraceStage stage) const;
+
+        // One line per step plus the total, percentiles in microseconds
+        void Report(std::ostream& out) const;
+        void Reset();
+
+        private:
+        LatencyPercentiles Percentiles(size_t from, size_t to) const;
+
+        ClockSync m_Clock;
+        FrameTrace m_Current;
+        bool m_Active = false;
+
+        std::vector<FrameTrace> m_Frames; // Ring of the last `window` frames
+        size_t m_Next = 0;
+        size_t m_Count = 0;
+
+        std::ofstream m_Csv;
+    };
+}
+
+#endif
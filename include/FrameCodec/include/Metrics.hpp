@@ -0,0 +1,200 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FrameCodec {
+    enum class MetricType : uint8_t {
+        Counter,   // Only goes up; scrapers take the rate
+        Gauge,     // Last value set
+        Histogram, // Distribution of recorded values, e.g. microseconds
+    };
+
+    constexpr uint32_t MAX_METRICS = 128;
+    constexpr uint32_t MAX_HISTOGRAMS = 32;
+    constexpr uint32_t METRIC_NONE = UINT32_MAX;
+
+    // Bucket 0 holds 0, bucket i holds [2^(i-1), 2^i); the last one everything above
+    constexpr uint32_t HISTOGRAM_BUCKETS = 32;
+
+    struct MetricSnapshot {
+        std::string name;
+        MetricType type;
+        int64_t value = 0;  // Counter total or gauge value
+        uint64_t count = 0; // Histogram only from here on
+        uint64_t sum = 0;
+        std::array<uint64_t, HISTOGRAM_BUCKETS> buckets = {};
+
+        // Upper bound of the bucket holding the `percent`th percentile
+        uint64_t Percentile(unsigned int percent) const;
+    };
+
+    // Process-wide. Registering takes a lock and is meant for startup; updates never do. Each thread writes counters
+    // and histograms into a shard of its own with plain relaxed stores, and a snapshot sums the shards, so hot loops
+    // on different threads never share a cache line. A shard outlives its thread and is handed to the next new one.
+    class MetricsRegistry {
+        public:
+        static MetricsRegistry& Instance();
+
+        // The same name always gets the same id. METRIC_NONE once the registry is full, or for a name already
+        // registered as another type; updates to it are ignored.
+        uint32_t Register(const std::string& name, MetricType type);
+
+        void Add(uint32_t id, uint64_t value);
+        void Set(uint32_t id, int64_t value);
+        void Record(uint32_t id, uint64_t value);
+
+        std::vector<MetricSnapshot> Snapshot();
+
+        private:
+        struct alignas(64) Shard {
+            std::array<std::atomic<uint64_t>, MAX_METRICS> values = {}; // Counter totals, histogram sums
+            std::array<std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS>, MAX_HISTOGRAMS> buckets = {};
+        };
+        struct ShardLease; // Returns a thread's shard when the thread ends
+
+        MetricsRegistry() = default;
+        Shard& LocalShard();
+        Shard* AcquireShard();
+        void ReleaseShard(Shard* shard);
+
+        struct Entry {
+            std::string name;
+            MetricType type;
+            uint32_t histogram; // Slot in Shard::buckets
+        };
+
+        std::mutex m_Mutex;
+        std::vector<Entry> m_Entries;
+        uint32_t m_HistogramCount = 0;
+        std::array<std::atomic<int64_t>, MAX_METRICS> m_Gauges = {};
+        std::array<uint32_t, MAX_METRICS> m_HistogramSlots = {};
+
+        std::vector<std::unique_ptr<Shard>> m_Shards;
+        std::vector<Shard*> m_FreeShards;
+    };
+
+    // Handles for the hot loops: register once, usually as a static or a member, then update freely
+    class Counter {
+        public:
+        explicit Counter(const std::string& name) : m_Id(MetricsRegistry::Instance().Register(name, MetricType::Counter)) {}
+        void Add(uint64_t value = 1) const { MetricsRegistry::Instance().Add(m_Id, value); }
+
+        private:
+        uint32_t m_Id;
+    };
+
+    class Gauge {
+        public:
+        explicit Gauge(const std::string& name) : m_Id(MetricsRegistry::Instance().Register(name, MetricType::Gauge)) {}
+        void Set(int64_t value) const { MetricsRegistry::Instance().Set(m_Id, value); }
+
+        private:
+        uint32_t m_Id;
+    };
+
+    class Histogram {
+        public:
+        explicit Histogram(const std::string& name) : m_Id(MetricsRegistry::Instance().Register(name, MetricType::Histogram)) {}
+        void Record(uint64_t value) const { MetricsRegistry::Instance().Record(m_Id, value); }
+        void RecordMicroseconds(std::chrono::steady_clock::duration elapsed) const {
+            Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        }
+
+        private:
+        uint32_t m_Id;
+    };
+
+    // Shared-memory segment the exporter publishes into, for monitoring to map and read without touching the process.
+    // A seqlock guards it: `sequence` is odd while a snapshot is being written, so readers copy, then retry if it moved.
+    constexpr char SHARED_METRICS_MAGIC[8] = { 'N', 'D', 'R', 'C', 'M', 'E', 'T', '\0' };
+    constexpr uint32_t SHARED_METRICS_VERSION = 1;
+
+    struct SharedMetricsHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        uint64_t sequence;    // Only through std::atomic_ref
+        uint64_t publishTime; // Milliseconds since the Unix epoch
+        uint32_t processId;
+        uint32_t periodMs;
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(SharedMetricsHeader) == 64, "SharedMetricsHeader must stay 64 bytes");
+
+    struct SharedMetric {
+        char name[56];       // NUL-terminated, truncated
+        uint8_t type;        // MetricType
+        uint8_t reserved[7];
+        int64_t value;
+        uint64_t count;
+        uint64_t sum;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint8_t reserved2[16];
+    };
+    static_assert(sizeof(SharedMetric) == 128, "SharedMetric must stay 128 bytes");
+
+    constexpr size_t SHARED_METRICS_SIZE = sizeof(SharedMetricsHeader) + MAX_METRICS * sizeof(SharedMetric);
+
+    // Publishes a snapshot of the registry every `period` from a thread of its own: into the shared-memory segment
+    // `name` (Local\<name> on Windows, /dev/shm/<name> elsewhere) and, if `jsonPath` is set, into a JSON file
+    // replaced whole each time.
+    class MetricsExporter {
+        public:
+        MetricsExporter(const std::string& name, const std::string& jsonPath = "", std::chrono::milliseconds period = std::chrono::milliseconds(1000));
+        ~MetricsExporter();
+
+        bool Start();
+        // Publishes once more, so the segment and the file end with the final values
+        void Stop();
+
+        void Publish();
+
+        private:
+        bool MapSegment();
+        void UnmapSegment();
+        void WriteJson(const std::vector<MetricSnapshot>& snapshot, uint64_t publishTime);
+
+        std::string m_Name;
+        std::string m_JsonPath;
+        std::chrono::milliseconds m_Period;
+
+        void* m_Segment = nullptr;
+        void* m_Mapping = nullptr; // Windows only: the file mapping handle
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        bool m_Stop = false;
+        std::thread m_Thread;
+    };
+
+    // What a monitoring tool does: maps an exporter's segment read-only and copies out consistent snapshots
+    class SharedMetricsReader {
+        public:
+        ~SharedMetricsReader();
+
+        bool Open(const std::string& name);
+        // False if the segment isn't there or no consistent copy could be taken
+        bool Read(SharedMetricsHeader& header, std::vector<SharedMetric>& metrics) const;
+
+        private:
+        const void* m_Segment = nullptr;
+        void* m_Mapping = nullptr;
+    };
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef OUTPUTLAYOUT_HPP
+#define OUTPUTLAYOUT_HPP
+
+#pragma once
+
+#include "SessionMode.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int MAX_OUTPUTS = 4;
+    constexpr uint32_t MAX_CANVAS_DIMENSION = 16384; // Largest 2D texture D3D11 guarantees
+
+    // One captured output: where it sits on the sender's desktop and the mode it runs at
+    struct OutputDesc {
+        int32_t left;
+        int32_t top;
+        uint16_t width;
+        uint16_t height;
+        uint16_t refreshRate;
+        uint16_t reserved;
+    };
+    static_assert(sizeof(OutputDesc) == 16, "OutputDesc is part of the handshake's wire format");
+
+    // Sent right behind the SessionMode in the handshake. The SessionMode describes output 0; frames name
+    // their output in FrameHeader::output.
+    struct OutputSet {
+        uint32_t count;
+        OutputDesc outputs[MAX_OUTPUTS];
+    };
+
+    enum class CanvasLayout : uint8_t {
+        Composite = 0, // As arranged on the sender's desktop; gaps between outputs stay black
+        Tile = 1,      // Side by side in output order, top-aligned
+    };
+
+    struct Placement {
+        uint32_t x;
+        uint32_t y;
+        uint16_t width;
+        uint16_t height;
+    };
+
+    // Rejects what the viewer couldn't lay out: no outputs, too many, or empty sizes
+    bool IsValidOutputSet(const OutputSet& set);
+
+    // `session` as it applies to the frames of one output
+    SessionMode OutputMode(const SessionMode& session, const OutputDesc& output);
+
+    // Composite unless outputs overlap (mirrored displays) or the desktop's bounding box is too large for one texture
+    CanvasLayout ChooseCanvasLayout(const OutputSet& set);
+
+    // Where each output lands in the viewer's single canvas texture
+    class OutputCanvas {
+        public:
+        OutputCanvas(const OutputSet& set, CanvasLayout layout);
+
+        CanvasLayout GetLayout() const { return m_Layout; }
+        uint32_t GetWidth() const { return m_Width; }
+        uint32_t GetHeight() const { return m_Height; }
+        unsigned int GetCount() const { return static_cast<unsigned int>(m_Placements.size()); }
+        const Placement& operator[](unsigned int output) const { return m_Placements[output]; }
+
+        // False when the canvas exceeds MAX_CANVAS_DIMENSION in either direction
+        bool Fits() const { return m_Width <= MAX_CANVAS_DIMENSION && m_Height <= MAX_CANVAS_DIMENSION; }
+
+        private:
+        CanvasLayout m_Layout;
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+        std::vector<Placement> m_Placements;
+    };
+}
+
+#endif
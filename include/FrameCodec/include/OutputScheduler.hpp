@@ -0,0 +1,55 @@
+#ifndef OUTPUTSCHEDULER_HPP
+#define OUTPUTSCHEDULER_HPP
+
+#pragma once
+
+#include "OutputLayout.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Decides which output the shared network stage sends next. Every output is captured at its own rate and
+    // marks itself ready; the sender takes the ready output whose frame is due first, that is ready time plus
+    // one refresh interval of its own. A 144Hz output can't starve a 30Hz one, and neither is paced by the other.
+    class OutputScheduler {
+        public:
+        explicit OutputScheduler(unsigned int count);
+
+        unsigned int GetCount() const { return m_Count; }
+        void SetRefreshRate(unsigned int output, uint16_t refreshRate);
+
+        // Capture side, one thread per output. A frame has been waiting since `time` (FrameClockNow()); marking
+        // again before it was taken keeps the older time, since the mailbox only replaced the frame.
+        void MarkReady(unsigned int output, uint64_t time);
+
+        // Network side: the ready output with the earliest deadline at `now`, or -1 when none is ready
+        int TakeNext(uint64_t now);
+        // Blocks until an output is ready. -1 once closed and nothing is left.
+        int WaitNext();
+
+        void Close();
+        // Nothing ready and open again; neither side may be running. Counters carry on.
+        void Reopen();
+
+        uint64_t GetSent(unsigned int output) const { return m_Outputs[output].sent.load(std::memory_order_relaxed); }
+        // Taken after its deadline had passed, i.e. later than one refresh interval after it was ready
+        uint64_t GetLate(unsigned int output) const { return m_Outputs[output].late.load(std::memory_order_relaxed); }
+
+        private:
+        struct Output {
+            std::atomic<uint64_t> readySince = 0; // 0: nothing waiting
+            uint64_t interval = 0;                // Nanoseconds per refresh
+            std::atomic<uint64_t> sent = 0;
+            std::atomic<uint64_t> late = 0;
+        };
+
+        unsigned int m_Count;
+        std::array<Output, MAX_OUTPUTS> m_Outputs;
+        std::atomic<uint32_t> m_Epoch = 0; // Bumped on every MarkReady() and Close(), for WaitNext() to wait on
+        std::atomic<bool> m_Closed = false;
+    };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PULLPROTOCOL_HPP
+#define PULLPROTOCOL_HPP
+
+#pragma once
+
+#include "FrameHeader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    constexpr uint32_t PULL_SLOTS = 3; // Newest, one being rewritten, one the receiver may still be reading
+
+    // Published behind the sender's slots; the receiver RDMA-reads it to find the newest frame.
+    // `latest` packs sequence and slot so a single 8-byte read can't pair a new sequence with an old slot.
+    // slotSequence[] is a seqlock per slot: 0 while the sender rewrites it, the frame's sequence once complete.
+    // Sequences start at 1, so 0 also means "nothing published yet".
+    struct alignas(FRAME_CACHE_LINE) PullControl {
+        uint64_t latest;
+        uint64_t slotSequence[PULL_SLOTS];
+    };
+
+    inline uint64_t PackLatest(uint64_t sequence, uint32_t slot) { return (sequence << 8) | slot; }
+    inline uint64_t LatestSequence(uint64_t latest) { return latest >> 8; }
+    inline uint32_t LatestSlot(uint64_t latest) { return static_cast<uint32_t>(latest & 0xFF); }
+
+    // Sender layout: [slot 0][slot 1][slot 2][PullControl], every slot laid out like a push buffer. The control
+    // block stays clear of the first line, which the connection setup still uses for its own messages.
+    inline size_t PullSlotOffset(uint32_t slot, size_t slotSize) { return slot * slotSize; }
+    inline size_t PullControlOffset(size_t slotSize) { return PULL_SLOTS * slotSize; }
+    inline size_t PullBufferSize(size_t slotSize) { return PullControlOffset(slotSize) + sizeof(PullControl); }
+
+    // Sender side. Never waits for the receiver: it always has a slot that is neither the newest
+    // frame nor the one it published before that.
+    class PullPublisher {
+        public:
+        explicit PullPublisher(PullControl* control);
+
+        // Picks the slot for the next frame and marks it as being rewritten
+        uint32_t BeginSlot();
+
+        // Makes the frame in `slot` the newest one
+        void Publish(uint32_t slot, uint64_t sequence);
+
+        private:
+        PullControl* m_Control;
+        uint32_t m_Newest = PULL_SLOTS;   // None yet
+        uint32_t m_Previous = PULL_SLOTS;
+    };
+
+    // Receiver side: `after` is the control block read back once the slot has been copied.
+    // The copy is intact only if the sender hasn't started rewriting the slot in the meantime.
+    inline bool PullSlotIntact(const PullControl& after, uint32_t slot, uint64_t sequence) {
+        return slot < PULL_SLOTS && sequence != 0 && after.slotSequence[slot] == sequence;
+    }
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef REPLAYSOURCE_HPP
+#define REPLAYSOURCE_HPP
+
+#pragma once
+
+#include "FrameSource.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace FrameCodec {
+    // Plays back a recording of raw BGRA32 frames, back to back with no header, e.g. what
+    // `ffmpeg -f gdigrab -i desktop -f rawvideo -pix_fmt bgra out.raw` writes. Every frame is delivered as new.
+    class ReplaySource : public FrameSource {
+        public:
+        ReplaySource(uint16_t width, uint16_t height, uint16_t refreshRate, bool paced = false, bool loop = true);
+
+        bool Open(const std::string& path);
+
+        uint16_t GetWidth() const override { return m_Width; }
+        uint16_t GetHeight() const override { return m_Height; }
+        uint16_t GetRefreshRate() const override { return m_RefreshRate; }
+
+        // Failed at the end of a recording that doesn't loop
+        AcquireResult Acquire(unsigned long timeoutMs, SourceFrame& frame) override;
+
+        uint64_t GetFrameCount() const { return m_FrameCount; }
+
+        private:
+        uint16_t m_Width;
+        uint16_t m_Height;
+        uint16_t m_RefreshRate;
+        bool m_Loop;
+        FramePacer m_Pacer;
+
+        std::ifstream m_File;
+        uint64_t m_FrameCount = 0;
+        uint64_t m_Next = 0;
+        std::vector<uint8_t> m_Pixels;
+    };
+}
+
+#endif
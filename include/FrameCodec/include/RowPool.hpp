@@ -0,0 +1,70 @@
+#ifndef ROWPOOL_HPP
+#define ROWPOOL_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FrameCodec {
+    // Runs a body over a frame's rows, or any run of independent units, on a few threads, one contiguous share
+    // each, the calling thread included, so `threads` = 1 runs without workers. Row shares are cut on even rows,
+    // so a UV row belongs to one share only; unit shares are cut anywhere.
+    class RowPool {
+        public:
+        static constexpr unsigned int MAX_THREADS = 8;
+
+        // `threads` 0 picks one per core up to MAX_THREADS
+        explicit RowPool(unsigned int threads);
+        ~RowPool();
+
+        RowPool(const RowPool&) = delete;
+        RowPool& operator=(const RowPool&) = delete;
+
+        // Calls body(begin, end) for every share of [0, rows) and returns once all are done
+        template <typename Body>
+        void Run(unsigned int rows, const Body& body) {
+            Dispatch(rows, 2, GetThreadCount(), &Call<Body>, &body);
+        }
+
+        // As Run(), over `units` units of uneven, small cost: no share gets fewer than `minShare` of them and there
+        // are never more shares than cores, so a handful of units, or a machine short of cores, runs on this thread
+        template <typename Body>
+        void RunUnits(unsigned int units, unsigned int minShare, const Body& body) {
+            const unsigned int shares = std::max(1u, std::min({ GetThreadCount(), m_Cores, units / std::max(minShare, 1u) }));
+            Dispatch(units, 1, shares, &Call<Body>, &body);
+        }
+
+        unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Workers.size()) + 1; }
+
+        private:
+        using Share = void (*)(const void* context, unsigned int begin, unsigned int end);
+
+        template <typename Body>
+        static void Call(const void* context, unsigned int begin, unsigned int end) { (*static_cast<const Body*>(context))(begin, end); }
+
+        void Dispatch(unsigned int count, unsigned int grain, unsigned int shares, Share share, const void* context);
+        void WorkerLoop(unsigned int index);
+        void RunShare(unsigned int index) const;
+
+        std::vector<std::thread> m_Workers;
+        unsigned int m_Cores;
+        std::mutex m_Mutex;
+        std::condition_variable m_Start;
+        std::condition_variable m_Done;
+        unsigned int m_Count = 0;
+        unsigned int m_Grain = 2; // Shares are whole multiples of this many rows or units
+        unsigned int m_Shares = 1;
+        Share m_Share = nullptr;
+        const void* m_Context = nullptr;
+        uint64_t m_Generation = 0;
+        unsigned int m_Pending = 0;
+        bool m_Stop = false;
+    };
+}
+
+#endif
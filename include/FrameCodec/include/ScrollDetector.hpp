@@ -0,0 +1,82 @@
+#ifndef SCROLLDETECTOR_HPP
+#define SCROLLDETECTOR_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int BYTES_PER_PIXEL = 4; // BGRA32
+
+    constexpr unsigned int SCROLL_STRIP_WIDTH = 64;  // Columns hashed together when looking for vertical moves
+    constexpr unsigned int SCROLL_BAND_HEIGHT = 64;  // Rows hashed together when looking for horizontal moves
+    constexpr unsigned int SCROLL_MIN_RUN = 16;      // Shortest matching run worth a copy command
+    constexpr unsigned int SCROLL_MIN_VOTES = 4;     // Changed rows/columns that must agree on the shift
+
+    // "Copy the rectangle at (srcX, srcY) of the previous frame to (dstX, dstY)".
+    // Commands are applied in order to the receiver's frame, before any dirty tile.
+    struct CopyRect {
+        uint16_t srcX;
+        uint16_t srcY;
+        uint16_t dstX;
+        uint16_t dstY;
+        uint16_t width;
+        uint16_t height;
+    };
+
+    // Moves a rectangle inside a BGRA frame. Source and destination may overlap.
+    void ApplyCopyRect(uint8_t* frame, size_t pitch, const CopyRect& rect);
+
+    // Finds scrolled content between two consecutive frames by hashing rows (per column strip)
+    // and columns (per row band), then voting for the displacement that explains the most changes.
+    class ScrollDetector {
+        public:
+        ScrollDetector(unsigned short width, unsigned short height);
+
+        // Appends the detected moves from `previous` to `current` to `rects`. Rects of one call never
+        // read from another rect's destination, so they can be applied in any order.
+        // Returns the number of rects appended.
+        size_t Detect(const uint8_t* previous, const uint8_t* current, size_t pitch, std::vector<CopyRect>& rects);
+
+        void SetMaxShift(unsigned int maxShift) { m_MaxShift = maxShift; }
+        void EnableHorizontal(bool enable) { m_Horizontal = enable; }
+
+        private:
+        struct Shift {
+            int offset;
+            unsigned int begin;
+            unsigned int end;
+        };
+
+        static bool SameShift(const Shift& a, const Shift& b) {
+            return a.offset == b.offset && a.begin == b.begin && a.end == b.end;
+        }
+
+        void HashRows(const uint8_t* frame, size_t pitch, std::vector<uint64_t>& hashes) const;
+        void HashColumns(const uint8_t* frame, size_t pitch, std::vector<uint64_t>& hashes) const;
+
+        bool FindShift(const uint64_t* previous, const uint64_t* current, unsigned int count, Shift& shift);
+
+        size_t DetectVertical(std::vector<CopyRect>& rects);
+        size_t DetectHorizontal(const uint8_t* previous, const uint8_t* current, size_t pitch, std::vector<CopyRect>& rects);
+
+        unsigned short m_Width;
+        unsigned short m_Height;
+        unsigned int m_Strips;
+        unsigned int m_Bands;
+        unsigned int m_MaxShift;
+        bool m_Horizontal = true;
+
+        std::vector<uint64_t> m_PrevHashes;
+        std::vector<uint64_t> m_CurHashes;
+
+        // Open-addressing table from previous hash to position, reused across strips
+        std::vector<uint64_t> m_TableKeys;
+        std::vector<int> m_TableValues;
+        std::vector<unsigned int> m_Votes;
+    };
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SESSIONMODE_HPP
+#define SESSIONMODE_HPP
+
+#pragma once
+
+#include "FrameHeader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    // What both ends agree on for the session. The TCP handshake sends it as is; a later mode change
+    // carries it in-band as the payload of a FRAME_FLAG_MODE_CHANGE frame.
+    struct SessionMode {
+        uint16_t width;
+        uint16_t height;
+        uint16_t refreshRate;
+        uint16_t format;        // PixelFormat: BGRA32 tile deltas or whole frames, lossless tile deltas, or planar YUV bands
+        uint16_t tileCacheSize;
+        uint16_t bandCount;
+        uint16_t pull;          // Fixed for the session; only push modes renegotiate
+        uint16_t colorSpace;    // ColorSpace of the planar YUV formats, see ColorSpace.hpp; 0 is the original BT.601 full range
+
+        bool operator==(const SessionMode&) const = default;
+    };
+    static_assert(sizeof(SessionMode) == 8 * sizeof(uint16_t), "SessionMode is the handshake's wire format");
+
+    // Rejects what neither side could lay out: empty sizes, unknown formats, color spaces or flags, band counts out of range
+    bool IsValidSessionMode(const SessionMode& mode);
+
+    // Largest payload a single frame carries in `mode`
+    size_t MaxFramePayload(const SessionMode& mode);
+
+    // Bytes each side lays out in its registered buffer. The receiver holds one slot; a push sender
+    // two slots and its band signals, a pull sender its published slots and control block.
+    size_t ReceiverBufferSize(const SessionMode& mode);
+    size_t SenderBufferSize(const SessionMode& mode);
+
+    // Viewer to sender: a mode the viewer would like, left in its flag line behind the FrameSignal. The
+    // sender's flag poll reads the line anyway, so the request costs nothing until `serial` changes.
+    struct ModeRequest {
+        uint32_t serial;
+        SessionMode mode;
+    };
+    constexpr size_t MODE_REQUEST_OFFSET = 32;
+    static_assert(MODE_REQUEST_OFFSET >= sizeof(FrameSignal) && MODE_REQUEST_OFFSET + sizeof(ModeRequest) <= FRAME_HEADER_OFFSET,
+                  "ModeRequest must sit in the flag line, clear of the FrameSignal");
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SYNTHETICSOURCE_HPP
+#define SYNTHETICSOURCE_HPP
+
+#pragma once
+
+#include "FrameSource.hpp"
+
+#include <vector>
+
+namespace FrameCodec {
+    enum class SyntheticContent : uint8_t {
+        StaticDesktop, // One frame, then nothing changes
+        ScrollingText, // Lines of glyphs moving up a few rows per frame, like a terminal or a long page
+        VideoNoise,    // Fresh noise in a video-sized rectangle every frame, over a static desktop
+        CursorOnly,    // A static desktop with only the pointer moving
+    };
+    constexpr unsigned int SYNTHETIC_CONTENT_COUNT = 4;
+
+    const char* SyntheticContentName(SyntheticContent content);
+
+    // Desktop-like frames without a desktop. The same seed always produces the same sequence, so two runs
+    // encode identical frames. Like the duplication, a source with nothing new reports Timeout, or Unchanged
+    // when only the pointer moved.
+    class SyntheticSource : public FrameSource {
+        public:
+        static constexpr unsigned int SCROLL_STEP = 4;  // Rows per frame
+        static constexpr unsigned int LINE_HEIGHT = 16;
+
+        SyntheticSource(uint16_t width, uint16_t height, uint16_t refreshRate, SyntheticContent content, uint32_t seed = 1, bool paced = false);
+
+        uint16_t GetWidth() const override { return m_Width; }
+        uint16_t GetHeight() const override { return m_Height; }
+        uint16_t GetRefreshRate() const override { return m_RefreshRate; }
+
+        AcquireResult Acquire(unsigned long timeoutMs, SourceFrame& frame) override;
+
+        uint64_t GetFrameCount() const { return m_Frames; }
+
+        private:
+        uint32_t Random();
+        void FillRect(unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t color);
+        void DrawDesktop();
+        void DrawTextRow(unsigned int y);
+        void NextLine();
+        void MovePointer();
+
+        uint16_t m_Width;
+        uint16_t m_Height;
+        uint16_t m_RefreshRate;
+        SyntheticContent m_Content;
+        FramePacer m_Pacer;
+        uint32_t m_State;
+        uint64_t m_Frames = 0;
+        std::vector<uint8_t> m_Pixels;
+
+        // ScrollingText: glyphs of the line being drawn in at the bottom, and how far along it is
+        std::vector<uint8_t> m_Line;
+        unsigned int m_LineRow = 0;
+        unsigned int m_TextLeft = 0;
+        unsigned int m_TextWidth = 0;
+
+        CursorState m_Pointer;
+    };
+}
+
+#endif
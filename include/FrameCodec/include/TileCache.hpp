@@ -0,0 +1,72 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr uint32_t TILE_CACHE_NONE = 0xFFFFFFFF;
+    constexpr unsigned short DEFAULT_TILE_CACHE_SIZE = 2048; // 2048 * 16KB = 32MB on the receiver
+
+    struct TileCacheStats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long savedBytes = 0;
+
+        double HitRate() const {
+            unsigned long long lookups = hits + misses;
+            return lookups ? static_cast<double>(hits) / lookups : 0.0;
+        }
+    };
+
+    // Sender-side mirror of the receiver's cache: content hash -> slot, least recently used first out.
+    // The sender picks every slot, so the receiver only has to store what it is told to store.
+    class TileCacheIndex {
+        public:
+        explicit TileCacheIndex(uint32_t capacity);
+
+        // Returns the slot holding `hash` and marks it most recently used, or TILE_CACHE_NONE.
+        uint32_t Find(uint64_t hash);
+
+        // Assigns a slot to `hash`, evicting the least recently used entry when full.
+        uint32_t Insert(uint64_t hash);
+
+        uint32_t GetCapacity() const { return m_Capacity; }
+
+        private:
+        void Unlink(uint32_t slot);
+        void PushFront(uint32_t slot);
+
+        uint32_t m_Capacity;
+        uint32_t m_Used = 0;
+        uint32_t m_Head = TILE_CACHE_NONE; // Most recently used
+        uint32_t m_Tail = TILE_CACHE_NONE; // Least recently used
+
+        std::vector<uint32_t> m_Prev;
+        std::vector<uint32_t> m_Next;
+        std::vector<uint64_t> m_Hashes;
+        std::unordered_map<uint64_t, uint32_t> m_Slots;
+    };
+
+    // Receiver-side tile storage. Every slot holds up to TILE_SIZE x TILE_SIZE BGRA pixels.
+    class TileCache {
+        public:
+        explicit TileCache(uint32_t capacity);
+
+        void Store(uint32_t slot, const uint8_t* src, size_t pitch, size_t rowBytes, unsigned int rows);
+        void Load(uint32_t slot, uint8_t* dst, size_t pitch, size_t rowBytes, unsigned int rows) const;
+        bool Matches(uint32_t slot, const uint8_t* src, size_t pitch, size_t rowBytes, unsigned int rows) const;
+
+        uint32_t GetCapacity() const { return m_Capacity; }
+
+        private:
+        uint32_t m_Capacity;
+        std::vector<uint8_t> m_Storage;
+    };
+}
+
+#endif
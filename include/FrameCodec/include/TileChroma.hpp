@@ -0,0 +1,58 @@
+#ifndef TILECHROMA_HPP
+#define TILECHROMA_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    // YUVAdaptive picks the chroma resolution of every square tile on its own. A band of it starts on a whole tile row.
+    constexpr unsigned int CHROMA_TILE_SIZE = 16;
+    // A U or V step wider than this inside a block is one subsampling would visibly smear
+    constexpr unsigned int CHROMA_EDGE = 16;
+
+    enum class TileChroma : uint8_t {
+        Full = 0,    // A U,V pair per pixel: coloured text and UI edges
+        Half = 1,    // 4:4:0, a pair per two rows: edges that only split columns
+        Quarter = 2, // 4:2:0, a pair per 2x2 block: photos, video and anything without chroma edges
+    };
+    constexpr unsigned int TILE_CHROMA_COUNT = 3;
+
+    inline unsigned int ChromaTilesX(unsigned int width) {
+        return (width + CHROMA_TILE_SIZE - 1) / CHROMA_TILE_SIZE;
+    }
+
+    inline unsigned int ChromaTilesY(unsigned int height) {
+        return (height + CHROMA_TILE_SIZE - 1) / CHROMA_TILE_SIZE;
+    }
+
+    // U,V pairs of a `width` x `height` tile in `mode`. Unlike the planar formats an odd height's last row keeps its
+    // chroma, since the frame's edge tiles are the only ones that can be odd.
+    inline size_t TileChromaPairs(TileChroma mode, unsigned int width, unsigned int height) {
+        switch (mode) {
+            case TileChroma::Half: return static_cast<size_t>(width) * ((height + 1) / 2);
+            case TileChroma::Quarter: return static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+            default: return static_cast<size_t>(width) * height;
+        }
+    }
+
+    // What the classifier measures on a tile's full-resolution U,V pairs. Only steps inside the blocks a mode would
+    // average count as edges, so a tile whose edges all fall between blocks loses nothing to 4:2:0.
+    struct TileStats {
+        uint32_t edgesH;  // Odd-column pixels more than CHROMA_EDGE away from the pixel on their left, in U or V
+        uint32_t edgesV;  // Odd-row pixels more than CHROMA_EDGE away from the pixel above
+        uint32_t changes; // Pixels whose U,V differ at all from the pixel on their left; low for the few colours of UI
+    };
+
+    // No edge, or so many colours that the content is natural: 4:2:0. Otherwise the cheapest mode keeping every edge.
+    TileChroma PickTileChroma(const TileStats& stats, unsigned int pixels);
+
+    // The chroma section of a YUVAdaptive band of `rows` rows: one TileChroma byte per tile, row by row, then the
+    // U,V pairs of each tile in the same order, row by row inside the tile. This is its size when every tile is Full.
+    inline size_t AdaptiveChromaMaxSize(unsigned int width, unsigned int rows) {
+        return static_cast<size_t>(ChromaTilesX(width)) * ChromaTilesY(rows) + static_cast<size_t>(width) * rows * 2;
+    }
+}
+
+#endif
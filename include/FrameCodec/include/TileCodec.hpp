@@ -0,0 +1,53 @@
+#ifndef TILECODEC_HPP
+#define TILECODEC_HPP
+
+#pragma once
+
+#include "ScrollDetector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameCodec {
+    // Lossless BGRA32 tile streams, in the spirit of QOI and LZ4: a few byte-aligned ops that desktop content hits
+    // almost every pixel, no entropy coding, and nothing carried from one tile to the next, so tiles code in parallel.
+    //
+    // A stream starts with a LosslessMode byte. Stored: the tile's pixels follow as is. Coded: ops follow, each a
+    // byte of kind << 6 | count, covering the tile's pixels in scan order. A count field below 63 stands for
+    // count + 1; 63 for 64 plus the following bytes, LZ4-style: 255 means another byte follows.
+    // "Left" is the pixel before in scan order, the previous row's last one at a row start, and "up" the pixel
+    // a row above. Both read zeros above the first row, and runs may wrap onto the next row.
+    enum class LosslessMode : uint8_t {
+        Stored = 0,
+        Coded = 1,
+    };
+
+    enum class LosslessOp : uint8_t {
+        Left = 0,    // `count` pixels repeating the left one: flat fills
+        Up = 1,      // `count` pixels copied from the row above: repeated rows, text lines, gradients that run across
+        Literal = 2, // `count` pixels follow, 4 bytes each; each also enters the palette
+        Index = 3,   // One pixel from the palette, the count field being its slot
+    };
+
+    constexpr unsigned int LOSSLESS_COUNT_BITS = 6;
+    constexpr unsigned int LOSSLESS_COUNT_EXTENDED = (1u << LOSSLESS_COUNT_BITS) - 1;
+    constexpr unsigned int LOSSLESS_PALETTE_SIZE = 1u << LOSSLESS_COUNT_BITS;
+
+    inline unsigned int LosslessPaletteSlot(uint32_t pixel) {
+        return (pixel * 0x9E3779B1u) >> (32 - LOSSLESS_COUNT_BITS);
+    }
+
+    // The encoder falls back to Stored rather than grow a tile, so this is the bound on a stream
+    inline size_t MaxLosslessTileSize(unsigned int width, unsigned int rows) {
+        return 1 + static_cast<size_t>(width) * rows * BYTES_PER_PIXEL;
+    }
+
+    // Codes the `width` x `rows` BGRA32 tile at `tile`, rows `pitch` bytes apart, into `out`, which must hold
+    // MaxLosslessTileSize() bytes. Returns the stream's length.
+    size_t EncodeLosslessTile(const uint8_t* tile, size_t pitch, unsigned int width, unsigned int rows, uint8_t* out);
+
+    // False when the stream is malformed or does not cover the tile exactly; the tile may then be partly written
+    bool DecodeLosslessTile(const uint8_t* in, size_t length, unsigned int width, unsigned int rows, uint8_t* tile, size_t pitch);
+}
+
+#endif
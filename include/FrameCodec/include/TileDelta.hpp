@@ -0,0 +1,143 @@
+#ifndef TILEDELTA_HPP
+#define TILEDELTA_HPP
+
+#pragma once
+
+#include "RowPool.hpp"
+#include "ScrollDetector.hpp"
+#include "TileCache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace FrameCodec {
+    constexpr unsigned int TILE_SIZE = 64;
+    constexpr unsigned int MAX_COPY_RECTS = 64;
+    constexpr uint32_t TILE_CACHE_HIT = 0x80000000; // Set in TileEntry::tile when the pixels come from the cache
+    constexpr unsigned int LOSSLESS_MIN_SHARE = 16;  // Tiles a lossless coding thread must get to be worth waking
+
+    // Raw frame payload layout:
+    //   DeltaHeader
+    //   CopyRect[copyCount]           - applied first, against the receiver's current frame
+    //   TileEntry[tileCount]          - row-major tile numbers with their cache slots
+    //   tile pixels, in entry order, each tile tightly packed (edge tiles are smaller); cache hits carry none
+    // A lossless payload (PayloadEncoding::TileDeltaLossless) has the same sections up to the entries, then
+    //   uint32_t[tileCount]           - each tile's stream length, 0 for cache hits
+    //   the EncodeLosslessTile() streams, in entry order
+    struct DeltaHeader {
+        uint16_t copyCount;
+        uint16_t reserved;
+        uint32_t tileCount;
+    };
+
+    // tile & TILE_CACHE_HIT: load the tile from `slot`.
+    // Otherwise pixels follow and are stored into `slot` unless it is TILE_CACHE_NONE.
+    struct TileEntry {
+        uint32_t tile;
+        uint32_t slot;
+    };
+
+    inline unsigned int TilesX(unsigned short width) { return (width + TILE_SIZE - 1) / TILE_SIZE; }
+    inline unsigned int TilesY(unsigned short height) { return (height + TILE_SIZE - 1) / TILE_SIZE; }
+
+    // Worst case: every tile dirty plus the largest command list
+    size_t MaxDeltaSize(unsigned short width, unsigned short height, bool lossless = false);
+
+    class DeltaEncoder {
+        public:
+        DeltaEncoder(unsigned short width, unsigned short height);
+
+        // Encodes a tightly packed BGRA frame against what the receiver currently shows.
+        // `out` must hold MaxDeltaSize() bytes. Returns the number of bytes written.
+        size_t Encode(const uint8_t* frame, uint8_t* out);
+
+        void EnableScrollDetection(bool enable) { m_ScrollEnabled = enable; }
+
+        // Codes dirty tiles losslessly on up to `threads` threads (0: one per core), each given a contiguous run of
+        // at least LOSSLESS_MIN_SHARE of them; must match the receiver's DeltaDecoder
+        void EnableLossless(bool enable, unsigned int threads = 0);
+        bool IsLossless() const { return m_Pool != nullptr; }
+
+        // The receiver was sent `frame` some other way (a keyframe); the next Encode() diffs against it
+        void Reset(const uint8_t* frame);
+
+        // Must match the receiver's DeltaDecoder::SetTileCache(). 0 disables the cache.
+        void SetTileCache(uint32_t capacity);
+
+        unsigned long long GetCopiedRects() const { return m_CopiedRects; }
+        unsigned long long GetDirtyTiles() const { return m_DirtyTileTotal; }
+        const TileCacheStats& GetTileCacheStats() const { return m_CacheStats; }
+        // Pixel bytes of the tiles sent losslessly, and what their streams took
+        unsigned long long GetLosslessRawBytes() const { return m_LosslessRawBytes; }
+        unsigned long long GetLosslessBytes() const { return m_LosslessBytes; }
+
+        private:
+        bool TileDiffers(const uint8_t* frame, unsigned int tx, unsigned int ty) const;
+        TileEntry LookupTile(const uint8_t* frame, uint32_t index);
+        uint8_t* WriteLosslessTiles(const uint8_t* frame, uint8_t* p);
+
+        unsigned short m_Width;
+        unsigned short m_Height;
+        size_t m_Pitch;
+
+        std::vector<uint8_t> m_Mirror; // The receiver's frame as of the last Encode()
+        ScrollDetector m_Scroll;
+        bool m_ScrollEnabled = true;
+
+        // Index mirrors the receiver's slots; the local copy of the pixels rules out hash collisions
+        std::unique_ptr<TileCacheIndex> m_CacheIndex;
+        std::unique_ptr<TileCache> m_CacheTiles;
+        TileCacheStats m_CacheStats;
+
+        std::vector<CopyRect> m_Rects;
+        std::vector<TileEntry> m_Entries;
+
+        std::unique_ptr<RowPool> m_Pool; // Set when lossless
+        std::vector<uint32_t> m_StreamSizes;
+        std::vector<size_t> m_StreamOffsets;
+
+        unsigned long long m_CopiedRects = 0;
+        unsigned long long m_DirtyTileTotal = 0;
+        unsigned long long m_LosslessRawBytes = 0;
+        unsigned long long m_LosslessBytes = 0;
+    };
+
+    class DeltaDecoder {
+        public:
+        DeltaDecoder(unsigned short width, unsigned short height);
+
+        // Applies a payload produced by DeltaEncoder. Returns false on a malformed payload,
+        // in which case the frame may be partially updated.
+        bool Decode(const uint8_t* in, size_t length);
+
+        // Replaces the frame with a tightly packed one, e.g. a keyframe that didn't come as a delta
+        void Reset(const uint8_t* frame);
+
+        void SetTileCache(uint32_t capacity);
+
+        // Must match the sender's DeltaEncoder::EnableLossless()
+        void EnableLossless(bool enable, unsigned int threads = 0);
+        bool IsLossless() const { return m_Pool != nullptr; }
+
+        const uint8_t* GetFrame() const { return m_Frame.data(); }
+        size_t GetPitch() const { return m_Pitch; }
+
+        private:
+        bool DecodeLosslessTiles(const uint8_t* entries, uint32_t count, const uint8_t* p, const uint8_t* end);
+
+        unsigned short m_Width;
+        unsigned short m_Height;
+        size_t m_Pitch;
+
+        std::vector<uint8_t> m_Frame;
+        std::unique_ptr<TileCache> m_Cache;
+
+        std::unique_ptr<RowPool> m_Pool; // Set when lossless
+        std::vector<size_t> m_StreamOffsets;
+        std::vector<uint8_t> m_Seen; // Per tile, so no two entries of a payload decode into the same one
+    };
+}
+
+#endif
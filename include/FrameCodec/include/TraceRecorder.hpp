@@ -0,0 +1,126 @@
+#ifndef TRACERECORDER_HPP
+#define TRACERECORDER_HPP
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FrameCodec {
+    // Set while a recording runs. Every trace call checks it first, so a disabled recorder costs one relaxed load.
+    inline std::atomic<bool> g_TraceEnabled = false;
+
+    inline bool TraceEnabled() { return g_TraceEnabled.load(std::memory_order_relaxed); }
+
+    // Raw TSC ticks on x86, steady-clock nanoseconds elsewhere; the recorder converts them when it writes the file
+    uint64_t TraceTicks();
+
+    enum class TracePhase : uint8_t {
+        Begin,
+        End,
+        Instant,
+    };
+
+    // Names and categories are never copied: pass string literals
+    struct TraceEvent {
+        uint64_t ticks;
+        const char* name;
+        const char* category;
+        TracePhase phase;
+    };
+
+    // Records begin/end/instant events into Chrome's trace event JSON, which chrome://tracing and ui.perfetto.dev
+    // both open. Each thread writes into a ring of its own with no lock and no allocation; a background thread
+    // drains the rings into the file every few milliseconds. When a ring is full the event is dropped and counted.
+    class TraceRecorder {
+        public:
+        static constexpr size_t DEFAULT_RING_EVENTS = 1 << 14; // Per thread; a power of two
+
+        static TraceRecorder& Instance();
+
+        bool Start(const std::string& path, size_t ringEvents = DEFAULT_RING_EVENTS);
+        // Drains what is left, names the threads and closes the file
+        void Stop();
+
+        void Record(TracePhase phase, const char* name, const char* category);
+        // Shown in the viewer instead of the thread id; kept by pointer like event names. Costs nothing until the
+        // thread records its first event, so threads may name themselves whether or not a recording runs.
+        void SetThreadName(const char* name);
+
+        uint64_t GetWritten() const { return m_Written.load(std::memory_order_relaxed); }
+        uint64_t GetDropped() const;
+
+        private:
+        struct Ring {
+            std::unique_ptr<TraceEvent[]> events;
+            size_t mask = 0;
+            uint32_t threadId = 0;
+            std::atomic<const char*> threadName = nullptr;
+            alignas(64) std::atomic<uint64_t> head = 0; // Next slot the thread writes
+            alignas(64) std::atomic<uint64_t> tail = 0; // Next slot the flusher reads
+            std::atomic<uint64_t> dropped = 0;
+        };
+
+        TraceRecorder() = default;
+        Ring* LocalRing(bool create = true);
+        void FlushLoop();
+        void Drain();
+        void Calibrate();
+
+        mutable std::mutex m_RingsMutex;
+        std::vector<std::unique_ptr<Ring>> m_Rings; // Live until the process ends; threads keep pointers to theirs
+        size_t m_RingEvents = DEFAULT_RING_EVENTS;
+
+        std::ofstream m_File;
+        bool m_FirstEvent = true;
+        uint64_t m_StartTicks = 0;
+        double m_TicksPerUs = 1.0;
+        uint32_t m_ProcessId = 0;
+
+        std::mutex m_Mutex; // Start/Stop and the file
+        std::condition_variable m_Wake;
+        bool m_Stop = false;
+        std::thread m_Thread;
+        std::atomic<uint64_t> m_Written = 0;
+    };
+
+    inline void TraceBegin(const char* name, const char* category) {
+        if (TraceEnabled()) TraceRecorder::Instance().Record(TracePhase::Begin, name, category);
+    }
+
+    inline void TraceEnd(const char* name, const char* category) {
+        if (TraceEnabled()) TraceRecorder::Instance().Record(TracePhase::End, name, category);
+    }
+
+    inline void TraceInstant(const char* name, const char* category) {
+        if (TraceEnabled()) TraceRecorder::Instance().Record(TracePhase::Instant, name, category);
+    }
+
+    // Begin now, end when the scope closes. A scope opened while disabled stays silent even if recording starts.
+    class TraceScope {
+        public:
+        TraceScope(const char* name, const char* category) : m_Name(name), m_Category(category), m_Active(TraceEnabled()) {
+            if (m_Active) TraceRecorder::Instance().Record(TracePhase::Begin, m_Name, m_Category);
+        }
+        ~TraceScope() {
+            if (m_Active) TraceRecorder::Instance().Record(TracePhase::End, m_Name, m_Category);
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+        private:
+        const char* m_Name;
+        const char* m_Category;
+        bool m_Active;
+    };
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include "AdaptiveScaler.hpp"
+
+using namespace FrameCodec;
+
+namespace {
+    constexpr double COST_SMOOTHING = 0.2; // Weight of the newest sample
+}
+
+AdaptiveScaler::AdaptiveScaler(uint16_t refreshRate) : m_FrameNs(1e9 / (refreshRate ? refreshRate : 60)) {}
+
+double AdaptiveScaler::PixelShare(ScaleLevel level) {
+    switch (level) {
+        case ScaleLevel::Full: return 1.0;
+        case ScaleLevel::ThreeQuarter: return 0.5625;
+        case ScaleLevel::Half: return 0.25;
+    }
+    return 1.0;
+}
+
+ScaleLevel AdaptiveScaler::Update(uint64_t bytes, uint64_t costNs) {
+    const double cost = static_cast<double>(costNs);
+    m_AverageCost = m_AverageCost == 0.0 ? cost : m_AverageCost + COST_SMOOTHING * (cost - m_AverageCost);
+    if (costNs > 0) {
+        const double throughput = bytes * 1e9 / cost;
+        m_Throughput = m_Throughput == 0.0 ? throughput : m_Throughput + COST_SMOOTHING * (throughput - m_Throughput);
+    }
+
+    const unsigned int index = static_cast<unsigned int>(m_Level);
+
+    if (m_AverageCost > m_FrameNs) {
+        m_Comfortable = 0;
+        if (++m_Late >= SCALE_DOWN_FRAMES && index + 1 < SCALE_LEVEL_COUNT) {
+            m_Level = static_cast<ScaleLevel>(index + 1);
+            m_Late = 0;
+            m_AverageCost *= PixelShare(m_Level) / PixelShare(static_cast<ScaleLevel>(index)); // Expected cost at the new size
+            m_Switches++;
+        }
+        return m_Level;
+    }
+    m_Late = 0;
+
+    if (index == 0) return m_Level;
+    const ScaleLevel up = static_cast<ScaleLevel>(index - 1);
+    const double predicted = m_AverageCost * PixelShare(up) / PixelShare(m_Level);
+    if (predicted < m_FrameNs * SCALE_UP_HEADROOM) {
+        if (++m_Comfortable >= SCALE_UP_FRAMES) {
+            m_Level = up;
+            m_Comfortable = 0;
+            m_AverageCost = predicted;
+            m_Switches++;
+        }
+    } else {
+        m_Comfortable = 0;
+    }
+    return m_Level;
+}
@@ -0,0 +1,54 @@
+#include "BandLayout.hpp"
+#include "TileChroma.hpp"
+
+#include <algorithm>
+
+using namespace FrameCodec;
+
+static_assert(BAND_ROW_ALIGN % CHROMA_TILE_SIZE == 0, "A band must hold whole chroma tile rows");
+
+bool FrameCodec::IsPlanarYuv(PixelFormat format) {
+    return format == PixelFormat::YUV440 || format == PixelFormat::YUV420 || format == PixelFormat::YUV422 || format == PixelFormat::YUVAdaptive;
+}
+
+ChromaLayout FrameCodec::GetChromaLayout(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::YUV420: return { 1, 1 };
+        case PixelFormat::YUV422: return { 1, 0 };
+        case PixelFormat::YUVAdaptive: return { 0, 0 };
+        default: return { 0, 1 };
+    }
+}
+
+size_t FrameCodec::PlanarFrameSize(PixelFormat format, unsigned int width, unsigned int height) {
+    if (format == PixelFormat::YUVAdaptive) return static_cast<size_t>(width) * height + AdaptiveChromaMaxSize(width, height);
+    const ChromaLayout chroma = GetChromaLayout(format);
+    return static_cast<size_t>(width) * height + static_cast<size_t>(ChromaWidth(chroma, width)) * 2 * ChromaHeight(chroma, height);
+}
+
+PlanarBands::PlanarBands(unsigned short width, unsigned short height, unsigned int count, PixelFormat format) : m_Format(format) {
+    count = std::clamp(count, 1u, MAX_BANDS);
+    const ChromaLayout chroma = GetChromaLayout(format);
+    m_UVPitch = static_cast<size_t>(ChromaWidth(chroma, width)) * 2;
+
+    // Aligned band height; a short frame just gets fewer bands
+    unsigned int rowsPerBand = (height + count - 1) / count;
+    rowsPerBand = (rowsPerBand + BAND_ROW_ALIGN - 1) / BAND_ROW_ALIGN * BAND_ROW_ALIGN;
+
+    size_t offset = 0;
+    for (unsigned int row = 0; row < height; row += rowsPerBand) {
+        Band band;
+        band.firstRow = row;
+        band.rows = std::min<unsigned int>(rowsPerBand, height - row);
+        band.uvRow = ChromaHeight(chroma, row);
+        band.uvRows = ChromaHeight(chroma, row + band.rows) - band.uvRow;
+        band.offset = offset;
+        band.ySize = static_cast<size_t>(band.rows) * width;
+        band.size = band.ySize + (format == PixelFormat::YUVAdaptive ? AdaptiveChromaMaxSize(width, band.rows) : band.uvRows * m_UVPitch);
+
+        offset += band.size;
+        m_Bands.push_back(band);
+    }
+
+    m_PayloadSize = offset;
+}
@@ -0,0 +1,20 @@
+#include "BufferArena.hpp"
+
+#include <algorithm>
+
+using namespace FrameCodec;
+
+size_t BufferArena::Reserve(size_t bytes) {
+    m_Used = bytes;
+    if (bytes <= m_Capacity) {
+        m_Reuses++;
+        return 0;
+    }
+
+    // The first registration is sized exactly; headroom only once a mode has outgrown it
+    size_t capacity = bytes;
+    if (m_Capacity > 0) capacity = std::max(bytes, m_Capacity / GROWTH_DENOMINATOR * GROWTH_NUMERATOR);
+    m_Capacity = (capacity + GRANULARITY - 1) / GRANULARITY * GRANULARITY;
+    m_Registrations++;
+    return m_Capacity;
+}
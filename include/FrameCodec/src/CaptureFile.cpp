@@ -0,0 +1,337 @@
+#include "CaptureFile.hpp"
+
+#include "CaptureRegion.hpp"
+#include "FrameHeader.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    size_t Padded(size_t length) {
+        return (length + CAPTURE_ALIGNMENT - 1) / CAPTURE_ALIGNMENT * CAPTURE_ALIGNMENT;
+    }
+}
+
+// MARK: CaptureWriter
+CaptureWriter::CaptureWriter(uint16_t width, uint16_t height, uint16_t refreshRate, CaptureEncoding encoding, unsigned int queueDepth)
+    : m_Width(width), m_Height(height), m_RefreshRate(refreshRate), m_Encoding(encoding),
+      m_FrameBytes(static_cast<size_t>(width) * height * 4), m_Buffers(std::max(queueDepth, 1u)) {}
+
+CaptureWriter::~CaptureWriter() {
+    Close();
+}
+
+bool CaptureWriter::Open(const std::string& path) {
+    m_File.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_File) {
+        std::cerr << "Failed to create capture file " << path << std::endl;
+        return false;
+    }
+
+    CaptureFileHeader header = {};
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.width = m_Width;
+    header.height = m_Height;
+    header.refreshRate = m_RefreshRate;
+    header.encoding = static_cast<uint8_t>(m_Encoding);
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_Offset = sizeof(header);
+
+    for (unsigned int i = 0; i < m_Buffers.size(); ++i) {
+        m_Buffers[i].resize(m_FrameBytes);
+        m_Free.push_back(i);
+    }
+    if (m_Encoding == CaptureEncoding::Delta) {
+        m_Encoder = std::make_unique<DeltaEncoder>(m_Width, m_Height);
+        m_Delta.resize(MaxDeltaSize(m_Width, m_Height));
+    }
+
+    m_Thread = std::thread(&CaptureWriter::WriteLoop, this);
+    return true;
+}
+
+bool CaptureWriter::Append(const uint8_t* pixels, size_t pitch, uint64_t captureTime) {
+    unsigned int buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Thread.joinable() || m_Stop || m_Free.empty()) {
+            m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer = m_Free.back();
+        m_Free.pop_back();
+    }
+
+    // The only work on the capture thread: one copy into memory the writer owns
+    PackRegion(pixels, pitch, { 0, 0, m_Width, m_Height }, m_Buffers[buffer].data());
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending.push_back({ buffer, captureTime });
+    }
+    m_Wake.notify_one();
+    return true;
+}
+
+void CaptureWriter::WriteLoop() {
+    while (true) {
+        Pending pending;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [this]() { return m_Stop || !m_Pending.empty(); });
+            if (m_Pending.empty()) return;
+            pending = m_Pending.front();
+            m_Pending.pop_front();
+        }
+
+        const uint8_t* frame = m_Buffers[pending.buffer].data();
+        if (!m_Encoder) {
+            WriteRecord(RecordKind::Raw, frame, m_FrameBytes, pending.captureTime);
+        } else if (m_Index.size() % CAPTURE_KEYFRAME_INTERVAL == 0) {
+            // Keyframes bound how far a reader has to decode from, and how much a damaged record can spoil
+            m_Encoder->Reset(frame);
+            WriteRecord(RecordKind::Raw, frame, m_FrameBytes, pending.captureTime);
+        } else {
+            const size_t length = m_Encoder->Encode(frame, m_Delta.data());
+            if (length < m_FrameBytes) WriteRecord(RecordKind::Delta, m_Delta.data(), length, pending.captureTime);
+            else WriteRecord(RecordKind::Raw, frame, m_FrameBytes, pending.captureTime);
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Free.push_back(pending.buffer);
+    }
+}
+
+bool CaptureWriter::WriteRecord(RecordKind kind, const uint8_t* payload, size_t length, uint64_t captureTime) {
+    if (m_Failed) return false;
+
+    CaptureRecord record = {};
+    record.length = static_cast<uint32_t>(length);
+    record.kind = static_cast<uint8_t>(kind);
+    record.captureTime = captureTime;
+
+    static const uint8_t zeros[CAPTURE_ALIGNMENT] = {};
+    const size_t padded = Padded(length);
+    m_File.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_File.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(length));
+    m_File.write(reinterpret_cast<const char*>(zeros), static_cast<std::streamsize>(padded - length));
+    if (!m_File) {
+        std::cerr << "Failed to write frame " << m_Index.size() << " to the capture file; recording stopped" << std::endl;
+        m_Failed = true;
+        return false;
+    }
+
+    m_Index.push_back({ m_Offset + sizeof(record), captureTime, static_cast<uint32_t>(length), static_cast<uint8_t>(kind), {} });
+    m_Offset += sizeof(record) + padded;
+    m_Bytes.fetch_add(sizeof(record) + padded, std::memory_order_relaxed);
+    m_Written.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CaptureWriter::Close() {
+    if (m_Thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+    }
+    if (!m_File.is_open()) return !m_Failed;
+
+    if (!m_Failed) {
+        m_File.write(reinterpret_cast<const char*>(m_Index.data()), static_cast<std::streamsize>(m_Index.size() * sizeof(CaptureIndexEntry)));
+
+        // Only now does the header point at the index; until here the file read as one cut short
+        const uint32_t frameCount = static_cast<uint32_t>(m_Index.size());
+        m_File.seekp(offsetof(CaptureFileHeader, frameCount));
+        m_File.write(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+        m_File.seekp(offsetof(CaptureFileHeader, indexOffset));
+        m_File.write(reinterpret_cast<const char*>(&m_Offset), sizeof(m_Offset));
+        if (!m_File) {
+            std::cerr << "Failed to write the capture file's index" << std::endl;
+            m_Failed = true;
+        }
+    }
+    m_File.close();
+    return !m_Failed;
+}
+
+// MARK: CaptureReader
+CaptureReader::CaptureReader(bool paced, bool loop) : m_Paced(paced), m_Loop(loop) {}
+
+CaptureReader::~CaptureReader() {
+    Unmap();
+}
+
+void CaptureReader::Unmap() {
+    if (!m_Data) return;
+    #ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+    #else
+    munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    #endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+bool CaptureReader::Open(const std::string& path) {
+    Unmap();
+    m_Index = nullptr;
+    m_IndexCount = 0;
+    m_RebuiltIndex.clear();
+    m_IndexRebuilt = false;
+    m_Next = 0;
+
+    // The handles can go as soon as the view exists; the view keeps the file mapped
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open capture file " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = size.QuadPart ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    m_Data = mapping ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    m_Size = m_Data ? static_cast<size_t>(size.QuadPart) : 0;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    #else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open capture file " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            m_Data = static_cast<const uint8_t*>(data);
+            m_Size = static_cast<size_t>(info.st_size);
+            madvise(data, m_Size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    #endif
+
+    if (!m_Data || m_Size < sizeof(CaptureFileHeader)) {
+        std::cerr << "Failed to map capture file " << path << std::endl;
+        Unmap();
+        return false;
+    }
+
+    memcpy(&m_Header, m_Data, sizeof(m_Header));
+    if (memcmp(m_Header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 || m_Header.version != CAPTURE_VERSION ||
+        m_Header.width == 0 || m_Header.height == 0) {
+        std::cerr << path << " is not a version " << CAPTURE_VERSION << " capture file" << std::endl;
+        Unmap();
+        return false;
+    }
+
+    if (m_Header.indexOffset != 0 && m_Header.indexOffset <= m_Size &&
+        (m_Size - m_Header.indexOffset) / sizeof(CaptureIndexEntry) >= m_Header.frameCount) {
+        m_Index = reinterpret_cast<const CaptureIndexEntry*>(m_Data + m_Header.indexOffset);
+        m_IndexCount = m_Header.frameCount;
+    } else if (!RebuildIndex()) {
+        std::cerr << path << " holds no frames" << std::endl;
+        Unmap();
+        return false;
+    }
+
+    if (m_Header.encoding == static_cast<uint8_t>(CaptureEncoding::Delta)) {
+        m_Decoder = std::make_unique<DeltaDecoder>(m_Header.width, m_Header.height);
+    } else {
+        m_Decoder.reset();
+    }
+    return m_IndexCount > 0;
+}
+
+bool CaptureReader::RebuildIndex() {
+    // No index: the writer never closed the file. Every whole record before the cut is still good.
+    size_t offset = sizeof(CaptureFileHeader);
+    while (m_Size - offset >= sizeof(CaptureRecord)) {
+        CaptureRecord record;
+        memcpy(&record, m_Data + offset, sizeof(record));
+        if (record.kind > static_cast<uint8_t>(RecordKind::Delta) || record.length > m_Size - offset - sizeof(record)) break;
+
+        m_RebuiltIndex.push_back({ offset + sizeof(record), record.captureTime, record.length, record.kind, {} });
+        offset += sizeof(record) + std::min(Padded(record.length), m_Size - offset - sizeof(record));
+    }
+
+    m_Index = m_RebuiltIndex.data();
+    m_IndexCount = m_RebuiltIndex.size();
+    m_IndexRebuilt = true;
+    return m_IndexCount > 0;
+}
+
+AcquireResult CaptureReader::Acquire(unsigned long timeoutMs, SourceFrame& frame) {
+    if (m_IndexCount == 0) return AcquireResult::Failed;
+    if (m_Next == m_IndexCount) {
+        if (!m_Loop) return AcquireResult::Failed;
+        m_Next = 0;
+    }
+    const CaptureIndexEntry& entry = m_Index[m_Next];
+
+    if (m_Paced) {
+        const auto now = std::chrono::steady_clock::now();
+        if (m_Next == 0) {
+            m_PlayStart = now;
+            m_FirstCaptureTime = entry.captureTime;
+        }
+        const auto due = m_PlayStart + std::chrono::nanoseconds(entry.captureTime - m_FirstCaptureTime);
+        if (due > now + std::chrono::milliseconds(timeoutMs)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return AcquireResult::Timeout;
+        }
+        std::this_thread::sleep_until(due);
+    }
+
+    const size_t frameBytes = static_cast<size_t>(m_Header.width) * m_Header.height * 4;
+    if (entry.offset > m_Size || entry.length > m_Size - entry.offset ||
+        (entry.kind == static_cast<uint8_t>(RecordKind::Raw) && entry.length != frameBytes)) {
+        std::cerr << "Capture frame " << m_Next << " lies outside the file" << std::endl;
+        return AcquireResult::Failed;
+    }
+    const uint8_t* payload = m_Data + entry.offset;
+
+    if (entry.kind == static_cast<uint8_t>(RecordKind::Raw)) {
+        // Straight from the mapping; the decoder only needs a copy when a delta builds on this frame
+        frame.pixels = payload;
+        frame.pitch = static_cast<size_t>(m_Header.width) * 4;
+        if (m_Decoder && m_Next + 1 < m_IndexCount && m_Index[m_Next + 1].kind == static_cast<uint8_t>(RecordKind::Delta)) {
+            m_Decoder->Reset(payload);
+        }
+    } else {
+        if (!m_Decoder || !m_Decoder->Decode(payload, entry.length)) {
+            std::cerr << "Capture frame " << m_Next << " is not a valid delta" << std::endl;
+            return AcquireResult::Failed;
+        }
+        frame.pixels = m_Decoder->GetFrame();
+        frame.pitch = m_Decoder->GetPitch();
+    }
+
+    m_Next++;
+    frame.captureTime = FrameClockNow();
+    return AcquireResult::Frame;
+}
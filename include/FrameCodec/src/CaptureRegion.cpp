@@ -0,0 +1,67 @@
+#include "CaptureRegion.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REGION_AVX2 1
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    constexpr unsigned int CHANNELS = 4;
+}
+
+CaptureRegion FrameCodec::ClampRegion(const CaptureRegion& region, uint16_t outputWidth, uint16_t outputHeight) {
+    if (region.width == 0 || region.height == 0) return { 0, 0, static_cast<uint16_t>(outputWidth & ~1), static_cast<uint16_t>(outputHeight & ~1) };
+
+    CaptureRegion clamped;
+    clamped.width = static_cast<uint16_t>(std::min(region.width, outputWidth) & ~1);
+    clamped.height = static_cast<uint16_t>(std::min(region.height, outputHeight) & ~1);
+    if (clamped.width == 0 || clamped.height == 0) return {};
+    clamped.left = std::min<uint16_t>(region.left, outputWidth - clamped.width);
+    clamped.top = std::min<uint16_t>(region.top, outputHeight - clamped.height);
+    return clamped;
+}
+
+void FrameCodec::PackRegion(const uint8_t* src, size_t srcPitch, const CaptureRegion& region, uint8_t* dst) {
+    const size_t rowSize = static_cast<size_t>(region.width) * CHANNELS;
+    src += region.top * srcPitch + static_cast<size_t>(region.left) * CHANNELS;
+
+    for (unsigned int y = 0; y < region.height; ++y) {
+        const uint8_t* srcRow = src + y * srcPitch;
+        uint8_t* dstRow = dst + y * rowSize;
+        size_t i = 0;
+#if defined(REGION_AVX2)
+        // Mapped staging memory is write-combined on some drivers; wide unaligned loads read it fastest
+        for (; i + 128 <= rowSize; i += 128) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + i + 32));
+            const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + i + 64));
+            const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + i + 96));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstRow + i), a);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstRow + i + 32), b);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstRow + i + 64), c);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstRow + i + 96), d);
+        }
+        for (; i + 32 <= rowSize; i += 32) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dstRow + i), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + i)));
+        }
+#endif
+        if (i < rowSize) memcpy(dstRow + i, srcRow + i, rowSize - i);
+    }
+}
+
+void FrameCodec::PackRegionReference(const uint8_t* src, size_t srcPitch, const CaptureRegion& region, uint8_t* dst) {
+    const size_t rowSize = static_cast<size_t>(region.width) * CHANNELS;
+    for (unsigned int y = 0; y < region.height; ++y) {
+        for (unsigned int x = 0; x < region.width; ++x) {
+            for (unsigned int c = 0; c < CHANNELS; ++c) {
+                dst[y * rowSize + static_cast<size_t>(x) * CHANNELS + c] =
+                    src[(region.top + y) * srcPitch + static_cast<size_t>(region.left + x) * CHANNELS + c];
+            }
+        }
+    }
+}
@@ -0,0 +1,441 @@
+#include "ColorConvert.hpp"
+#include "ColorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace FrameCodec;
+
+namespace {
+    // What the GPU does when it stores a float into a UNORM texture
+    uint8_t ToUnorm(float value) {
+        return static_cast<uint8_t>(std::nearbyint(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // Between the matrix's Y in [0, 1] and U, V in [-0.5, 0.5] and what the planes store, as shaders/YuvMatrix.hlsli does it
+    float ScaleY(float y, bool limited) {
+        return limited ? (16.0f + 219.0f * y) / 255.0f : y;
+    }
+
+    float ScaleUV(float c, bool limited) {
+        return limited ? (128.0f + 224.0f * c) / 255.0f : c + 0.5f;
+    }
+
+    float UnscaleY(float y, bool limited) {
+        return limited ? (y * 255.0f - 16.0f) / 219.0f : y;
+    }
+
+    float UnscaleUV(float c, bool limited) {
+        return limited ? (c * 255.0f - 128.0f) / 224.0f : c - 0.5f;
+    }
+
+    ColorKernels::Yuv440Row PickEncodeRow(SimdLevel level, ColorSpace space) {
+        const size_t index = static_cast<size_t>(space);
+#if defined(FRAMECODEC_X86_KERNELS)
+        switch (level) {
+            case SimdLevel::AVX512: return ColorKernels::YUV440_ROWS_AVX512[index];
+            case SimdLevel::AVX2: return ColorKernels::YUV440_ROWS_AVX2[index];
+            case SimdLevel::SSE41: return ColorKernels::YUV440_ROWS_SSE41[index];
+            default: break;
+        }
+#endif
+        (void)level;
+        return ColorKernels::YUV440_ROWS_SCALAR[index];
+    }
+
+    ColorKernels::Bgra440Row PickDecodeRow(SimdLevel level, ColorSpace space) {
+        const size_t index = static_cast<size_t>(space);
+#if defined(FRAMECODEC_X86_KERNELS)
+        switch (level) {
+            case SimdLevel::AVX512: return ColorKernels::BGRA440_ROWS_AVX512[index];
+            case SimdLevel::AVX2: return ColorKernels::BGRA440_ROWS_AVX2[index];
+            case SimdLevel::SSE41: return ColorKernels::BGRA440_ROWS_SSE41[index];
+            default: break;
+        }
+#endif
+        (void)level;
+        return ColorKernels::BGRA440_ROWS_SCALAR[index];
+    }
+
+    ColorSpace Checked(ColorSpace space) {
+        return static_cast<size_t>(space) < COLOR_SPACE_COUNT ? space : ColorSpace::BT601Full;
+    }
+
+    ColorKernels::HalveRow PickHalveRow(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        if (level >= SimdLevel::SSE41) return ColorKernels::HalveRowSSE41;
+#endif
+        (void)level;
+        return ColorKernels::HalveRowScalar;
+    }
+
+    ColorKernels::QuarterRow PickQuarterRow(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        if (level >= SimdLevel::SSE41) return ColorKernels::QuarterRowSSE41;
+#endif
+        (void)level;
+        return ColorKernels::QuarterRowScalar;
+    }
+
+    ColorKernels::WidenRow PickWidenRow(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        if (level >= SimdLevel::SSE41) return ColorKernels::WidenRowSSE41;
+#endif
+        (void)level;
+        return ColorKernels::WidenRowScalar;
+    }
+
+    ColorKernels::TileStatsKernel PickTileStats(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        if (level >= SimdLevel::AVX2) return ColorKernels::TileStatsAVX2;
+        if (level >= SimdLevel::SSE41) return ColorKernels::TileStatsSSE41;
+#endif
+        (void)level;
+        return ColorKernels::TileStatsScalar;
+    }
+
+    ColorKernels::AverageRow PickAverageRow(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        if (level >= SimdLevel::SSE41) return ColorKernels::AverageRowSSE41;
+#endif
+        (void)level;
+        return ColorKernels::AverageRowScalar;
+    }
+
+    template <ColorSpace S>
+    void EncodeRowScalar(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv) {
+        ColorKernels::Yuv440Pixels<S>(bgra, 0, width, y, uv);
+    }
+
+    template <ColorSpace S>
+    void DecodeRowScalar(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra) {
+        ColorKernels::Bgra440Pixels<S>(y, uv, 0, width, bgra);
+    }
+
+    // Full-width U,V rows for the subsampled formats, one or two per thread, or a tile row's for YUVAdaptive
+    thread_local std::vector<uint8_t> t_Chroma;
+
+    // Pixels of tile `index` along a side of `size` pixels: CHROMA_TILE_SIZE except at the far edge
+    unsigned int TileExtent(unsigned int index, unsigned int size) {
+        return std::min(CHROMA_TILE_SIZE, size - index * CHROMA_TILE_SIZE);
+    }
+
+    // Tile rows are short: a constant size lets the compiler inline a whole one
+    void CopyTileRow(uint8_t* dst, const uint8_t* src, unsigned int width) {
+        if (width == CHROMA_TILE_SIZE) std::memcpy(dst, src, CHROMA_TILE_SIZE * 2);
+        else std::memcpy(dst, src, width * 2);
+    }
+
+    // One tile of full-resolution U,V rows into its mode's pairs; returns the end of what it wrote
+    uint8_t* PackTile(TileChroma mode, const uint8_t* full, size_t pitch, unsigned int width, unsigned int height,
+                      ColorKernels::AverageRow average, ColorKernels::QuarterRow quarter, uint8_t* out) {
+        if (mode == TileChroma::Full) {
+            for (unsigned int row = 0; row < height; ++row, out += width * 2) CopyTileRow(out, full + row * pitch, width);
+            return out;
+        }
+
+        // An odd last row pairs with itself
+        const size_t rowBytes = static_cast<size_t>(mode == TileChroma::Half ? width : (width + 1) / 2) * 2;
+        for (unsigned int row = 0; row < height; row += 2, out += rowBytes) {
+            const uint8_t* top = full + row * pitch;
+            const uint8_t* bottom = row + 1 < height ? top + pitch : top;
+            if (mode == TileChroma::Half) average(top, bottom, width, out);
+            else quarter(top, bottom, width, out);
+        }
+        return out;
+    }
+
+    // The reverse, each pair repeated over its block; returns the end of what it read
+    const uint8_t* UnpackTile(TileChroma mode, const uint8_t* in, unsigned int width, unsigned int height, ColorKernels::WidenRow widen,
+                              uint8_t* full, size_t pitch) {
+        if (mode == TileChroma::Full) {
+            for (unsigned int row = 0; row < height; ++row, in += width * 2) CopyTileRow(full + row * pitch, in, width);
+            return in;
+        }
+
+        const size_t rowBytes = static_cast<size_t>(mode == TileChroma::Half ? width : (width + 1) / 2) * 2;
+        for (unsigned int row = 0; row < height; row += 2, in += rowBytes) {
+            uint8_t* top = full + row * pitch;
+            if (mode == TileChroma::Half) CopyTileRow(top, in, width);
+            else widen(in, width, top);
+            if (row + 1 < height) CopyTileRow(top + pitch, top, width);
+        }
+        return in;
+    }
+
+    SimdLevel Supported(SimdLevel level) {
+#if defined(FRAMECODEC_X86_KERNELS)
+        return std::min(level, DetectSimdLevel());
+#else
+        (void)level;
+        return SimdLevel::Scalar;
+#endif
+    }
+}
+
+const ColorKernels::Yuv440Row ColorKernels::YUV440_ROWS_SCALAR[COLOR_SPACE_COUNT] = {
+    EncodeRowScalar<ColorSpace::BT601Full>, EncodeRowScalar<ColorSpace::BT601Limited>,
+    EncodeRowScalar<ColorSpace::BT709Full>, EncodeRowScalar<ColorSpace::BT709Limited>,
+};
+
+const ColorKernels::Bgra440Row ColorKernels::BGRA440_ROWS_SCALAR[COLOR_SPACE_COUNT] = {
+    DecodeRowScalar<ColorSpace::BT601Full>, DecodeRowScalar<ColorSpace::BT601Limited>,
+    DecodeRowScalar<ColorSpace::BT709Full>, DecodeRowScalar<ColorSpace::BT709Limited>,
+};
+
+void ColorKernels::HalveRowScalar(const uint8_t* full, unsigned int width, uint8_t* uv) {
+    HalvePairs(full, 0, width, uv);
+}
+
+void ColorKernels::QuarterRowScalar(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv) {
+    QuarterPairs(top, bottom, 0, width, uv);
+}
+
+void ColorKernels::WidenRowScalar(const uint8_t* uv, unsigned int width, uint8_t* full) {
+    WidenPairs(uv, 0, width, full);
+}
+
+void ColorKernels::TileStatsScalar(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats) {
+    TilePixelStats(uv, pitch, width, height, stats);
+}
+
+void ColorKernels::AverageRowScalar(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv) {
+    AveragePairs(top, bottom, 0, width, uv);
+}
+
+// MARK: YuvEncoder
+YuvEncoder::YuvEncoder(unsigned int width, unsigned int height, PixelFormat format, ColorSpace space, unsigned int threads, SimdLevel level)
+    : m_Width(width), m_Height(height), m_Chroma(GetChromaLayout(format)), m_Level(Supported(level)), m_Row(PickEncodeRow(m_Level, Checked(space))),
+      m_Halve(PickHalveRow(m_Level)), m_Quarter(PickQuarterRow(m_Level)), m_Average(PickAverageRow(m_Level)), m_Stats(PickTileStats(m_Level)),
+      m_Pool(threads) {}
+
+void YuvEncoder::Encode(const uint8_t* bgra, size_t pitch, uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch) {
+    EncodeRows(bgra, pitch, 0, m_Height, y, yPitch, uv, uvPitch);
+}
+
+void YuvEncoder::EncodeRows(const uint8_t* bgra, size_t pitch, unsigned int firstRow, unsigned int rows,
+                            uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch) {
+    const unsigned int chromaRows = ChromaHeight(m_Chroma, m_Height);
+    const unsigned int rowMask = (1u << m_Chroma.yShift) - 1;
+
+    m_Pool.Run(rows, [&](unsigned int begin, unsigned int end) {
+        uint8_t* full = nullptr;
+        if (m_Chroma.xShift) {
+            t_Chroma.resize(static_cast<size_t>(m_Width) * 4);
+            full = t_Chroma.data();
+        }
+
+        for (unsigned int local = begin; local < end; ++local) {
+            // An odd height's last row has no UV row, as in the shaders' UV textures
+            const unsigned int row = firstRow + local;
+            const uint8_t* src = bgra + row * pitch;
+            uint8_t* yRow = y + local * yPitch;
+            if ((row & rowMask) || (row >> m_Chroma.yShift) >= chromaRows) {
+                m_Row(src, m_Width, yRow, nullptr);
+                continue;
+            }
+
+            uint8_t* uvRow = uv + (local >> m_Chroma.yShift) * uvPitch;
+            if (!m_Chroma.xShift) {
+                m_Row(src, m_Width, yRow, uvRow);
+            } else if (!m_Chroma.yShift) {
+                m_Row(src, m_Width, yRow, full);
+                m_Halve(full, m_Width, uvRow);
+            } else {
+                // 4:2:0 takes the row pair at once
+                m_Row(src, m_Width, yRow, full);
+                m_Row(src + pitch, m_Width, yRow + yPitch, full + m_Width * 2);
+                m_Quarter(full, full + m_Width * 2, m_Width, uvRow);
+                ++local;
+            }
+        }
+    });
+}
+
+size_t YuvEncoder::EncodeAdaptiveRows(const uint8_t* bgra, size_t pitch, unsigned int firstRow, unsigned int rows,
+                                      uint8_t* y, size_t yPitch, uint8_t* chroma) {
+    const unsigned int tilesX = ChromaTilesX(m_Width);
+    const unsigned int tileRows = ChromaTilesY(rows);
+    const size_t fullPitch = static_cast<size_t>(m_Width) * 2;
+    const size_t slot = fullPitch * CHROMA_TILE_SIZE;
+    m_Packed.resize(slot * tileRows);
+    m_TileSizes.resize(tileRows);
+
+    // Each tile row is converted, classified and packed while its U,V rows are still in cache, into a slot of its own:
+    // where it goes in `chroma` depends on the rows above it
+    m_Pool.Run(tileRows, [&](unsigned int begin, unsigned int end) {
+        t_Chroma.resize(slot);
+        uint8_t* full = t_Chroma.data();
+        for (unsigned int tileRow = begin; tileRow < end; ++tileRow) {
+            const unsigned int top = tileRow * CHROMA_TILE_SIZE;
+            const unsigned int height = TileExtent(tileRow, rows);
+            for (unsigned int local = top; local < top + height; ++local) {
+                m_Row(bgra + (firstRow + local) * pitch, m_Width, y + local * yPitch, full + (local - top) * fullPitch);
+            }
+
+            uint8_t* out = m_Packed.data() + tileRow * slot;
+            for (unsigned int tile = 0; tile < tilesX; ++tile) {
+                const unsigned int width = TileExtent(tile, m_Width);
+                TileStats stats;
+                m_Stats(full + tile * CHROMA_TILE_SIZE * 2, fullPitch, width, height, stats);
+                const TileChroma mode = PickTileChroma(stats, width * height);
+                chroma[tileRow * tilesX + tile] = static_cast<uint8_t>(mode);
+                out = PackTile(mode, full + tile * CHROMA_TILE_SIZE * 2, fullPitch, width, height, m_Average, m_Quarter, out);
+            }
+            m_TileSizes[tileRow] = static_cast<size_t>(out - (m_Packed.data() + tileRow * slot));
+        }
+    });
+
+    // The slots one after another behind the mode map
+    size_t offset = static_cast<size_t>(tilesX) * tileRows;
+    for (unsigned int tileRow = 0; tileRow < tileRows; ++tileRow) {
+        std::memcpy(chroma + offset, m_Packed.data() + tileRow * slot, m_TileSizes[tileRow]);
+        offset += m_TileSizes[tileRow];
+    }
+    return offset;
+}
+
+void YuvEncoder::EncodeReference(const uint8_t* bgra, size_t pitch, unsigned int width, unsigned int height,
+                                 uint8_t* y, size_t yPitch, uint8_t* uv, size_t uvPitch, PixelFormat format, ColorSpace space) {
+    const YuvMatrix& m = GetYuvMatrix(space);
+    const float kr = static_cast<float>(m.kr), kb = static_cast<float>(m.kb), kg = 1.0f - kr - kb;
+    for (unsigned int row = 0; row < height; ++row) {
+        const uint8_t* src = bgra + row * pitch;
+        for (unsigned int x = 0; x < width; ++x) {
+            const float b = src[x * 4] / 255.0f;
+            const float g = src[x * 4 + 1] / 255.0f;
+            const float r = src[x * 4 + 2] / 255.0f;
+            y[row * yPitch + x] = ToUnorm(ScaleY(kr * r + kg * g + kb * b, m.limited));
+        }
+    }
+
+    // Each U,V pair from the mean of its block, clamped to the frame; 4:4:0 only ever read the even row
+    const ChromaLayout chroma = GetChromaLayout(format);
+    const unsigned int blockRows = format == PixelFormat::YUV440 ? 1 : 1u << chroma.yShift;
+    for (unsigned int cy = 0; cy < ChromaHeight(chroma, height); ++cy) {
+        for (unsigned int cx = 0; cx < ChromaWidth(chroma, width); ++cx) {
+            float b = 0.0f, g = 0.0f, r = 0.0f;
+            for (unsigned int dy = 0; dy < blockRows; ++dy) {
+                for (unsigned int dx = 0; dx < (1u << chroma.xShift); ++dx) {
+                    const unsigned int row = std::min((cy << chroma.yShift) + dy, height - 1);
+                    const unsigned int x = std::min((cx << chroma.xShift) + dx, width - 1);
+                    b += bgra[row * pitch + x * 4] / 255.0f;
+                    g += bgra[row * pitch + x * 4 + 1] / 255.0f;
+                    r += bgra[row * pitch + x * 4 + 2] / 255.0f;
+                }
+            }
+            const float samples = static_cast<float>(blockRows << chroma.xShift);
+            b /= samples;
+            g /= samples;
+            r /= samples;
+
+            const float luma = kr * r + kg * g + kb * b;
+            uint8_t* pair = uv + cy * uvPitch + cx * 2;
+            pair[0] = ToUnorm(ScaleUV((b - luma) / (2.0f * (1.0f - kb)), m.limited));
+            pair[1] = ToUnorm(ScaleUV((r - luma) / (2.0f * (1.0f - kr)), m.limited));
+        }
+    }
+}
+
+// MARK: YuvDecoder
+YuvDecoder::YuvDecoder(unsigned int width, unsigned int height, PixelFormat format, ColorSpace space, unsigned int threads, SimdLevel level)
+    : m_Width(width), m_Height(height), m_Chroma(GetChromaLayout(format)), m_Level(Supported(level)), m_Row(PickDecodeRow(m_Level, Checked(space))),
+      m_Widen(PickWidenRow(m_Level)), m_Pool(threads) {
+    if (ChromaHeight(m_Chroma, height) << m_Chroma.yShift < height) m_ZeroUV.resize(static_cast<size_t>(width) * 2);
+}
+
+void YuvDecoder::Decode(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, uint8_t* bgra, size_t pitch) {
+    DecodeRows(y, yPitch, uv, uvPitch, 0, m_Height, bgra, pitch);
+}
+
+void YuvDecoder::DecodeRows(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, unsigned int firstRow, unsigned int rows,
+                            uint8_t* bgra, size_t pitch) {
+    const unsigned int chromaRows = ChromaHeight(m_Chroma, m_Height);
+
+    m_Pool.Run(rows, [&](unsigned int begin, unsigned int end) {
+        uint8_t* full = nullptr;
+        if (m_Chroma.xShift) {
+            t_Chroma.resize(static_cast<size_t>(m_Width) * 2);
+            full = t_Chroma.data();
+        }
+
+        for (unsigned int local = begin; local < end; ++local) {
+            const unsigned int row = firstRow + local;
+            if ((row >> m_Chroma.yShift) >= chromaRows) {
+                m_Row(y + local * yPitch, m_ZeroUV.data(), m_Width, bgra + row * pitch);
+                continue;
+            }
+
+            const uint8_t* uvRow = uv + (local >> m_Chroma.yShift) * uvPitch;
+            if (m_Chroma.xShift) {
+                m_Widen(uvRow, m_Width, full);
+                uvRow = full;
+            }
+            m_Row(y + local * yPitch, uvRow, m_Width, bgra + row * pitch);
+        }
+    });
+}
+
+bool YuvDecoder::DecodeAdaptiveRows(const uint8_t* y, size_t yPitch, const uint8_t* chroma, size_t chromaSize, unsigned int firstRow,
+                                    unsigned int rows, uint8_t* bgra, size_t pitch) {
+    const unsigned int tilesX = ChromaTilesX(m_Width);
+    const unsigned int tileRows = ChromaTilesY(rows);
+    const size_t fullPitch = static_cast<size_t>(m_Width) * 2;
+
+    // The mode map must be valid and the pairs it describes must fit before anything is read from them
+    size_t offset = static_cast<size_t>(tilesX) * tileRows;
+    if (offset > chromaSize) return false;
+    m_TileOffsets.resize(tileRows);
+    for (unsigned int tileRow = 0; tileRow < tileRows; ++tileRow) {
+        m_TileOffsets[tileRow] = offset;
+        for (unsigned int tile = 0; tile < tilesX; ++tile) {
+            const uint8_t mode = chroma[tileRow * tilesX + tile];
+            if (mode >= TILE_CHROMA_COUNT) return false;
+            offset += TileChromaPairs(static_cast<TileChroma>(mode), TileExtent(tile, m_Width), TileExtent(tileRow, rows)) * 2;
+        }
+    }
+    if (offset > chromaSize) return false;
+
+    m_Pool.Run(tileRows, [&](unsigned int begin, unsigned int end) {
+        t_Chroma.resize(fullPitch * CHROMA_TILE_SIZE);
+        uint8_t* full = t_Chroma.data();
+        for (unsigned int tileRow = begin; tileRow < end; ++tileRow) {
+            const unsigned int top = tileRow * CHROMA_TILE_SIZE;
+            const unsigned int height = TileExtent(tileRow, rows);
+            const uint8_t* in = chroma + m_TileOffsets[tileRow];
+            for (unsigned int tile = 0; tile < tilesX; ++tile) {
+                const TileChroma mode = static_cast<TileChroma>(chroma[tileRow * tilesX + tile]);
+                in = UnpackTile(mode, in, TileExtent(tile, m_Width), height, m_Widen, full + tile * CHROMA_TILE_SIZE * 2, fullPitch);
+            }
+            for (unsigned int local = top; local < top + height; ++local) {
+                m_Row(y + local * yPitch, full + (local - top) * fullPitch, m_Width, bgra + (firstRow + local) * pitch);
+            }
+        }
+    });
+    return true;
+}
+
+void YuvDecoder::DecodeReference(const uint8_t* y, size_t yPitch, const uint8_t* uv, size_t uvPitch, unsigned int width, unsigned int height,
+                                 uint8_t* bgra, size_t pitch, PixelFormat format, ColorSpace space) {
+    const YuvMatrix& m = GetYuvMatrix(space);
+    const float kr = static_cast<float>(m.kr), kb = static_cast<float>(m.kb), kg = 1.0f - kr - kb;
+    const ChromaLayout chroma = GetChromaLayout(format);
+    for (unsigned int row = 0; row < height; ++row) {
+        uint8_t* dst = bgra + row * pitch;
+        const unsigned int uvRow = row >> chroma.yShift;
+        for (unsigned int x = 0; x < width; ++x) {
+            // A load past the UV texture returns zeros
+            const bool inside = uvRow < ChromaHeight(chroma, height);
+            const uint8_t* pair = uv + uvRow * uvPitch + (x >> chroma.xShift) * 2;
+            const float luma = UnscaleY(y[row * yPitch + x] / 255.0f, m.limited);
+            const float u = UnscaleUV((inside ? pair[0] : 0) / 255.0f, m.limited);
+            const float v = UnscaleUV((inside ? pair[1] : 0) / 255.0f, m.limited);
+
+            dst[x * 4] = ToUnorm(luma + 2.0f * (1.0f - kb) * u);
+            dst[x * 4 + 1] = ToUnorm(luma - 2.0f * kb * (1.0f - kb) / kg * u - 2.0f * kr * (1.0f - kr) / kg * v);
+            dst[x * 4 + 2] = ToUnorm(luma + 2.0f * (1.0f - kr) * v);
+            dst[x * 4 + 3] = 255;
+        }
+    }
+}
@@ -0,0 +1,232 @@
+#ifndef COLORKERNELS_HPP
+#define COLORKERNELS_HPP
+
+#pragma once
+
+#include "ColorSpace.hpp"
+#include "TileChroma.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Row kernels behind YuvEncoder and YuvDecoder. Each instruction set lives in a translation unit of its own, compiled with
+// that set enabled, so nothing here may be an inline function with external linkage: the linker could keep an
+// AVX-512 copy of it for every caller.
+namespace FrameCodec::ColorKernels {
+    // Coefficients are generated from YUV_MATRICES at compile time, one set per ColorSpace, and every kernel is a template
+    // on the ColorSpace: the constants end up as immediates and the rows carry no branch on the matrix or the range.
+    static constexpr int Round(double value) {
+        return value < 0 ? -static_cast<int>(-value + 0.5) : static_cast<int>(value + 0.5);
+    }
+
+    // BGRA to YUV in 1.15 fixed point, the shaders' math (shaders/YuvMatrix.hlsli). One weight per row takes the rounding
+    // error, so each row sums to exactly the range's scale (Y) or 0 (U, V) and results stay in range without clamping.
+    // For BT.601 full range these are the constants BGRA2_440.hlsl was first matched with.
+    constexpr int FIXED_SHIFT = 15;
+    struct Forward {
+        int yr, yg, yb;
+        int ur, ug, ub;
+        int vr, vg, vb;
+        int yRound, uvRound; // Offset plus rounding
+    };
+
+    static constexpr Forward MakeForward(ColorSpace space) {
+        const YuvMatrix m = YUV_MATRICES[static_cast<size_t>(space)];
+        const double one = 1 << FIXED_SHIFT;
+        const double yScale = m.limited ? one * 219.0 / 255.0 : one;
+        const double uvScale = m.limited ? one * 224.0 / 255.0 : one;
+        Forward f = {};
+        f.yr = Round(m.kr * yScale);
+        f.yg = Round((1.0 - m.kr - m.kb) * yScale);
+        f.yb = Round(yScale) - f.yr - f.yg;
+        f.ub = Round(0.5 * uvScale);
+        f.ur = Round(-0.5 * m.kr / (1.0 - m.kb) * uvScale);
+        f.ug = -f.ub - f.ur;
+        f.vr = Round(0.5 * uvScale);
+        f.vb = Round(-0.5 * m.kb / (1.0 - m.kr) * uvScale);
+        f.vg = -f.vr - f.vb;
+        // Full range stores U, V around UNORM 0.5, code 127.5, so +128 and a floor is the GPU's round to nearest
+        f.yRound = (m.limited ? 16 << FIXED_SHIFT : 0) + (1 << (FIXED_SHIFT - 1));
+        f.uvRound = m.limited ? (128 << FIXED_SHIFT) + (1 << (FIXED_SHIFT - 1)) : 128 << FIXED_SHIFT;
+        return f;
+    }
+    static_assert(MakeForward(ColorSpace::BT601Full).yr == 9798 && MakeForward(ColorSpace::BT601Full).yg == 19235 &&
+                  MakeForward(ColorSpace::BT601Full).ur == -5529 && MakeForward(ColorSpace::BT601Full).vb == -2664,
+                  "BT.601 full range must keep the bytes it always produced");
+
+    // One row: `width` BGRA pixels into `width` Y bytes and, when `uv` is set, `width` U,V byte pairs
+    using Yuv440Row = void (*)(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv);
+
+    template <ColorSpace S>
+    static inline void Yuv440Pixels(const uint8_t* bgra, unsigned int from, unsigned int to, uint8_t* y, uint8_t* uv) {
+        constexpr Forward C = MakeForward(S);
+        for (unsigned int x = from; x < to; ++x) {
+            const int b = bgra[x * 4], g = bgra[x * 4 + 1], r = bgra[x * 4 + 2];
+            y[x] = static_cast<uint8_t>((C.yr * r + C.yg * g + C.yb * b + C.yRound) >> FIXED_SHIFT);
+            if (!uv) continue;
+            uv[x * 2] = static_cast<uint8_t>((C.ur * r + C.ug * g + C.ub * b + C.uvRound) >> FIXED_SHIFT);
+            uv[x * 2 + 1] = static_cast<uint8_t>((C.vr * r + C.vg * g + C.vb * b + C.uvRound) >> FIXED_SHIFT);
+        }
+    }
+
+    // A coefficient pair for _madd_epi16 on [B, R] or [G, A] words: `low` multiplies the first, `high` the second
+    static constexpr int32_t Pair(int low, int high) {
+        return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16) | static_cast<uint16_t>(low));
+    }
+
+    // The shaders' inverse in fixed point, on bytes: each channel is one multiply-add of a [U, V] word pair on top of
+    // the scaled Y, short of the clamp. Full range centres U, V on 127.5, because UNORM 0.5 is halfway between two
+    // codes, and takes Y whole; limited range centres them on 128 and stretches Y from 16-235. `shift` is 14 unless a
+    // coefficient would not fit the signed words madd multiplies, as limited range's blue does not.
+    struct Inverse {
+        int shift;
+        int y;
+        int ru, rv;
+        int gu, gv;
+        int bu, bv;
+        int rBias, gBias, bBias;
+    };
+
+    static constexpr Inverse MakeInverse(ColorSpace space) {
+        const YuvMatrix m = YUV_MATRICES[static_cast<size_t>(space)];
+        const double kg = 1.0 - m.kr - m.kb;
+        const double yScale = m.limited ? 255.0 / 219.0 : 1.0;
+        const double uvScale = m.limited ? 255.0 / 224.0 : 1.0;
+        const double rv = 2.0 * (1.0 - m.kr) * uvScale;
+        const double gu = -2.0 * m.kb * (1.0 - m.kb) / kg * uvScale;
+        const double gv = -2.0 * m.kr * (1.0 - m.kr) / kg * uvScale;
+        const double bu = 2.0 * (1.0 - m.kb) * uvScale;
+
+        Inverse c = {};
+        c.shift = 14;
+        while ((bu > rv ? bu : rv) * (1 << c.shift) >= 32767.5) --c.shift;
+        const double one = 1 << c.shift;
+        c.y = Round(yScale * one);
+        c.ru = 0;
+        c.rv = Round(rv * one);
+        c.gu = Round(gu * one);
+        c.gv = Round(gv * one);
+        c.bu = Round(bu * one);
+        c.bv = 0;
+        auto bias = [&](int u, int v) {
+            const int half = 1 << (c.shift - 1);
+            return m.limited ? half - 16 * c.y - (u + v) * 128 : half - (u + v) * 255 / 2;
+        };
+        c.rBias = bias(c.ru, c.rv);
+        c.gBias = bias(c.gu, c.gv);
+        c.bBias = bias(c.bu, c.bv);
+        return c;
+    }
+
+    // One row: `width` Y bytes and U,V byte pairs into `width` opaque BGRA pixels
+    using Bgra440Row = void (*)(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra);
+
+    static inline uint8_t Saturate(int value) {
+        return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+
+    template <ColorSpace S>
+    static inline void Bgra440Pixels(const uint8_t* y, const uint8_t* uv, unsigned int from, unsigned int to, uint8_t* bgra) {
+        constexpr Inverse C = MakeInverse(S);
+        for (unsigned int x = from; x < to; ++x) {
+            const int luma = y[x] * C.y, u = uv[x * 2], v = uv[x * 2 + 1];
+            bgra[x * 4] = Saturate((luma + C.bu * u + C.bv * v + C.bBias) >> C.shift);
+            bgra[x * 4 + 1] = Saturate((luma + C.gu * u + C.gv * v + C.gBias) >> C.shift);
+            bgra[x * 4 + 2] = Saturate((luma + C.ru * u + C.rv * v + C.rBias) >> C.shift);
+            bgra[x * 4 + 3] = 255;
+        }
+    }
+
+    // The subsampled formats run the 4:4:0 kernels on full-width U,V rows and resample those. `width` counts pixels;
+    // an odd width's last column keeps a pair of its own.
+    using HalveRow = void (*)(const uint8_t* full, unsigned int width, uint8_t* uv);                         // 4:2:2, pairs of columns
+    using QuarterRow = void (*)(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv); // 4:2:0, 2x2 blocks
+    using WidenRow = void (*)(const uint8_t* uv, unsigned int width, uint8_t* full);                         // Each pair repeated
+
+    static inline void HalvePairs(const uint8_t* full, unsigned int from, unsigned int width, uint8_t* uv) {
+        for (unsigned int i = from; i < width / 2; ++i) {
+            uv[i * 2] = static_cast<uint8_t>((full[i * 4] + full[i * 4 + 2] + 1) >> 1);
+            uv[i * 2 + 1] = static_cast<uint8_t>((full[i * 4 + 1] + full[i * 4 + 3] + 1) >> 1);
+        }
+        if (width & 1) {
+            uv[width / 2 * 2] = full[width / 2 * 4];
+            uv[width / 2 * 2 + 1] = full[width / 2 * 4 + 1];
+        }
+    }
+
+    static inline void QuarterPairs(const uint8_t* top, const uint8_t* bottom, unsigned int from, unsigned int width, uint8_t* uv) {
+        for (unsigned int i = from; i < width / 2; ++i) {
+            uv[i * 2] = static_cast<uint8_t>((top[i * 4] + top[i * 4 + 2] + bottom[i * 4] + bottom[i * 4 + 2] + 2) >> 2);
+            uv[i * 2 + 1] = static_cast<uint8_t>((top[i * 4 + 1] + top[i * 4 + 3] + bottom[i * 4 + 1] + bottom[i * 4 + 3] + 2) >> 2);
+        }
+        if (width & 1) {
+            uv[width / 2 * 2] = static_cast<uint8_t>((top[width / 2 * 4] + bottom[width / 2 * 4] + 1) >> 1);
+            uv[width / 2 * 2 + 1] = static_cast<uint8_t>((top[width / 2 * 4 + 1] + bottom[width / 2 * 4 + 1] + 1) >> 1);
+        }
+    }
+
+    static inline void WidenPairs(const uint8_t* uv, unsigned int from, unsigned int width, uint8_t* full) {
+        for (unsigned int x = from; x < width; ++x) {
+            full[x * 2] = uv[(x >> 1) * 2];
+            full[x * 2 + 1] = uv[(x >> 1) * 2 + 1];
+        }
+    }
+
+    // YUVAdaptive's chroma tiles, up to CHROMA_TILE_SIZE square, on full-resolution U,V rows: the classifier's counts, and
+    // the 4:4:0 pack averaging each pair of rows (QuarterRow packs 4:2:0, WidenRow unpacks it).
+    using TileStatsKernel = void (*)(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats);
+    using AverageRow = void (*)(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+
+    static inline unsigned int Distance(unsigned int a, unsigned int b) {
+        return a > b ? a - b : b - a;
+    }
+
+    static inline void TilePixelStats(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats) {
+        stats = {};
+        for (unsigned int y = 0; y < height; ++y) {
+            const uint8_t* row = uv + y * pitch;
+            for (unsigned int x = 1; x < width; ++x) {
+                const uint8_t* pair = row + x * 2;
+                if (pair[0] != pair[-2] || pair[1] != pair[-1]) stats.changes++;
+                if ((x & 1) && (Distance(pair[0], pair[-2]) > CHROMA_EDGE || Distance(pair[1], pair[-1]) > CHROMA_EDGE)) stats.edgesH++;
+            }
+            if (!(y & 1)) continue;
+            for (unsigned int x = 0; x < width; ++x) {
+                const uint8_t* pair = row + x * 2;
+                const uint8_t* above = pair - pitch;
+                if (Distance(pair[0], above[0]) > CHROMA_EDGE || Distance(pair[1], above[1]) > CHROMA_EDGE) stats.edgesV++;
+            }
+        }
+    }
+
+    static inline void AveragePairs(const uint8_t* top, const uint8_t* bottom, unsigned int from, unsigned int width, uint8_t* uv) {
+        for (unsigned int i = from * 2; i < width * 2; ++i) uv[i] = static_cast<uint8_t>((top[i] + bottom[i] + 1) >> 1);
+    }
+
+    // Each kernel once per ColorSpace, indexed by it
+    extern const Yuv440Row YUV440_ROWS_SCALAR[COLOR_SPACE_COUNT];
+    extern const Bgra440Row BGRA440_ROWS_SCALAR[COLOR_SPACE_COUNT];
+    void HalveRowScalar(const uint8_t* full, unsigned int width, uint8_t* uv);
+    void QuarterRowScalar(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+    void WidenRowScalar(const uint8_t* uv, unsigned int width, uint8_t* full);
+    void TileStatsScalar(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats);
+    void AverageRowScalar(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+#if defined(FRAMECODEC_X86_KERNELS)
+    extern const Yuv440Row YUV440_ROWS_SSE41[COLOR_SPACE_COUNT];
+    extern const Yuv440Row YUV440_ROWS_AVX2[COLOR_SPACE_COUNT];
+    extern const Yuv440Row YUV440_ROWS_AVX512[COLOR_SPACE_COUNT];
+    extern const Bgra440Row BGRA440_ROWS_SSE41[COLOR_SPACE_COUNT];
+    extern const Bgra440Row BGRA440_ROWS_AVX2[COLOR_SPACE_COUNT];
+    extern const Bgra440Row BGRA440_ROWS_AVX512[COLOR_SPACE_COUNT];
+    // Byte shuffles on rows already in cache; wider registers gain nothing, so every level uses these
+    void HalveRowSSE41(const uint8_t* full, unsigned int width, uint8_t* uv);
+    void QuarterRowSSE41(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+    void WidenRowSSE41(const uint8_t* uv, unsigned int width, uint8_t* full);
+    void AverageRowSSE41(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv);
+    // A full tile's row is two SSE registers or one AVX2 one; narrower edge tiles take the scalar path
+    void TileStatsSSE41(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats);
+    void TileStatsAVX2(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats);
+#endif
+}
+
+#endif
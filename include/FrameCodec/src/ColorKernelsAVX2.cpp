@@ -0,0 +1,136 @@
+#include "ColorKernels.hpp"
+
+#if defined(FRAMECODEC_X86_KERNELS)
+#include <immintrin.h>
+
+using namespace FrameCodec::ColorKernels;
+using FrameCodec::ColorSpace;
+
+namespace {
+    struct Yuv {
+        __m256i y, u, v;
+    };
+
+    template <ColorSpace S>
+    inline Yuv Convert8(__m256i pixels) {
+        constexpr Forward C = MakeForward(S);
+        const __m256i br = _mm256_and_si256(pixels, _mm256_set1_epi32(0x00FF00FF));
+        const __m256i ga = _mm256_srli_epi16(pixels, 8);
+        Yuv out;
+        out.y = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(Pair(C.yb, C.yr))), _mm256_madd_epi16(ga, _mm256_set1_epi32(Pair(C.yg, 0))));
+        out.u = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(Pair(C.ub, C.ur))), _mm256_madd_epi16(ga, _mm256_set1_epi32(Pair(C.ug, 0))));
+        out.v = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(Pair(C.vb, C.vr))), _mm256_madd_epi16(ga, _mm256_set1_epi32(Pair(C.vg, 0))));
+        out.y = _mm256_srai_epi32(_mm256_add_epi32(out.y, _mm256_set1_epi32(C.yRound)), FIXED_SHIFT);
+        out.u = _mm256_srai_epi32(_mm256_add_epi32(out.u, _mm256_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        out.v = _mm256_srai_epi32(_mm256_add_epi32(out.v, _mm256_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        return out;
+    }
+
+    inline __m256i PackUV(const Yuv& p) {
+        return _mm256_or_si256(p.u, _mm256_slli_epi32(p.v, 8));
+    }
+
+    template <int SHIFT>
+    inline __m256i Channel(__m256i luma, __m256i uv, int u, int v, int bias) {
+        const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(luma, _mm256_madd_epi16(uv, _mm256_set1_epi32(Pair(u, v)))), _mm256_set1_epi32(bias));
+        return _mm256_srai_epi32(sum, SHIFT);
+    }
+
+    // Eight pixels, four per 128-bit lane, which is where the packs and the shuffle work anyway
+    template <ColorSpace S>
+    inline __m256i Bgra8(__m256i y, __m256i uv) {
+        constexpr Inverse C = MakeInverse(S);
+        __m256i luma;
+        if constexpr (C.y == 1 << C.shift) luma = _mm256_slli_epi32(y, C.shift);
+        else luma = _mm256_madd_epi16(y, _mm256_set1_epi32(Pair(C.y, 0)));
+        const __m256i b = Channel<C.shift>(luma, uv, C.bu, C.bv, C.bBias);
+        const __m256i g = Channel<C.shift>(luma, uv, C.gu, C.gv, C.gBias);
+        const __m256i r = Channel<C.shift>(luma, uv, C.ru, C.rv, C.rBias);
+        const __m256i planes = _mm256_packus_epi16(_mm256_packs_epi32(b, g), _mm256_packs_epi32(r, _mm256_set1_epi32(255)));
+        return _mm256_shuffle_epi8(planes, _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                                            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    template <ColorSpace S>
+    void EncodeRow(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv) {
+        unsigned int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            Yuv p[4];
+            for (unsigned int i = 0; i < 4; ++i) p[i] = Convert8<S>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bgra + (x + i * 8) * 4)));
+
+            // The packs work per 128-bit lane; the permutes put the four-pixel groups back in order
+            const __m256i y01 = _mm256_packs_epi32(p[0].y, p[1].y);
+            const __m256i y23 = _mm256_packs_epi32(p[2].y, p[3].y);
+            const __m256i ys = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(y01, y23), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), ys);
+            if (!uv) continue;
+            const __m256i uv01 = _mm256_permute4x64_epi64(_mm256_packus_epi32(PackUV(p[0]), PackUV(p[1])), _MM_SHUFFLE(3, 1, 2, 0));
+            const __m256i uv23 = _mm256_permute4x64_epi64(_mm256_packus_epi32(PackUV(p[2]), PackUV(p[3])), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + x * 2), uv01);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + x * 2 + 32), uv23);
+        }
+        Yuv440Pixels<S>(bgra, x, width, y, uv);
+    }
+
+    template <ColorSpace S>
+    void DecodeRow(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra) {
+        unsigned int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const __m128i ys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+            const __m256i uvs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + x * 2));
+            __m256i* out = reinterpret_cast<__m256i*>(bgra + x * 4);
+            _mm256_storeu_si256(out, Bgra8<S>(_mm256_cvtepu8_epi32(ys), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(uvs))));
+            _mm256_storeu_si256(out + 1, Bgra8<S>(_mm256_cvtepu8_epi32(_mm_srli_si128(ys, 8)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(uvs, 1))));
+        }
+        Bgra440Pixels<S>(y, uv, x, width, bgra);
+    }
+
+    inline __m256i Calm(__m256i a, __m256i b) {
+        const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+        const __m256i over = _mm256_subs_epu8(diff, _mm256_set1_epi8(static_cast<char>(FrameCodec::CHROMA_EDGE)));
+        return _mm256_cmpeq_epi16(over, _mm256_setzero_si256());
+    }
+
+    inline uint32_t Sum16(__m256i counts) {
+        const __m256i sums = _mm256_madd_epi16(counts, _mm256_set1_epi16(1));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        total = _mm_add_epi32(total, _mm_srli_si128(total, 8));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_add_epi32(total, _mm_srli_si128(total, 4))));
+    }
+}
+
+const Yuv440Row FrameCodec::ColorKernels::YUV440_ROWS_AVX2[COLOR_SPACE_COUNT] = {
+    EncodeRow<ColorSpace::BT601Full>, EncodeRow<ColorSpace::BT601Limited>,
+    EncodeRow<ColorSpace::BT709Full>, EncodeRow<ColorSpace::BT709Limited>,
+};
+
+const Bgra440Row FrameCodec::ColorKernels::BGRA440_ROWS_AVX2[COLOR_SPACE_COUNT] = {
+    DecodeRow<ColorSpace::BT601Full>, DecodeRow<ColorSpace::BT601Limited>,
+    DecodeRow<ColorSpace::BT709Full>, DecodeRow<ColorSpace::BT709Limited>,
+};
+
+void FrameCodec::ColorKernels::TileStatsAVX2(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats) {
+    if (width != CHROMA_TILE_SIZE) {
+        TilePixelStats(uv, pitch, width, height, stats);
+        return;
+    }
+
+    // As TileStatsSSE41 with the row in one register. The left neighbours cross the 128-bit lanes through the permute;
+    // the first pixel's is zero, so it is left out of the compare and counted as the same.
+    const __m256i lowWords = _mm256_set1_epi32(0xFFFF);
+    const __m256i notFirst = _mm256_setr_epi16(0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i same = _mm256_setzero_si256(), calmH = _mm256_setzero_si256(), calmV = _mm256_setzero_si256();
+    __m256i above = _mm256_setzero_si256();
+    for (unsigned int y = 0; y < height; ++y) {
+        const __m256i row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + y * pitch));
+        const __m256i left = _mm256_alignr_epi8(row, _mm256_permute2x128_si256(row, row, 0x08), 14);
+        same = _mm256_sub_epi16(same, _mm256_and_si256(_mm256_cmpeq_epi16(row, left), notFirst));
+        calmH = _mm256_sub_epi16(calmH, _mm256_and_si256(Calm(row, _mm256_srli_epi32(row, 16)), lowWords));
+        if (y & 1) calmV = _mm256_sub_epi16(calmV, Calm(row, above));
+        above = row;
+    }
+    stats.changes = (CHROMA_TILE_SIZE - 1) * height - Sum16(same);
+    stats.edgesH = CHROMA_TILE_SIZE / 2 * height - Sum16(calmH);
+    stats.edgesV = CHROMA_TILE_SIZE * (height / 2) - Sum16(calmV);
+}
+#endif
@@ -0,0 +1,84 @@
+#include "ColorKernels.hpp"
+
+#if defined(FRAMECODEC_X86_KERNELS)
+#include <immintrin.h>
+
+using namespace FrameCodec::ColorKernels;
+using FrameCodec::ColorSpace;
+
+namespace {
+    struct Yuv {
+        __m512i y, u, v;
+    };
+
+    template <ColorSpace S>
+    inline Yuv Convert16(__m512i pixels) {
+        constexpr Forward C = MakeForward(S);
+        const __m512i br = _mm512_and_si512(pixels, _mm512_set1_epi32(0x00FF00FF));
+        const __m512i ga = _mm512_srli_epi16(pixels, 8);
+        Yuv out;
+        out.y = _mm512_add_epi32(_mm512_madd_epi16(br, _mm512_set1_epi32(Pair(C.yb, C.yr))), _mm512_madd_epi16(ga, _mm512_set1_epi32(Pair(C.yg, 0))));
+        out.u = _mm512_add_epi32(_mm512_madd_epi16(br, _mm512_set1_epi32(Pair(C.ub, C.ur))), _mm512_madd_epi16(ga, _mm512_set1_epi32(Pair(C.ug, 0))));
+        out.v = _mm512_add_epi32(_mm512_madd_epi16(br, _mm512_set1_epi32(Pair(C.vb, C.vr))), _mm512_madd_epi16(ga, _mm512_set1_epi32(Pair(C.vg, 0))));
+        out.y = _mm512_srai_epi32(_mm512_add_epi32(out.y, _mm512_set1_epi32(C.yRound)), FIXED_SHIFT);
+        out.u = _mm512_srai_epi32(_mm512_add_epi32(out.u, _mm512_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        out.v = _mm512_srai_epi32(_mm512_add_epi32(out.v, _mm512_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        return out;
+    }
+
+    template <int SHIFT>
+    inline __m512i Channel(__m512i luma, __m512i uv, int u, int v, int bias) {
+        const __m512i sum = _mm512_add_epi32(_mm512_add_epi32(luma, _mm512_madd_epi16(uv, _mm512_set1_epi32(Pair(u, v)))), _mm512_set1_epi32(bias));
+        return _mm512_srai_epi32(sum, SHIFT);
+    }
+
+    // Sixteen pixels, four per 128-bit lane as in the AVX2 kernel
+    template <ColorSpace S>
+    inline __m512i Bgra16(__m512i y, __m512i uv) {
+        constexpr Inverse C = MakeInverse(S);
+        __m512i luma;
+        if constexpr (C.y == 1 << C.shift) luma = _mm512_slli_epi32(y, C.shift);
+        else luma = _mm512_madd_epi16(y, _mm512_set1_epi32(Pair(C.y, 0)));
+        const __m512i b = Channel<C.shift>(luma, uv, C.bu, C.bv, C.bBias);
+        const __m512i g = Channel<C.shift>(luma, uv, C.gu, C.gv, C.gBias);
+        const __m512i r = Channel<C.shift>(luma, uv, C.ru, C.rv, C.rBias);
+        const __m512i planes = _mm512_packus_epi16(_mm512_packs_epi32(b, g), _mm512_packs_epi32(r, _mm512_set1_epi32(255)));
+        return _mm512_shuffle_epi8(planes, _mm512_broadcast_i32x4(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15)));
+    }
+
+    template <ColorSpace S>
+    void EncodeRow(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv) {
+        unsigned int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            // Results are already bytes, so the narrowing moves keep pixel order without any permute
+            const Yuv p = Convert16<S>(_mm512_loadu_si512(bgra + x * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), _mm512_cvtepi32_epi8(p.y));
+            if (!uv) continue;
+            const __m512i pairs = _mm512_or_si512(p.u, _mm512_slli_epi32(p.v, 8));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + x * 2), _mm512_cvtepi32_epi16(pairs));
+        }
+        Yuv440Pixels<S>(bgra, x, width, y, uv);
+    }
+
+    template <ColorSpace S>
+    void DecodeRow(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra) {
+        unsigned int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const __m512i ys = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x)));
+            const __m512i uvs = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(uv + x * 2)));
+            _mm512_storeu_si512(bgra + x * 4, Bgra16<S>(ys, uvs));
+        }
+        Bgra440Pixels<S>(y, uv, x, width, bgra);
+    }
+}
+
+const Yuv440Row FrameCodec::ColorKernels::YUV440_ROWS_AVX512[COLOR_SPACE_COUNT] = {
+    EncodeRow<ColorSpace::BT601Full>, EncodeRow<ColorSpace::BT601Limited>,
+    EncodeRow<ColorSpace::BT709Full>, EncodeRow<ColorSpace::BT709Limited>,
+};
+
+const Bgra440Row FrameCodec::ColorKernels::BGRA440_ROWS_AVX512[COLOR_SPACE_COUNT] = {
+    DecodeRow<ColorSpace::BT601Full>, DecodeRow<ColorSpace::BT601Limited>,
+    DecodeRow<ColorSpace::BT709Full>, DecodeRow<ColorSpace::BT709Limited>,
+};
+#endif
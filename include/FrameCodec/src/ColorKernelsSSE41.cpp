@@ -0,0 +1,192 @@
+#include "ColorKernels.hpp"
+
+#if defined(FRAMECODEC_X86_KERNELS)
+#include <smmintrin.h>
+
+using namespace FrameCodec::ColorKernels;
+using FrameCodec::ColorSpace;
+
+namespace {
+    struct Yuv {
+        __m128i y, u, v;
+    };
+
+    // Four pixels: BGRA bytes split into [B, R] and [G, A] words, one multiply-add per pair
+    template <ColorSpace S>
+    inline Yuv Convert4(__m128i pixels) {
+        constexpr Forward C = MakeForward(S);
+        const __m128i br = _mm_and_si128(pixels, _mm_set1_epi32(0x00FF00FF));
+        const __m128i ga = _mm_srli_epi16(pixels, 8);
+        Yuv out;
+        out.y = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(Pair(C.yb, C.yr))), _mm_madd_epi16(ga, _mm_set1_epi32(Pair(C.yg, 0))));
+        out.u = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(Pair(C.ub, C.ur))), _mm_madd_epi16(ga, _mm_set1_epi32(Pair(C.ug, 0))));
+        out.v = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(Pair(C.vb, C.vr))), _mm_madd_epi16(ga, _mm_set1_epi32(Pair(C.vg, 0))));
+        out.y = _mm_srai_epi32(_mm_add_epi32(out.y, _mm_set1_epi32(C.yRound)), FIXED_SHIFT);
+        out.u = _mm_srai_epi32(_mm_add_epi32(out.u, _mm_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        out.v = _mm_srai_epi32(_mm_add_epi32(out.v, _mm_set1_epi32(C.uvRound)), FIXED_SHIFT);
+        return out;
+    }
+
+    // U in the low byte, V in the next: the interleaved pair as one little-endian word
+    inline __m128i PackUV(const Yuv& p) {
+        return _mm_or_si128(p.u, _mm_slli_epi32(p.v, 8));
+    }
+
+    template <int SHIFT>
+    inline __m128i Channel(__m128i luma, __m128i uv, int u, int v, int bias) {
+        const __m128i sum = _mm_add_epi32(_mm_add_epi32(luma, _mm_madd_epi16(uv, _mm_set1_epi32(Pair(u, v)))), _mm_set1_epi32(bias));
+        return _mm_srai_epi32(sum, SHIFT);
+    }
+
+    // Four pixels from Y widened to dwords and their U,V bytes widened to one word pair per dword. The saturating
+    // packs clamp to [0, 255] and leave [B0-3 G0-3 R0-3 A0-3]; the shuffle interleaves that into pixels.
+    template <ColorSpace S>
+    inline __m128i Bgra4(__m128i y, __m128i uv) {
+        constexpr Inverse C = MakeInverse(S);
+        // Y's high word is zero, so a multiply-add scales it; full range only needs the shift
+        __m128i luma;
+        if constexpr (C.y == 1 << C.shift) luma = _mm_slli_epi32(y, C.shift);
+        else luma = _mm_madd_epi16(y, _mm_set1_epi32(Pair(C.y, 0)));
+        const __m128i b = Channel<C.shift>(luma, uv, C.bu, C.bv, C.bBias);
+        const __m128i g = Channel<C.shift>(luma, uv, C.gu, C.gv, C.gBias);
+        const __m128i r = Channel<C.shift>(luma, uv, C.ru, C.rv, C.rBias);
+        const __m128i planes = _mm_packus_epi16(_mm_packs_epi32(b, g), _mm_packs_epi32(r, _mm_set1_epi32(255)));
+        return _mm_shuffle_epi8(planes, _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    template <ColorSpace S>
+    void EncodeRow(const uint8_t* bgra, unsigned int width, uint8_t* y, uint8_t* uv) {
+        unsigned int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            Yuv p[4];
+            for (unsigned int i = 0; i < 4; ++i) p[i] = Convert4<S>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + (x + i * 4) * 4)));
+
+            const __m128i y01 = _mm_packs_epi32(p[0].y, p[1].y);
+            const __m128i y23 = _mm_packs_epi32(p[2].y, p[3].y);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), _mm_packus_epi16(y01, y23));
+            if (!uv) continue;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x * 2), _mm_packus_epi32(PackUV(p[0]), PackUV(p[1])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x * 2 + 16), _mm_packus_epi32(PackUV(p[2]), PackUV(p[3])));
+        }
+        Yuv440Pixels<S>(bgra, x, width, y, uv);
+    }
+
+    template <ColorSpace S>
+    void DecodeRow(const uint8_t* y, const uint8_t* uv, unsigned int width, uint8_t* bgra) {
+        unsigned int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            const __m128i ys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+            const __m128i uv0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2));
+            const __m128i uv1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x * 2 + 16));
+            __m128i* out = reinterpret_cast<__m128i*>(bgra + x * 4);
+            _mm_storeu_si128(out, Bgra4<S>(_mm_cvtepu8_epi32(ys), _mm_cvtepu8_epi16(uv0)));
+            _mm_storeu_si128(out + 1, Bgra4<S>(_mm_cvtepu8_epi32(_mm_srli_si128(ys, 4)), _mm_cvtepu8_epi16(_mm_srli_si128(uv0, 8))));
+            _mm_storeu_si128(out + 2, Bgra4<S>(_mm_cvtepu8_epi32(_mm_srli_si128(ys, 8)), _mm_cvtepu8_epi16(uv1)));
+            _mm_storeu_si128(out + 3, Bgra4<S>(_mm_cvtepu8_epi32(_mm_srli_si128(ys, 12)), _mm_cvtepu8_epi16(_mm_srli_si128(uv1, 8))));
+        }
+        Bgra440Pixels<S>(y, uv, x, width, bgra);
+    }
+}
+
+const Yuv440Row FrameCodec::ColorKernels::YUV440_ROWS_SSE41[COLOR_SPACE_COUNT] = {
+    EncodeRow<ColorSpace::BT601Full>, EncodeRow<ColorSpace::BT601Limited>,
+    EncodeRow<ColorSpace::BT709Full>, EncodeRow<ColorSpace::BT709Limited>,
+};
+
+const Bgra440Row FrameCodec::ColorKernels::BGRA440_ROWS_SSE41[COLOR_SPACE_COUNT] = {
+    DecodeRow<ColorSpace::BT601Full>, DecodeRow<ColorSpace::BT601Limited>,
+    DecodeRow<ColorSpace::BT709Full>, DecodeRow<ColorSpace::BT709Limited>,
+};
+
+void FrameCodec::ColorKernels::HalveRowSSE41(const uint8_t* full, unsigned int width, uint8_t* uv) {
+    // Even pairs to the low half, odd pairs to the high half; then the two halves of both loads are averaged
+    const __m128i split = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+    unsigned int i = 0;
+    for (; i + 8 <= width / 2; i += 8) {
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(full + i * 4)), split);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(full + i * 4 + 16)), split);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + i * 2), _mm_avg_epu8(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)));
+    }
+    HalvePairs(full, i, width, uv);
+}
+
+void FrameCodec::ColorKernels::QuarterRowSSE41(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv) {
+    // [U0 U1 V0 V1 ...] so that one multiply-add by ones sums each pair of columns into a word
+    const __m128i pairs = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i round = _mm_set1_epi16(2);
+    auto sums = [&](unsigned int offset) {
+        const __m128i t = _mm_maddubs_epi16(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + offset)), pairs), ones);
+        const __m128i b = _mm_maddubs_epi16(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + offset)), pairs), ones);
+        return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, b), round), 2);
+    };
+    unsigned int i = 0;
+    for (; i + 8 <= width / 2; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + i * 2), _mm_packus_epi16(sums(i * 4), sums(i * 4 + 16)));
+    }
+    QuarterPairs(top, bottom, i, width, uv);
+}
+
+void FrameCodec::ColorKernels::WidenRowSSE41(const uint8_t* uv, unsigned int width, uint8_t* full) {
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(full + x * 2), _mm_unpacklo_epi16(pairs, pairs));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(full + x * 2 + 16), _mm_unpackhi_epi16(pairs, pairs));
+    }
+    WidenPairs(uv, x, width, full);
+}
+
+void FrameCodec::ColorKernels::AverageRowSSE41(const uint8_t* top, const uint8_t* bottom, unsigned int width, uint8_t* uv) {
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 2));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + x * 2), _mm_avg_epu8(t, b));
+    }
+    AveragePairs(top, bottom, x, width, uv);
+}
+
+namespace {
+    // Words whose bytes both step by at most CHROMA_EDGE, as -1
+    inline __m128i Calm(__m128i a, __m128i b) {
+        const __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        const __m128i over = _mm_subs_epu8(diff, _mm_set1_epi8(static_cast<char>(FrameCodec::CHROMA_EDGE)));
+        return _mm_cmpeq_epi16(over, _mm_setzero_si128());
+    }
+
+    inline uint32_t Sum16(__m128i counts) {
+        const __m128i sums = _mm_madd_epi16(counts, _mm_set1_epi16(1));
+        const __m128i pairs = _mm_add_epi32(sums, _mm_srli_si128(sums, 8));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_add_epi32(pairs, _mm_srli_si128(pairs, 4))));
+    }
+}
+
+void FrameCodec::ColorKernels::TileStatsSSE41(const uint8_t* uv, size_t pitch, unsigned int width, unsigned int height, TileStats& stats) {
+    if (width != CHROMA_TILE_SIZE) {
+        TilePixelStats(uv, pitch, width, height, stats);
+        return;
+    }
+
+    // Word counters of the pixels that don't count, subtracting the compares' -1s. Each dword holds a column pair, so
+    // shifting the odd pixel down onto the even one compares the pair in the low word; the row's first pixel is
+    // compared with itself.
+    const __m128i lowWords = _mm_set1_epi32(0xFFFF);
+    __m128i same = _mm_setzero_si128(), calmH = _mm_setzero_si128(), calmV = _mm_setzero_si128();
+    __m128i aboveA = _mm_setzero_si128(), aboveB = _mm_setzero_si128();
+    for (unsigned int y = 0; y < height; ++y) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + y * pitch));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + y * pitch + 16));
+        same = _mm_sub_epi16(same, _mm_cmpeq_epi16(a, _mm_alignr_epi8(a, _mm_slli_si128(a, 14), 14)));
+        same = _mm_sub_epi16(same, _mm_cmpeq_epi16(b, _mm_alignr_epi8(b, a, 14)));
+        calmH = _mm_sub_epi16(calmH, _mm_and_si128(Calm(a, _mm_srli_epi32(a, 16)), lowWords));
+        calmH = _mm_sub_epi16(calmH, _mm_and_si128(Calm(b, _mm_srli_epi32(b, 16)), lowWords));
+        if (y & 1) calmV = _mm_sub_epi16(_mm_sub_epi16(calmV, Calm(a, aboveA)), Calm(b, aboveB));
+        aboveA = a;
+        aboveB = b;
+    }
+    stats.changes = CHROMA_TILE_SIZE * height - Sum16(same);
+    stats.edgesH = CHROMA_TILE_SIZE / 2 * height - Sum16(calmH);
+    stats.edgesV = CHROMA_TILE_SIZE * (height / 2) - Sum16(calmV);
+}
+#endif
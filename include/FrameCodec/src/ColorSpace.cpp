@@ -0,0 +1,26 @@
+#include "ColorSpace.hpp"
+
+#include <cctype>
+
+using namespace FrameCodec;
+
+const YuvMatrix& FrameCodec::GetYuvMatrix(ColorSpace space) {
+    const size_t index = static_cast<size_t>(space);
+    return YUV_MATRICES[index < COLOR_SPACE_COUNT ? index : 0];
+}
+
+bool FrameCodec::ParseColorSpace(const char* name, ColorSpace& space) {
+    for (size_t i = 0; i < COLOR_SPACE_COUNT; ++i) {
+        const char* a = name;
+        const char* b = YUV_MATRICES[i].name;
+        while (*a && std::tolower(static_cast<unsigned char>(*a)) == *b) {
+            ++a;
+            ++b;
+        }
+        if (*a == '\0' && *b == '\0') {
+            space = static_cast<ColorSpace>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#include "CpuFeatures.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    SimdLevel Probe() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool sse41 = info[2] & (1 << 19);
+        const bool osxsave = info[2] & (1 << 27);
+        const bool avx = info[2] & (1 << 28);
+        if (!sse41) return SimdLevel::Scalar;
+        if (!osxsave || !avx || maxLeaf < 7) return SimdLevel::SSE41;
+
+        // The OS must save the YMM (and for AVX-512 the ZMM and mask) registers across context switches
+        const unsigned long long xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x6) != 0x6) return SimdLevel::SSE41;
+        __cpuidex(info, 7, 0);
+        if (!(info[1] & (1 << 5))) return SimdLevel::SSE41;
+        const bool avx512 = (info[1] & (1 << 16)) && (info[1] & (1 << 30)) && (xcr0 & 0xE6) == 0xE6;
+        return avx512 ? SimdLevel::AVX512 : SimdLevel::AVX2;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+        return SimdLevel::Scalar;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+}
+
+SimdLevel FrameCodec::DetectSimdLevel() {
+    static const SimdLevel level = Probe();
+    return level;
+}
+
+const char* FrameCodec::SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE41: return "SSE4.1";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        default: return "Scalar";
+    }
+}
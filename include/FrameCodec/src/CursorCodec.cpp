@@ -0,0 +1,144 @@
+#include "CursorCodec.hpp"
+#include "FrameHash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace FrameCodec;
+
+constexpr uint32_t CURSOR_BLACK = 0xFF000000;
+constexpr uint32_t CURSOR_WHITE = 0xFFFFFFFF;
+constexpr uint32_t CURSOR_CLEAR = 0x00000000;
+
+bool FrameCodec::ConvertCursorShape(CursorShapeType type, unsigned int width, unsigned int height, unsigned int pitch,
+                                    const uint8_t* data, CursorState& state) {
+    const unsigned int rows = (type == CursorShapeType::Monochrome) ? height / 2 : height;
+    if (width == 0 || rows == 0 || width > MAX_CURSOR_SIZE || rows > MAX_CURSOR_SIZE) return false;
+
+    state.width = static_cast<uint16_t>(width);
+    state.height = static_cast<uint16_t>(rows);
+    state.pixels.resize(static_cast<size_t>(width) * rows * 4);
+    uint8_t* out = state.pixels.data();
+
+    switch (type) {
+        case CursorShapeType::Color:
+            for (unsigned int y = 0; y < rows; ++y) {
+                memcpy(out + y * width * 4, data + y * pitch, width * 4);
+            }
+            break;
+
+        case CursorShapeType::MaskedColor:
+            // Alpha is a mask: 0 replaces the screen with the color, 0xFF XORs the color onto the screen
+            for (unsigned int y = 0; y < rows; ++y) {
+                for (unsigned int x = 0; x < width; ++x) {
+                    uint32_t pixel;
+                    memcpy(&pixel, data + y * pitch + x * 4, sizeof(pixel));
+
+                    if ((pixel >> 24) == 0) pixel |= 0xFF000000;
+                    else pixel = (pixel & 0x00FFFFFF) ? CURSOR_BLACK : CURSOR_CLEAR;
+
+                    memcpy(out + (y * width + x) * 4, &pixel, sizeof(pixel));
+                }
+            }
+            break;
+
+        case CursorShapeType::Monochrome: {
+            const uint8_t* andMask = data;
+            const uint8_t* xorMask = data + rows * pitch;
+
+            for (unsigned int y = 0; y < rows; ++y) {
+                for (unsigned int x = 0; x < width; ++x) {
+                    const uint8_t bit = 0x80 >> (x % 8);
+                    const bool andBit = (andMask[y * pitch + x / 8] & bit) != 0;
+                    const bool xorBit = (xorMask[y * pitch + x / 8] & bit) != 0;
+
+                    uint32_t pixel;
+                    if (!andBit) pixel = xorBit ? CURSOR_WHITE : CURSOR_BLACK;
+                    else pixel = xorBit ? CURSOR_BLACK : CURSOR_CLEAR; // Inverted -> black, the I-beam stays visible
+
+                    memcpy(out + (y * width + x) * 4, &pixel, sizeof(pixel));
+                }
+            }
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    state.shapeId = HashBytes(state.pixels.data(), state.pixels.size(), (static_cast<uint64_t>(width) << 16) | rows);
+    if (state.shapeId == 0) state.shapeId = 1; // 0 is reserved for "no shape"
+    return true;
+}
+
+// MARK: CursorEncoder
+size_t CursorEncoder::Encode(const CursorState& state, uint8_t* out) {
+    CursorHeader header = {};
+    header.type = CURSOR_MSG_MOVE;
+    header.visible = state.visible ? 1 : 0;
+    header.x = state.x;
+    header.y = state.y;
+    header.shapeId = state.shapeId;
+
+    const bool known = state.shapeId == 0 || std::find(m_Sent.begin(), m_Sent.end(), state.shapeId) != m_Sent.end();
+    if (known) {
+        memcpy(out, &header, sizeof(header));
+        m_MoveMessages++;
+        return sizeof(header);
+    }
+
+    header.type = CURSOR_MSG_SHAPE;
+    header.width = state.width;
+    header.height = state.height;
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), state.pixels.data(), state.pixels.size());
+
+    m_Sent.push_back(state.shapeId);
+    if (m_Sent.size() > CURSOR_SHAPE_CACHE) m_Sent.pop_front();
+
+    m_ShapeMessages++;
+    return sizeof(header) + state.pixels.size();
+}
+
+// MARK: CursorDecoder
+bool CursorDecoder::Decode(const uint8_t* in, size_t length) {
+    if (length < sizeof(CursorHeader)) return false;
+
+    CursorHeader header;
+    memcpy(&header, in, sizeof(header));
+
+    if (header.type == CURSOR_MSG_SHAPE) {
+        const size_t bytes = static_cast<size_t>(header.width) * header.height * 4;
+        if (header.width == 0 || header.height == 0 || header.width > MAX_CURSOR_SIZE || header.height > MAX_CURSOR_SIZE) return false;
+        if (length < sizeof(header) + bytes || header.shapeId == 0) return false;
+
+        if (m_Shapes.find(header.shapeId) == m_Shapes.end()) {
+            m_Order.push_back(header.shapeId);
+            if (m_Order.size() > CURSOR_SHAPE_CACHE) {
+                m_Shapes.erase(m_Order.front());
+                m_Order.pop_front();
+            }
+        }
+
+        CursorState& shape = m_Shapes[header.shapeId];
+        shape.shapeId = header.shapeId;
+        shape.width = header.width;
+        shape.height = header.height;
+        shape.pixels.assign(in + sizeof(header), in + sizeof(header) + bytes);
+    } else if (header.type != CURSOR_MSG_MOVE) {
+        return false;
+    }
+
+    if (header.shapeId != 0 && m_Shapes.find(header.shapeId) == m_Shapes.end()) return false;
+
+    m_Visible = header.visible != 0;
+    m_X = header.x;
+    m_Y = header.y;
+    m_ShapeId = header.shapeId;
+    return true;
+}
+
+const CursorState* CursorDecoder::GetShape() const {
+    auto it = m_Shapes.find(m_ShapeId);
+    return it == m_Shapes.end() ? nullptr : &it->second;
+}
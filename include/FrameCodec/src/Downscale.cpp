@@ -0,0 +1,215 @@
+#include "Downscale.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DOWNSCALE_AVX2 1
+#endif
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <smmintrin.h>
+#define DOWNSCALE_SSE41 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DOWNSCALE_SSE2 1
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    constexpr unsigned int CHANNELS = 4;
+
+    // out[i] = sum of rows[k][i] * weight[k]; at most 255 * 256, so it fits 16 bits exactly
+    void VerticalReference(const uint8_t* const* rows, const uint16_t* weight, unsigned int taps, size_t bytes, uint16_t* out) {
+        for (size_t i = 0; i < bytes; ++i) {
+            uint32_t sum = 0;
+            for (unsigned int k = 0; k < taps; ++k) sum += rows[k][i] * weight[k];
+            out[i] = static_cast<uint16_t>(sum);
+        }
+    }
+
+    void Vertical(const uint8_t* const* rows, const uint16_t* weight, unsigned int taps, size_t bytes, uint16_t* out) {
+        size_t i = 0;
+#if defined(DOWNSCALE_AVX2)
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i lo = _mm256_setzero_si256();
+            __m256i hi = _mm256_setzero_si256();
+            for (unsigned int k = 0; k < taps; ++k) {
+                const __m256i w = _mm256_set1_epi16(static_cast<short>(weight[k]));
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i + 16));
+                lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(a), w));
+                hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(b), w));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), lo);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), hi);
+        }
+#elif defined(DOWNSCALE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+            for (unsigned int k = 0; k < taps; ++k) {
+                const __m128i w = _mm_set1_epi16(static_cast<short>(weight[k]));
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+                lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), w));
+                hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), w));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), hi);
+        }
+#endif
+        if (i < bytes) {
+            const uint8_t* tail[Downscaler::MAX_TAPS];
+            for (unsigned int k = 0; k < taps; ++k) tail[k] = rows[k] + i;
+            VerticalReference(tail, weight, taps, bytes - i, out + i);
+        }
+    }
+}
+
+const char* FrameCodec::ScaleLevelName(ScaleLevel level) {
+    switch (level) {
+        case ScaleLevel::Full: return "1";
+        case ScaleLevel::ThreeQuarter: return "3/4";
+        case ScaleLevel::Half: return "1/2";
+    }
+    return "?";
+}
+
+uint16_t FrameCodec::ScaledDimension(uint16_t full, ScaleLevel level) {
+    unsigned int scaled = full;
+    if (level == ScaleLevel::ThreeQuarter) scaled = full * 3u / 4u;
+    else if (level == ScaleLevel::Half) scaled = full / 2u;
+    return static_cast<uint16_t>(std::max(2u, scaled & ~1u));
+}
+
+bool FrameCodec::FindScaleLevel(uint16_t fullWidth, uint16_t fullHeight, uint16_t width, uint16_t height, ScaleLevel& level) {
+    for (unsigned int i = 0; i < SCALE_LEVEL_COUNT; ++i) {
+        const ScaleLevel candidate = static_cast<ScaleLevel>(i);
+        const uint16_t w = candidate == ScaleLevel::Full ? fullWidth : ScaledDimension(fullWidth, candidate);
+        const uint16_t h = candidate == ScaleLevel::Full ? fullHeight : ScaledDimension(fullHeight, candidate);
+        if (w == width && h == height) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+Downscaler::Downscaler(unsigned int srcWidth, unsigned int srcHeight, unsigned int dstWidth, unsigned int dstHeight, ScaleFilter filter) :
+    m_SrcWidth(srcWidth), m_SrcHeight(srcHeight), m_DstWidth(dstWidth), m_DstHeight(dstHeight),
+    m_Columns(BuildTaps(srcWidth, dstWidth, filter)), m_Rows(BuildTaps(srcHeight, dstHeight, filter)),
+    m_RowBuffer(static_cast<size_t>(srcWidth) * CHANNELS)
+{}
+
+std::vector<Downscaler::Taps> Downscaler::BuildTaps(unsigned int src, unsigned int dst, ScaleFilter filter) {
+    std::vector<Taps> taps(dst);
+    const double ratio = static_cast<double>(src) / dst;
+
+    for (unsigned int d = 0; d < dst; ++d) {
+        double coverage[MAX_TAPS] = {};
+        Taps& t = taps[d];
+
+        if (filter == ScaleFilter::Bilinear) {
+            const double centre = std::clamp((d + 0.5) * ratio - 0.5, 0.0, static_cast<double>(src - 1));
+            t.first = std::min(static_cast<unsigned int>(centre), src - 1);
+            const double frac = centre - t.first;
+            t.count = t.first + 1 < src ? 2 : 1;
+            coverage[0] = 1.0 - frac;
+            coverage[1] = t.count == 2 ? frac : 0.0;
+        } else {
+            const double begin = d * ratio;
+            const double end = std::min((d + 1) * ratio, static_cast<double>(src));
+            t.first = std::min(static_cast<unsigned int>(begin), src - 1);
+            t.count = 0;
+            for (unsigned int s = t.first; s < src && s < end && t.count < MAX_TAPS; ++s) {
+                coverage[t.count++] = std::min(end, s + 1.0) - std::max(begin, static_cast<double>(s));
+            }
+        }
+
+        // Quantise to 1/256ths; rounding error goes to the heaviest tap so the weights still sum to 256
+        double total = 0.0;
+        for (unsigned int k = 0; k < t.count; ++k) total += coverage[k];
+        int sum = 0;
+        unsigned int heaviest = 0;
+        for (unsigned int k = 0; k < MAX_TAPS; ++k) {
+            t.weight[k] = k < t.count ? static_cast<uint16_t>(std::lround(coverage[k] / total * 256.0)) : 0;
+            sum += t.weight[k];
+            if (t.weight[k] > t.weight[heaviest]) heaviest = k;
+        }
+        t.weight[heaviest] = static_cast<uint16_t>(t.weight[heaviest] + 256 - sum);
+    }
+    return taps;
+}
+
+void Downscaler::ScaleReference(const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch) {
+    const size_t rowBytes = static_cast<size_t>(m_SrcWidth) * CHANNELS;
+    for (unsigned int y = 0; y < m_DstHeight; ++y) {
+        const Taps& row = m_Rows[y];
+        const uint8_t* rows[MAX_TAPS];
+        for (unsigned int k = 0; k < row.count; ++k) rows[k] = src + (row.first + k) * srcPitch;
+        VerticalReference(rows, row.weight, row.count, rowBytes, m_RowBuffer.data());
+
+        uint8_t* out = dst + y * dstPitch;
+        for (unsigned int x = 0; x < m_DstWidth; ++x) {
+            const Taps& column = m_Columns[x];
+            for (unsigned int c = 0; c < CHANNELS; ++c) {
+                uint32_t sum = 0x8000;
+                for (unsigned int k = 0; k < column.count; ++k) sum += m_RowBuffer[(column.first + k) * CHANNELS + c] * column.weight[k];
+                out[x * CHANNELS + c] = static_cast<uint8_t>(sum >> 16);
+            }
+        }
+    }
+}
+
+void Downscaler::Scale(const uint8_t* src, size_t srcPitch, uint8_t* dst, size_t dstPitch) {
+#if !defined(DOWNSCALE_SSE2)
+    ScaleReference(src, srcPitch, dst, dstPitch);
+#else
+    const size_t rowBytes = static_cast<size_t>(m_SrcWidth) * CHANNELS;
+    for (unsigned int y = 0; y < m_DstHeight; ++y) {
+        const Taps& row = m_Rows[y];
+        const uint8_t* rows[MAX_TAPS];
+        for (unsigned int k = 0; k < row.count; ++k) rows[k] = src + (row.first + k) * srcPitch;
+        Vertical(rows, row.weight, row.count, rowBytes, m_RowBuffer.data());
+
+        uint8_t* out = dst + y * dstPitch;
+        const uint16_t* blended = m_RowBuffer.data();
+        for (unsigned int x = 0; x < m_DstWidth; ++x) {
+            const Taps& column = m_Columns[x];
+#if defined(DOWNSCALE_SSE41)
+            // One BGRA pixel per iteration: four 8.8 channels widened to 32 bits, weighted, rounded, packed
+            __m128i sum = _mm_set1_epi32(0x8000);
+            for (unsigned int k = 0; k < column.count; ++k) {
+                const __m128i v = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(blended + (column.first + k) * CHANNELS)));
+                sum = _mm_add_epi32(sum, _mm_mullo_epi32(v, _mm_set1_epi32(column.weight[k])));
+            }
+            const __m128i packed = _mm_packus_epi32(_mm_srli_epi32(sum, 16), _mm_setzero_si128());
+            const int pixel = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+            std::memcpy(out + x * CHANNELS, &pixel, CHANNELS);
+#else
+            for (unsigned int c = 0; c < CHANNELS; ++c) {
+                uint32_t sum = 0x8000;
+                for (unsigned int k = 0; k < column.count; ++k) sum += blended[(column.first + k) * CHANNELS + c] * column.weight[k];
+                out[x * CHANNELS + c] = static_cast<uint8_t>(sum >> 16);
+            }
+#endif
+        }
+    }
+#endif
+}
+
+const char* Downscaler::KernelName() {
+#if defined(DOWNSCALE_AVX2)
+    return "AVX2";
+#elif defined(DOWNSCALE_SSE41)
+    return "SSE4.1";
+#elif defined(DOWNSCALE_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
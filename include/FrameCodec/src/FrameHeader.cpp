@@ -0,0 +1,85 @@
+#include "FrameHeader.hpp"
+#include "FrameHash.hpp"
+
+#include <chrono>
+#include <new>
+
+using namespace FrameCodec;
+
+const char* FrameCodec::FrameHeaderStatusString(FrameHeaderStatus status) {
+    switch (status) {
+        case FrameHeaderStatus::Ok: return "Ok";
+        case FrameHeaderStatus::TooShort: return "Buffer shorter than the header";
+        case FrameHeaderStatus::Misaligned: return "Header is not cache-line aligned";
+        case FrameHeaderStatus::BadMagic: return "Bad magic";
+        case FrameHeaderStatus::UnsupportedVersion: return "Unsupported header version";
+        case FrameHeaderStatus::BadPayloadSize: return "Payload exceeds the buffer";
+        case FrameHeaderStatus::ChecksumMismatch: return "Payload checksum mismatch";
+    }
+    return "Unknown";
+}
+
+uint64_t FrameCodec::FrameClockNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+FrameHeader* FrameCodec::BeginFrameHeader(uint8_t* dst, uint64_t sequence, PixelFormat format, PayloadEncoding encoding,
+                                          uint16_t width, uint16_t height) {
+    FrameHeader* header = new (dst) FrameHeader{};
+    header->magic = FRAME_MAGIC;
+    header->version = FRAME_HEADER_VERSION;
+    header->headerSize = static_cast<uint16_t>(sizeof(FrameHeader));
+    header->sequence = sequence;
+    header->width = width;
+    header->height = height;
+    header->format = format;
+    header->encoding = encoding;
+    header->bandCount = 1;
+    return header;
+}
+
+void FrameCodec::SealFrameHeader(FrameHeader* header, uint32_t payloadSize, bool checksum) {
+    header->payloadSize = payloadSize;
+    header->checksum = 0;
+    header->flags &= ~FRAME_FLAG_CHECKSUM;
+
+    if (checksum) {
+        header->checksum = static_cast<uint32_t>(HashBytes(GetFramePayload(header), payloadSize, header->sequence));
+        header->flags |= FRAME_FLAG_CHECKSUM;
+    }
+}
+
+const FrameHeader* FrameCodec::ParseFrameHeader(const uint8_t* src, size_t length, FrameHeaderStatus& status) {
+    if (length < sizeof(FrameHeader)) {
+        status = FrameHeaderStatus::TooShort;
+        return nullptr;
+    }
+    if (reinterpret_cast<uintptr_t>(src) % alignof(FrameHeader) != 0) {
+        status = FrameHeaderStatus::Misaligned;
+        return nullptr;
+    }
+
+    const FrameHeader* header = reinterpret_cast<const FrameHeader*>(src);
+    if (header->magic != FRAME_MAGIC) {
+        status = FrameHeaderStatus::BadMagic;
+        return nullptr;
+    }
+    // Any later version is accepted as long as it only grew the header
+    if (header->version < FRAME_HEADER_VERSION || header->headerSize < sizeof(FrameHeader)) {
+        status = FrameHeaderStatus::UnsupportedVersion;
+        return nullptr;
+    }
+    if (header->headerSize > length || header->payloadSize > length - header->headerSize) {
+        status = FrameHeaderStatus::BadPayloadSize;
+        return nullptr;
+    }
+    if ((header->flags & FRAME_FLAG_CHECKSUM) &&
+        static_cast<uint32_t>(HashBytes(GetFramePayload(header), header->payloadSize, header->sequence)) != header->checksum) {
+        status = FrameHeaderStatus::ChecksumMismatch;
+        return nullptr;
+    }
+
+    status = FrameHeaderStatus::Ok;
+    return header;
+}
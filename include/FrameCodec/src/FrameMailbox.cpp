@@ -0,0 +1,48 @@
+#include "FrameMailbox.hpp"
+
+using namespace FrameCodec;
+
+void FrameMailbox::Publish() {
+    // Release hands over what was written into the slot; acquire takes back a slot the consumer is done with
+    uint32_t previous = m_Middle.load(std::memory_order_relaxed);
+    uint32_t next;
+    do {
+        next = m_Write | FRESH | (previous & CLOSED);
+    } while (!m_Middle.compare_exchange_weak(previous, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    if (previous & FRESH) m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    m_Published.fetch_add(1, std::memory_order_relaxed);
+    m_Write = previous & INDEX_MASK;
+    m_Middle.notify_one();
+}
+
+bool FrameMailbox::Take() {
+    uint32_t previous = m_Middle.load(std::memory_order_relaxed);
+    do {
+        if (!(previous & FRESH)) return false;
+    } while (!m_Middle.compare_exchange_weak(previous, m_Read | (previous & CLOSED), std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    m_Read = previous & INDEX_MASK;
+    return true;
+}
+
+bool FrameMailbox::WaitAndTake() {
+    while (true) {
+        if (Take()) return true;
+
+        const uint32_t current = m_Middle.load(std::memory_order_acquire);
+        if (current & CLOSED) return false;
+        if (!(current & FRESH)) m_Middle.wait(current, std::memory_order_acquire);
+    }
+}
+
+void FrameMailbox::Close() {
+    m_Middle.fetch_or(CLOSED, std::memory_order_acq_rel);
+    m_Middle.notify_all();
+}
+
+void FrameMailbox::Reopen() {
+    m_Write = 0;
+    m_Read = 2;
+    m_Middle.store(1, std::memory_order_release);
+}
@@ -0,0 +1,54 @@
+#include "FrameRing.hpp"
+
+using namespace FrameCodec;
+
+bool FrameRing::WaitForSpace() {
+    const uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+    while (true) {
+        const uint64_t head = m_Head.load(std::memory_order_acquire);
+        if ((head | tail) & CLOSED) return false;
+        if (Count(tail) - Count(head) < m_Capacity) return true;
+        m_Head.wait(head, std::memory_order_acquire);
+    }
+}
+
+void FrameRing::Push() {
+    m_Tail.fetch_add(1, std::memory_order_release);
+    m_Tail.notify_one();
+}
+
+bool FrameRing::WaitForFrame() {
+    const uint64_t head = m_Head.load(std::memory_order_relaxed);
+    while (true) {
+        const uint64_t tail = m_Tail.load(std::memory_order_acquire);
+        if (Count(tail) != Count(head)) return true;
+        if (tail & CLOSED) return false;
+        if (tail & NUDGED) {
+            m_Tail.fetch_and(~NUDGED, std::memory_order_relaxed);
+            return true;
+        }
+        m_Tail.wait(tail, std::memory_order_acquire);
+    }
+}
+
+unsigned int FrameRing::GetCount() const {
+    const uint64_t tail = m_Tail.load(std::memory_order_acquire);
+    return static_cast<unsigned int>(Count(tail) - Count(m_Head.load(std::memory_order_relaxed)));
+}
+
+void FrameRing::Pop() {
+    m_Head.fetch_add(1, std::memory_order_release);
+    m_Head.notify_one();
+}
+
+void FrameRing::Nudge() {
+    m_Tail.fetch_or(NUDGED, std::memory_order_release);
+    m_Tail.notify_one();
+}
+
+void FrameRing::Close() {
+    m_Head.fetch_or(CLOSED, std::memory_order_acq_rel);
+    m_Tail.fetch_or(CLOSED, std::memory_order_acq_rel);
+    m_Head.notify_all();
+    m_Tail.notify_all();
+}
@@ -0,0 +1,24 @@
+#include "FrameSource.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace FrameCodec;
+
+FramePacer::FramePacer(uint16_t refreshRate, bool paced)
+    : m_Paced(paced), m_Interval(1000000000LL / std::max<uint16_t>(refreshRate, 1)), m_NextDue(std::chrono::steady_clock::now()) {}
+
+bool FramePacer::WaitUntilDue(unsigned long timeoutMs) {
+    if (!m_Paced) return true;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto deadline = now + std::chrono::milliseconds(timeoutMs);
+    if (m_NextDue > deadline) {
+        std::this_thread::sleep_until(deadline);
+        return false;
+    }
+
+    std::this_thread::sleep_until(m_NextDue);
+    m_NextDue = std::max(m_NextDue + m_Interval, now);
+    return true;
+}
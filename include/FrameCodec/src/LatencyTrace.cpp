@@ -0,0 +1,149 @@
+#include "LatencyTrace.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+using namespace FrameCodec;
+
+// MARK: ClockSync
+void ClockSync::AddSample(uint64_t localSend, uint64_t remote, uint64_t localRecv) {
+    if (localRecv < localSend) return;
+
+    const uint64_t roundTrip = localRecv - localSend;
+    if (roundTrip < m_RoundTrip) {
+        const uint64_t midpoint = localSend + roundTrip / 2;
+        m_Offset = static_cast<int64_t>(remote - midpoint);
+        m_RoundTrip = roundTrip;
+    }
+    m_Samples++;
+}
+
+// MARK: LatencyTracer
+const char* FrameCodec::TraceStageName(TraceStage stage) {
+    switch (stage) {
+        case TraceStage::Capture: return "Capture";
+        case TraceStage::Encode: return "Encode";
+        case TraceStage::WritePosted: return "WritePosted";
+        case TraceStage::WriteDone: return "WriteDone";
+        case TraceStage::Received: return "Received";
+        case TraceStage::Uploaded: return "Uploaded";
+        case TraceStage::Presented: return "Presented";
+        default: return "Unknown";
+    }
+}
+
+LatencyTracer::LatencyTracer(size_t window) : m_Frames(std::max<size_t>(window, 1)) {}
+
+bool LatencyTracer::OpenCsv(const std::string& path) {
+    m_Csv.open(path, std::ios::out | std::ios::trunc);
+    if (!m_Csv) return false;
+
+    // Every column after the sequence is microseconds since capture, in the viewer's clock
+    m_Csv << "sequence";
+    for (size_t i = 1; i < TRACE_STAGE_COUNT; ++i) {
+        m_Csv << "," << TraceStageName(static_cast<TraceStage>(i));
+    }
+    m_Csv << "\n";
+    return true;
+}
+
+void LatencyTracer::Begin(const FrameHeader& header, uint64_t writeDoneTime) {
+    m_Current = {};
+    m_Current.sequence = header.sequence;
+    m_Current.times[static_cast<size_t>(TraceStage::Capture)] = m_Clock.ToLocal(header.captureTime);
+    m_Current.times[static_cast<size_t>(TraceStage::Encode)] = m_Clock.ToLocal(header.encodeTime);
+    m_Current.times[static_cast<size_t>(TraceStage::WritePosted)] = m_Clock.ToLocal(header.sendTime);
+    m_Current.times[static_cast<size_t>(TraceStage::WriteDone)] = m_Clock.ToLocal(writeDoneTime);
+    m_Active = true;
+}
+
+void LatencyTracer::Stamp(TraceStage stage, uint64_t time) {
+    if (!m_Active) return;
+    m_Current.times[static_cast<size_t>(stage)] = time;
+}
+
+bool LatencyTracer::End() {
+    if (!m_Active) return false;
+    m_Active = false;
+
+    m_Frames[m_Next] = m_Current;
+    m_Next = (m_Next + 1) % m_Frames.size();
+    m_Count = std::min(m_Count + 1, m_Frames.size());
+
+    if (m_Csv.is_open()) {
+        const uint64_t capture = m_Current.times[0];
+        m_Csv << m_Current.sequence;
+        for (size_t i = 1; i < TRACE_STAGE_COUNT; ++i) {
+            const uint64_t time = m_Current.times[i];
+            m_Csv << ",";
+            if (time && capture) m_Csv << (static_cast<int64_t>(time - capture) / 1000.0);
+        }
+        m_Csv << "\n";
+    }
+    return true;
+}
+
+LatencyPercentiles LatencyTracer::Percentiles(size_t from, size_t to) const {
+    std::vector<uint64_t> samples;
+    samples.reserve(m_Count);
+
+    for (size_t i = 0; i < m_Count; ++i) {
+        const FrameTrace& frame = m_Frames[i];
+        const uint64_t start = frame.times[from];
+        const uint64_t end = frame.times[to];
+        if (!start || !end) continue;
+        samples.push_back(end > start ? end - start : 0); // Clock error can make tiny steps negative
+    }
+
+    LatencyPercentiles result;
+    if (samples.empty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return samples[static_cast<size_t>(q * (samples.size() - 1))]; };
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.max = samples.back();
+    return result;
+}
+
+LatencyPercentiles LatencyTracer::GetTotal() const {
+    return Percentiles(static_cast<size_t>(TraceStage::Capture), static_cast<size_t>(TraceStage::Presented));
+}
+
+uint64_t LatencyTracer::GetLastTotal() const {
+    const uint64_t start = m_Current.times[static_cast<size_t>(TraceStage::Capture)];
+    const uint64_t end = m_Current.times[static_cast<size_t>(TraceStage::Presented)];
+    if (!start || !end) return 0;
+    return end > start ? end - start : 0;
+}
+
+LatencyPercentiles LatencyTracer::GetStep(TraceStage stage) const {
+    const size_t to = static_cast<size_t>(stage);
+    return to == 0 ? LatencyPercentiles{} : Percentiles(to - 1, to);
+}
+
+void LatencyTracer::Report(std::ostream& out) const {
+    auto line = [&](const char* name, const LatencyPercentiles& p) {
+        out << std::left << std::setw(14) << name << std::right
+            << " p50 " << std::setw(7) << p.p50 / 1000
+            << "us | p90 " << std::setw(7) << p.p90 / 1000
+            << "us | p99 " << std::setw(7) << p.p99 / 1000
+            << "us | max " << std::setw(7) << p.max / 1000 << "us\n";
+    };
+
+    out << "Latency over " << m_Count << " frames (clock offset " << m_Clock.GetOffset() / 1000
+        << "us, +-" << m_Clock.GetRoundTrip() / 2000 << "us)\n";
+    for (size_t i = 1; i < TRACE_STAGE_COUNT; ++i) {
+        const TraceStage stage = static_cast<TraceStage>(i);
+        line(TraceStageName(stage), GetStep(stage));
+    }
+    line("Glass-to-glass", GetTotal());
+    out << std::flush;
+}
+
+void LatencyTracer::Reset() {
+    m_Next = 0;
+    m_Count = 0;
+    m_Active = false;
+}
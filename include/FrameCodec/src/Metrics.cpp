@@ -0,0 +1,366 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    // Single writer per shard, so a load and a store are enough; no read-modify-write on the hot path
+    inline void Bump(std::atomic<uint64_t>& value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    uint32_t BucketOf(uint64_t value) {
+        return std::min<uint32_t>(static_cast<uint32_t>(std::bit_width(value)), HISTOGRAM_BUCKETS - 1);
+    }
+
+    uint64_t NowUnixMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    uint32_t ProcessId() {
+        #ifdef _WIN32
+        return GetCurrentProcessId();
+        #else
+        return static_cast<uint32_t>(getpid());
+        #endif
+    }
+
+    std::string SegmentName(const std::string& name) {
+        #ifdef _WIN32
+        return "Local\\" + name;
+        #else
+        return "/" + name;
+        #endif
+    }
+}
+
+uint64_t MetricSnapshot::Percentile(unsigned int percent) const {
+    if (count == 0) return 0;
+    const uint64_t rank = (count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return (1ULL << i) - 1;
+    }
+    return (1ULL << (HISTOGRAM_BUCKETS - 1)) - 1;
+}
+
+// MARK: MetricsRegistry
+struct MetricsRegistry::ShardLease {
+    Shard* shard = nullptr;
+    ~ShardLease() {
+        if (shard) MetricsRegistry::Instance().ReleaseShard(shard);
+    }
+};
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+uint32_t MetricsRegistry::Register(const std::string& name, MetricType type) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (uint32_t id = 0; id < m_Entries.size(); ++id) {
+        if (m_Entries[id].name == name) return m_Entries[id].type == type ? id : METRIC_NONE;
+    }
+    if (m_Entries.size() == MAX_METRICS || (type == MetricType::Histogram && m_HistogramCount == MAX_HISTOGRAMS)) {
+        std::cerr << "Metrics registry full; " << name << " is not recorded" << std::endl;
+        return METRIC_NONE;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(m_Entries.size());
+    const uint32_t histogram = type == MetricType::Histogram ? m_HistogramCount++ : METRIC_NONE;
+    m_HistogramSlots[id] = histogram;
+    m_Entries.push_back({ name, type, histogram });
+    return id;
+}
+
+MetricsRegistry::Shard& MetricsRegistry::LocalShard() {
+    thread_local ShardLease lease;
+    if (!lease.shard) lease.shard = AcquireShard();
+    return *lease.shard;
+}
+
+MetricsRegistry::Shard* MetricsRegistry::AcquireShard() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_FreeShards.empty()) {
+        Shard* shard = m_FreeShards.back();
+        m_FreeShards.pop_back();
+        return shard;
+    }
+    m_Shards.push_back(std::make_unique<Shard>());
+    return m_Shards.back().get();
+}
+
+void MetricsRegistry::ReleaseShard(Shard* shard) {
+    // Its totals stay in the sums; the next thread just keeps adding to them
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_FreeShards.push_back(shard);
+}
+
+void MetricsRegistry::Add(uint32_t id, uint64_t value) {
+    if (id >= MAX_METRICS) return;
+    Bump(LocalShard().values[id], value);
+}
+
+void MetricsRegistry::Set(uint32_t id, int64_t value) {
+    if (id >= MAX_METRICS) return;
+    m_Gauges[id].store(value, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::Record(uint32_t id, uint64_t value) {
+    if (id >= MAX_METRICS || m_HistogramSlots[id] >= MAX_HISTOGRAMS) return;
+    Shard& shard = LocalShard();
+    Bump(shard.values[id], value);
+    Bump(shard.buckets[m_HistogramSlots[id]][BucketOf(value)], 1);
+}
+
+std::vector<MetricSnapshot> MetricsRegistry::Snapshot() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<MetricSnapshot> snapshot(m_Entries.size());
+
+    for (uint32_t id = 0; id < m_Entries.size(); ++id) {
+        MetricSnapshot& metric = snapshot[id];
+        const Entry& entry = m_Entries[id];
+        metric.name = entry.name;
+        metric.type = entry.type;
+        if (entry.type == MetricType::Gauge) {
+            metric.value = m_Gauges[id].load(std::memory_order_relaxed);
+            continue;
+        }
+
+        uint64_t total = 0;
+        for (const auto& shard : m_Shards) {
+            total += shard->values[id].load(std::memory_order_relaxed);
+            if (entry.type != MetricType::Histogram) continue;
+            for (uint32_t b = 0; b < HISTOGRAM_BUCKETS; ++b) metric.buckets[b] += shard->buckets[entry.histogram][b].load(std::memory_order_relaxed);
+        }
+        if (entry.type == MetricType::Counter) {
+            metric.value = static_cast<int64_t>(total);
+        } else {
+            metric.sum = total;
+            for (uint64_t bucket : metric.buckets) metric.count += bucket;
+        }
+    }
+    return snapshot;
+}
+
+// MARK: MetricsExporter
+MetricsExporter::MetricsExporter(const std::string& name, const std::string& jsonPath, std::chrono::milliseconds period)
+    : m_Name(name), m_JsonPath(jsonPath), m_Period(period) {}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+bool MetricsExporter::MapSegment() {
+    #ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(SHARED_METRICS_SIZE), SegmentName(m_Name).c_str());
+    if (!mapping) {
+        std::cerr << "Failed to create metrics segment " << m_Name << ". Reason: " << GetLastError() << std::endl;
+        return false;
+    }
+    m_Segment = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, SHARED_METRICS_SIZE);
+    if (!m_Segment) {
+        CloseHandle(mapping);
+        std::cerr << "Failed to map metrics segment " << m_Name << ". Reason: " << GetLastError() << std::endl;
+        return false;
+    }
+    m_Mapping = mapping;
+    #else
+    const int fd = shm_open(SegmentName(m_Name).c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, SHARED_METRICS_SIZE) != 0) {
+        if (fd >= 0) close(fd);
+        std::cerr << "Failed to create metrics segment " << m_Name << std::endl;
+        return false;
+    }
+    void* segment = mmap(nullptr, SHARED_METRICS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        std::cerr << "Failed to map metrics segment " << m_Name << std::endl;
+        return false;
+    }
+    m_Segment = segment;
+    #endif
+
+    auto* header = static_cast<SharedMetricsHeader*>(m_Segment);
+    memset(m_Segment, 0, SHARED_METRICS_SIZE);
+    memcpy(header->magic, SHARED_METRICS_MAGIC, sizeof(header->magic));
+    header->version = SHARED_METRICS_VERSION;
+    header->processId = ProcessId();
+    header->periodMs = static_cast<uint32_t>(m_Period.count());
+    return true;
+}
+
+void MetricsExporter::UnmapSegment() {
+    if (!m_Segment) return;
+    #ifdef _WIN32
+    UnmapViewOfFile(m_Segment);
+    CloseHandle(static_cast<HANDLE>(m_Mapping));
+    #else
+    munmap(m_Segment, SHARED_METRICS_SIZE);
+    shm_unlink(SegmentName(m_Name).c_str());
+    #endif
+    m_Segment = nullptr;
+    m_Mapping = nullptr;
+}
+
+bool MetricsExporter::Start() {
+    if (m_Thread.joinable()) return true;
+    if (!MapSegment()) return false;
+
+    m_Stop = false;
+    m_Thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (!m_Wake.wait_for(lock, m_Period, [this]() { return m_Stop; })) {
+            lock.unlock();
+            Publish();
+            lock.lock();
+        }
+    });
+    return true;
+}
+
+void MetricsExporter::Stop() {
+    if (m_Thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+        m_Thread.join();
+        Publish();
+    }
+    UnmapSegment();
+}
+
+void MetricsExporter::Publish() {
+    const std::vector<MetricSnapshot> snapshot = MetricsRegistry::Instance().Snapshot();
+    const uint64_t publishTime = NowUnixMs();
+
+    if (m_Segment) {
+        auto* header = static_cast<SharedMetricsHeader*>(m_Segment);
+        auto* metrics = reinterpret_cast<SharedMetric*>(header + 1);
+        std::atomic_ref<uint64_t> sequence(header->sequence);
+
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->count = static_cast<uint32_t>(snapshot.size());
+        header->publishTime = publishTime;
+        for (size_t i = 0; i < snapshot.size(); ++i) {
+            const MetricSnapshot& metric = snapshot[i];
+            SharedMetric& shared = metrics[i];
+            memset(&shared, 0, sizeof(shared));
+            strncpy(shared.name, metric.name.c_str(), sizeof(shared.name) - 1);
+            shared.type = static_cast<uint8_t>(metric.type);
+            shared.value = metric.value;
+            shared.count = metric.count;
+            shared.sum = metric.sum;
+            shared.p50 = metric.Percentile(50);
+            shared.p90 = metric.Percentile(90);
+            shared.p99 = metric.Percentile(99);
+        }
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    if (!m_JsonPath.empty()) WriteJson(snapshot, publishTime);
+}
+
+void MetricsExporter::WriteJson(const std::vector<MetricSnapshot>& snapshot, uint64_t publishTime) {
+    // Written aside and renamed over the old file, so a scraper never reads half a snapshot
+    const std::string temporary = m_JsonPath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        out << "{\"time\": " << publishTime << ", \"pid\": " << ProcessId() << ", \"metrics\": {";
+        for (size_t i = 0; i < snapshot.size(); ++i) {
+            const MetricSnapshot& metric = snapshot[i];
+            out << (i ? ", " : "") << "\"" << metric.name << "\": ";
+            if (metric.type == MetricType::Histogram) {
+                out << "{\"count\": " << metric.count << ", \"sum\": " << metric.sum << ", \"p50\": " << metric.Percentile(50)
+                    << ", \"p90\": " << metric.Percentile(90) << ", \"p99\": " << metric.Percentile(99) << "}";
+            } else {
+                out << metric.value;
+            }
+        }
+        out << "}}\n";
+        if (!out) return;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, m_JsonPath, error);
+}
+
+// MARK: SharedMetricsReader
+SharedMetricsReader::~SharedMetricsReader() {
+    if (!m_Segment) return;
+    #ifdef _WIN32
+    UnmapViewOfFile(m_Segment);
+    CloseHandle(static_cast<HANDLE>(m_Mapping));
+    #else
+    munmap(const_cast<void*>(m_Segment), SHARED_METRICS_SIZE);
+    #endif
+}
+
+bool SharedMetricsReader::Open(const std::string& name) {
+    #ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, SegmentName(name).c_str());
+    if (!mapping) return false;
+    m_Segment = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, SHARED_METRICS_SIZE);
+    if (!m_Segment) {
+        CloseHandle(mapping);
+        return false;
+    }
+    m_Mapping = mapping;
+    #else
+    const int fd = shm_open(SegmentName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    void* segment = mmap(nullptr, SHARED_METRICS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) return false;
+    m_Segment = segment;
+    #endif
+    return true;
+}
+
+bool SharedMetricsReader::Read(SharedMetricsHeader& header, std::vector<SharedMetric>& metrics) const {
+    if (!m_Segment) return false;
+    auto* shared = static_cast<const SharedMetricsHeader*>(m_Segment);
+    std::atomic_ref<uint64_t> sequence(const_cast<uint64_t&>(shared->sequence));
+
+    for (unsigned int attempt = 0; attempt < 100; ++attempt) {
+        const uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        memcpy(&header, shared, sizeof(header));
+        const uint32_t count = std::min(header.count, MAX_METRICS);
+        metrics.resize(count);
+        memcpy(metrics.data(), shared + 1, count * sizeof(SharedMetric));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            return memcmp(header.magic, SHARED_METRICS_MAGIC, sizeof(header.magic)) == 0 && header.version == SHARED_METRICS_VERSION;
+        }
+    }
+    return false;
+}
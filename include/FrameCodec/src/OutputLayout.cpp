@@ -0,0 +1,68 @@
+#include "OutputLayout.hpp"
+
+#include <algorithm>
+#include <climits>
+
+using namespace FrameCodec;
+
+bool FrameCodec::IsValidOutputSet(const OutputSet& set) {
+    if (set.count == 0 || set.count > MAX_OUTPUTS) return false;
+    for (unsigned int i = 0; i < set.count; ++i) {
+        const OutputDesc& output = set.outputs[i];
+        if (output.width == 0 || output.height == 0 || output.refreshRate == 0) return false;
+    }
+    return true;
+}
+
+SessionMode FrameCodec::OutputMode(const SessionMode& session, const OutputDesc& output) {
+    SessionMode mode = session;
+    mode.width = output.width;
+    mode.height = output.height;
+    mode.refreshRate = output.refreshRate;
+    return mode;
+}
+
+static bool Overlaps(const OutputDesc& a, const OutputDesc& b) {
+    return a.left < b.left + b.width && b.left < a.left + a.width && a.top < b.top + b.height && b.top < a.top + a.height;
+}
+
+CanvasLayout FrameCodec::ChooseCanvasLayout(const OutputSet& set) {
+    for (unsigned int i = 0; i < set.count; ++i) {
+        for (unsigned int j = i + 1; j < set.count; ++j) {
+            if (Overlaps(set.outputs[i], set.outputs[j])) return CanvasLayout::Tile;
+        }
+    }
+    return OutputCanvas(set, CanvasLayout::Composite).Fits() ? CanvasLayout::Composite : CanvasLayout::Tile;
+}
+
+OutputCanvas::OutputCanvas(const OutputSet& set, CanvasLayout layout) : m_Layout(layout) {
+    m_Placements.resize(set.count);
+
+    if (layout == CanvasLayout::Tile) {
+        uint32_t x = 0;
+        for (unsigned int i = 0; i < set.count; ++i) {
+            const OutputDesc& output = set.outputs[i];
+            m_Placements[i] = { x, 0, output.width, output.height };
+            x += output.width;
+            m_Height = std::max<uint32_t>(m_Height, output.height);
+        }
+        m_Width = x;
+        return;
+    }
+
+    // Desktop coordinates may be negative left of or above the primary output
+    int64_t left = INT64_MAX, top = INT64_MAX, right = INT64_MIN, bottom = INT64_MIN;
+    for (unsigned int i = 0; i < set.count; ++i) {
+        const OutputDesc& output = set.outputs[i];
+        left = std::min<int64_t>(left, output.left);
+        top = std::min<int64_t>(top, output.top);
+        right = std::max<int64_t>(right, static_cast<int64_t>(output.left) + output.width);
+        bottom = std::max<int64_t>(bottom, static_cast<int64_t>(output.top) + output.height);
+    }
+    for (unsigned int i = 0; i < set.count; ++i) {
+        const OutputDesc& output = set.outputs[i];
+        m_Placements[i] = { static_cast<uint32_t>(output.left - left), static_cast<uint32_t>(output.top - top), output.width, output.height };
+    }
+    m_Width = static_cast<uint32_t>(right - left);
+    m_Height = static_cast<uint32_t>(bottom - top);
+}
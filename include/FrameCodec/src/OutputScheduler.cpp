@@ -0,0 +1,64 @@
+#include "OutputScheduler.hpp"
+
+#include "FrameHeader.hpp"
+
+#include <algorithm>
+
+using namespace FrameCodec;
+
+OutputScheduler::OutputScheduler(unsigned int count) : m_Count(std::min(count, MAX_OUTPUTS)) {
+    for (Output& output : m_Outputs) output.interval = 1000000000ULL / 60;
+}
+
+void OutputScheduler::SetRefreshRate(unsigned int output, uint16_t refreshRate) {
+    m_Outputs[output].interval = 1000000000ULL / std::max<uint16_t>(refreshRate, 1);
+}
+
+void OutputScheduler::MarkReady(unsigned int output, uint64_t time) {
+    uint64_t expected = 0;
+    m_Outputs[output].readySince.compare_exchange_strong(expected, time, std::memory_order_release, std::memory_order_relaxed);
+    m_Epoch.fetch_add(1, std::memory_order_release);
+    m_Epoch.notify_one();
+}
+
+int OutputScheduler::TakeNext(uint64_t now) {
+    int next = -1;
+    uint64_t earliest = UINT64_MAX;
+    for (unsigned int i = 0; i < m_Count; ++i) {
+        const uint64_t ready = m_Outputs[i].readySince.load(std::memory_order_acquire);
+        if (ready == 0) continue;
+        const uint64_t deadline = ready + m_Outputs[i].interval;
+        if (deadline < earliest) {
+            earliest = deadline;
+            next = static_cast<int>(i);
+        }
+    }
+    if (next < 0) return -1;
+
+    Output& output = m_Outputs[next];
+    output.readySince.store(0, std::memory_order_relaxed);
+    output.sent.fetch_add(1, std::memory_order_relaxed);
+    if (now > earliest) output.late.fetch_add(1, std::memory_order_relaxed);
+    return next;
+}
+
+int OutputScheduler::WaitNext() {
+    while (true) {
+        const uint32_t epoch = m_Epoch.load(std::memory_order_acquire);
+        const int next = TakeNext(FrameClockNow());
+        if (next >= 0) return next;
+        if (m_Closed.load(std::memory_order_acquire)) return -1;
+        m_Epoch.wait(epoch, std::memory_order_acquire);
+    }
+}
+
+void OutputScheduler::Close() {
+    m_Closed.store(true, std::memory_order_release);
+    m_Epoch.fetch_add(1, std::memory_order_release);
+    m_Epoch.notify_all();
+}
+
+void OutputScheduler::Reopen() {
+    for (Output& output : m_Outputs) output.readySince.store(0, std::memory_order_relaxed);
+    m_Closed.store(false, std::memory_order_release);
+}
@@ -0,0 +1,25 @@
+#include "PullProtocol.hpp"
+
+#include <atomic>
+
+using namespace FrameCodec;
+
+PullPublisher::PullPublisher(PullControl* control) : m_Control(control) {}
+
+uint32_t PullPublisher::BeginSlot() {
+    uint32_t slot = 0;
+    while (slot == m_Newest || slot == m_Previous) slot++;
+
+    // The fence keeps the pixels written next from landing before the seqlock says "being rewritten"
+    std::atomic_ref<uint64_t>(m_Control->slotSequence[slot]).store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return slot;
+}
+
+void PullPublisher::Publish(uint32_t slot, uint64_t sequence) {
+    std::atomic_ref<uint64_t>(m_Control->slotSequence[slot]).store(sequence, std::memory_order_release);
+    std::atomic_ref<uint64_t>(m_Control->latest).store(PackLatest(sequence, slot), std::memory_order_release);
+
+    m_Previous = m_Newest;
+    m_Newest = slot;
+}
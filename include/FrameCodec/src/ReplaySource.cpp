@@ -0,0 +1,55 @@
+#include "ReplaySource.hpp"
+
+#include "FrameHeader.hpp"
+
+#include <iostream>
+
+using namespace FrameCodec;
+
+ReplaySource::ReplaySource(uint16_t width, uint16_t height, uint16_t refreshRate, bool paced, bool loop)
+    : m_Width(width), m_Height(height), m_RefreshRate(refreshRate), m_Loop(loop), m_Pacer(refreshRate, paced),
+      m_Pixels(static_cast<size_t>(width) * height * 4) {}
+
+bool ReplaySource::Open(const std::string& path) {
+    m_File.open(path, std::ios::binary | std::ios::ate);
+    if (!m_File) {
+        std::cerr << "Failed to open recording " << path << std::endl;
+        return false;
+    }
+
+    const uint64_t size = static_cast<uint64_t>(m_File.tellg());
+    m_FrameCount = m_Pixels.empty() ? 0 : size / m_Pixels.size();
+    if (m_FrameCount == 0) {
+        std::cerr << "Recording " << path << " holds no " << m_Width << "x" << m_Height << " frame" << std::endl;
+        return false;
+    }
+    if (size % m_Pixels.size() != 0) {
+        std::cerr << "Recording " << path << " ends in a partial frame; it will be skipped" << std::endl;
+    }
+
+    m_File.seekg(0);
+    m_Next = 0;
+    return true;
+}
+
+AcquireResult ReplaySource::Acquire(unsigned long timeoutMs, SourceFrame& frame) {
+    if (m_FrameCount == 0) return AcquireResult::Failed;
+    if (m_Next == m_FrameCount) {
+        if (!m_Loop) return AcquireResult::Failed;
+        m_File.clear();
+        m_File.seekg(0);
+        m_Next = 0;
+    }
+    if (!m_Pacer.WaitUntilDue(timeoutMs)) return AcquireResult::Timeout;
+
+    if (!m_File.read(reinterpret_cast<char*>(m_Pixels.data()), static_cast<std::streamsize>(m_Pixels.size()))) {
+        std::cerr << "Failed to read frame " << m_Next << " of the recording" << std::endl;
+        return AcquireResult::Failed;
+    }
+    m_Next++;
+
+    frame.pixels = m_Pixels.data();
+    frame.pitch = static_cast<size_t>(m_Width) * 4;
+    frame.captureTime = FrameClockNow();
+    return AcquireResult::Frame;
+}
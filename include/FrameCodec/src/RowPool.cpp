@@ -0,0 +1,67 @@
+#include "RowPool.hpp"
+
+#include <algorithm>
+
+using namespace FrameCodec;
+
+RowPool::RowPool(unsigned int threads) : m_Cores(std::max(1u, std::thread::hardware_concurrency())) {
+    if (threads == 0) threads = std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_THREADS));
+    threads = std::min(threads, MAX_THREADS);
+    for (unsigned int i = 1; i < threads; ++i) m_Workers.emplace_back(&RowPool::WorkerLoop, this, i);
+}
+
+RowPool::~RowPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Start.notify_all();
+    for (std::thread& worker : m_Workers) worker.join();
+}
+
+void RowPool::Dispatch(unsigned int count, unsigned int grain, unsigned int shares, Share share, const void* context) {
+    if (m_Workers.empty() || shares <= 1) {
+        share(context, 0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Count = count;
+        m_Grain = grain;
+        m_Shares = shares;
+        m_Share = share;
+        m_Context = context;
+        m_Pending = static_cast<unsigned int>(m_Workers.size());
+        m_Generation++;
+    }
+    m_Start.notify_all();
+    RunShare(0);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Done.wait(lock, [this]() { return m_Pending == 0; });
+}
+
+void RowPool::WorkerLoop(unsigned int index) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_Start.wait(lock, [this, seen]() { return m_Stop || m_Generation != seen; });
+        if (m_Stop) return;
+        seen = m_Generation;
+
+        lock.unlock();
+        RunShare(index);
+        lock.lock();
+        if (--m_Pending == 0) m_Done.notify_one();
+    }
+}
+
+void RowPool::RunShare(unsigned int index) const {
+    // Whole grains per share; the fields are only written while every worker waits
+    if (index >= m_Shares) return;
+    const unsigned int grains = (m_Count + m_Grain - 1) / m_Grain;
+    const unsigned int begin = m_Grain * (grains * index / m_Shares);
+    const unsigned int end = std::min(m_Grain * (grains * (index + 1) / m_Shares), m_Count);
+    if (begin < end) m_Share(m_Context, begin, end);
+}
@@ -0,0 +1,240 @@
+#include "ScrollDetector.hpp"
+#include "FrameHash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace FrameCodec;
+
+void FrameCodec::ApplyCopyRect(uint8_t* frame, size_t pitch, const CopyRect& rect) {
+    const size_t rowBytes = static_cast<size_t>(rect.width) * BYTES_PER_PIXEL;
+    uint8_t* src = frame + rect.srcY * pitch + rect.srcX * BYTES_PER_PIXEL;
+    uint8_t* dst = frame + rect.dstY * pitch + rect.dstX * BYTES_PER_PIXEL;
+
+    // Walk against the direction of the move so overlapping rows are read before they are overwritten
+    if (rect.dstY > rect.srcY) {
+        for (unsigned int y = rect.height; y > 0; --y) {
+            memmove(dst + (y - 1) * pitch, src + (y - 1) * pitch, rowBytes);
+        }
+    } else {
+        for (unsigned int y = 0; y < rect.height; ++y) {
+            memmove(dst + y * pitch, src + y * pitch, rowBytes);
+        }
+    }
+}
+
+ScrollDetector::ScrollDetector(unsigned short width, unsigned short height) :
+    m_Width(width), m_Height(height),
+    m_Strips((width + SCROLL_STRIP_WIDTH - 1) / SCROLL_STRIP_WIDTH),
+    m_Bands((height + SCROLL_BAND_HEIGHT - 1) / SCROLL_BAND_HEIGHT),
+    m_MaxShift(std::max(width, height))
+{
+    size_t tableSize = 1;
+    while (tableSize < 2 * static_cast<size_t>(std::max(width, height))) tableSize <<= 1;
+
+    m_TableKeys.resize(tableSize);
+    m_TableValues.resize(tableSize);
+}
+
+void ScrollDetector::HashRows(const uint8_t* frame, size_t pitch, std::vector<uint64_t>& hashes) const {
+    hashes.resize(static_cast<size_t>(m_Strips) * m_Height);
+
+    for (unsigned int y = 0; y < m_Height; ++y) {
+        const uint8_t* row = frame + y * pitch;
+        for (unsigned int s = 0; s < m_Strips; ++s) {
+            const unsigned int x0 = s * SCROLL_STRIP_WIDTH;
+            const unsigned int columns = std::min(SCROLL_STRIP_WIDTH, m_Width - x0);
+            hashes[static_cast<size_t>(s) * m_Height + y] = HashBytes(row + x0 * BYTES_PER_PIXEL, columns * BYTES_PER_PIXEL);
+        }
+    }
+}
+
+void ScrollDetector::HashColumns(const uint8_t* frame, size_t pitch, std::vector<uint64_t>& hashes) const {
+    hashes.resize(static_cast<size_t>(m_Bands) * m_Width);
+
+    for (unsigned int b = 0; b < m_Bands; ++b) {
+        uint64_t* column = hashes.data() + static_cast<size_t>(b) * m_Width;
+        std::fill(column, column + m_Width, HASH_PRIME3);
+
+        const unsigned int y0 = b * SCROLL_BAND_HEIGHT;
+        const unsigned int y1 = std::min<unsigned int>(m_Height, y0 + SCROLL_BAND_HEIGHT);
+
+        // Row-major walk keeps the reads sequential; each column accumulates its own hash
+        for (unsigned int y = y0; y < y1; ++y) {
+            const uint8_t* row = frame + y * pitch;
+            for (unsigned int x = 0; x < m_Width; ++x) {
+                uint32_t pixel;
+                memcpy(&pixel, row + x * BYTES_PER_PIXEL, sizeof(pixel));
+                column[x] = HashRound(column[x], pixel);
+            }
+        }
+
+        for (unsigned int x = 0; x < m_Width; ++x) {
+            column[x] = HashAvalanche(column[x]);
+        }
+    }
+}
+
+bool ScrollDetector::FindShift(const uint64_t* previous, const uint64_t* current, unsigned int count, Shift& shift) {
+    constexpr int EMPTY = -1;
+    constexpr int AMBIGUOUS = -2;
+
+    const size_t mask = m_TableKeys.size() - 1;
+    std::fill(m_TableValues.begin(), m_TableValues.end(), EMPTY);
+
+    // Index the previous hashes. Repeated content (blank rows, gradients) cannot vote.
+    for (unsigned int i = 0; i < count; ++i) {
+        size_t slot = previous[i] & mask;
+        while (m_TableValues[slot] != EMPTY && m_TableKeys[slot] != previous[i]) slot = (slot + 1) & mask;
+
+        if (m_TableValues[slot] == EMPTY) {
+            m_TableKeys[slot] = previous[i];
+            m_TableValues[slot] = static_cast<int>(i);
+        } else {
+            m_TableValues[slot] = AMBIGUOUS;
+        }
+    }
+
+    const int maxShift = static_cast<int>(std::min(m_MaxShift, count));
+    m_Votes.assign(2 * maxShift + 1, 0);
+
+    for (unsigned int i = 0; i < count; ++i) {
+        if (current[i] == previous[i]) continue;
+
+        size_t slot = current[i] & mask;
+        while (m_TableValues[slot] != EMPTY && m_TableKeys[slot] != current[i]) slot = (slot + 1) & mask;
+        if (m_TableValues[slot] < 0) continue;
+
+        int offset = static_cast<int>(i) - m_TableValues[slot];
+        if (offset == 0 || offset > maxShift || offset < -maxShift) continue;
+        m_Votes[offset + maxShift]++;
+    }
+
+    auto best = std::max_element(m_Votes.begin(), m_Votes.end());
+    if (*best < SCROLL_MIN_VOTES) return false;
+
+    const int offset = static_cast<int>(best - m_Votes.begin()) - maxShift;
+
+    // Pick the matching run that explains the most changes; runs of unchanged content are free riders
+    const unsigned int first = static_cast<unsigned int>(std::max(0, offset));
+    const unsigned int last = static_cast<unsigned int>(std::min<int>(count, static_cast<int>(count) + offset));
+
+    unsigned int bestBegin = 0, bestEnd = 0, bestChanged = 0;
+    unsigned int runBegin = first, runChanged = 0;
+
+    for (unsigned int i = first; i <= last; ++i) {
+        bool match = i < last && current[i] == previous[i - offset];
+        if (match) {
+            if (current[i] != previous[i]) runChanged++;
+            continue;
+        }
+
+        if (runChanged > bestChanged || (runChanged == bestChanged && i - runBegin > bestEnd - bestBegin)) {
+            bestBegin = runBegin;
+            bestEnd = i;
+            bestChanged = runChanged;
+        }
+        runBegin = i + 1;
+        runChanged = 0;
+    }
+
+    if (bestChanged < SCROLL_MIN_VOTES || bestEnd - bestBegin < SCROLL_MIN_RUN) return false;
+
+    shift = { offset, bestBegin, bestEnd };
+    return true;
+}
+
+size_t ScrollDetector::DetectVertical(std::vector<CopyRect>& rects) {
+    std::vector<Shift> shifts(m_Strips);
+    std::vector<bool> found(m_Strips);
+
+    for (unsigned int s = 0; s < m_Strips; ++s) {
+        const size_t base = static_cast<size_t>(s) * m_Height;
+        found[s] = FindShift(m_PrevHashes.data() + base, m_CurHashes.data() + base, m_Height, shifts[s]);
+    }
+
+    // Neighbouring strips that moved the same run by the same amount become one rect.
+    // Runs must match exactly: shrinking to the overlap would let a moving scrollbar thumb cut into the page.
+    size_t appended = 0;
+    unsigned int s = 0;
+    while (s < m_Strips) {
+        if (!found[s]) { s++; continue; }
+
+        const Shift& group = shifts[s];
+        unsigned int last = s;
+        while (last + 1 < m_Strips && found[last + 1] && SameShift(group, shifts[last + 1])) last++;
+
+        const unsigned int x0 = s * SCROLL_STRIP_WIDTH;
+        const unsigned int x1 = std::min<unsigned int>(m_Width, (last + 1) * SCROLL_STRIP_WIDTH);
+
+        rects.push_back({
+            static_cast<uint16_t>(x0),
+            static_cast<uint16_t>(static_cast<int>(group.begin) - group.offset),
+            static_cast<uint16_t>(x0),
+            static_cast<uint16_t>(group.begin),
+            static_cast<uint16_t>(x1 - x0),
+            static_cast<uint16_t>(group.end - group.begin)
+        });
+        appended++;
+
+        s = last + 1;
+    }
+
+    return appended;
+}
+
+size_t ScrollDetector::DetectHorizontal(const uint8_t* previous, const uint8_t* current, size_t pitch, std::vector<CopyRect>& rects) {
+    HashColumns(previous, pitch, m_PrevHashes);
+    HashColumns(current, pitch, m_CurHashes);
+
+    std::vector<Shift> shifts(m_Bands);
+    std::vector<bool> found(m_Bands);
+
+    for (unsigned int b = 0; b < m_Bands; ++b) {
+        const size_t base = static_cast<size_t>(b) * m_Width;
+        found[b] = FindShift(m_PrevHashes.data() + base, m_CurHashes.data() + base, m_Width, shifts[b]);
+    }
+
+    size_t appended = 0;
+    unsigned int b = 0;
+    while (b < m_Bands) {
+        if (!found[b]) { b++; continue; }
+
+        const Shift& group = shifts[b];
+        unsigned int last = b;
+        while (last + 1 < m_Bands && found[last + 1] && SameShift(group, shifts[last + 1])) last++;
+
+        const unsigned int y0 = b * SCROLL_BAND_HEIGHT;
+        const unsigned int y1 = std::min<unsigned int>(m_Height, (last + 1) * SCROLL_BAND_HEIGHT);
+
+        rects.push_back({
+            static_cast<uint16_t>(static_cast<int>(group.begin) - group.offset),
+            static_cast<uint16_t>(y0),
+            static_cast<uint16_t>(group.begin),
+            static_cast<uint16_t>(y0),
+            static_cast<uint16_t>(group.end - group.begin),
+            static_cast<uint16_t>(y1 - y0)
+        });
+        appended++;
+
+        b = last + 1;
+    }
+
+    return appended;
+}
+
+size_t ScrollDetector::Detect(const uint8_t* previous, const uint8_t* current, size_t pitch, std::vector<CopyRect>& rects) {
+    if (m_Width == 0 || m_Height == 0) return 0;
+
+    HashRows(previous, pitch, m_PrevHashes);
+    HashRows(current, pitch, m_CurHashes);
+
+    if (m_PrevHashes == m_CurHashes) return 0; // Nothing changed, nothing moved
+
+    size_t appended = DetectVertical(rects);
+    if (appended == 0 && m_Horizontal) {
+        appended = DetectHorizontal(previous, current, pitch, rects);
+    }
+
+    return appended;
+}
@@ -0,0 +1,36 @@
+#include "SessionMode.hpp"
+
+#include "BandLayout.hpp"
+#include "ColorSpace.hpp"
+#include "PullProtocol.hpp"
+#include "TileDelta.hpp"
+
+using namespace FrameCodec;
+
+bool FrameCodec::IsValidSessionMode(const SessionMode& mode) {
+    if (mode.width == 0 || mode.height == 0 || mode.refreshRate == 0) return false;
+    if (mode.format > 0xFF || mode.pull > 1 || mode.colorSpace >= COLOR_SPACE_COUNT) return false;
+    const PixelFormat format = static_cast<PixelFormat>(mode.format);
+    if (format != PixelFormat::BGRA32 && format != PixelFormat::BGRALossless && !IsPlanarYuv(format)) return false;
+    if (format == PixelFormat::BGRALossless && mode.pull) return false; // Its tiles are deltas, which pulled frames can't be
+    if (IsPlanarYuv(format) && (mode.bandCount == 0 || mode.bandCount > MAX_BANDS)) return false;
+    return true;
+}
+
+size_t FrameCodec::MaxFramePayload(const SessionMode& mode) {
+    const size_t pixels = static_cast<size_t>(mode.width) * mode.height;
+    const PixelFormat format = static_cast<PixelFormat>(mode.format);
+    if (IsPlanarYuv(format)) return PlanarFrameSize(format, mode.width, mode.height); // Y, then UV
+    if (mode.pull) return pixels * 4; // Whole frames; the receiver may skip any of them
+    return MaxDeltaSize(mode.width, mode.height, format == PixelFormat::BGRALossless);
+}
+
+size_t FrameCodec::ReceiverBufferSize(const SessionMode& mode) {
+    return FrameSlotSize(MaxFramePayload(mode));
+}
+
+size_t FrameCodec::SenderBufferSize(const SessionMode& mode) {
+    const size_t slot = FrameSlotSize(MaxFramePayload(mode));
+    if (mode.pull) return PullBufferSize(slot);
+    return slot * 2 + MAX_BANDS * sizeof(FrameSignal);
+}
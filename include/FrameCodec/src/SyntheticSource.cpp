@@ -0,0 +1,179 @@
+#include "SyntheticSource.hpp"
+
+#include "FrameHeader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace FrameCodec;
+
+namespace {
+    constexpr unsigned int CHANNELS = 4;
+    constexpr unsigned int GLYPH_WIDTH = 8;
+    constexpr unsigned int GLYPH_HEIGHT = 12;
+    constexpr unsigned int GLYPH_COUNT = 95;    // Printable ASCII
+    constexpr unsigned int POINTER_SIZE = 16;
+    constexpr uint32_t PAPER = 0xFFFAFAFA;
+    constexpr uint32_t INK = 0xFF202020;
+
+    // Eight columns of one glyph row; the same glyph always looks the same
+    uint8_t GlyphBits(uint8_t glyph, unsigned int row) {
+        uint32_t h = (static_cast<uint32_t>(glyph) + 1) * 0x9E3779B1u ^ (row + 1) * 0x85EBCA77u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        return static_cast<uint8_t>(h) & 0x7E; // Leave the side columns empty, like letter spacing
+    }
+}
+
+const char* FrameCodec::SyntheticContentName(SyntheticContent content) {
+    switch (content) {
+        case SyntheticContent::StaticDesktop: return "static";
+        case SyntheticContent::ScrollingText: return "scroll";
+        case SyntheticContent::VideoNoise: return "video";
+        case SyntheticContent::CursorOnly: return "cursor";
+    }
+    return "?";
+}
+
+SyntheticSource::SyntheticSource(uint16_t width, uint16_t height, uint16_t refreshRate, SyntheticContent content, uint32_t seed, bool paced)
+    : m_Width(width), m_Height(height), m_RefreshRate(refreshRate), m_Content(content), m_Pacer(refreshRate, paced),
+      m_State(seed ? seed : 1), m_Pixels(static_cast<size_t>(width) * height * CHANNELS) {
+    DrawDesktop();
+
+    if (m_Content == SyntheticContent::CursorOnly) {
+        m_Pointer.visible = true;
+        m_Pointer.shapeId = 1;
+        m_Pointer.width = m_Pointer.height = POINTER_SIZE;
+        m_Pointer.pixels.assign(POINTER_SIZE * POINTER_SIZE * CHANNELS, 0);
+        // A filled triangle, white with a black edge
+        for (unsigned int y = 0; y < POINTER_SIZE; ++y) {
+            for (unsigned int x = 0; x <= y; ++x) {
+                const uint32_t color = (x == 0 || x == y || y == POINTER_SIZE - 1) ? 0xFF000000 : 0xFFFFFFFF;
+                memcpy(&m_Pointer.pixels[(y * POINTER_SIZE + x) * CHANNELS], &color, CHANNELS);
+            }
+        }
+    }
+}
+
+uint32_t SyntheticSource::Random() {
+    // xorshift32: cheap enough to fill a 4K rectangle every frame
+    m_State ^= m_State << 13;
+    m_State ^= m_State >> 17;
+    m_State ^= m_State << 5;
+    return m_State;
+}
+
+void SyntheticSource::FillRect(unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t color) {
+    x = std::min<unsigned int>(x, m_Width);
+    y = std::min<unsigned int>(y, m_Height);
+    width = std::min<unsigned int>(width, m_Width - x);
+    height = std::min<unsigned int>(height, m_Height - y);
+    for (unsigned int row = y; row < y + height; ++row) {
+        uint32_t* dst = reinterpret_cast<uint32_t*>(m_Pixels.data()) + static_cast<size_t>(row) * m_Width + x;
+        std::fill(dst, dst + width, color);
+    }
+}
+
+void SyntheticSource::DrawDesktop() {
+    // Wallpaper gradient, a few windows with title bars, and a taskbar
+    for (unsigned int y = 0; y < m_Height; ++y) {
+        const uint32_t shade = 0x40 + y * 0x60 / std::max<unsigned int>(m_Height, 1);
+        FillRect(0, y, m_Width, 1, 0xFF000000 | (shade / 2) << 16 | (shade * 3 / 4) << 8 | shade);
+    }
+    for (unsigned int i = 0; i < 4; ++i) {
+        const unsigned int width = m_Width / 4 + Random() % (m_Width / 3 + 1);
+        const unsigned int height = m_Height / 4 + Random() % (m_Height / 3 + 1);
+        const unsigned int x = Random() % (m_Width - std::min<unsigned int>(width, m_Width) + 1);
+        const unsigned int y = Random() % (m_Height - std::min<unsigned int>(height, m_Height) + 1);
+        FillRect(x, y, width, height, 0xFFF0F0F0);
+        FillRect(x, y, width, 30, 0xFF000000 | (Random() & 0x7F7F7F));
+    }
+    FillRect(0, m_Height - std::min<unsigned int>(m_Height, 40), m_Width, 40, 0xFF303030);
+
+    if (m_Content == SyntheticContent::ScrollingText) {
+        // One window covers most of the desktop; its text scrolls
+        m_TextLeft = m_Width / 8;
+        m_TextWidth = m_Width * 3 / 4;
+        FillRect(m_TextLeft, 0, m_TextWidth, m_Height, PAPER);
+        NextLine();
+    }
+}
+
+void SyntheticSource::NextLine() {
+    // Ragged lines of words, some empty, like source code
+    m_Line.assign(m_TextWidth / GLYPH_WIDTH, 0);
+    const size_t length = (Random() % 5 == 0) ? 0 : Random() % (m_Line.size() + 1);
+    for (size_t i = 0; i < length; ++i) m_Line[i] = (Random() % 6 == 0) ? 0 : static_cast<uint8_t>(1 + Random() % GLYPH_COUNT);
+    m_LineRow = 0;
+}
+
+void SyntheticSource::DrawTextRow(unsigned int y) {
+    uint32_t* dst = reinterpret_cast<uint32_t*>(m_Pixels.data()) + static_cast<size_t>(y) * m_Width + m_TextLeft;
+    std::fill(dst, dst + m_TextWidth, PAPER);
+
+    const unsigned int glyphRow = m_LineRow - (LINE_HEIGHT - GLYPH_HEIGHT) / 2;
+    if (m_LineRow < (LINE_HEIGHT - GLYPH_HEIGHT) / 2 || glyphRow >= GLYPH_HEIGHT) return;
+    for (size_t i = 0; i < m_Line.size(); ++i) {
+        if (m_Line[i] == 0) continue;
+        const uint8_t bits = GlyphBits(m_Line[i], glyphRow);
+        for (unsigned int x = 0; x < GLYPH_WIDTH; ++x) {
+            if (bits & (0x80 >> x)) dst[i * GLYPH_WIDTH + x] = INK;
+        }
+    }
+}
+
+void SyntheticSource::MovePointer() {
+    // Around the centre, a full turn every two seconds
+    const double angle = static_cast<double>(m_Frames) * 3.14159265358979 / std::max<uint16_t>(m_RefreshRate, 1);
+    const double radius = std::min(m_Width, m_Height) / 4.0;
+    m_Pointer.x = static_cast<int32_t>(m_Width / 2 + radius * std::cos(angle));
+    m_Pointer.y = static_cast<int32_t>(m_Height / 2 + radius * std::sin(angle));
+    if (m_PointerCallback) m_PointerCallback(m_Pointer);
+}
+
+AcquireResult SyntheticSource::Acquire(unsigned long timeoutMs, SourceFrame& frame) {
+    if (m_Width == 0 || m_Height == 0) return AcquireResult::Failed;
+    if (!m_Pacer.WaitUntilDue(timeoutMs)) return AcquireResult::Timeout;
+
+    if (m_Frames > 0) {
+        switch (m_Content) {
+            case SyntheticContent::StaticDesktop:
+                return AcquireResult::Timeout;
+            case SyntheticContent::CursorOnly:
+                m_Frames++;
+                MovePointer();
+                return AcquireResult::Unchanged;
+            case SyntheticContent::ScrollingText: {
+                // Move the text area up and draw the next rows of the current line in at the bottom
+                const size_t pitch = static_cast<size_t>(m_Width) * CHANNELS;
+                const unsigned int step = std::min<unsigned int>(SCROLL_STEP, m_Height);
+                for (unsigned int y = 0; y + step < m_Height; ++y) {
+                    memcpy(m_Pixels.data() + y * pitch + m_TextLeft * CHANNELS, m_Pixels.data() + (y + step) * pitch + m_TextLeft * CHANNELS,
+                           static_cast<size_t>(m_TextWidth) * CHANNELS);
+                }
+                for (unsigned int y = m_Height - step; y < m_Height; ++y) {
+                    DrawTextRow(y);
+                    if (++m_LineRow == LINE_HEIGHT) NextLine();
+                }
+                break;
+            }
+            case SyntheticContent::VideoNoise: {
+                const unsigned int width = m_Width / 2;
+                const unsigned int height = m_Height / 2;
+                for (unsigned int y = m_Height / 4; y < m_Height / 4 + height; ++y) {
+                    uint32_t* dst = reinterpret_cast<uint32_t*>(m_Pixels.data()) + static_cast<size_t>(y) * m_Width + m_Width / 4;
+                    for (unsigned int x = 0; x < width; ++x) dst[x] = Random() | 0xFF000000;
+                }
+                break;
+            }
+        }
+    }
+
+    m_Frames++;
+    frame.pixels = m_Pixels.data();
+    frame.pitch = static_cast<size_t>(m_Width) * CHANNELS;
+    frame.captureTime = FrameClockNow();
+    return AcquireResult::Frame;
+}
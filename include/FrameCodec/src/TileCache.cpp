@@ -0,0 +1,94 @@
+#include "TileCache.hpp"
+#include "TileDelta.hpp"
+
+#include <cstring>
+
+using namespace FrameCodec;
+
+constexpr size_t TILE_SLOT_PITCH = TILE_SIZE * BYTES_PER_PIXEL;
+constexpr size_t TILE_SLOT_BYTES = TILE_SLOT_PITCH * TILE_SIZE;
+
+// MARK: TileCacheIndex
+TileCacheIndex::TileCacheIndex(uint32_t capacity) :
+    m_Capacity(capacity), m_Prev(capacity), m_Next(capacity), m_Hashes(capacity)
+{
+    m_Slots.reserve(capacity);
+}
+
+void TileCacheIndex::Unlink(uint32_t slot) {
+    uint32_t prev = m_Prev[slot];
+    uint32_t next = m_Next[slot];
+
+    if (prev != TILE_CACHE_NONE) m_Next[prev] = next;
+    else m_Head = next;
+
+    if (next != TILE_CACHE_NONE) m_Prev[next] = prev;
+    else m_Tail = prev;
+}
+
+void TileCacheIndex::PushFront(uint32_t slot) {
+    m_Prev[slot] = TILE_CACHE_NONE;
+    m_Next[slot] = m_Head;
+
+    if (m_Head != TILE_CACHE_NONE) m_Prev[m_Head] = slot;
+    m_Head = slot;
+
+    if (m_Tail == TILE_CACHE_NONE) m_Tail = slot;
+}
+
+uint32_t TileCacheIndex::Find(uint64_t hash) {
+    auto it = m_Slots.find(hash);
+    if (it == m_Slots.end()) return TILE_CACHE_NONE;
+
+    uint32_t slot = it->second;
+    if (slot != m_Head) {
+        Unlink(slot);
+        PushFront(slot);
+    }
+    return slot;
+}
+
+uint32_t TileCacheIndex::Insert(uint64_t hash) {
+    if (m_Capacity == 0) return TILE_CACHE_NONE;
+
+    uint32_t slot;
+    if (m_Used < m_Capacity) {
+        slot = m_Used++;
+    } else {
+        slot = m_Tail;
+        Unlink(slot);
+        m_Slots.erase(m_Hashes[slot]);
+    }
+
+    m_Hashes[slot] = hash;
+    m_Slots[hash] = slot;
+    PushFront(slot);
+    return slot;
+}
+
+// MARK: TileCache
+TileCache::TileCache(uint32_t capacity) :
+    m_Capacity(capacity), m_Storage(static_cast<size_t>(capacity) * TILE_SLOT_BYTES)
+{}
+
+void TileCache::Store(uint32_t slot, const uint8_t* src, size_t pitch, size_t rowBytes, unsigned int rows) {
+    uint8_t* dst = m_Storage.data() + slot * TILE_SLOT_BYTES;
+    for (unsigned int y = 0; y < rows; ++y) {
+        memcpy(dst + y * TILE_SLOT_PITCH, src + y * pitch, rowBytes);
+    }
+}
+
+void TileCache::Load(uint32_t slot, uint8_t* dst, size_t pitch, size_t rowBytes, unsigned int rows) const {
+    const uint8_t* src = m_Storage.data() + slot * TILE_SLOT_BYTES;
+    for (unsigned int y = 0; y < rows; ++y) {
+        memcpy(dst + y * pitch, src + y * TILE_SLOT_PITCH, rowBytes);
+    }
+}
+
+bool TileCache::Matches(uint32_t slot, const uint8_t* src, size_t pitch, size_t rowBytes, unsigned int rows) const {
+    const uint8_t* cached = m_Storage.data() + slot * TILE_SLOT_BYTES;
+    for (unsigned int y = 0; y < rows; ++y) {
+        if (memcmp(cached + y * TILE_SLOT_PITCH, src + y * pitch, rowBytes) != 0) return false;
+    }
+    return true;
+}
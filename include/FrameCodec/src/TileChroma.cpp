@@ -0,0 +1,9 @@
+#include "TileChroma.hpp"
+
+using namespace FrameCodec;
+
+TileChroma FrameCodec::PickTileChroma(const TileStats& stats, unsigned int pixels) {
+    if (!stats.edgesH && !stats.edgesV) return TileChroma::Quarter;
+    if (stats.changes * 2 > pixels) return TileChroma::Quarter;
+    return stats.edgesV ? TileChroma::Full : TileChroma::Half;
+}
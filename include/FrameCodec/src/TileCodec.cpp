@@ -0,0 +1,223 @@
+#include "TileCodec.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+// Built at the baseline ISA, since the viewer decodes these tiles: the scans use SSE2, which every x86-64 CPU has,
+// and AVX2 only where the whole build targets it
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LOSSLESS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOSSLESS_SSE2 1
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    // The tile in scan order behind a row of zeros, which is what "up" and "left" see above the first row
+    thread_local std::vector<uint32_t> t_Pixels;
+
+    uint32_t* PixelScratch(unsigned int width, unsigned int rows) {
+        const size_t size = static_cast<size_t>(width) * (rows + 1);
+        if (t_Pixels.size() < size) t_Pixels.resize(size);
+        std::fill_n(t_Pixels.begin(), width, 0u);
+        return t_Pixels.data() + width;
+    }
+
+    // How many of the `count` pixels at `p` equal `value`, counting from the first
+    size_t RepeatLength(const uint32_t* p, size_t count, uint32_t value) {
+        size_t i = 0;
+#if defined(LOSSLESS_AVX2)
+        const __m256i repeated = _mm256_set1_epi32(static_cast<int>(value));
+        for (; i + 8 <= count; i += 8) {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const unsigned int differs = ~static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(pixels, repeated)))) & 0xFF;
+            if (differs) return i + std::countr_zero(differs);
+        }
+#endif
+#if defined(LOSSLESS_SSE2)
+        const __m128i repeated4 = _mm_set1_epi32(static_cast<int>(value));
+        for (; i + 4 <= count; i += 4) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const unsigned int differs = ~static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(pixels, repeated4)))) & 0xF;
+            if (differs) return i + std::countr_zero(differs);
+        }
+#endif
+        while (i < count && p[i] == value) ++i;
+        return i;
+    }
+
+    // How many of the `count` pixels at `p` equal the ones at `q`, counting from the first
+    size_t MatchLength(const uint32_t* p, const uint32_t* q, size_t count) {
+        size_t i = 0;
+#if defined(LOSSLESS_AVX2)
+        for (; i + 8 <= count; i += 8) {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const __m256i other = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + i));
+            const unsigned int differs = ~static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(pixels, other)))) & 0xFF;
+            if (differs) return i + std::countr_zero(differs);
+        }
+#endif
+#if defined(LOSSLESS_SSE2)
+        for (; i + 4 <= count; i += 4) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i other = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + i));
+            const unsigned int differs = ~static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(pixels, other)))) & 0xF;
+            if (differs) return i + std::countr_zero(differs);
+        }
+#endif
+        while (i < count && p[i] == q[i]) ++i;
+        return i;
+    }
+
+    size_t OpSize(size_t count) {
+        if (count <= LOSSLESS_COUNT_EXTENDED) return 1;
+        return 2 + (count - LOSSLESS_COUNT_EXTENDED - 1) / 255;
+    }
+
+    uint8_t* PutOp(uint8_t* o, LosslessOp op, size_t count) {
+        if (count <= LOSSLESS_COUNT_EXTENDED) {
+            *o++ = static_cast<uint8_t>(static_cast<unsigned int>(op) << LOSSLESS_COUNT_BITS | (count - 1));
+            return o;
+        }
+        *o++ = static_cast<uint8_t>(static_cast<unsigned int>(op) << LOSSLESS_COUNT_BITS | LOSSLESS_COUNT_EXTENDED);
+        size_t rest = count - LOSSLESS_COUNT_EXTENDED - 1;
+        for (; rest >= 255; rest -= 255) *o++ = 255;
+        *o++ = static_cast<uint8_t>(rest);
+        return o;
+    }
+
+    size_t StoreTile(const uint8_t* tile, size_t pitch, unsigned int width, unsigned int rows, uint8_t* out) {
+        const size_t rowBytes = static_cast<size_t>(width) * BYTES_PER_PIXEL;
+        out[0] = static_cast<uint8_t>(LosslessMode::Stored);
+        for (unsigned int y = 0; y < rows; ++y) memcpy(out + 1 + y * rowBytes, tile + y * pitch, rowBytes);
+        return MaxLosslessTileSize(width, rows);
+    }
+}
+
+size_t FrameCodec::EncodeLosslessTile(const uint8_t* tile, size_t pitch, unsigned int width, unsigned int rows, uint8_t* out) {
+    const size_t rowBytes = static_cast<size_t>(width) * BYTES_PER_PIXEL;
+    const size_t count = static_cast<size_t>(width) * rows;
+    uint32_t* p = PixelScratch(width, rows);
+    for (unsigned int y = 0; y < rows; ++y) memcpy(p + y * width, tile + y * pitch, rowBytes);
+
+    // Anything not smaller than the tile itself is sent stored
+    uint8_t* o = out + 1;
+    const uint8_t* limit = out + MaxLosslessTileSize(width, rows) - 1;
+    uint32_t palette[LOSSLESS_PALETTE_SIZE] = {};
+
+    size_t i = 0;
+    while (i < count) {
+        const uint32_t pixel = p[i];
+        const bool left = pixel == p[i - 1];
+        const bool up = pixel == p[i - width];
+        if (left || up) {
+            // Flat areas match both; the longer run wins
+            const size_t leftRun = left ? RepeatLength(p + i, count - i, pixel) : 0;
+            const size_t upRun = up ? MatchLength(p + i, p + i - width, count - i) : 0;
+            const size_t run = std::max(leftRun, upRun);
+            if (o + OpSize(run) > limit) return StoreTile(tile, pitch, width, rows, out);
+            o = PutOp(o, leftRun >= upRun ? LosslessOp::Left : LosslessOp::Up, run);
+            i += run;
+            continue;
+        }
+
+        const unsigned int slot = LosslessPaletteSlot(pixel);
+        if (palette[slot] == pixel) {
+            if (o + 1 > limit) return StoreTile(tile, pitch, width, rows, out);
+            *o++ = static_cast<uint8_t>(static_cast<unsigned int>(LosslessOp::Index) << LOSSLESS_COUNT_BITS | slot);
+            ++i;
+            continue;
+        }
+
+        // Up to the next pixel another op could take
+        size_t end = i;
+        do {
+            palette[LosslessPaletteSlot(p[end])] = p[end];
+            ++end;
+        } while (end < count && p[end] != p[end - 1] && p[end] != p[end - width] && palette[LosslessPaletteSlot(p[end])] != p[end]);
+
+        const size_t literals = end - i;
+        if (o + OpSize(literals) + literals * BYTES_PER_PIXEL > limit) return StoreTile(tile, pitch, width, rows, out);
+        o = PutOp(o, LosslessOp::Literal, literals);
+        memcpy(o, p + i, literals * BYTES_PER_PIXEL);
+        o += literals * BYTES_PER_PIXEL;
+        i = end;
+    }
+
+    out[0] = static_cast<uint8_t>(LosslessMode::Coded);
+    return static_cast<size_t>(o - out);
+}
+
+bool FrameCodec::DecodeLosslessTile(const uint8_t* in, size_t length, unsigned int width, unsigned int rows, uint8_t* tile, size_t pitch) {
+    const size_t rowBytes = static_cast<size_t>(width) * BYTES_PER_PIXEL;
+    const size_t count = static_cast<size_t>(width) * rows;
+    if (length == 0 || count == 0) return false;
+
+    if (in[0] == static_cast<uint8_t>(LosslessMode::Stored)) {
+        if (length != MaxLosslessTileSize(width, rows)) return false;
+        for (unsigned int y = 0; y < rows; ++y) memcpy(tile + y * pitch, in + 1 + y * rowBytes, rowBytes);
+        return true;
+    }
+    if (in[0] != static_cast<uint8_t>(LosslessMode::Coded)) return false;
+
+    uint32_t* p = PixelScratch(width, rows);
+    uint32_t palette[LOSSLESS_PALETTE_SIZE] = {};
+    const uint8_t* q = in + 1;
+    const uint8_t* end = in + length;
+
+    size_t i = 0;
+    while (q < end) {
+        const uint8_t byte = *q++;
+        const LosslessOp op = static_cast<LosslessOp>(byte >> LOSSLESS_COUNT_BITS);
+        const unsigned int field = byte & LOSSLESS_COUNT_EXTENDED;
+
+        if (op == LosslessOp::Index) {
+            if (i == count) return false;
+            p[i++] = palette[field];
+            continue;
+        }
+
+        size_t run = field + 1;
+        if (field == LOSSLESS_COUNT_EXTENDED) {
+            uint8_t extra;
+            do {
+                if (q == end) return false;
+                extra = *q++;
+                run += extra;
+                if (run > count - i) return false;
+            } while (extra == 255);
+        }
+        if (run > count - i) return false;
+
+        switch (op) {
+            case LosslessOp::Left:
+                std::fill_n(p + i, run, p[i - 1]);
+                break;
+            case LosslessOp::Up:
+                // The source may overlap what this run writes, so copy a row's worth at a time
+                for (size_t done = 0; done < run;) {
+                    const size_t chunk = std::min<size_t>(run - done, width);
+                    memcpy(p + i + done, p + i + done - width, chunk * BYTES_PER_PIXEL);
+                    done += chunk;
+                }
+                break;
+            default:
+                if (static_cast<size_t>(end - q) < run * BYTES_PER_PIXEL) return false;
+                memcpy(p + i, q, run * BYTES_PER_PIXEL);
+                q += run * BYTES_PER_PIXEL;
+                for (size_t k = i; k < i + run; ++k) palette[LosslessPaletteSlot(p[k])] = p[k];
+                break;
+        }
+        i += run;
+    }
+    if (i != count) return false;
+
+    for (unsigned int y = 0; y < rows; ++y) memcpy(tile + y * pitch, p + y * width, rowBytes);
+    return true;
+}
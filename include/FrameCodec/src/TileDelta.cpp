@@ -0,0 +1,362 @@
+#include "TileDelta.hpp"
+#include "FrameHash.hpp"
+#include "TileCodec.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+using namespace FrameCodec;
+
+size_t FrameCodec::MaxDeltaSize(unsigned short width, unsigned short height, bool lossless) {
+    const size_t tiles = static_cast<size_t>(TilesX(width)) * TilesY(height);
+    return sizeof(DeltaHeader)
+        + MAX_COPY_RECTS * sizeof(CopyRect)
+        + tiles * sizeof(TileEntry)
+        + (lossless ? tiles * (sizeof(uint32_t) + 1) : 0) // Stream lengths and mode bytes
+        + static_cast<size_t>(width) * height * BYTES_PER_PIXEL;
+}
+
+// MARK: DeltaEncoder
+DeltaEncoder::DeltaEncoder(unsigned short width, unsigned short height) :
+    m_Width(width), m_Height(height), m_Pitch(static_cast<size_t>(width) * BYTES_PER_PIXEL),
+    m_Mirror(static_cast<size_t>(width) * height * BYTES_PER_PIXEL, 0), // Receiver starts black
+    m_Scroll(width, height)
+{
+    m_Rects.reserve(MAX_COPY_RECTS);
+    m_Entries.reserve(static_cast<size_t>(TilesX(width)) * TilesY(height));
+}
+
+void DeltaEncoder::SetTileCache(uint32_t capacity) {
+    if (capacity == 0) {
+        m_CacheIndex.reset();
+        m_CacheTiles.reset();
+        return;
+    }
+    m_CacheIndex = std::make_unique<TileCacheIndex>(capacity);
+    m_CacheTiles = std::make_unique<TileCache>(capacity);
+}
+
+void DeltaEncoder::EnableLossless(bool enable, unsigned int threads) {
+    if (enable) m_Pool = std::make_unique<RowPool>(threads);
+    else m_Pool.reset();
+}
+
+void DeltaEncoder::Reset(const uint8_t* frame) {
+    memcpy(m_Mirror.data(), frame, m_Mirror.size());
+}
+
+bool DeltaEncoder::TileDiffers(const uint8_t* frame, unsigned int tx, unsigned int ty) const {
+    const unsigned int x0 = tx * TILE_SIZE;
+    const unsigned int y0 = ty * TILE_SIZE;
+    const size_t rowBytes = std::min<unsigned int>(TILE_SIZE, m_Width - x0) * BYTES_PER_PIXEL;
+    const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+
+    size_t offset = y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+    for (unsigned int y = 0; y < rows; ++y, offset += m_Pitch) {
+        if (memcmp(frame + offset, m_Mirror.data() + offset, rowBytes) != 0) return true;
+    }
+    return false;
+}
+
+TileEntry DeltaEncoder::LookupTile(const uint8_t* frame, uint32_t index) {
+    if (!m_CacheIndex) return { index, TILE_CACHE_NONE };
+
+    const unsigned int tilesX = TilesX(m_Width);
+    const unsigned int x0 = (index % tilesX) * TILE_SIZE;
+    const unsigned int y0 = (index / tilesX) * TILE_SIZE;
+    const size_t rowBytes = std::min<unsigned int>(TILE_SIZE, m_Width - x0) * BYTES_PER_PIXEL;
+    const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+    const uint8_t* tile = frame + y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+
+    // Seeded with the tile shape so an edge tile never aliases a full one
+    uint64_t hash = (static_cast<uint64_t>(rowBytes) << 32) | rows;
+    for (unsigned int y = 0; y < rows; ++y) {
+        hash = HashBytes(tile + y * m_Pitch, rowBytes, hash);
+    }
+
+    uint32_t slot = m_CacheIndex->Find(hash);
+    if (slot != TILE_CACHE_NONE) {
+        if (m_CacheTiles->Matches(slot, tile, m_Pitch, rowBytes, rows)) {
+            m_CacheStats.hits++;
+            m_CacheStats.savedBytes += rowBytes * rows;
+            return { index | TILE_CACHE_HIT, slot };
+        }
+        // Hash collision: send the pixels and leave the cached tile alone
+        m_CacheStats.misses++;
+        return { index, TILE_CACHE_NONE };
+    }
+
+    m_CacheStats.misses++;
+    slot = m_CacheIndex->Insert(hash);
+    m_CacheTiles->Store(slot, tile, m_Pitch, rowBytes, rows);
+    return { index, slot };
+}
+
+size_t DeltaEncoder::Encode(const uint8_t* frame, uint8_t* out) {
+    m_Rects.clear();
+    m_Entries.clear();
+
+    if (m_ScrollEnabled) {
+        m_Scroll.Detect(m_Mirror.data(), frame, m_Pitch, m_Rects);
+        if (m_Rects.size() > MAX_COPY_RECTS) m_Rects.resize(MAX_COPY_RECTS);
+
+        // Replay the moves on the mirror so the tile diff only sees what the copies could not explain
+        for (const CopyRect& rect : m_Rects) {
+            ApplyCopyRect(m_Mirror.data(), m_Pitch, rect);
+        }
+        m_CopiedRects += m_Rects.size();
+    }
+
+    const unsigned int tilesX = TilesX(m_Width);
+    const unsigned int tilesY = TilesY(m_Height);
+
+    for (unsigned int ty = 0; ty < tilesY; ++ty) {
+        for (unsigned int tx = 0; tx < tilesX; ++tx) {
+            if (TileDiffers(frame, tx, ty)) m_Entries.push_back(LookupTile(frame, ty * tilesX + tx));
+        }
+    }
+    m_DirtyTileTotal += m_Entries.size();
+
+    DeltaHeader header = { static_cast<uint16_t>(m_Rects.size()), 0, static_cast<uint32_t>(m_Entries.size()) };
+
+    uint8_t* p = out;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    if (!m_Rects.empty()) {
+        memcpy(p, m_Rects.data(), m_Rects.size() * sizeof(CopyRect));
+        p += m_Rects.size() * sizeof(CopyRect);
+    }
+    if (!m_Entries.empty()) {
+        memcpy(p, m_Entries.data(), m_Entries.size() * sizeof(TileEntry));
+        p += m_Entries.size() * sizeof(TileEntry);
+    }
+
+    if (m_Pool) return static_cast<size_t>(WriteLosslessTiles(frame, p) - out);
+
+    for (const TileEntry& entry : m_Entries) {
+        const bool hit = (entry.tile & TILE_CACHE_HIT) != 0;
+        const uint32_t index = entry.tile & ~TILE_CACHE_HIT;
+        const unsigned int x0 = (index % tilesX) * TILE_SIZE;
+        const unsigned int y0 = (index / tilesX) * TILE_SIZE;
+        const size_t rowBytes = std::min<unsigned int>(TILE_SIZE, m_Width - x0) * BYTES_PER_PIXEL;
+        const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+
+        size_t offset = y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+        for (unsigned int y = 0; y < rows; ++y, offset += m_Pitch) {
+            memcpy(m_Mirror.data() + offset, frame + offset, rowBytes);
+            if (hit) continue;
+            memcpy(p, frame + offset, rowBytes);
+            p += rowBytes;
+        }
+    }
+
+    return static_cast<size_t>(p - out);
+}
+
+uint8_t* DeltaEncoder::WriteLosslessTiles(const uint8_t* frame, uint8_t* p) {
+    const unsigned int tilesX = TilesX(m_Width);
+    const unsigned int count = static_cast<unsigned int>(m_Entries.size());
+
+    // Every stream is coded where it would sit if all came out stored, which the payload always has room for,
+    // then moved down behind the one before it
+    uint8_t* sizes = p;
+    p += count * sizeof(uint32_t);
+    m_StreamSizes.assign(count, 0);
+    m_StreamOffsets.resize(count);
+    size_t offset = 0;
+    for (unsigned int i = 0; i < count; ++i) {
+        m_StreamOffsets[i] = offset;
+        if (m_Entries[i].tile & TILE_CACHE_HIT) continue;
+        const uint32_t index = m_Entries[i].tile;
+        const unsigned int width = std::min<unsigned int>(TILE_SIZE, m_Width - (index % tilesX) * TILE_SIZE);
+        const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - (index / tilesX) * TILE_SIZE);
+        offset += MaxLosslessTileSize(width, rows);
+        m_LosslessRawBytes += static_cast<size_t>(width) * rows * BYTES_PER_PIXEL;
+    }
+
+    // Entries name distinct tiles, so shares never touch the same part of the mirror or the payload
+    m_Pool->RunUnits(count, LOSSLESS_MIN_SHARE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            const TileEntry& entry = m_Entries[i];
+            const uint32_t index = entry.tile & ~TILE_CACHE_HIT;
+            const unsigned int x0 = (index % tilesX) * TILE_SIZE;
+            const unsigned int y0 = (index / tilesX) * TILE_SIZE;
+            const unsigned int width = std::min<unsigned int>(TILE_SIZE, m_Width - x0);
+            const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+            const size_t tile = y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+
+            for (unsigned int y = 0; y < rows; ++y) {
+                memcpy(m_Mirror.data() + tile + y * m_Pitch, frame + tile + y * m_Pitch, width * BYTES_PER_PIXEL);
+            }
+            if (entry.tile & TILE_CACHE_HIT) continue;
+            m_StreamSizes[i] = static_cast<uint32_t>(EncodeLosslessTile(frame + tile, m_Pitch, width, rows, p + m_StreamOffsets[i]));
+        }
+    });
+
+    uint8_t* q = p;
+    for (unsigned int i = 0; i < count; ++i) {
+        if (m_StreamSizes[i] == 0) continue;
+        memmove(q, p + m_StreamOffsets[i], m_StreamSizes[i]);
+        q += m_StreamSizes[i];
+    }
+    if (count > 0) memcpy(sizes, m_StreamSizes.data(), count * sizeof(uint32_t));
+    m_LosslessBytes += static_cast<size_t>(q - p);
+    return q;
+}
+
+// MARK: DeltaDecoder
+DeltaDecoder::DeltaDecoder(unsigned short width, unsigned short height) :
+    m_Width(width), m_Height(height), m_Pitch(static_cast<size_t>(width) * BYTES_PER_PIXEL),
+    m_Frame(static_cast<size_t>(width) * height * BYTES_PER_PIXEL, 0)
+{}
+
+void DeltaDecoder::SetTileCache(uint32_t capacity) {
+    if (capacity == 0) m_Cache.reset();
+    else m_Cache = std::make_unique<TileCache>(capacity);
+}
+
+void DeltaDecoder::EnableLossless(bool enable, unsigned int threads) {
+    if (enable) m_Pool = std::make_unique<RowPool>(threads);
+    else m_Pool.reset();
+}
+
+void DeltaDecoder::Reset(const uint8_t* frame) {
+    memcpy(m_Frame.data(), frame, m_Frame.size());
+}
+
+bool DeltaDecoder::Decode(const uint8_t* in, size_t length) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + length;
+
+    if (length < sizeof(DeltaHeader)) return false;
+
+    DeltaHeader header;
+    memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+
+    const unsigned int tilesX = TilesX(m_Width);
+    const unsigned int tileCount = tilesX * TilesY(m_Height);
+
+    if (header.copyCount > MAX_COPY_RECTS || header.tileCount > tileCount) return false;
+    const size_t entrySize = sizeof(TileEntry) + (m_Pool ? sizeof(uint32_t) : 0);
+    if (static_cast<size_t>(end - p) < header.copyCount * sizeof(CopyRect) + header.tileCount * entrySize) return false;
+
+    for (uint16_t i = 0; i < header.copyCount; ++i, p += sizeof(CopyRect)) {
+        CopyRect rect;
+        memcpy(&rect, p, sizeof(rect));
+
+        if (rect.srcX + rect.width > m_Width || rect.dstX + rect.width > m_Width ||
+            rect.srcY + rect.height > m_Height || rect.dstY + rect.height > m_Height) {
+            return false;
+        }
+        ApplyCopyRect(m_Frame.data(), m_Pitch, rect);
+    }
+
+    const uint8_t* entries = p;
+    p += header.tileCount * sizeof(TileEntry);
+    if (m_Pool) return DecodeLosslessTiles(entries, header.tileCount, p, end);
+
+    const uint32_t cacheSlots = m_Cache ? m_Cache->GetCapacity() : 0;
+
+    for (uint32_t i = 0; i < header.tileCount; ++i) {
+        TileEntry entry;
+        memcpy(&entry, entries + i * sizeof(TileEntry), sizeof(entry));
+
+        const bool hit = (entry.tile & TILE_CACHE_HIT) != 0;
+        const uint32_t index = entry.tile & ~TILE_CACHE_HIT;
+        if (index >= tileCount) return false;
+        if ((hit || entry.slot != TILE_CACHE_NONE) && entry.slot >= cacheSlots) return false;
+
+        const unsigned int x0 = (index % tilesX) * TILE_SIZE;
+        const unsigned int y0 = (index / tilesX) * TILE_SIZE;
+        const size_t rowBytes = std::min<unsigned int>(TILE_SIZE, m_Width - x0) * BYTES_PER_PIXEL;
+        const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+
+        uint8_t* tile = m_Frame.data() + y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+        if (hit) {
+            m_Cache->Load(entry.slot, tile, m_Pitch, rowBytes, rows);
+            continue;
+        }
+
+        if (static_cast<size_t>(end - p) < rowBytes * rows) return false;
+
+        for (unsigned int y = 0; y < rows; ++y) {
+            memcpy(tile + y * m_Pitch, p, rowBytes);
+            p += rowBytes;
+        }
+        if (entry.slot != TILE_CACHE_NONE) m_Cache->Store(entry.slot, tile, m_Pitch, rowBytes, rows);
+    }
+
+    return true;
+}
+
+bool DeltaDecoder::DecodeLosslessTiles(const uint8_t* entries, uint32_t count, const uint8_t* p, const uint8_t* end) {
+    const unsigned int tilesX = TilesX(m_Width);
+    const unsigned int tileCount = tilesX * TilesY(m_Height);
+    const uint32_t cacheSlots = m_Cache ? m_Cache->GetCapacity() : 0;
+
+    // Everything is checked before the first tile decodes, since the tiles decode out of order
+    const uint8_t* sizes = p;
+    p += count * sizeof(uint32_t);
+    m_StreamOffsets.resize(count);
+    m_Seen.assign(tileCount, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        TileEntry entry;
+        uint32_t size;
+        memcpy(&entry, entries + i * sizeof(TileEntry), sizeof(entry));
+        memcpy(&size, sizes + i * sizeof(uint32_t), sizeof(size));
+
+        const bool hit = (entry.tile & TILE_CACHE_HIT) != 0;
+        const uint32_t index = entry.tile & ~TILE_CACHE_HIT;
+        if (index >= tileCount || m_Seen[index]) return false;
+        if ((hit || entry.slot != TILE_CACHE_NONE) && entry.slot >= cacheSlots) return false;
+        m_Seen[index] = 1;
+
+        const unsigned int width = std::min<unsigned int>(TILE_SIZE, m_Width - (index % tilesX) * TILE_SIZE);
+        const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - (index / tilesX) * TILE_SIZE);
+        if (hit ? size != 0 : (size == 0 || size > MaxLosslessTileSize(width, rows))) return false;
+        if (static_cast<size_t>(end - p) < size) return false;
+        m_StreamOffsets[i] = static_cast<size_t>(p - sizes);
+        p += size;
+    }
+
+    std::atomic<bool> valid = true;
+    m_Pool->RunUnits(count, LOSSLESS_MIN_SHARE, [&](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; ++i) {
+            TileEntry entry;
+            uint32_t size;
+            memcpy(&entry, entries + i * sizeof(TileEntry), sizeof(entry));
+            memcpy(&size, sizes + i * sizeof(uint32_t), sizeof(size));
+            if (entry.tile & TILE_CACHE_HIT) continue;
+
+            const unsigned int x0 = (entry.tile % tilesX) * TILE_SIZE;
+            const unsigned int y0 = (entry.tile / tilesX) * TILE_SIZE;
+            const unsigned int width = std::min<unsigned int>(TILE_SIZE, m_Width - x0);
+            const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+            uint8_t* tile = m_Frame.data() + y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+            if (!DecodeLosslessTile(sizes + m_StreamOffsets[i], size, width, rows, tile, m_Pitch)) valid.store(false, std::memory_order_relaxed);
+        }
+    });
+    if (!valid.load(std::memory_order_relaxed)) return false;
+
+    // The cache sees the tiles in entry order, as the encoder's index did
+    for (uint32_t i = 0; i < count; ++i) {
+        TileEntry entry;
+        memcpy(&entry, entries + i * sizeof(TileEntry), sizeof(entry));
+        const bool hit = (entry.tile & TILE_CACHE_HIT) != 0;
+        if (!hit && entry.slot == TILE_CACHE_NONE) continue;
+
+        const uint32_t index = entry.tile & ~TILE_CACHE_HIT;
+        const unsigned int x0 = (index % tilesX) * TILE_SIZE;
+        const unsigned int y0 = (index / tilesX) * TILE_SIZE;
+        const size_t rowBytes = std::min<unsigned int>(TILE_SIZE, m_Width - x0) * BYTES_PER_PIXEL;
+        const unsigned int rows = std::min<unsigned int>(TILE_SIZE, m_Height - y0);
+        uint8_t* tile = m_Frame.data() + y0 * m_Pitch + x0 * BYTES_PER_PIXEL;
+        if (hit) m_Cache->Load(entry.slot, tile, m_Pitch, rowBytes, rows);
+        else m_Cache->Store(entry.slot, tile, m_Pitch, rowBytes, rows);
+    }
+
+    return true;
+}
@@ -0,0 +1,208 @@
+#include "TraceRecorder.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define TRACE_USE_TSC
+#endif
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace FrameCodec;
+
+namespace {
+    constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+    constexpr auto CALIBRATION_TIME = std::chrono::milliseconds(20);
+
+    thread_local const char* t_ThreadName = nullptr;
+
+    const char* PhaseCode(TracePhase phase) {
+        switch (phase) {
+            case TracePhase::Begin: return "B";
+            case TracePhase::End: return "E";
+            default: return "i";
+        }
+    }
+}
+
+uint64_t FrameCodec::TraceTicks() {
+    #ifdef TRACE_USE_TSC
+    return __rdtsc();
+    #else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    #endif
+}
+
+TraceRecorder& TraceRecorder::Instance() {
+    static TraceRecorder instance;
+    return instance;
+}
+
+// MARK: Recording
+TraceRecorder::Ring* TraceRecorder::LocalRing(bool create) {
+    thread_local Ring* ring = nullptr;
+    if (ring || !create) return ring;
+
+    auto created = std::make_unique<Ring>();
+    std::lock_guard<std::mutex> lock(m_RingsMutex);
+    created->events = std::make_unique<TraceEvent[]>(m_RingEvents);
+    created->mask = m_RingEvents - 1;
+    created->threadId = static_cast<uint32_t>(m_Rings.size() + 1);
+    created->threadName.store(t_ThreadName, std::memory_order_relaxed);
+    ring = created.get();
+    m_Rings.push_back(std::move(created));
+    return ring;
+}
+
+void TraceRecorder::Record(TracePhase phase, const char* name, const char* category) {
+    const uint64_t ticks = TraceTicks();
+    Ring* ring = LocalRing();
+
+    // Single producer: only this thread moves head
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) > ring->mask) {
+        ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    ring->events[head & ring->mask] = { ticks, name, category, phase };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+    t_ThreadName = name;
+    if (Ring* ring = LocalRing(false)) ring->threadName.store(name, std::memory_order_relaxed);
+}
+
+uint64_t TraceRecorder::GetDropped() const {
+    std::lock_guard<std::mutex> lock(m_RingsMutex);
+    uint64_t dropped = 0;
+    for (const auto& ring : m_Rings) dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+// MARK: File
+bool TraceRecorder::Start(const std::string& path, size_t ringEvents) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Thread.joinable()) return true;
+
+    m_File.open(path, std::ios::trunc);
+    if (!m_File) {
+        std::cerr << "Failed to open trace file " << path << std::endl;
+        return false;
+    }
+
+    {
+        // Rings of threads that traced before keep their size; events left from an earlier recording are discarded
+        std::lock_guard<std::mutex> ringsLock(m_RingsMutex);
+        m_RingEvents = 1;
+        while (m_RingEvents < ringEvents) m_RingEvents <<= 1;
+        for (const auto& ring : m_Rings) {
+            ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+            ring->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Calibrate();
+    #ifdef _WIN32
+    m_ProcessId = static_cast<uint32_t>(_getpid());
+    #else
+    m_ProcessId = static_cast<uint32_t>(getpid());
+    #endif
+    m_File << "{\"traceEvents\":[\n";
+    m_FirstEvent = true;
+    m_Written.store(0, std::memory_order_relaxed);
+
+    m_Stop = false;
+    m_Thread = std::thread(&TraceRecorder::FlushLoop, this);
+    g_TraceEnabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::Stop() {
+    if (!m_Thread.joinable()) return;
+    g_TraceEnabled.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Drain();
+
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> ringsLock(m_RingsMutex);
+        for (const auto& ring : m_Rings) rings.push_back(ring.get());
+    }
+    for (Ring* ring : rings) {
+        const char* name = ring->threadName.load(std::memory_order_relaxed);
+        if (!name) continue;
+        m_File << (m_FirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << m_ProcessId
+               << ",\"tid\":" << ring->threadId << ",\"args\":{\"name\":\"" << name << "\"}}";
+        m_FirstEvent = false;
+    }
+    m_File << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    m_File.close();
+}
+
+// TSC ticks are turned into microseconds with a rate measured against the steady clock. Invariant TSCs (every
+// x86 CPU this runs on) tick at that rate on all cores, so events from different threads line up.
+void TraceRecorder::Calibrate() {
+    const auto clockStart = std::chrono::steady_clock::now();
+    const uint64_t ticksStart = TraceTicks();
+    std::this_thread::sleep_for(CALIBRATION_TIME);
+    const uint64_t ticksEnd = TraceTicks();
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - clockStart).count();
+
+    m_StartTicks = ticksStart;
+    m_TicksPerUs = ticksEnd > ticksStart && us > 0 ? (ticksEnd - ticksStart) / us : 1.0;
+}
+
+void TraceRecorder::FlushLoop() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Wake.wait_for(lock, FLUSH_INTERVAL, [this]() { return m_Stop; })) Drain();
+}
+
+// Called with m_Mutex held
+void TraceRecorder::Drain() {
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(m_RingsMutex);
+        for (const auto& ring : m_Rings) rings.push_back(ring.get());
+    }
+
+    char line[256];
+    uint64_t written = 0;
+    for (Ring* ring : rings) {
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            const TraceEvent& event = ring->events[tail & ring->mask];
+            const double ts = static_cast<double>(static_cast<int64_t>(event.ticks - m_StartTicks)) / m_TicksPerUs;
+            snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u%s}",
+                     m_FirstEvent ? "" : ",\n", event.name, event.category, PhaseCode(event.phase), ts, m_ProcessId, ring->threadId,
+                     event.phase == TracePhase::Instant ? ",\"s\":\"t\"" : "");
+            m_File << line;
+            m_FirstEvent = false;
+            written++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    if (written) {
+        m_File.flush();
+        m_Written.fetch_add(written, std::memory_order_relaxed);
+    }
+}
@@ -1,4 +1,6 @@
 #include "InputNDSession.hpp"
+#include "Metrics.hpp"
+#include "TraceRecorder.hpp"
 #define ABSCURSOR
 
 #include <emmintrin.h>
@@ -96,6 +98,7 @@ void InputNDSessionServer::ExchangePeerInfo() {
 static UINT KeyFlags = 0;
 
 void InputNDSessionServer::SendEvent(RAWINPUT input) {
+    FrameCodec::TraceInstant("Raw input", "input");
     switch (input.header.dwType) {
         case RIM_TYPEMOUSE: {
             #ifdef ABSCURSOR
@@ -232,12 +235,17 @@ void InputNDSessionServer::Loop() {
 
     auto flagWaitTotal = std::chrono::microseconds(0);
 
+    static const FrameCodec::Counter packetsSent("input.packets_sent");
+    static const FrameCodec::Histogram flagWait("input.flag_wait_us");
+    FrameCodec::TraceRecorder::Instance().SetThreadName("input");
+
     while (m_isRunning && !g_shouldQuit.load()) {
         flag[0] = 0; // Reset flag
         _mm_clflush(m_Buf);
         _mm_sfence();
 
         WaitForSingleObject(m_hCallbackEvent, INFINITE);
+        FrameCodec::TraceScope send("Send input", "input");
         //delta = {m_Mouse.x.exchange(0), m_Mouse.y.exchange(0)};
 
         packet->mouse = {
@@ -271,6 +279,7 @@ void InputNDSessionServer::Loop() {
 
         auto flagWaitEnd = std::chrono::steady_clock::now();
         flagWaitTotal += std::chrono::duration_cast<std::chrono::microseconds>(flagWaitEnd - flagWaitStart);
+        flagWait.RecordMicroseconds(flagWaitEnd - flagWaitStart);
     
         //ND2_SGE sge = { m_Buf, INPUT_EVENT_BUFFER_SIZE, m_pMr->GetLocalToken() };
         if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
@@ -302,6 +311,7 @@ void InputNDSessionServer::Loop() {
             std::cerr << "INPUT: " << "WaitForCompletion for send failed." << std::endl;
             return;
         }
+        packetsSent.Add();
         
         /*
         auto now = std::chrono::steady_clock::now();
@@ -444,6 +454,10 @@ void InputNDSessionClient::Loop() {
     uint8_t* flag = reinterpret_cast<uint8_t*>(m_Buf); // 0 = Cannot accomodate 1 = Good to go
     Packet* received = reinterpret_cast<Packet*>(reinterpret_cast<uint8_t*>(m_Buf) + 1);
 
+    static const FrameCodec::Counter packetsReceived("input.packets_received");
+    static const FrameCodec::Counter packetsEmpty("input.packets_empty");
+    FrameCodec::TraceRecorder::Instance().SetThreadName("input");
+
     while (m_isRunning && !g_shouldQuit.load()) {
         if (sgeCount < 10) {
             for (int i = 0; i < 10; i++) {
@@ -466,6 +480,8 @@ void InputNDSessionClient::Loop() {
         sgeCount--;
 
         count++;
+        packetsReceived.Add();
+        FrameCodec::TraceScope inject("Inject input", "input");
 
         flag[0] = 0;
         _mm_clflush(m_Buf);
@@ -478,6 +494,7 @@ void InputNDSessionClient::Loop() {
         bool shouldKey = (key.scanCode != 0 && key.down != 2);
 
         if (!shouldMouse && !shouldKey) {
+            packetsEmpty.Add();
             continue; // Nothing to do
         }
 
@@ -5,6 +5,7 @@
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #include <ndsupport.h>
+#include <functional>
 #include <variant>
 #include <iostream>
 
@@ -12,6 +13,7 @@
 #define SEND_CTXT ((void*)0x2000)
 #define READ_CTXT ((void*)0x3000)
 #define WRITE_CTXT ((void*)0x4000)
+#define INVALIDATE_CTXT ((void*)0x5000)
 
 struct PeerInfo {
     UINT64 remoteAddr;
@@ -60,6 +62,9 @@ class NDSessionBase {
     HRESULT CreateMR();
     HRESULT RegisterDataBuffer(DWORD bufferLength, ULONG type);
     HRESULT RegisterDataBuffer(void *pBuffer, DWORD bufferLength, ULONG type);
+    // Replaces m_Buf with a new registration of bufferLength and rebinds the memory window over it, keeping
+    // the QP connected. Nothing posted may still reference the old buffer; the peer needs the new PeerInfo.
+    HRESULT ResizeDataBuffer(DWORD bufferLength, ULONG mrFlags, ULONG mwFlags);
     HRESULT CreateCQ(DWORD depth);
     HRESULT CreateCQ(IND2CompletionQueue **pCq, DWORD depth);
     HRESULT CreateConnector();
@@ -84,9 +89,14 @@ class NDSessionBase {
     void WaitForEventNotification(ULONG notifyFlag);
     
     ND2_RESULT WaitForCompletion(ULONG notifyFlag, bool bBlocking = true);
+    // Blocking, but runs `onWake` each time `wake` is set before a completion arrives. The CQ notification stays
+    // requested meanwhile, so a completion landing during `onWake` ends the wait right after it.
+    ND2_RESULT WaitForCompletion(ULONG notifyFlag, HANDLE wake, const std::function<void()>& onWake);
     HRESULT WaitForCompletion();
 
     bool WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag = ND_CQ_NOTIFY_ANY);
+    bool WaitForCompletionAndCheckContext(void *expectedContext, HANDLE wake, const std::function<void()>& onWake, ULONG notifyFlag = ND_CQ_NOTIFY_ANY);
+    bool CheckCompletion(const ND2_RESULT& ndRes, void *expectedContext);
 
     std::variant<HRESULT, ND2_RESULT> Bind(DWORD bufferLength, ULONG type, void *context = nullptr);
     std::variant<HRESULT, ND2_RESULT> Bind(const void *pBuf, DWORD BufferLength, ULONG type, void *context = nullptr);
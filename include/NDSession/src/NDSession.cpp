@@ -1,4 +1,5 @@
 #include "NDSession.hpp"
+#include "TraceRecorder.hpp"
 #include <cassert>
 #include <iostream>
 
@@ -72,6 +73,25 @@ HRESULT NDSessionBase::RegisterDataBuffer(void *pBuf, DWORD bufferLength, ULONG
     return hr;
 }
 
+HRESULT NDSessionBase::ResizeDataBuffer(DWORD bufferLength, ULONG mrFlags, ULONG mwFlags) {
+    // The window has to let go of the region before it can be deregistered
+    if (m_pMw) {
+        HRESULT hr = m_pQp->Invalidate(INVALIDATE_CTXT, m_pMw, 0);
+        if (FAILED(hr)) {
+            std::cerr << "Failed to invalidate memory window: " << std::hex << hr << std::endl;
+            return hr;
+        }
+        if (!WaitForCompletionAndCheckContext(INVALIDATE_CTXT)) return E_FAIL;
+    }
+
+    HRESULT hr = RegisterDataBuffer(bufferLength, mrFlags);
+    if (FAILED(hr) || !m_pMw) return hr;
+
+    std::variant<HRESULT, ND2_RESULT> bound = Bind(m_Buf, bufferLength, mwFlags);
+    if (std::holds_alternative<HRESULT>(bound)) return std::get<HRESULT>(bound);
+    return std::get<ND2_RESULT>(bound).Status;
+}
+
 HRESULT NDSessionBase::CreateMW() {
     HRESULT hr = m_pAdapter->CreateMemoryWindow(IID_IND2MemoryWindow, reinterpret_cast<void**>(&m_pMw));
     return hr;
@@ -269,6 +289,7 @@ ND2_RESULT NDSessionBase::WaitForCompletion(ULONG notifyFlag, bool bBlocking) {
         return ndRes;
     }
 
+    FrameCodec::TraceScope wait("CQ wait", "cq");
     do {
         WaitForEventNotification(notifyFlag);
     } while (m_pCq->GetResults(&ndRes, 1) == 0);
@@ -276,9 +297,33 @@ ND2_RESULT NDSessionBase::WaitForCompletion(ULONG notifyFlag, bool bBlocking) {
     return ndRes;
 }
 
+ND2_RESULT NDSessionBase::WaitForCompletion(ULONG notifyFlag, HANDLE wake, const std::function<void()>& onWake) {
+    ND2_RESULT ndRes;
+    if (m_pCq->GetResults(&ndRes, 1) == 1) return ndRes;
+
+    FrameCodec::TraceScope wait("CQ wait", "cq");
+    const HANDLE handles[] = { m_Ov.hEvent, wake };
+    do {
+        HRESULT hr = m_pCq->Notify(notifyFlag, &m_Ov);
+        if (hr == ND_PENDING) {
+            while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) onWake();
+            // The wait consumed the event, so only collect the result
+            hr = m_pCq->GetOverlappedResult(&m_Ov, false);
+        }
+    } while (m_pCq->GetResults(&ndRes, 1) == 0);
+
+    return ndRes;
+}
+
 bool NDSessionBase::WaitForCompletionAndCheckContext(void *expectedContext, ULONG notifyFlag) {
-    ND2_RESULT ndRes = WaitForCompletion(notifyFlag, true);
+    return CheckCompletion(WaitForCompletion(notifyFlag, true), expectedContext);
+}
+
+bool NDSessionBase::WaitForCompletionAndCheckContext(void *expectedContext, HANDLE wake, const std::function<void()>& onWake, ULONG notifyFlag) {
+    return CheckCompletion(WaitForCompletion(notifyFlag, wake, onWake), expectedContext);
+}
 
+bool NDSessionBase::CheckCompletion(const ND2_RESULT& ndRes, void *expectedContext) {
     if (ndRes.Status == ND_CANCELED) {
         std::cout << "Remote has closed the connection." << std::endl;
         return false;
@@ -0,0 +1,26 @@
+#include "YuvMatrix.hlsli"
+
+Texture2D<float> YPlane : register(t0);       // Input Y plane (luminance)
+Texture2D<float2> UVPlane : register(t1);     // Input UV plane (chroma, interleaved)
+
+RWTexture2D<float4> OutputTexture : register(u0); // Output BGRA32 texture
+
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID) {
+    uint2 coord = DTid.xy;
+    
+    // Get texture dimensions from the Y plane
+    uint width, height;
+    YPlane.GetDimensions(width, height);
+    
+    if (coord.x >= width || coord.y >= height) return;
+
+    // Read Y plane directly
+    float y = YPlane.Load(int3(coord, 0));
+
+    // Read UV plane (4:2:0 subsampling: each pair covers a 2x2 block)
+    // UV plane is half-width and half-height, so map both coordinates to UV texture space
+    float2 uv_01 = UVPlane.Load(int3(coord / 2, 0)); // Hardware converts R8G8_UNORM to [0,1] float2
+    // Convert YUV to RGB in the session's matrix and range
+    OutputTexture[coord] = ToBgra(y, uv_01);
+}
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "YuvMatrix.hlsli"
+
 Texture2D<float> YPlane : register(t0);       // Input Y plane (luminance)
 Texture2D<float2> UVPlane : register(t1);     // Input UV plane (chroma, interleaved)
 
@@ -20,17 +22,6 @@ void main(uint3 DTid : SV_DispatchThreadID) {
     // UV plane is half-height, so map coord.y to UV texture space
     uint uvY = coord.y / 2;  // Map to UV plane coordinates
     float2 uv_01 = UVPlane.Load(int3(coord.x, uvY, 0)); // Hardware converts R8G8_UNORM to [0,1] float2
-    float2 uv = uv_01 - 0.5;
-
-    // Convert YUV to RGB
-    float r = y + 1.402 * uv.y;
-    float g = y - 0.344136 * uv.x - 0.714136 * uv.y;
-    float b = y + 1.772 * uv.x;
-
-    r = saturate(r);
-    g = saturate(g);
-    b = saturate(b);
-
-    // Write output texture (BGRA format, alpha = 1.0)
-    OutputTexture[coord] = float4(b, g, r, 1.0);
+    // Convert YUV to RGB in the session's matrix and range
+    OutputTexture[coord] = ToBgra(y, uv_01);
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include "YuvMatrix.hlsli"
+
+Texture2D<float4> InputTexture : register(t0); // Input BGRA32 texture
+RWTexture2D<float> YPlane : register(u0);      // Output Y plane (luminance)
+RWTexture2D<float2> UVPlane : register(u1);    // Output UV plane (chroma, interleaved, half width and half height)
+
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID) {
+    uint2 coord = DTid.xy;
+    
+    // Get texture dimensions
+    uint width, height;
+    InputTexture.GetDimensions(width, height);
+    
+    if (coord.x >= width || coord.y >= height) return;
+
+    // Load the input texture directly (no sampling needed in compute shader)
+    float4 bgra = InputTexture.Load(int3(coord, 0));
+
+    YPlane[coord] = ToY(bgra);
+
+    // 4:2:0 subsampling: the thread at the top-left of each 2x2 block writes the block's mean,
+    // clamping to the last column or row when the size is odd
+    if ((coord.x & 1) == 0 && (coord.y & 1) == 0) {
+        uint x1 = min(coord.x + 1, width - 1);
+        uint y1 = min(coord.y + 1, height - 1);
+        float4 mean = (bgra + InputTexture.Load(int3(x1, coord.y, 0)) +
+                       InputTexture.Load(int3(coord.x, y1, 0)) + InputTexture.Load(int3(x1, y1, 0))) * 0.25;
+        UVPlane[coord / 2] = ToUV(mean);
+    }
+}
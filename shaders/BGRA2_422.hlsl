@@ -0,0 +1,28 @@
+#include "YuvMatrix.hlsli"
+
+Texture2D<float4> InputTexture : register(t0); // Input BGRA32 texture
+RWTexture2D<float> YPlane : register(u0);      // Output Y plane (luminance)
+RWTexture2D<float2> UVPlane : register(u1);    // Output UV plane (chroma, interleaved, half width)
+
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID) {
+    uint2 coord = DTid.xy;
+    
+    // Get texture dimensions
+    uint width, height;
+    InputTexture.GetDimensions(width, height);
+    
+    if (coord.x >= width || coord.y >= height) return;
+
+    // Load the input texture directly (no sampling needed in compute shader)
+    float4 bgra = InputTexture.Load(int3(coord, 0));
+
+    YPlane[coord] = ToY(bgra);
+
+    // 4:2:2 subsampling: the even column writes the mean of its pair, or its own pixel at an odd width's edge
+    if ((coord.x & 1) == 0) {
+        uint x1 = min(coord.x + 1, width - 1);
+        float4 mean = (bgra + InputTexture.Load(int3(x1, coord.y, 0))) * 0.5;
+        UVPlane[uint2(coord.x / 2, coord.y)] = ToUV(mean);
+    }
+}
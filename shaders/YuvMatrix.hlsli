@@ -0,0 +1,48 @@
+// Matrix and range shared by the BGRA2_4xx and 4xx_2BGRA shaders. The host defines KR, KB and LIMITED when it compiles
+// them, from FrameCodec's YUV_MATRICES; without them this is BT.601 full range, what the shaders always used.
+#ifndef KR
+#define KR 0.299
+#endif
+#ifndef KB
+#define KB 0.114
+#endif
+#ifndef LIMITED
+#define LIMITED 0
+#endif
+
+static const float KG = 1.0 - KR - KB;
+
+// Red is in the Z component for BGRA
+float ToY(float4 bgra) {
+    float y = KR * bgra.z + KG * bgra.y + KB * bgra.x;
+#if LIMITED
+    return (16.0 + 219.0 * y) / 255.0; // Y in 16-235
+#else
+    return y;
+#endif
+}
+
+// U, V as the R8G8_UNORM plane stores them: centred on 0.5 in full range, on code 128 in 16-240 in limited range
+float2 ToUV(float4 bgra) {
+    float y = KR * bgra.z + KG * bgra.y + KB * bgra.x;
+    float2 uv = float2((bgra.x - y) / (2.0 * (1.0 - KB)), (bgra.z - y) / (2.0 * (1.0 - KR)));
+#if LIMITED
+    return (128.0 + 224.0 * uv) / 255.0;
+#else
+    return uv + 0.5;
+#endif
+}
+
+// Y and a U,V pair as the planes store them back to saturated BGRA, alpha 1
+float4 ToBgra(float y, float2 uv_01) {
+#if LIMITED
+    y = (y * 255.0 - 16.0) / 219.0;
+    float2 uv = (uv_01 * 255.0 - 128.0) / 224.0;
+#else
+    float2 uv = uv_01 - 0.5;
+#endif
+    float r = y + 2.0 * (1.0 - KR) * uv.y;
+    float g = y - 2.0 * KB * (1.0 - KB) / KG * uv.x - 2.0 * KR * (1.0 - KR) / KG * uv.y;
+    float b = y + 2.0 * (1.0 - KB) * uv.x;
+    return float4(saturate(b), saturate(g), saturate(r), 1.0);
+}
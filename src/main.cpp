@@ -4,6 +4,24 @@
 #include "D2DWindow.hpp"
 #include "InputNDSession.hpp"
 #include "AudioNDSession.hpp"
+#include "CursorNDSession.hpp"
+#include "TileDelta.hpp"
+#include "FrameHeader.hpp"
+#include "LatencyTrace.hpp"
+#include "BandLayout.hpp"
+#include "PullProtocol.hpp"
+#include "FrameMailbox.hpp"
+#include "FrameRing.hpp"
+#include "AdaptiveScaler.hpp"
+#include "SessionMode.hpp"
+#include "BufferArena.hpp"
+#include "CaptureRegion.hpp"
+#include "OutputLayout.hpp"
+#include "OutputScheduler.hpp"
+#include "CaptureFile.hpp"
+#include "Metrics.hpp"
+#include "TraceRecorder.hpp"
+#include "ColorConvert.hpp"
 
 #include <WtsApi32.h>
 #include <conio.h>
@@ -17,6 +35,7 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <future>
+#include <optional>
 
 void SetupConsole() {
     if (!AllocConsole()) {
@@ -36,6 +55,10 @@ void SetupConsole() {
 
 //#define NOCONTROL
 //#define NOAUDIO
+//#define NOCURSOR
+//#define FRAME_CHECKSUM
+//#define NOSCALE
+//#define CPU_YUV440
 
 #pragma comment(lib, "ws2_32.lib")
 
@@ -48,6 +71,34 @@ bool SaveFrameFromBuffer(const std::filesystem::path& path, ID3D11Texture2D* tex
 
 static size_t maxSge = -1;
 
+// While the desktop is static no frames are sent; at this interval the server still gets one so its loop (and window) stays live
+constexpr auto KEEPALIVE_INTERVAL = std::chrono::milliseconds(250);
+
+// Raw frames the viewer's network thread may run ahead of the render thread
+constexpr unsigned int RECEIVE_RING_SLOTS = 4;
+
+// Hashes every payload on both ends; catches torn or corrupted writes at the cost of a pass over the frame
+#ifdef FRAME_CHECKSUM
+constexpr bool FRAME_CHECKSUM_ENABLED = true;
+#else
+constexpr bool FRAME_CHECKSUM_ENABLED = false;
+#endif
+
+// Raw mode sends at 3/4 or 1/2 size while full-size frames don't fit the refresh interval; the viewer stretches them back
+#ifdef NOSCALE
+constexpr bool ADAPTIVE_SCALE_ENABLED = false;
+#else
+constexpr bool ADAPTIVE_SCALE_ENABLED = true;
+#endif
+
+// Compressed mode converts between BGRA and planar YUV on the CPU's SIMD units instead of the BGRA2_4xx and 4xx_2BGRA
+// shaders, for GPUs that are busy with the game or too weak to spare
+#ifdef CPU_YUV440
+constexpr bool CPU_YUV_ENABLED = true;
+#else
+constexpr bool CPU_YUV_ENABLED = false;
+#endif
+
 std::string FormatBytes(uint64_t bytes) {
     if (bytes >= 1024ULL * 1024 * 1024) {
         return std::to_string(bytes / (1024ULL * 1024 * 1024)) + "GB";
@@ -60,11 +111,49 @@ std::string FormatBytes(uint64_t bytes) {
     }
 }
 
+// How the mode lines name a session's pixel format
+const char* FormatName(FrameCodec::PixelFormat format) {
+    switch (format) {
+        case FrameCodec::PixelFormat::YUV440: return "Compressed 4:4:0";
+        case FrameCodec::PixelFormat::YUV420: return "Compressed 4:2:0";
+        case FrameCodec::PixelFormat::YUV422: return "Compressed 4:2:2";
+        case FrameCodec::PixelFormat::YUVAdaptive: return "Compressed adaptive";
+        case FrameCodec::PixelFormat::BGRALossless: return "Raw lossless";
+        default: return "Raw";
+    }
+}
+
+// What a raw push session's tile deltas are sent as
+FrameCodec::PayloadEncoding RawEncoding(FrameCodec::PixelFormat format) {
+    return format == FrameCodec::PixelFormat::BGRALossless ? FrameCodec::PayloadEncoding::TileDeltaLossless : FrameCodec::PayloadEncoding::TileDelta;
+}
+
+const wchar_t* DecompressShaderPath(FrameCodec::PixelFormat format) {
+    switch (format) {
+        case FrameCodec::PixelFormat::YUV420: return L"shaders/420_2BGRA.hlsl";
+        case FrameCodec::PixelFormat::YUV422: return L"shaders/422_2BGRA.hlsl";
+        default: return L"shaders/440_2BGRA.hlsl";
+    }
+}
+
 void ShowUsage() {
     printf("main.exe [options]\n"
            "Options:\n"
-           "\t-s <local_ip>           - Start as server\n"
-           "\t-c <local_ip> <server_ip> - Start as client\n");
+           "\t-s <local_ip> [trace.csv] - Start as server\n"
+           "\t                          trace.csv: per-frame capture-to-present breakdown, in microseconds\n"
+           "\t-c <local_ip> <server_ip> <r|rl|c|c420|c422|ca> [tile_cache_tiles] [bands] [push|pull] [region] - Start as client\n"
+           "\t                          r: raw tile deltas, c: compressed 4:4:0, c420/c422: compressed 4:2:0/4:2:2; raw push may capture up to 4 outputs\n"
+           "\t                          ca: compressed with full, 4:4:0 or 4:2:0 chroma picked per 16x16 tile (CPU_YUV440 builds, push only)\n"
+           "\t                          rl: raw tile deltas with each tile coded losslessly on the CPU (push only)\n"
+           "\t                          tile_cache_tiles: receiver tile cache slots for raw mode, 0 disables (default 2048)\n"
+           "\t                          bands: horizontal bands per compressed frame, 1 sends whole frames (default 4, max 16)\n"
+           "\t                          push: client writes every frame once the server is ready (default)\n"
+           "\t                          pull: server RDMA-reads the newest published frame whenever it can present\n"
+           "\t                          region: <x>,<y>,<width>,<height> of the output, or window=<title> to follow a window (raw only)\n"
+           "\t                          record=<file> at the end writes the first output's frames to a capture file (raw push only)\n"
+           "\t                          color=<bt601|bt601-limited|bt709|bt709-limited> at the end sets the YUV matrix and range (default bt601)\n"
+           "\tmetrics=<file> - At the end of either: also write the metrics published to shared memory (ndrc-server or ndrc-client) to a JSON file every second\n"
+           "\ttimeline=<file> - At the end of either: record capture, copy, write, completion wait, audio and input events per thread (Chrome trace JSON)\n");
 }
 
 
@@ -177,15 +266,16 @@ private:
         yPlaneDesc.CPUAccessFlags = 0;
         yPlaneDesc.MiscFlags = 0;
 
-        HRESULT hr = d3dDevice->CreateTexture2D(&yPlaneDesc, nullptr, m_YPlaneTexture.GetAddressOf());
+        HRESULT hr = d3dDevice->CreateTexture2D(&yPlaneDesc, nullptr, m_YPlaneTexture.ReleaseAndGetAddressOf());
         if (FAILED(hr)) {
             std::cerr << "Failed to create Y plane texture: " << std::hex << hr << std::endl;
             return false;
         }
 
+        const FrameCodec::ChromaLayout chroma = FrameCodec::GetChromaLayout(m_Format);
         D3D11_TEXTURE2D_DESC uvPlaneDesc = {};
-        uvPlaneDesc.Width = m_Width;
-        uvPlaneDesc.Height = m_Height / 2;
+        uvPlaneDesc.Width = FrameCodec::ChromaWidth(chroma, m_Width);
+        uvPlaneDesc.Height = FrameCodec::ChromaHeight(chroma, m_Height);
         uvPlaneDesc.MipLevels = 1;
         uvPlaneDesc.ArraySize = 1;
         uvPlaneDesc.Format = DXGI_FORMAT_R8G8_UNORM;
@@ -196,15 +286,16 @@ private:
         uvPlaneDesc.CPUAccessFlags = 0;
         uvPlaneDesc.MiscFlags = 0;
 
-        hr = d3dDevice->CreateTexture2D(&uvPlaneDesc, nullptr, m_UVPlaneTexture.GetAddressOf());
+        hr = d3dDevice->CreateTexture2D(&uvPlaneDesc, nullptr, m_UVPlaneTexture.ReleaseAndGetAddressOf());
         if (FAILED(hr)) {
             std::cerr << "Failed to create UV plane texture: " << std::hex << hr << std::endl;
             return false;
         }
 
+        // Raw frames of every output are composed into this one texture; see OutputCanvas
         D3D11_TEXTURE2D_DESC outputDesc = {};
-        outputDesc.Width = m_Width;
-        outputDesc.Height = m_Height;
+        outputDesc.Width = m_Canvas->GetWidth();
+        outputDesc.Height = m_Canvas->GetHeight();
         outputDesc.MipLevels = 1;
         outputDesc.ArraySize = 1;
         outputDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
@@ -215,12 +306,26 @@ private:
         outputDesc.CPUAccessFlags = 0;
         outputDesc.MiscFlags = 0;
 
-        hr = d3dDevice->CreateTexture2D(&outputDesc, nullptr, m_FrameTexture.GetAddressOf());
+        hr = d3dDevice->CreateTexture2D(&outputDesc, nullptr, m_FrameTexture.ReleaseAndGetAddressOf());
         if (FAILED(hr)) {
             std::cerr << "Failed to create output texture: " << std::hex << hr << std::endl;
             return false;
         }
 
+        // The decompress shader reads the UV plane the way it was just sized
+        if (m_Compress && !CPU_YUV_ENABLED) {
+            // shaders/YuvMatrix.hlsli's KR, KB and LIMITED, for the session's color space
+            const FrameCodec::YuvMatrix& matrix = FrameCodec::GetYuvMatrix(m_ColorSpace);
+            const std::string kr = std::to_string(matrix.kr);
+            const std::string kb = std::to_string(matrix.kb);
+            const D3D_SHADER_MACRO defines[] = { { "KR", kr.c_str() }, { "KB", kb.c_str() }, { "LIMITED", matrix.limited ? "1" : "0" }, { nullptr, nullptr } };
+            hr = m_Renderer->SetDecompressShader(DecompressShaderPath(m_Format), defines);
+            if (FAILED(hr)) {
+                std::cerr << "Failed to load the decompress shader: " << std::hex << hr << std::endl;
+                return false;
+            }
+        }
+
         return true;
     }
 
@@ -269,8 +374,8 @@ public:
         inet_ntop(AF_INET, &clientAddr.sin_addr, clientIp, sizeof(clientIp));
         std::cout << "Client connected: " << clientIp << ":" << ntohs(clientAddr.sin_port) << std::endl;
 
-        uint16_t buffer[4];
-        int bytesReceived = recv(clientSock, reinterpret_cast<char*>(buffer), sizeof(buffer), 0);
+        FrameCodec::SessionMode mode = {};
+        int bytesReceived = recv(clientSock, reinterpret_cast<char*>(&mode), sizeof(mode), MSG_WAITALL);
         if (bytesReceived == SOCKET_ERROR) {
             std::cerr << "Failed to receive data: " << WSAGetLastError() << std::endl;
             closesocket(clientSock);
@@ -283,32 +388,101 @@ public:
             return false;
         }
 
-        uint16_t width = buffer[0];
-        uint16_t height = buffer[1];
-        uint16_t refreshRate = buffer[2];
-        m_Compress = static_cast<bool>(buffer[3]);
-
-        std::cout << "Received resolution: " << width << "x" << height << " @ " << refreshRate << "Hz" << " " << (m_Compress ? "Compressed" : "Raw") << std::endl;
+        FrameCodec::OutputSet outputs = {};
+        bytesReceived = recv(clientSock, reinterpret_cast<char*>(&outputs), sizeof(outputs), MSG_WAITALL);
+        const bool adaptive = static_cast<FrameCodec::PixelFormat>(mode.format) == FrameCodec::PixelFormat::YUVAdaptive;
+        if (bytesReceived != sizeof(outputs) || !FrameCodec::IsValidSessionMode(mode) || !FrameCodec::IsValidOutputSet(outputs) ||
+            (outputs.count > 1 && (FrameCodec::IsPlanarYuv(static_cast<FrameCodec::PixelFormat>(mode.format)) || mode.pull)) ||
+            (adaptive && (mode.pull || !CPU_YUV_ENABLED))) {
+            std::cerr << "Client sent an invalid mode." << std::endl;
+            closesocket(clientSock);
+            closesocket(listenSock);
+            return false;
+        }
+        m_OutputSet = outputs;
+        SetMode(mode);
+
+        std::cout << "Received resolution: " << m_Width << "x" << m_Height << " @ " << m_RefreshRate << "Hz" << " " << FormatName(m_Format)
+                  << (m_Compress ? std::string(" ") + FrameCodec::GetYuvMatrix(m_ColorSpace).name : "") << " " << (m_Pull ? "Pull" : "Push") << std::endl;
+        if (m_Pull) std::cout << "Pulling whole " << (m_Compress ? "YUV" : "BGRA") << " frames" << std::endl;
+        else if (!m_Compress) std::cout << "Tile cache: " << m_TileCacheSize << " tiles" << std::endl;
+        else std::cout << "Bands: " << m_BandCount << std::endl;
+        for (unsigned int i = 1; i < m_OutputSet.count; ++i) {
+            const FrameCodec::OutputDesc& output = m_OutputSet.outputs[i];
+            std::cout << "Output " << i << ": " << output.width << "x" << output.height << " @ " << output.refreshRate << "Hz at "
+                      << output.left << "," << output.top << std::endl;
+        }
 
-        m_Width = width;
-        m_Height = height;
-        m_RefreshRate = refreshRate;
+        if (!SyncClock(clientSock)) {
+            std::cerr << "Clock sync failed; latency figures will include the clock difference." << std::endl;
+        }
 
         closesocket(clientSock);
         closesocket(listenSock);
         return true;
     }
 
-    bool Setup(char* localAddr) {
-        m_YPlaneSize = m_Width * m_Height;
-        m_UVPlaneSize = m_Width * (m_Height / 2) * 2;
+    FrameCodec::SessionMode GetMode() const {
+        return { m_Width, m_Height, m_RefreshRate, static_cast<uint16_t>(m_Format), m_TileCacheSize, m_BandCount, static_cast<uint16_t>(m_Pull),
+                 static_cast<uint16_t>(m_ColorSpace) };
+    }
 
+    void SetMode(const FrameCodec::SessionMode& mode) {
+        m_Width = mode.width;
+        m_Height = mode.height;
+        m_RefreshRate = mode.refreshRate;
+        m_Format = static_cast<FrameCodec::PixelFormat>(mode.format);
+        m_Compress = FrameCodec::IsPlanarYuv(m_Format);
+        if (m_Compress) m_PlanarFormat = m_Format;
+        else m_RawFormat = m_Format;
+        m_ColorSpace = static_cast<FrameCodec::ColorSpace>(mode.colorSpace);
+        m_TileCacheSize = mode.tileCacheSize;
+        m_BandCount = mode.bandCount;
+        m_Pull = mode.pull != 0;
+
+        // Sessions with a single output renegotiate it; the mode is output 0's
+        if (m_OutputSet.count <= 1) m_OutputSet = { 1, { { 0, 0, m_Width, m_Height, m_RefreshRate, 0 } } };
+    }
+
+    // Codec state and buffer layout for the current mode, at setup and again after every mode change
+    void ConfigureMode() {
+        const FrameCodec::SessionMode mode = GetMode();
+        m_YPlaneSize = m_Width * m_Height;
+        m_UVPlaneSize = static_cast<unsigned long>(FrameCodec::PlanarFrameSize(m_Format, m_Width, m_Height) - m_YPlaneSize);
+
+        // Pulled frames may be skipped, so each one must stand alone: no tile deltas.
+        // Outputs share the one slot, so it is sized for the largest.
+        m_LengthPerFrame = 0;
+        for (unsigned int i = 0; i < m_OutputSet.count; ++i) {
+            const FrameCodec::SessionMode outputMode = FrameCodec::OutputMode(mode, m_OutputSet.outputs[i]);
+            m_LengthPerFrame = std::max(m_LengthPerFrame, static_cast<unsigned long>(FrameCodec::MaxFramePayload(outputMode)));
+        }
+        m_Bands.reset();
+        m_DeltaDecoders.clear();
+        m_YuvDecoder.reset();
         if (m_Compress) {
-            m_LengthPerFrame = m_YPlaneSize + m_UVPlaneSize;
-        } else {
-            m_LengthPerFrame = m_Width * m_Height * 4;
+            m_Bands = std::make_unique<FrameCodec::PlanarBands>(m_Width, m_Height, m_Pull ? 1 : m_BandCount, m_Format);
+            if (CPU_YUV_ENABLED) {
+                m_YuvDecoder = std::make_unique<FrameCodec::YuvDecoder>(m_Width, m_Height, m_Format, m_ColorSpace);
+                m_Decoded.resize(static_cast<size_t>(m_Width) * m_Height * 4);
+            }
+        } else if (!m_Pull) {
+            for (unsigned int i = 0; i < m_OutputSet.count; ++i) {
+                const FrameCodec::OutputDesc& output = m_OutputSet.outputs[i];
+                m_DeltaDecoders.push_back(std::make_unique<FrameCodec::DeltaDecoder>(output.width, output.height));
+                m_DeltaDecoders.back()->SetTileCache(m_TileCacheSize);
+                m_DeltaDecoders.back()->EnableLossless(m_Format == FrameCodec::PixelFormat::BGRALossless);
+            }
         }
-        m_BufferSize = 1 + m_LengthPerFrame;
+        m_BufferSize = static_cast<unsigned long>(FrameCodec::FrameSlotSize(m_LengthPerFrame));
+        m_Canvas = std::make_unique<FrameCodec::OutputCanvas>(m_OutputSet, FrameCodec::ChooseCanvasLayout(m_OutputSet));
+        const FrameCodec::Placement& first = (*m_Canvas)[0];
+        m_CursorOriginX.store(m_OutputSet.count > 1 ? static_cast<int>(first.x) : 0, std::memory_order_relaxed);
+        m_CursorOriginY.store(m_OutputSet.count > 1 ? static_cast<int>(first.y) : 0, std::memory_order_relaxed);
+    }
+
+    bool Setup(char* localAddr) {
+        ConfigureMode();
 
         if (!Initialize(localAddr)) return false;
 
@@ -327,13 +501,7 @@ public:
         if (FAILED(CreateMR())) return false;
 
 
-        ULONG flags = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
-        if (FAILED(RegisterDataBuffer(m_BufferSize, flags))) return false;
-
-        ND2_SGE sge = { 0 };
-        sge.Buffer = m_Buf;
-        sge.BufferLength = m_BufferSize;
-        sge.MemoryRegionToken = m_pMr->GetLocalToken();
+        if (FAILED(RegisterDataBuffer(static_cast<DWORD>(m_Arena.Reserve(m_BufferSize)), BUFFER_MR_FLAGS))) return false;
 
         if (FAILED(CreateListener())) return false;
         if (FAILED(CreateConnector())) return false;
@@ -345,7 +513,7 @@ public:
         }
 
         m_Renderer = std::make_unique<D2DPresentation::D2DRenderer>();
-        m_Window = std::make_unique<D2DPresentation::D2DWindow>("RDMA Texture Preview", m_Width, m_Height);
+        m_Window = std::make_unique<D2DPresentation::D2DWindow>("RDMA Texture Preview", m_Canvas->GetWidth(), m_Canvas->GetHeight());
 
         m_Window->Start();
 
@@ -353,7 +521,7 @@ public:
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
 
-        HRESULT hr = m_Renderer->Initialize(nullptr, m_hWnd, m_Width, m_Height, nullptr);
+        HRESULT hr = m_Renderer->Initialize(nullptr, m_hWnd, m_Canvas->GetWidth(), m_Canvas->GetHeight(), nullptr);
         if (FAILED(hr)) {
             std::cerr << "D2DRenderer initialization failed: " << std::hex << hr << std::endl;
             CoUninitialize();
@@ -362,7 +530,11 @@ public:
 
         m_Window->DisplayWindow();
 
-        if (!CreateTexutres()) {
+        if (m_OutputSet.count > 1) {
+            std::cout << "Canvas: " << m_Canvas->GetWidth() << "x" << m_Canvas->GetHeight() << " "
+                      << (m_Canvas->GetLayout() == FrameCodec::CanvasLayout::Composite ? "composited" : "tiled") << std::endl;
+        }
+        if (!m_Canvas->Fits() || !CreateTexutres()) {
             std::cerr << "Failed to create textures." << std::endl;
             CoUninitialize();
             return false;
@@ -387,7 +559,7 @@ public:
         if (FAILED(Accept(1, 1, nullptr, 0))) return;
         
         CreateMW();
-        Bind(m_Buf, m_BufferSize, ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ);
+        Bind(m_Buf, static_cast<DWORD>(m_Arena.GetCapacity()), BUFFER_MW_FLAGS);
     }
 
     void ExchangePeerInfo() {
@@ -439,8 +611,224 @@ public:
         memset(m_Buf, 0, m_BufferSize);
     }
 
+    // Tops the receive queue up to `count` frame signals
+    bool PostFrameReceives(unsigned int count) {
+        ND2_SGE sge = { m_Buf, sizeof(FrameCodec::FrameSignal), m_pMr->GetLocalToken() };
+        while (m_PostedReceives < count) {
+            if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+                std::cerr << "PostReceive for frame data failed." << std::endl;
+                return false;
+            }
+            m_PostedReceives++;
+        }
+        return true;
+    }
+
+    bool WaitForFrameSignal() {
+        if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
+            std::cerr << "WaitForCompletion for frame data failed." << std::endl;
+            return false;
+        }
+        m_PostedReceives--;
+        return true;
+    }
+
+    // Compressed mode's wait for the next frame. A cursor move meanwhile presents the last frame again under the new
+    // pointer, as raw mode's nudge does, instead of leaving it for the next frame or keep-alive.
+    bool WaitForFrameSignalOrCursor() {
+        auto presentCursor = [this] {
+            if (!m_CursorDirty.exchange(false, std::memory_order_relaxed)) return;
+            FrameCodec::TraceBegin("Present", "present");
+            m_Renderer->Render();
+            FrameCodec::TraceEnd("Present", "present");
+        };
+        if (!WaitForCompletionAndCheckContext(RECV_CTXT, m_CursorWake, presentCursor)) {
+            std::cerr << "WaitForCompletion for frame data failed." << std::endl;
+            return false;
+        }
+        m_PostedReceives--;
+        return true;
+    }
+
+    // Raises the flag the client polls for, with the viewer's latest mode request beside it
+    void ArmReceiver() {
+        {
+            std::lock_guard<std::mutex> lock(m_RequestMutex);
+            memcpy(static_cast<uint8_t*>(m_Buf) + FrameCodec::MODE_REQUEST_OFFSET, &m_Request, sizeof(m_Request));
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        *reinterpret_cast<uint8_t*>(m_Buf) = 2;
+    }
+
+    // Asks the client to flip between raw and the last compressed format (4:4:0 unless the session started in another);
+    // it answers with a mode-change frame once it has
+    void RequestCodecSwitch() {
+        if (m_OutputSet.count > 1) {
+            std::cout << std::endl << "Compressed frames are single-output only." << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_RequestMutex);
+        m_Request.serial++;
+        m_Request.mode = GetMode();
+        m_Request.mode.format = static_cast<uint16_t>(m_Compress ? m_RawFormat : m_PlanarFormat);
+        if (m_Request.mode.bandCount == 0) m_Request.mode.bandCount = 1;
+        std::cout << std::endl << "Requesting " << FormatName(static_cast<FrameCodec::PixelFormat>(m_Request.mode.format)) << " frames" << std::endl;
+    }
+
+    // The client's mode-change frame was the last one in the old mode and nothing is posted on this side any more,
+    // so the buffer can be laid out again (or regrown) and its PeerInfo sent back over the live connection
+    bool ApplyModeChange(const FrameCodec::SessionMode& mode) {
+        auto start = std::chrono::steady_clock::now();
+
+        SetMode(mode);
+        ConfigureMode();
+
+        const size_t capacity = m_Arena.Reserve(m_BufferSize);
+        if (capacity && FAILED(ResizeDataBuffer(static_cast<DWORD>(capacity), BUFFER_MR_FLAGS, BUFFER_MW_FLAGS))) {
+            std::cerr << "Failed to grow the frame buffer to " << capacity << " bytes." << std::endl;
+            return false;
+        }
+        memset(m_Buf, 0, m_Arena.GetCapacity());
+
+        if (!CreateTexutres()) return false;
+
+        // Clear of the flag line, so the client can't mistake it for an armed receiver
+        PeerInfo* myInfo = reinterpret_cast<PeerInfo*>(static_cast<uint8_t*>(m_Buf) + FrameCodec::FRAME_HEADER_OFFSET);
+        myInfo->remoteAddr = reinterpret_cast<UINT64>(m_Buf);
+        myInfo->remoteToken = m_pMw->GetRemoteToken();
+        ND2_SGE sge = { myInfo, sizeof(PeerInfo), m_pMr->GetLocalToken() };
+        if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
+            std::cerr << "Send of my PeerInfo failed." << std::endl;
+            return false;
+        }
+        if (!WaitForCompletionAndCheckContext(SEND_CTXT)) {
+            std::cerr << "WaitForCompletion for my PeerInfo send failed." << std::endl;
+            return false;
+        }
+        memset(myInfo, 0, sizeof(PeerInfo));
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << std::endl << "Switched to " << m_Width << "x" << m_Height << " @ " << m_RefreshRate << "Hz "
+                  << FormatName(m_Format) << " in " << elapsed.count() / 1000.0 << "ms, "
+                  << (capacity ? "buffer grown to " : "buffer reused at ") << m_Arena.GetCapacity() << " bytes" << std::endl;
+        return true;
+    }
+
+    void UploadBand(ID3D11DeviceContext* context, const uint8_t* payload, const FrameCodec::Band& band) {
+        const uint8_t* y = payload + band.offset;
+        if (CPU_YUV_ENABLED) {
+            // Decoded straight into the frame texture's rows; DecompressTexture() is skipped
+            const size_t pitch = static_cast<size_t>(m_Width) * 4;
+            if (m_Format != FrameCodec::PixelFormat::YUVAdaptive) {
+                m_YuvDecoder->DecodeRows(y, m_Width, y + band.ySize, m_Bands->GetUVPitch(), band.firstRow, band.rows, m_Decoded.data(), pitch);
+            } else if (!m_YuvDecoder->DecodeAdaptiveRows(y, m_Width, y + band.ySize, band.size - band.ySize, band.firstRow, band.rows, m_Decoded.data(), pitch)) {
+                std::cerr << "Band at row " << band.firstRow << " has a corrupt chroma map; skipped." << std::endl;
+                return;
+            }
+            D3D11_BOX box = { 0, band.firstRow, 0, m_Width, band.firstRow + band.rows, 1 };
+            std::lock_guard<std::mutex> lock(m_Renderer->GetContextMutex());
+            context->UpdateSubresource(m_FrameTexture.Get(), 0, &box, m_Decoded.data() + band.firstRow * pitch, static_cast<UINT>(pitch), 0);
+            return;
+        }
+
+        const UINT uvPitch = static_cast<UINT>(m_Bands->GetUVPitch());
+        D3D11_BOX yBox = { 0, band.firstRow, 0, m_Width, band.firstRow + band.rows, 1 };
+        D3D11_BOX uvBox = { 0, band.uvRow, 0, uvPitch / 2, band.uvRow + band.uvRows, 1 };
+
+        std::lock_guard<std::mutex> lock(m_Renderer->GetContextMutex());
+        context->UpdateSubresource(m_YPlaneTexture.Get(), 0, &yBox, y, m_Width, 0);
+        if (band.uvRows) context->UpdateSubresource(m_UVPlaneTexture.Get(), 0, &uvBox, y + band.ySize, uvPitch, 0);
+    }
+
+    // Round trips over the handshake socket so the client's timestamps can be moved into this machine's clock
+    bool SyncClock(SOCKET sock) {
+        BOOL noDelay = TRUE;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        FrameCodec::ClockSync clock;
+        for (unsigned int i = 0; i < FrameCodec::CLOCK_SYNC_ROUNDS; ++i) {
+            uint64_t localSend = FrameCodec::FrameClockNow();
+            uint64_t remote = 0;
+            if (send(sock, reinterpret_cast<const char*>(&localSend), sizeof(localSend), 0) != sizeof(localSend)) return false;
+            if (recv(sock, reinterpret_cast<char*>(&remote), sizeof(remote), MSG_WAITALL) != sizeof(remote)) return false;
+            clock.AddSample(localSend, remote, FrameCodec::FrameClockNow());
+        }
+
+        m_Tracer.SetClock(clock);
+        std::cout << "Clock offset: " << clock.GetOffset() / 1000 << "us (+-" << clock.GetRoundTrip() / 2000 << "us)" << std::endl;
+        return true;
+    }
+
+    // After m_Tracer.End() closed a frame: counts it and its glass-to-glass time for the metrics exporter. Repaints of
+    // the last frame, for a keep-alive or a cursor move, close nothing and aren't counted.
+    void RecordPresented() {
+        m_Metrics.presented.Add();
+        if (const uint64_t total = m_Tracer.GetLastTotal()) m_Metrics.g2g.Record(total / 1000);
+    }
+
+    // Validates what the client just wrote and tracks the sequence. nullptr means the stream can't be trusted.
+    const FrameCodec::FrameHeader* ReceiveFrameHeader(FrameCodec::PixelFormat format) {
+        const uint8_t* base = static_cast<const uint8_t*>(m_Buf);
+        FrameCodec::FrameHeaderStatus status;
+        const FrameCodec::FrameHeader* header = FrameCodec::ParseFrameHeader(base + FrameCodec::FRAME_HEADER_OFFSET,
+                                                                             m_BufferSize - FrameCodec::FRAME_HEADER_OFFSET, status);
+        if (!header) {
+            std::cerr << "Bad frame header: " << FrameCodec::FrameHeaderStatusString(status) << std::endl;
+            return nullptr;
+        }
+
+        // The buffer may be laid out for a larger mode than this one; the receive slots only hold this mode's payloads
+        if (header->payloadSize > m_LengthPerFrame) {
+            std::cerr << "Frame " << header->sequence << " carries " << header->payloadSize << " bytes, more than the mode's "
+                      << m_LengthPerFrame << "." << std::endl;
+            return nullptr;
+        }
+
+        if (header->output >= m_OutputSet.count) {
+            std::cerr << "Frame " << header->sequence << " is for output " << header->output << ", which was never announced." << std::endl;
+            return nullptr;
+        }
+
+        // Tile deltas may arrive at a scaled-down size; the size itself says which level
+        const FrameCodec::OutputDesc& output = m_OutputSet.outputs[header->output];
+        const bool control = (header->flags & (FrameCodec::FRAME_FLAG_KEEPALIVE | FrameCodec::FRAME_FLAG_MODE_CHANGE)) != 0;
+        FrameCodec::ScaleLevel level;
+        const bool sizeMatches = (header->width == output.width && header->height == output.height) ||
+            (header->encoding != FrameCodec::PayloadEncoding::Planar && FrameCodec::FindScaleLevel(output.width, output.height, header->width, header->height, level));
+        if (!control && (header->format != format || !sizeMatches)) {
+            std::cerr << "Frame " << header->sequence << " does not match the negotiated mode: "
+                      << header->width << "x" << header->height << " format " << static_cast<int>(header->format) << std::endl;
+            return nullptr;
+        }
+
+        if (header->flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) {
+            const FrameCodec::SessionMode* mode = reinterpret_cast<const FrameCodec::SessionMode*>(FrameCodec::GetFramePayload(header));
+            if (header->payloadSize != sizeof(FrameCodec::SessionMode) || !FrameCodec::IsValidSessionMode(*mode) || (mode->pull != 0) != m_Pull ||
+                m_OutputSet.count > 1) {
+                std::cerr << "Frame " << header->sequence << " asks for a mode this session can't switch to." << std::endl;
+                return nullptr;
+            }
+        }
+
+        // Where a streamed region sat; the pointer arrives in output coordinates
+        if (!control && header->output == 0) {
+            m_RegionLeft.store(header->regionLeft, std::memory_order_relaxed);
+            m_RegionTop.store(header->regionTop, std::memory_order_relaxed);
+        }
+
+        if (m_FramesReceived > 0 && header->sequence > m_LastSequence + 1) {
+            m_LostFrames += header->sequence - m_LastSequence - 1;
+            m_Metrics.lost.Add(header->sequence - m_LastSequence - 1);
+        }
+        m_LastSequence = header->sequence;
+        m_FramesReceived++;
+        m_Metrics.received.Add();
+        return header;
+    }
+
     void CompressLoop() {
-        unsigned int frames = 0;
+        unsigned int frames = 0;   // New frames presented, for the FPS
+        unsigned int presents = 0; // Those and the repaints, which the timings average over
         auto lastTime = std::chrono::steady_clock::now();
 
         ComPtr<ID3D11Device> d3dDevice = m_Renderer->GetD3DDevice();
@@ -458,25 +846,18 @@ public:
         while (isWindowOpen && !g_shouldQuit.load()) {
             isWindowOpen = m_Window->isRunning();
             auto flagWaitStart = std::chrono::steady_clock::now();
-            sge.Buffer = m_Buf;
-            sge.BufferLength = 1;
-            sge.MemoryRegionToken = m_pMr->GetLocalToken();
-            if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
-                std::cerr << "PostReceive for frame data failed." << std::endl;
-                break;
-            }
+            // One signal per band; all of them must be posted before the client may start
+            if (!PostFrameReceives(m_Bands->GetCount())) break;
             DPRINT("PR for frame");
 
-            *reinterpret_cast<uint8_t*>(m_Buf) = 2;
+            ArmReceiver();
 
-            if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
-                std::cerr << "WaitForCompletion for frame data failed." << std::endl;
-                break;
-            }
+            if (!WaitForFrameSignalOrCursor()) break;
             DPRINT("Completion for frame");
 
             auto flagWaitEnd = std::chrono::steady_clock::now();
             FlagWaitTotal += std::chrono::duration_cast<std::chrono::microseconds>(flagWaitEnd - flagWaitStart);
+            const uint64_t receivedTime = FrameCodec::FrameClockNow();
 
 
             auto decompressStart = std::chrono::steady_clock::now();
@@ -485,17 +866,48 @@ public:
             if (flag == 1) {
                 std::atomic_thread_fence(std::memory_order_acquire);
 
-                uint8_t* frameData = reinterpret_cast<uint8_t*>(m_Buf) + 1;
-
-                d3dContext->UpdateSubresource(m_YPlaneTexture.Get(), 0, nullptr, frameData, m_Width, 0);
-                d3dContext->UpdateSubresource(m_UVPlaneTexture.Get(), 0, nullptr, frameData + m_YPlaneSize, m_Width * 2, 0);
+                const FrameCodec::FrameHeader* header = ReceiveFrameHeader(m_Format);
+                if (!header) break;
 
-                m_Renderer->DecompressTexture(m_YPlaneTexture.Get(), m_UVPlaneTexture.Get(), m_FrameTexture.Get());
-
-                m_Renderer->SetSourceSurface(m_FrameTexture.Get());
+                // The client sends the rest of this frame's signals empty, so nothing stays posted into the old buffer
+                if (header->flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) {
+                    m_PendingMode = *reinterpret_cast<const FrameCodec::SessionMode*>(FrameCodec::GetFramePayload(header));
+                    while (m_PostedReceives > 0 && WaitForFrameSignal()) {}
+                    if (m_PostedReceives > 0) m_PendingMode.reset();
+                    break;
+                }
 
-                D3D11_TEXTURE2D_DESC desc;
-                m_FrameTexture->GetDesc(&desc);
+                // Keep-alives carry no payload; the last frame is simply presented again
+                if (!(header->flags & FrameCodec::FRAME_FLAG_KEEPALIVE)) {
+                    if (header->payloadSize != m_LengthPerFrame || header->bandCount != m_Bands->GetCount()) {
+                        std::cerr << "Unexpected compressed frame: " << header->payloadSize << " bytes in " << header->bandCount << " bands" << std::endl;
+                        break;
+                    }
+
+                    // Each band is uploaded as soon as it lands while the next one is still on the wire
+                    const uint8_t* frameData = FrameCodec::GetFramePayload(header);
+                    uint64_t lastReceivedTime = receivedTime;
+                    bool complete = true;
+                    for (unsigned int i = 0; i < m_Bands->GetCount(); ++i) {
+                        if (i > 0) {
+                            if (!WaitForFrameSignal()) {
+                                complete = false;
+                                break;
+                            }
+                            lastReceivedTime = FrameCodec::FrameClockNow();
+                        }
+                        UploadBand(d3dContext.Get(), frameData, (*m_Bands)[i]);
+                    }
+                    if (!complete) break;
+
+                    m_Tracer.Begin(*header, static_cast<const FrameCodec::FrameSignal*>(m_Buf)->writeDoneTime);
+                    m_Tracer.Stamp(FrameCodec::TraceStage::Received, lastReceivedTime);
+
+                    if (!CPU_YUV_ENABLED) m_Renderer->DecompressTexture(m_YPlaneTexture.Get(), m_UVPlaneTexture.Get(), m_FrameTexture.Get());
+                    m_Tracer.Stamp(FrameCodec::TraceStage::Uploaded);
+
+                    m_Renderer->SetSourceSurface(m_FrameTexture.Get());
+                }
             } else {
                 throw std::exception();
             }
@@ -506,18 +918,28 @@ public:
             lastDraw = std::chrono::steady_clock::now();
             
             auto drawStart = std::chrono::steady_clock::now();
+            FrameCodec::TraceBegin("Present", "present");
+            m_CursorDirty.store(false, std::memory_order_relaxed);
             m_Renderer->Render();
+            FrameCodec::TraceEnd("Present", "present");
+            m_Tracer.Stamp(FrameCodec::TraceStage::Presented);
+            const bool presented = m_Tracer.End();
+            if (presented) RecordPresented();
             auto drawEnd = std::chrono::steady_clock::now();
             DrawTotal += std::chrono::duration_cast<std::chrono::microseconds>(drawEnd - drawStart);
 
-            frames++;
+            if (presented) frames++;
+            presents++;
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::seconds>(now - lastTime).count() >= 1) {
                 std::cout << "\r                                                                                                       \r";
-                std::cout << "FPS: " << frames << " | FlagWait: " << FlagWaitTotal.count() / frames
-                          << "us | Decompress: " << DecompressTotal.count() / frames
-                          << "us | Draw: " << DrawTotal.count() / frames << "us" << std::flush;
+                std::cout << "FPS: " << frames << " | FlagWait: " << FlagWaitTotal.count() / presents
+                          << "us | Decompress: " << DecompressTotal.count() / presents
+                          << "us | Draw: " << DrawTotal.count() / presents << "us"
+                          << " | Lost: " << m_LostFrames.load()
+                          << " | G2G p50: " << m_Tracer.GetTotal().p50 / 1000 << "us p99: " << m_Tracer.GetTotal().p99 / 1000 << "us" << std::flush;
                 frames = 0;
+                presents = 0;
                 FlagWaitTotal = std::chrono::microseconds(0);
                 DecompressTotal = std::chrono::microseconds(0);
                 DrawTotal = std::chrono::microseconds(0);
@@ -530,100 +952,203 @@ public:
                     std::cout << "Exiting..." << std::endl;
                     break;
                 }
+                if (c == 'm' || c == 'M') RequestCodecSwitch();
             }
         }
-        
+
+        if (m_PendingMode) return;
         Shutdown();
+    }
 
-        g_shouldQuit.store(true);
+    // Network side of Loop(): each frame is copied out of the RDMA buffer into the ring and the next one is
+    // re-armed right away, so the client's wait for the flag no longer includes upload, present or vsync
+    void ReceiveLoop() {
+        ND2_SGE sge = { m_Buf, sizeof(FrameCodec::FrameSignal), m_pMr->GetLocalToken() };
+        FrameCodec::TraceRecorder::Instance().SetThreadName("receive");
 
-        m_Renderer->Cleanup();
-        m_Window->Stop();
-        CoUninitialize();
+        // Exactly one receive per arm, so none is left posted into the buffer when a mode change replaces it
+        while (!m_StopReceiving.load()) {
+            if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+                std::cerr << "PostReceive for frame data failed." << std::endl;
+                break;
+            }
+
+            ArmReceiver();
+
+            if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
+                if (!m_StopReceiving.load()) std::cerr << "WaitForCompletion for frame data failed." << std::endl;
+                break;
+            }
+            const uint64_t receivedTime = FrameCodec::FrameClockNow();
+
+            if (*static_cast<unsigned char*>(m_Buf) != 1) {
+                std::cerr << "Unexpected frame signal." << std::endl;
+                break;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            const FrameCodec::FrameHeader* header = ReceiveFrameHeader(m_Format);
+            if (!header) break;
+
+            if (!m_Ring->WaitForSpace()) break;
+            ReceivedFrame& slot = m_Received[m_Ring->GetWriteSlot()];
+            slot.header = *header;
+            slot.writeDoneTime = static_cast<const FrameCodec::FrameSignal*>(m_Buf)->writeDoneTime;
+            slot.receivedTime = receivedTime;
+            memcpy(slot.payload.data(), FrameCodec::GetFramePayload(header), header->payloadSize);
+            m_Ring->Push();
+
+            // Left unarmed: Loop() relays the buffer once it reaches this frame
+            if (header->flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) break;
+
+            m_AckMicros.fetch_add((FrameCodec::FrameClockNow() - receivedTime) / 1000, std::memory_order_relaxed);
+            m_AckCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_Ring->Close();
     }
 
+    // Render side of raw mode. Every delta in the ring is applied in order, but only the newest result is uploaded
+    // and presented; the ones it replaced are counted as superseded.
     void Loop() {
-        unsigned int frames = 0;
+        unsigned int frames = 0;   // New frames presented, for the FPS
+        unsigned int presents = 0; // Those and the repaints, which the timings average over
         auto lastTime = std::chrono::steady_clock::now();
 
         ComPtr<ID3D11Device> d3dDevice = m_Renderer->GetD3DDevice();
         ComPtr<ID3D11DeviceContext> d3dContext = m_Renderer->GetD3DContext();
 
-        auto lastDraw = std::chrono::steady_clock::time_point::max();
-        ND2_SGE sge = { 0 };
-
-        auto FlagWaitTotal = std::chrono::microseconds(0);
+        auto WaitTotal = std::chrono::microseconds(0);
         auto DecompressTotal = std::chrono::microseconds(0);
         auto DrawTotal = std::chrono::microseconds(0);
+        unsigned long long Superseded = 0;
+        unsigned long long Rescaled = 0;
+        std::array<unsigned short, FrameCodec::MAX_OUTPUTS> decodedWidth = {}; // Size the client currently sends each output at
+        std::array<unsigned short, FrameCodec::MAX_OUTPUTS> decodedHeight = {};
+        for (unsigned int i = 0; i < m_OutputSet.count; ++i) {
+            decodedWidth[i] = m_OutputSet.outputs[i].width;
+            decodedHeight[i] = m_OutputSet.outputs[i].height;
+        }
 
-        bool isWindowOpen = true;
-
-        sge.Buffer = m_Buf;
-        sge.BufferLength = 1;
-        sge.MemoryRegionToken = m_pMr->GetLocalToken();
-        if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
-            std::cerr << "PostReceive for frame data failed." << std::endl;
-            return;
+        m_Received.resize(RECEIVE_RING_SLOTS);
+        for (ReceivedFrame& frame : m_Received) frame.payload.resize(m_LengthPerFrame);
+        {
+            std::lock_guard<std::mutex> lock(m_RingMutex);
+            m_Ring = std::make_unique<FrameCodec::FrameRing>(RECEIVE_RING_SLOTS);
         }
+        m_StopReceiving.store(false);
+        std::thread receiver(&TestServer::ReceiveLoop, this);
+        FrameCodec::TraceRecorder::Instance().SetThreadName("render");
+
+        bool isWindowOpen = true;
 
         while (isWindowOpen && !g_shouldQuit.load()) {
             isWindowOpen = m_Window->isRunning();
-            auto flagWaitStart = std::chrono::steady_clock::now();
-            sge.Buffer = m_Buf;
-            sge.BufferLength = 1;
-            sge.MemoryRegionToken = m_pMr->GetLocalToken();
-            if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
-                std::cerr << "PostReceive for frame data failed." << std::endl;
-                break;
-            }
 
-            *reinterpret_cast<uint8_t*>(m_Buf) = 2;
+            // Keep-alives come through the ring too, so this wakes at least every KEEPALIVE_INTERVAL; cursor moves nudge it
+            auto waitStart = std::chrono::steady_clock::now();
+            if (!m_Ring->WaitForFrame()) break;
+            auto waitEnd = std::chrono::steady_clock::now();
+            WaitTotal += std::chrono::duration_cast<std::chrono::microseconds>(waitEnd - waitStart);
 
-            if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
-                std::cerr << "WaitForCompletion for frame data failed." << std::endl;
+            auto decompressStart = std::chrono::steady_clock::now();
+            FrameCodec::FrameHeader newest = {};
+            uint64_t newestWriteDone = 0;
+            uint64_t newestReceived = 0;
+            bool hasFrame = false;
+            bool malformed = false;
+            std::array<bool, FrameCodec::MAX_OUTPUTS> updated = {};
+
+            for (unsigned int pending = m_Ring->GetCount(); pending > 0; --pending) {
+                const ReceivedFrame& frame = m_Received[m_Ring->GetReadSlot()];
+                if (frame.header.flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) {
+                    m_PendingMode = *reinterpret_cast<const FrameCodec::SessionMode*>(frame.payload.data());
+                    m_Ring->Pop();
+                    break;
+                }
+                if (!(frame.header.flags & FrameCodec::FRAME_FLAG_KEEPALIVE)) {
+                    // The client restarts its encoder from black at every scale switch; follow it
+                    const uint16_t output = frame.header.output;
+                    if (frame.header.width != decodedWidth[output] || frame.header.height != decodedHeight[output]) {
+                        decodedWidth[output] = frame.header.width;
+                        decodedHeight[output] = frame.header.height;
+                        m_DeltaDecoders[output] = std::make_unique<FrameCodec::DeltaDecoder>(decodedWidth[output], decodedHeight[output]);
+                        m_DeltaDecoders[output]->SetTileCache(m_TileCacheSize);
+                        m_DeltaDecoders[output]->EnableLossless(m_Format == FrameCodec::PixelFormat::BGRALossless);
+                        Rescaled++;
+                    }
+                    if (frame.header.encoding != RawEncoding(m_Format) || !m_DeltaDecoders[output]->Decode(frame.payload.data(), frame.header.payloadSize)) {
+                        malformed = true;
+                        break;
+                    }
+                    if (updated[output]) Superseded++;
+                    updated[output] = true;
+                    newest = frame.header;
+                    newestWriteDone = frame.writeDoneTime;
+                    newestReceived = frame.receivedTime;
+                    hasFrame = true;
+                }
+                m_Ring->Pop();
+            }
+            if (malformed) {
+                std::cerr << "Malformed frame delta." << std::endl;
                 break;
             }
+            if (m_PendingMode) break;
+
+            if (hasFrame) {
+                m_Tracer.Begin(newest, newestWriteDone);
+                m_Tracer.Stamp(FrameCodec::TraceStage::Received, newestReceived);
+                {
+                    std::lock_guard<std::mutex> lock(m_Renderer->GetContextMutex());
+                    for (unsigned int i = 0; i < m_OutputSet.count; ++i) {
+                        if (!updated[i]) continue;
+                        const FrameCodec::Placement& place = (*m_Canvas)[i];
+                        const D3D11_BOX box = { place.x, place.y, 0, place.x + decodedWidth[i], place.y + decodedHeight[i], 1 };
+                        d3dContext->UpdateSubresource(m_FrameTexture.Get(), 0, &box, m_DeltaDecoders[i]->GetFrame(), decodedWidth[i] * 4, 0);
+                    }
+                }
+                m_Tracer.Stamp(FrameCodec::TraceStage::Uploaded);
 
-            auto flagWaitEnd = std::chrono::steady_clock::now();
-            FlagWaitTotal += std::chrono::duration_cast<std::chrono::microseconds>(flagWaitEnd - flagWaitStart);
-
-
-            auto decompressStart = std::chrono::steady_clock::now();
-            uint8_t flag = *static_cast<unsigned char*>(m_Buf);
-
-            if (flag == 1) {
-                std::atomic_thread_fence(std::memory_order_acquire);
-
-                uint8_t* frameData = reinterpret_cast<uint8_t*>(m_Buf) + 1;
-                d3dContext->UpdateSubresource(m_FrameTexture.Get(), 0, nullptr, frameData, m_Width * 4, 0);
-
-                m_Renderer->SetSourceSurface(m_FrameTexture.Get());
-
-
-                D3D11_TEXTURE2D_DESC desc;
-                m_FrameTexture->GetDesc(&desc);
-            } else {
-                throw std::exception();
+                // A downscaled frame fills the top-left of the texture and is stretched back on present.
+                // Only single-output sessions scale, so several outputs always fill the whole canvas.
+                if (m_OutputSet.count > 1) m_Renderer->SetSourceSurface(m_FrameTexture.Get());
+                else m_Renderer->SetSourceSurface(m_FrameTexture.Get(), decodedWidth[0], decodedHeight[0]);
             }
             auto decompressEnd = std::chrono::steady_clock::now();
             DecompressTotal += std::chrono::duration_cast<std::chrono::microseconds>(decompressEnd - decompressStart);
 
-            lastDraw = std::chrono::steady_clock::now();
-            
             auto drawStart = std::chrono::steady_clock::now();
+            FrameCodec::TraceBegin("Present", "present");
+            m_CursorDirty.store(false, std::memory_order_relaxed);
             m_Renderer->Render();
+            FrameCodec::TraceEnd("Present", "present");
+            m_Tracer.Stamp(FrameCodec::TraceStage::Presented);
+            const bool presented = m_Tracer.End();
+            if (presented) RecordPresented();
             auto drawEnd = std::chrono::steady_clock::now();
             DrawTotal += std::chrono::duration_cast<std::chrono::microseconds>(drawEnd - drawStart);
 
-            frames++;
+            if (presented) frames++;
+            presents++;
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::seconds>(now - lastTime).count() >= 1) {
+                const unsigned long long acks = m_AckCount.exchange(0);
+                const unsigned long long ackMicros = m_AckMicros.exchange(0);
+
                 std::cout << "\r                                                                                                                \r";
-                std::cout << "FPS: " << frames << " | FlagWait: " << FlagWaitTotal.count() / frames
-                          << "us | Decompress: " << DecompressTotal.count() / frames
-                          << "us | Draw: " << DrawTotal.count() / frames << "us" << std::flush;
+                std::cout << "FPS: " << frames << " | Wait: " << WaitTotal.count() / presents
+                          << "us | Decompress: " << DecompressTotal.count() / presents
+                          << "us | Draw: " << DrawTotal.count() / presents << "us"
+                          << " | Received: " << acks
+                          << " | Ack: " << (acks ? ackMicros / acks : 0) << "us"
+                          << " | Superseded: " << Superseded
+                          << " | Size: " << decodedWidth[0] << "x" << decodedHeight[0] << " (" << Rescaled << " switches)"
+                          << " | Lost: " << m_LostFrames.load()
+                          << " | G2G p50: " << m_Tracer.GetTotal().p50 / 1000 << "us p99: " << m_Tracer.GetTotal().p99 / 1000 << "us" << std::flush;
                 frames = 0;
-                FlagWaitTotal = std::chrono::microseconds(0);
+                presents = 0;
+                WaitTotal = std::chrono::microseconds(0);
                 DecompressTotal = std::chrono::microseconds(0);
                 DrawTotal = std::chrono::microseconds(0);
                 lastTime = now;
@@ -634,69 +1159,326 @@ public:
                     std::cout << "Exiting..." << std::endl;
                     break;
                 }
+                if (c == 'm' || c == 'M') RequestCodecSwitch();
             }
         }
-        
-        Shutdown();
 
-        g_shouldQuit.store(true);
+        // The network thread stopped on its own after the mode-change frame
+        if (m_PendingMode) {
+            receiver.join();
+            return;
+        }
 
-        m_Renderer->Cleanup();
-        m_Window->Stop();
-        CoUninitialize();
+        // Shutdown() fails the receive the network thread is blocked on
+        m_StopReceiving.store(true);
+        m_Ring->Close();
+        Shutdown();
+        receiver.join();
     }
 
-    void Run(const char* localAddr) {
-        bool a = Announce(const_cast<char*>(localAddr));
-        if (!a) return;
-        #ifndef NOCONTROL
-        inputSession.Start(const_cast<char*>(localAddr));
-        #endif
-
-        #ifndef NOAUDIO
-        audioSession.Start(const_cast<char*>(localAddr));
-        #endif
-        
-        if (!Setup(const_cast<char*>(localAddr))) return;
-        m_Window->RegisterRawInputCallback([this](RAWINPUT rawInput) {
-            inputSession.SendEvent(rawInput);
-        }, inputSession.GetCallbackEvent());
-        OpenListener(localAddr);
-        ExchangePeerInfo();
-        if (m_Compress) CompressLoop();
-        else Loop();
-        inputSession.Stop();
-        audioSession.Stop();
+    // Copies `length` bytes at `remoteOffset` in the client's buffer into `local` and waits for them
+    bool ReadRemote(void* local, UINT64 remoteOffset, size_t length) {
+        ND2_SGE sge = { local, static_cast<ULONG>(length), m_pMr->GetLocalToken() };
+        if (FAILED(Read(&sge, 1, remoteInfo.remoteAddr + remoteOffset, remoteInfo.remoteToken, 0, READ_CTXT))) {
+            std::cerr << "Read of client buffer failed." << std::endl;
+            return false;
+        }
+        if (!WaitForCompletionAndCheckContext(READ_CTXT)) {
+            std::cerr << "WaitForCompletion for client buffer read failed." << std::endl;
+            return false;
+        }
+        return true;
     }
 
-    private:
-    std::unique_ptr<D2DPresentation::D2DRenderer> m_Renderer;
-    std::unique_ptr<D2DPresentation::D2DWindow> m_Window;
-    HWND m_hWnd = nullptr;
-
-    ComPtr<ID3D11Texture2D> m_YPlaneTexture;
-    ComPtr<ID3D11Texture2D> m_UVPlaneTexture;
-    ComPtr<ID3D11Texture2D> m_FrameTexture;
+    // Receiver-paced: whenever this side is ready to present it reads the client's control block, then the newest
+    // slot, then the control block again. Frames published in the meantime are never read at all.
+    void PullLoop() {
+        unsigned int frames = 0;
+        auto lastTime = std::chrono::steady_clock::now();
 
-    std::atomic<bool> m_isRunning = true;
+        ComPtr<ID3D11DeviceContext> d3dContext = m_Renderer->GetD3DContext();
 
-    PeerInfo remoteInfo;
+        const FrameCodec::PixelFormat format = m_Format;
+        const size_t slotSize = FrameCodec::FrameSlotSize(m_LengthPerFrame);
+        const size_t controlOffset = FrameCodec::PullControlOffset(slotSize);
+        uint8_t* base = static_cast<uint8_t*>(m_Buf);
+        const FrameCodec::PullControl* control = reinterpret_cast<const FrameCodec::PullControl*>(m_Buf); // Lands in the flag line, unused in pull mode
+        uint64_t shown = 0;
 
-    InputNDSessionServer inputSession;
-    AudioNDSessionServer audioSession;
+        auto lastDraw = std::chrono::steady_clock::now();
+        auto ReadTotal = std::chrono::microseconds(0);
+        auto UploadTotal = std::chrono::microseconds(0);
+        auto DrawTotal = std::chrono::microseconds(0);
 
-    unsigned short m_Width = 0;
-    unsigned short m_Height = 0;
-    unsigned short m_RefreshRate = 0;
-    bool m_Compress = false;
+        // When the last new frame turned up; an empty poll waits for the next one the refresh rate predicts
+        const auto frameInterval = std::chrono::microseconds(1000000 / std::max<unsigned short>(m_RefreshRate, 1));
+        auto lastNewFrame = std::chrono::steady_clock::now();
 
-    unsigned short m_listenPort = 0;
+        bool isWindowOpen = true;
 
-    unsigned long m_LengthPerFrame = 0;
+        while (isWindowOpen && !g_shouldQuit.load()) {
+            isWindowOpen = m_Window->isRunning();
+            if (_kbhit()) {
+                char c = _getch();
+                if (c == 'q' || c == 'Q') {
+                    std::cout << "Exiting..." << std::endl;
+                    break;
+                }
+            }
+
+            auto readStart = std::chrono::steady_clock::now();
+            if (!ReadRemote(base, controlOffset, sizeof(FrameCodec::PullControl))) break;
+
+            const uint64_t sequence = FrameCodec::LatestSequence(control->latest);
+            const uint32_t slot = FrameCodec::LatestSlot(control->latest);
+            if (sequence == 0 || sequence == shown) {
+                // Nothing new on a static desktop; still present cursor moves, and now and then so the window stays live
+                if (m_CursorDirty.exchange(false, std::memory_order_relaxed) || readStart - lastDraw >= KEEPALIVE_INTERVAL) {
+                    m_Renderer->Render();
+                    lastDraw = readStart;
+                }
+                auto next = lastNewFrame + frameInterval;
+                while (next <= readStart) next += frameInterval;
+                std::this_thread::sleep_until(next);
+                continue;
+            }
+            lastNewFrame = readStart;
+            if (slot >= FrameCodec::PULL_SLOTS) {
+                std::cerr << "Client published slot " << slot << std::endl;
+                break;
+            }
+
+            const uint64_t readStartTime = FrameCodec::FrameClockNow();
+            const size_t slotOffset = FrameCodec::PullSlotOffset(slot, slotSize);
+            if (!ReadRemote(base + FrameCodec::FRAME_HEADER_OFFSET, slotOffset + FrameCodec::FRAME_HEADER_OFFSET,
+                            sizeof(FrameCodec::FrameHeader) + m_LengthPerFrame)) break;
+            if (!ReadRemote(base, controlOffset, sizeof(FrameCodec::PullControl))) break;
+            const uint64_t receivedTime = FrameCodec::FrameClockNow();
+
+            // The client lapped this slot mid-read; the next poll finds a newer frame anyway
+            if (!FrameCodec::PullSlotIntact(*control, slot, sequence)) {
+                m_TornReads++;
+                continue;
+            }
+            ReadTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - readStart);
+
+            const FrameCodec::FrameHeader* header = ReceiveFrameHeader(format);
+            if (!header) break;
+            if (header->sequence != sequence || header->encoding != FrameCodec::PayloadEncoding::Planar || header->payloadSize != m_LengthPerFrame) {
+                std::cerr << "Unexpected pulled frame " << header->sequence << ": " << header->payloadSize << " bytes" << std::endl;
+                break;
+            }
+
+            // Publishing stands in for the write; the slot sat there until this side started reading it
+            m_Tracer.Begin(*header, header->sendTime);
+            m_Tracer.Stamp(FrameCodec::TraceStage::WriteDone, readStartTime);
+            m_Tracer.Stamp(FrameCodec::TraceStage::Received, receivedTime);
+
+            auto uploadStart = std::chrono::steady_clock::now();
+            const uint8_t* payload = FrameCodec::GetFramePayload(header);
+            if (m_Compress) {
+                UploadBand(d3dContext.Get(), payload, (*m_Bands)[0]);
+                if (!CPU_YUV_ENABLED) m_Renderer->DecompressTexture(m_YPlaneTexture.Get(), m_UVPlaneTexture.Get(), m_FrameTexture.Get());
+            } else {
+                std::lock_guard<std::mutex> lock(m_Renderer->GetContextMutex());
+                d3dContext->UpdateSubresource(m_FrameTexture.Get(), 0, nullptr, payload, m_Width * 4, 0);
+            }
+            m_Tracer.Stamp(FrameCodec::TraceStage::Uploaded);
+            m_Renderer->SetSourceSurface(m_FrameTexture.Get());
+            UploadTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - uploadStart);
+
+            auto drawStart = std::chrono::steady_clock::now();
+            FrameCodec::TraceBegin("Present", "present");
+            m_CursorDirty.store(false, std::memory_order_relaxed);
+            m_Renderer->Render();
+            FrameCodec::TraceEnd("Present", "present");
+            m_Tracer.Stamp(FrameCodec::TraceStage::Presented);
+            if (m_Tracer.End()) RecordPresented();
+            lastDraw = std::chrono::steady_clock::now();
+            DrawTotal += std::chrono::duration_cast<std::chrono::microseconds>(lastDraw - drawStart);
+            shown = sequence;
+
+            frames++;
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - lastTime).count() >= 1) {
+                std::cout << "\r                                                                                                                \r";
+                std::cout << "FPS: " << frames << " | Read: " << ReadTotal.count() / frames
+                          << "us | Upload: " << UploadTotal.count() / frames
+                          << "us | Draw: " << DrawTotal.count() / frames << "us"
+                          << " | Skipped: " << m_LostFrames.load()
+                          << " | Torn: " << m_TornReads
+                          << " | G2G p50: " << m_Tracer.GetTotal().p50 / 1000 << "us p99: " << m_Tracer.GetTotal().p99 / 1000 << "us" << std::flush;
+                frames = 0;
+                ReadTotal = std::chrono::microseconds(0);
+                UploadTotal = std::chrono::microseconds(0);
+                DrawTotal = std::chrono::microseconds(0);
+                lastTime = now;
+            }
+        }
+
+        Shutdown();
+    }
+
+    void Run(const char* localAddr, const char* tracePath) {
+        if (tracePath && !m_Tracer.OpenCsv(tracePath)) {
+            std::cerr << "Failed to open trace file: " << tracePath << std::endl;
+            return;
+        }
+
+        bool a = Announce(const_cast<char*>(localAddr));
+        if (!a) return;
+        #ifndef NOCONTROL
+        inputSession.Start(const_cast<char*>(localAddr));
+        #endif
+
+        #ifndef NOAUDIO
+        audioSession.Start(const_cast<char*>(localAddr));
+        #endif
+
+        #ifndef NOCURSOR
+        cursorSession.Start(const_cast<char*>(localAddr));
+        #endif
+        
+        if (!Setup(const_cast<char*>(localAddr))) return;
+        m_CursorWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+        m_Window->RegisterRawInputCallback([this](RAWINPUT rawInput) {
+            inputSession.SendEvent(rawInput);
+        }, inputSession.GetCallbackEvent());
+        #ifndef NOCURSOR
+        // Pointer-only motion is presented by the render loop, which is woken for it instead of waiting for the next frame
+        cursorSession.RegisterCallback([this](const FrameCodec::CursorDecoder& cursor) {
+            const FrameCodec::CursorState* shape = cursor.GetShape();
+            if (shape) m_Renderer->SetCursorShape(shape->shapeId, shape->pixels.data(), shape->width, shape->height);
+            m_Renderer->SetCursorPosition(cursor.GetX() - m_RegionLeft.load(std::memory_order_relaxed) + m_CursorOriginX.load(std::memory_order_relaxed),
+                                          cursor.GetY() - m_RegionTop.load(std::memory_order_relaxed) + m_CursorOriginY.load(std::memory_order_relaxed),
+                                          cursor.IsVisible() && shape != nullptr);
+            if (m_CursorDirty.exchange(true, std::memory_order_relaxed)) return;
+            SetEvent(m_CursorWake);
+            std::lock_guard<std::mutex> lock(m_RingMutex);
+            if (m_Ring) m_Ring->Nudge();
+        });
+        #endif
+        OpenListener(localAddr);
+        ExchangePeerInfo();
+        while (true) {
+            if (m_Pull) PullLoop();
+            else if (m_Compress) CompressLoop();
+            else Loop();
+
+            if (!m_PendingMode) break;
+            const FrameCodec::SessionMode mode = *m_PendingMode;
+            m_PendingMode.reset();
+            if (!ApplyModeChange(mode)) {
+                Shutdown();
+                break;
+            }
+        }
+
+        std::cout << std::endl;
+        m_Tracer.Report(std::cout);
+
+        g_shouldQuit.store(true);
+
+        m_Renderer->Cleanup();
+        m_Window->Stop();
+        CoUninitialize();
+
+        inputSession.Stop();
+        audioSession.Stop();
+        cursorSession.Stop();
+        CloseHandle(m_CursorWake);
+    }
+
+    private:
+    std::unique_ptr<D2DPresentation::D2DRenderer> m_Renderer;
+    std::unique_ptr<D2DPresentation::D2DWindow> m_Window;
+    HWND m_hWnd = nullptr;
+
+    ComPtr<ID3D11Texture2D> m_YPlaneTexture;
+    ComPtr<ID3D11Texture2D> m_UVPlaneTexture;
+    ComPtr<ID3D11Texture2D> m_FrameTexture;
+
+    std::vector<std::unique_ptr<FrameCodec::DeltaDecoder>> m_DeltaDecoders; // Receiver's copy of each output's raw frame
+    unsigned short m_TileCacheSize = 0;
+
+    std::unique_ptr<FrameCodec::PlanarBands> m_Bands; // Compressed frames arrive and upload band by band
+    std::unique_ptr<FrameCodec::YuvDecoder> m_YuvDecoder; // With CPU_YUV440, bands are decoded here and uploaded as BGRA
+    std::vector<uint8_t> m_Decoded;
+    unsigned short m_BandCount = 1;
+    unsigned int m_PostedReceives = 0;
+
+    uint64_t m_LastSequence = 0;
+    unsigned long long m_FramesReceived = 0;
+    std::atomic<unsigned long long> m_LostFrames = 0; // Counted on the network thread in raw mode
+    unsigned long long m_TornReads = 0; // Pull mode: slots the client rewrote while they were being read
+    FrameCodec::LatencyTracer m_Tracer; // Capture to present, in this machine's clock
+
+    // What the metrics exporter publishes
+    struct ServerMetrics {
+        FrameCodec::Counter received{ "server.frames_received" };
+        FrameCodec::Counter lost{ "server.frames_lost" };
+        FrameCodec::Counter presented{ "server.frames_presented" };
+        FrameCodec::Histogram g2g{ "server.g2g_us" };
+    };
+    ServerMetrics m_Metrics;
+
+    // Raw mode: frames copied off the wire by ReceiveLoop(), applied and presented by Loop()
+    struct ReceivedFrame {
+        FrameCodec::FrameHeader header;
+        uint64_t writeDoneTime = 0;
+        uint64_t receivedTime = 0;
+        std::vector<uint8_t> payload;
+    };
+    std::vector<ReceivedFrame> m_Received;
+    std::unique_ptr<FrameCodec::FrameRing> m_Ring;
+    std::mutex m_RingMutex; // Replacing m_Ring against the cursor thread nudging it
+    std::atomic<bool> m_CursorDirty = false; // Cursor moved since the last present
+    HANDLE m_CursorWake = nullptr; // Set with m_CursorDirty; compressed mode waits on it beside the frame signal
+    std::atomic<bool> m_StopReceiving = false;
+    std::atomic<unsigned long long> m_AckMicros = 0; // Signal received to next frame re-armed
+    std::atomic<unsigned long long> m_AckCount = 0;
+
+    std::atomic<bool> m_isRunning = true;
+
+    PeerInfo remoteInfo;
+
+    InputNDSessionServer inputSession;
+    AudioNDSessionServer audioSession;
+    CursorNDSessionServer cursorSession;
+
+    unsigned short m_Width = 0;
+    unsigned short m_Height = 0;
+    unsigned short m_RefreshRate = 0;
+    FrameCodec::PixelFormat m_Format = FrameCodec::PixelFormat::BGRA32;
+    bool m_Compress = false; // m_Format is planar YUV
+    FrameCodec::PixelFormat m_PlanarFormat = FrameCodec::PixelFormat::YUV440; // What RequestCodecSwitch() asks for from raw
+    FrameCodec::PixelFormat m_RawFormat = FrameCodec::PixelFormat::BGRA32;    // And from compressed
+    FrameCodec::ColorSpace m_ColorSpace = FrameCodec::ColorSpace::BT601Full; // The client's pick, kept across mode changes
+    bool m_Pull = false;
+
+    unsigned short m_listenPort = 0;
+
+    unsigned long m_LengthPerFrame = 0;
     unsigned long m_BufferSize = 0;
 
     unsigned long m_YPlaneSize = 0;
     unsigned long m_UVPlaneSize = 0;
+
+    // Mode changes: the buffer is laid out again in the same registration whenever the new mode fits
+    static constexpr ULONG BUFFER_MR_FLAGS = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
+    static constexpr ULONG BUFFER_MW_FLAGS = ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ;
+    FrameCodec::BufferArena m_Arena;
+    std::optional<FrameCodec::SessionMode> m_PendingMode; // Announced by the client's last frame in the old mode
+    std::mutex m_RequestMutex;
+    FrameCodec::ModeRequest m_Request = {}; // Left beside the flag for the client to pick up
+
+    // Outputs the client captures; raw frames of all of them are composed on one canvas
+    FrameCodec::OutputSet m_OutputSet = {};
+    std::unique_ptr<FrameCodec::OutputCanvas> m_Canvas;
+    std::atomic<int> m_RegionLeft = 0; // Origin of the last frame on the client's output
+    std::atomic<int> m_RegionTop = 0;
+    std::atomic<int> m_CursorOriginX = 0; // Where output 0, which the pointer is reported on, sits on the canvas
+    std::atomic<int> m_CursorOriginY = 0;
 };
 
 // MARK: TestClient
@@ -761,12 +1543,14 @@ private:
         return true;
     }
 
-    bool AsyncWrite(uint8_t* data) {
+    // Polls the server's flag over RDMA until it has taken the previous frame. The whole flag line is read, so
+    // the viewer's mode request comes along with it.
+    bool WaitForReceiver(uint8_t* data) {
         ND2_SGE sge = { 0 };
         uint8_t flag = 0;
 
         sge.Buffer = data;
-        sge.BufferLength = 1;
+        sge.BufferLength = static_cast<ULONG>(FrameCodec::FRAME_HEADER_OFFSET);
         sge.MemoryRegionToken = m_pMr->GetLocalToken();
 
         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
@@ -794,8 +1578,22 @@ private:
             _mm_pause();
         }
         DPRINT("Read");
+
+        FrameCodec::ModeRequest request;
+        memcpy(&request, data + FrameCodec::MODE_REQUEST_OFFSET, sizeof(request));
+        std::lock_guard<std::mutex> lock(m_RequestMutex);
+        if (request.serial != m_Request.serial) m_Request = request;
+        return true;
+    }
+
+    bool AsyncWrite(uint8_t* data, unsigned long length) {
+        ND2_SGE sge = { 0 };
+        if (!WaitForReceiver(data)) return false;
+
+        reinterpret_cast<FrameCodec::FrameHeader*>(data + FrameCodec::FRAME_HEADER_OFFSET)->sendTime = FrameCodec::FrameClockNow();
+
         sge.Buffer = data;
-        sge.BufferLength = m_LengthPerFrame;
+        sge.BufferLength = static_cast<ULONG>(FrameCodec::FRAME_PAYLOAD_OFFSET + length);
         sge.MemoryRegionToken = m_pMr->GetLocalToken();
 
         if (FAILED(Write(&sge, 1, remoteInfo.remoteAddr, remoteInfo.remoteToken, 0, WRITE_CTXT))) {
@@ -808,9 +1606,11 @@ private:
         }
         DPRINT("Write");
 
-        data[0] = 1;
+        FrameCodec::FrameSignal* signal = reinterpret_cast<FrameCodec::FrameSignal*>(data);
+        signal->flag = 1;
+        signal->writeDoneTime = FrameCodec::FrameClockNow();
         sge.Buffer = data;
-        sge.BufferLength = 1;
+        sge.BufferLength = sizeof(FrameCodec::FrameSignal);
         sge.MemoryRegionToken = m_pMr->GetLocalToken();
 
         if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
@@ -826,6 +1626,83 @@ private:
         return true;
     }
 
+    // Posts one band's write and its signal without waiting; the first band also carries the flag line and header.
+    // A Send never overtakes a Write on the same queue pair, so the signal can't arrive ahead of the rows.
+    // `size` is what the band filled of its room: all of it, except for YUVAdaptive's packed chroma.
+    bool PostBand(uint8_t* data, const FrameCodec::Band& band, size_t size, uint16_t index, bool last) {
+        size_t offset = FrameCodec::FRAME_PAYLOAD_OFFSET + band.offset;
+        size_t length = size;
+        if (index == 0) {
+            reinterpret_cast<FrameCodec::FrameHeader*>(data + FrameCodec::FRAME_HEADER_OFFSET)->sendTime = FrameCodec::FrameClockNow();
+            offset = 0;
+            length += FrameCodec::FRAME_PAYLOAD_OFFSET;
+        }
+
+        ND2_SGE sge = { data + offset, static_cast<ULONG>(length), m_pMr->GetLocalToken() };
+        if (FAILED(Write(&sge, 1, remoteInfo.remoteAddr + offset, remoteInfo.remoteToken, 0, WRITE_CTXT))) {
+            std::cerr << "Write of band " << index << " failed." << std::endl;
+            return false;
+        }
+
+        // Each band signals from its own slot; they are all in flight at once
+        FrameCodec::FrameSignal* signal = m_Signals + index;
+        signal->flag = 1;
+        signal->band = index;
+        signal->writeDoneTime = last ? FrameCodec::FrameClockNow() : 0; // Completion isn't awaited; the last post stands in for it
+
+        sge = { signal, sizeof(FrameCodec::FrameSignal), m_pMr->GetLocalToken() };
+        if (FAILED(Send(&sge, 1, 0, SEND_CTXT))) {
+            std::cerr << "Send of band " << index << " failed." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Reaps the completions of `count` PostBand() calls, in posting order
+    bool WaitForBands(unsigned int count) {
+        for (unsigned int i = 0; i < count; ++i) {
+            if (!WaitForCompletionAndCheckContext(WRITE_CTXT) || !WaitForCompletionAndCheckContext(SEND_CTXT)) {
+                std::cerr << "WaitForCompletion for band " << i << " failed." << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The server's probes get this machine's FrameClockNow(), see TestServer::SyncClock()
+    bool AnswerClockSync(SOCKET sock) {
+        BOOL noDelay = TRUE;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        for (unsigned int i = 0; i < FrameCodec::CLOCK_SYNC_ROUNDS; ++i) {
+            uint64_t probe = 0;
+            if (recv(sock, reinterpret_cast<char*>(&probe), sizeof(probe), MSG_WAITALL) != sizeof(probe)) return false;
+            uint64_t now = FrameCodec::FrameClockNow();
+            if (send(sock, reinterpret_cast<const char*>(&now), sizeof(now), 0) != sizeof(now)) return false;
+        }
+        return true;
+    }
+
+    // Arms the flag and starts the header in place; the payload is written straight behind it.
+    // width/height default to the negotiated mode; a downscaled frame, or one of another output, passes its own size.
+    FrameCodec::FrameHeader* BeginFrame(uint8_t* buffer, FrameCodec::PixelFormat format, FrameCodec::PayloadEncoding encoding,
+                                        unsigned short width = 0, unsigned short height = 0, uint16_t output = 0) {
+        buffer[0] = 2;
+        FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(buffer + FrameCodec::FRAME_HEADER_OFFSET, m_Sequence++, format, encoding,
+                                                                       width ? width : m_Width, height ? height : m_Height);
+        header->output = output;
+        return header;
+    }
+
+    // Header only: the server presents what it already has
+    void BeginKeepAlive(uint8_t* buffer, FrameCodec::PixelFormat format, FrameCodec::PayloadEncoding encoding,
+                        unsigned short width = 0, unsigned short height = 0, uint16_t output = 0) {
+        FrameCodec::FrameHeader* header = BeginFrame(buffer, format, encoding, width, height, output);
+        header->flags = FrameCodec::FRAME_FLAG_KEEPALIVE;
+        header->captureTime = header->encodeTime = FrameCodec::FrameClockNow();
+        FrameCodec::SealFrameHeader(header, 0, false);
+    }
+
     void CreateTextures() {
         DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
 
@@ -842,9 +1719,11 @@ private:
         yPlaneDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
         yPlaneDesc.MiscFlags = 0;
 
+        // Duplication sizes its UV plane the same way; see Duplication::SetPixelFormat()
+        const FrameCodec::ChromaLayout chroma = FrameCodec::GetChromaLayout(m_Format);
         D3D11_TEXTURE2D_DESC uvPlaneDesc = {};
-        uvPlaneDesc.Width = m_Width;
-        uvPlaneDesc.Height = m_Height / 2;
+        uvPlaneDesc.Width = FrameCodec::ChromaWidth(chroma, m_Width);
+        uvPlaneDesc.Height = FrameCodec::ChromaHeight(chroma, m_Height);
         uvPlaneDesc.MipLevels = 1;
         uvPlaneDesc.ArraySize = 1;
         uvPlaneDesc.Format = DXGI_FORMAT_R8G8_UNORM;
@@ -870,9 +1749,9 @@ private:
 
         ComPtr<ID3D11Device> d3dDevice = dupl.GetDevice();
         std::array<HRESULT, 3> HResults;
-        HResults[0] = d3dDevice->CreateTexture2D(&yPlaneDesc, nullptr, m_YPlaneTexture.GetAddressOf());
-        HResults[1] = d3dDevice->CreateTexture2D(&uvPlaneDesc, nullptr, m_UVPlaneTexture.GetAddressOf());
-        HResults[2] = d3dDevice->CreateTexture2D(&frameDesc, nullptr, m_FrameTexture.GetAddressOf());
+        HResults[0] = d3dDevice->CreateTexture2D(&yPlaneDesc, nullptr, m_YPlaneTexture.ReleaseAndGetAddressOf());
+        HResults[1] = d3dDevice->CreateTexture2D(&uvPlaneDesc, nullptr, m_UVPlaneTexture.ReleaseAndGetAddressOf());
+        HResults[2] = d3dDevice->CreateTexture2D(&frameDesc, nullptr, m_FrameTexture.ReleaseAndGetAddressOf());
 
         for (const auto& hr : HResults) {
             if (FAILED(hr)) {
@@ -881,13 +1760,28 @@ private:
             }
         }
 
+        // Every other output reads back on its own duplication's device
+        if (!m_Outputs.empty()) m_Outputs[0]->frameTexture = m_FrameTexture;
+        for (unsigned int i = 1; i < m_Outputs.size(); ++i) {
+            frameDesc.Width = m_OutputSet.outputs[i].width;
+            frameDesc.Height = m_OutputSet.outputs[i].height;
+            HRESULT hr = m_Outputs[i]->dupl->GetDevice()->CreateTexture2D(&frameDesc, nullptr, m_Outputs[i]->frameTexture.ReleaseAndGetAddressOf());
+            if (FAILED(hr)) {
+                std::cerr << "Failed to create texture for output " << i << ": " << std::hex << hr << std::endl;
+                throw std::runtime_error("Texture creation failed.");
+            }
+        }
+        for (auto& output : m_Outputs) {
+            output->source = std::make_unique<DesktopDuplication::DuplicationSource>(*output->dupl, output->frameTexture);
+        }
+
         return;
     }
 
 public:
     TestClient() : m_CoutMutex(), inputSession(m_CoutMutex) {}
 
-    bool FindAndSendMode(char* localAddr, bool compress) {
+    bool FindAndSendMode(char* localAddr) {
         WSADATA wsaData;
         if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
             std::cerr << "WSAStartup failed: " << WSAGetLastError() << std::endl;
@@ -895,13 +1789,55 @@ public:
         }
 
         SyncThreadDesktop();
-        DesktopDuplication::ChooseOutput(m_Width, m_Height, m_RefreshRate);
+        // More than one output only for raw push, where each gets a capture pipeline of its own
+        const bool partial = m_Region.width != 0 || !m_WindowTitle.empty();
+        std::vector<DesktopDuplication::OutputInfo> outputs;
+        if (!DesktopDuplication::ChooseOutputs(outputs, (m_Compress || m_Pull || partial) ? 1 : FrameCodec::MAX_OUTPUTS)) return false;
+        m_Width = outputs[0].desc.width;
+        m_Height = outputs[0].desc.height;
+        m_RefreshRate = outputs[0].desc.refreshRate;
         if (m_Width == 0 || m_Height == 0 || m_RefreshRate == 0) {
             throw std::runtime_error("Invalid output resolution or refresh rate.");
         }
         DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
         if (!dupl.InitDuplication()) return false;
 
+        // Streaming part of the output: the mode is that part's size
+        if (!m_WindowTitle.empty()) {
+            m_TrackedWindow = DesktopDuplication::FindWindowByTitle(m_WindowTitle);
+            if (!m_TrackedWindow || !dupl.GetWindowRegion(m_TrackedWindow, m_Region)) {
+                std::wcerr << L"No window titled \"" << m_WindowTitle << L"\" is visible on the chosen output." << std::endl;
+                return false;
+            }
+        }
+        if (partial) {
+            dupl.SetRegion(m_Region);
+            if (dupl.GetRegion().width == 0) {
+                std::cerr << "The region is empty on the chosen output." << std::endl;
+                return false;
+            }
+            m_Width = dupl.GetRegion().width;
+            m_Height = dupl.GetRegion().height;
+        }
+
+        m_OutputSet = { static_cast<uint32_t>(outputs.size()) };
+        m_Outputs.clear();
+        for (unsigned int i = 0; i < outputs.size(); ++i) {
+            m_OutputSet.outputs[i] = outputs[i].desc;
+            auto output = std::make_unique<OutputPipeline>();
+            if (i == 0) {
+                output->dupl = &dupl;
+            } else {
+                output->ownedDupl = std::make_unique<DesktopDuplication::Duplication>();
+                output->ownedDupl->SetOutput(outputs[i].adapterIndex, outputs[i].outputIndex);
+                if (!output->ownedDupl->InitDuplication()) return false;
+                output->dupl = output->ownedDupl.get();
+            }
+            m_Outputs.push_back(std::move(output));
+        }
+        m_OutputSet.outputs[0].width = m_Width;
+        m_OutputSet.outputs[0].height = m_Height;
+
         std::string ip;
         unsigned short port;
 
@@ -934,32 +1870,106 @@ public:
             return false;
         }
 
-        uint16_t mode[4] = { m_Width, m_Height, m_RefreshRate, static_cast<uint16_t>(compress) };
-        int bytesSent = send(tcpSock, reinterpret_cast<const char*>(mode), sizeof(mode), 0);
+        const FrameCodec::SessionMode mode = GetMode();
+        int bytesSent = send(tcpSock, reinterpret_cast<const char*>(&mode), sizeof(mode), 0);
         if (bytesSent == SOCKET_ERROR) {
             std::cerr << "Failed to send mode: " << WSAGetLastError() << std::endl;
             closesocket(tcpSock);
             return false;
         }
 
-        std::cout << "Sent mode: " << m_Width << "x" << m_Height << " @ " << m_RefreshRate << "Hz" << " " << (compress ? "Compressed" : "Uncompressed") << std::endl;
+        bytesSent = send(tcpSock, reinterpret_cast<const char*>(&m_OutputSet), sizeof(m_OutputSet), 0);
+        if (bytesSent == SOCKET_ERROR) {
+            std::cerr << "Failed to send outputs: " << WSAGetLastError() << std::endl;
+            closesocket(tcpSock);
+            return false;
+        }
+
+        std::cout << "Sent mode: " << m_Width << "x" << m_Height << " @ " << m_RefreshRate << "Hz" << " " << FormatName(m_Format)
+                  << (m_Compress ? std::string(" ") + FrameCodec::GetYuvMatrix(m_ColorSpace).name : "") << " " << (m_Pull ? "Pull" : "Push") << std::endl;
+        if (partial) {
+            std::cout << "Streaming " << (m_TrackedWindow ? "a window" : "a region") << " at " << dupl.GetRegion().left << "," << dupl.GetRegion().top
+                      << " of the output" << std::endl;
+        }
+        for (unsigned int i = 1; i < m_OutputSet.count; ++i) {
+            const FrameCodec::OutputDesc& output = m_OutputSet.outputs[i];
+            std::cout << "Sent output " << i << ": " << output.width << "x" << output.height << " @ " << output.refreshRate << "Hz" << std::endl;
+        }
+
+        if (!AnswerClockSync(tcpSock)) {
+            std::cerr << "Clock sync failed: " << WSAGetLastError() << std::endl;
+        }
 
         closesocket(tcpSock);
         return true;
     }
 
-    bool Setup(char* localAddr, bool compress) {
+    FrameCodec::SessionMode GetMode() const {
+        return { m_Width, m_Height, m_RefreshRate, static_cast<uint16_t>(m_Format), m_TileCacheSize, m_BandCount, static_cast<uint16_t>(m_Pull),
+                 static_cast<uint16_t>(m_ColorSpace) };
+    }
+
+    void SetMode(const FrameCodec::SessionMode& mode) {
+        m_Width = mode.width;
+        m_Height = mode.height;
+        m_RefreshRate = mode.refreshRate;
+        m_Format = static_cast<FrameCodec::PixelFormat>(mode.format);
+        m_Compress = FrameCodec::IsPlanarYuv(m_Format);
+        m_ColorSpace = static_cast<FrameCodec::ColorSpace>(mode.colorSpace);
+        m_TileCacheSize = mode.tileCacheSize;
+        m_BandCount = mode.bandCount;
+        m_Pull = mode.pull != 0;
+        if (m_OutputSet.count <= 1) m_OutputSet = { 1, { { 0, 0, m_Width, m_Height, m_RefreshRate, 0 } } };
+    }
+
+    // Encoder state and buffer layout for the current mode, at setup and again after every mode change
+    void ConfigureMode() {
+        const FrameCodec::SessionMode mode = GetMode();
         m_YPlaneSize = m_Width * m_Height;
-        m_UVPlaneSize = m_Width * (m_Height / 2) * 2;
+        m_UVPlaneSize = static_cast<unsigned long>(FrameCodec::PlanarFrameSize(m_Format, m_Width, m_Height) - m_YPlaneSize);
 
-        if (compress) {
-            m_LengthPerFrame = m_YPlaneSize + m_UVPlaneSize;
-        } else {
-            m_LengthPerFrame = m_Width * m_Height * 4;
+        // Pulled frames are whole; the server may skip any of them
+        m_LengthPerFrame = static_cast<unsigned long>(FrameCodec::MaxFramePayload(mode));
+        m_Bands.reset();
+        if (m_Compress) {
+            m_Bands = std::make_unique<FrameCodec::PlanarBands>(m_Width, m_Height, m_BandCount, m_Format);
+            if (CPU_YUV_ENABLED) m_YuvEncoder = std::make_unique<FrameCodec::YuvEncoder>(m_Width, m_Height, m_Format, m_ColorSpace);
+            DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance().SetPixelFormat(m_Format);
+            DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance().SetColorSpace(m_ColorSpace);
+        } else if (!m_Pull) {
+            for (unsigned int i = 0; i < m_Outputs.size(); ++i) {
+                OutputPipeline& output = *m_Outputs[i];
+                const FrameCodec::OutputDesc& desc = m_OutputSet.outputs[i];
+                for (CapturedFrame& frame : output.captured) frame.pixels.resize(static_cast<size_t>(desc.width) * desc.height * 4);
+                output.encoder = std::make_unique<FrameCodec::DeltaEncoder>(desc.width, desc.height);
+                output.encoder->SetTileCache(m_TileCacheSize);
+                output.encoder->EnableLossless(m_Format == FrameCodec::PixelFormat::BGRALossless);
+            }
+            m_Scheduler = std::make_unique<FrameCodec::OutputScheduler>(m_OutputSet.count);
+            for (unsigned int i = 0; i < m_OutputSet.count; ++i) m_Scheduler->SetRefreshRate(i, m_OutputSet.outputs[i].refreshRate);
+
+            m_Scaler = std::make_unique<FrameCodec::AdaptiveScaler>(m_RefreshRate);
+            for (unsigned int i = 1; i < FrameCodec::SCALE_LEVEL_COUNT; ++i) {
+                const FrameCodec::ScaleLevel level = static_cast<FrameCodec::ScaleLevel>(i);
+                m_Downscalers[i] = std::make_unique<FrameCodec::Downscaler>(m_Width, m_Height,
+                    FrameCodec::ScaledDimension(m_Width, level), FrameCodec::ScaledDimension(m_Height, level), FrameCodec::ScaleFilter::Box);
+            }
+            m_Scaled.resize(static_cast<size_t>(m_Width) * m_Height * 4);
+        }
+        // Outputs share the slots, which fit the largest of them
+        size_t bufferSize = 0;
+        for (unsigned int i = 0; i < m_OutputSet.count; ++i) {
+            const FrameCodec::SessionMode outputMode = FrameCodec::OutputMode(mode, m_OutputSet.outputs[i]);
+            m_LengthPerFrame = std::max(m_LengthPerFrame, static_cast<unsigned long>(FrameCodec::MaxFramePayload(outputMode)));
+            bufferSize = std::max(bufferSize, FrameCodec::SenderBufferSize(outputMode));
         }
-        m_BufferSize = 1 + m_LengthPerFrame;
-        m_BufferSize = m_BufferSize * 2;
+        m_SlotSize = static_cast<unsigned long>(FrameCodec::FrameSlotSize(m_LengthPerFrame));
+        // Pull: control block, then the published slots. Push: two frame slots, then the band signals
+        m_BufferSize = static_cast<unsigned long>(bufferSize);
+    }
 
+    bool Setup(char* localAddr) {
+        ConfigureMode();
         CreateTextures();
 
         if (!Initialize(localAddr)) return false;
@@ -971,8 +1981,10 @@ public:
         if (FAILED(CreateQP(info.MaxReceiveQueueDepth, info.MaxInitiatorQueueDepth, info.MaxReceiveSge, info.MaxInitiatorSge))) return false;
         if (FAILED(CreateMR())) return false;
 
-        ULONG flags = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
-        if (FAILED(RegisterDataBuffer(m_BufferSize, flags))) return false;
+        ULONG flags = BUFFER_MR_FLAGS;
+        if (m_Pull) flags |= ND_MR_FLAG_ALLOW_REMOTE_READ; // The server reads the published slots itself
+        if (FAILED(RegisterDataBuffer(static_cast<DWORD>(m_Arena.Reserve(m_BufferSize)), flags))) return false;
+        if (!m_Pull) m_Signals = reinterpret_cast<FrameCodec::FrameSignal*>(reinterpret_cast<uint8_t*>(m_Buf) + m_SlotSize * 2);
         if (FAILED(CreateConnector())) return false;
 
         return true;
@@ -1008,7 +2020,7 @@ public:
         std::cout << "Connection established." << std::endl;
 
         CreateMW();
-        Bind(m_Buf, m_BufferSize, ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ);
+        Bind(m_Buf, static_cast<DWORD>(m_Arena.GetCapacity()), BUFFER_MW_FLAGS);
 
         return true;
     }
@@ -1075,122 +2087,160 @@ public:
         auto UVMapTotal = std::chrono::microseconds::zero();
         auto UVMemCpyTotal = std::chrono::microseconds::zero();
 
+        unsigned long long SuppressedFrames = 0;
+        unsigned long long SuppressedBytes = 0;
+        auto lastWrite = std::chrono::steady_clock::now();
+
         bool index = 0;
-        uint8_t* buffers[] = { reinterpret_cast<uint8_t*>(m_Buf), reinterpret_cast<uint8_t*>(m_Buf) + (m_LengthPerFrame + 1) };
+        uint8_t* buffers[] = { reinterpret_cast<uint8_t*>(m_Buf), reinterpret_cast<uint8_t*>(m_Buf) + m_SlotSize };
 
         std::future<bool> WriteFuture;
 
         ID3D11Texture2D* yPlane = m_YPlaneTexture.Get();
         ID3D11Texture2D* uvPlane = m_UVPlaneTexture.Get();
+        FrameCodec::FrameSource& source = *m_Outputs[0]->source;
+        FrameCodec::SourceFrame cpuFrame;
 
-        while (true) {
-            index = !index;
-            uint8_t* thisBuffer = buffers[index];
+        while (!ModeChangePending()) {
+            uint8_t* thisBuffer = buffers[index]; // Flips only once a write is posted, so it is never the one in flight
 
             auto GetAndCompressStart = std::chrono::steady_clock::now();
 
-            bool success = dupl.GetStagedTexture(yPlane, uvPlane, 1000 / m_RefreshRate);
+            // On the CPU path the GPU only copies BGRA back; the planes are produced band by band below
+            bool success = CPU_YUV_ENABLED ? source.Acquire(1000 / m_RefreshRate, cpuFrame) == FrameCodec::AcquireResult::Frame
+                                           : dupl.GetStagedTexture(yPlane, uvPlane, 1000 / m_RefreshRate);
             DPRINT("Got frame");
 
             //sge.Buffer = thisBuffer;
             //sge.BufferLength = 1;
             //sge.MemoryRegionToken = m_pMr->GetLocalToken();
 
-            if (!success) continue;
+            if (!success) {
+                if (dupl.WasFrameUnchanged()) {
+                    SuppressedFrames++;
+                    SuppressedBytes += m_LengthPerFrame; // Readback and write both skipped
+                }
+                if (std::chrono::steady_clock::now() - lastWrite < KEEPALIVE_INTERVAL) continue;
+
+                if (WriteFuture.valid() && !WriteFuture.get()) {
+                    std::cerr << "AsyncWrite failed." << std::endl;
+                    return;
+                }
+                BeginKeepAlive(thisBuffer, m_Format, FrameCodec::PayloadEncoding::Planar);
+                WriteFuture = std::async(std::launch::async, &TestClient::AsyncWrite, this, thisBuffer, 0UL);
+                lastWrite = std::chrono::steady_clock::now();
+                index = !index;
+                continue;
+            }
+            const uint64_t captureTime = CPU_YUV_ENABLED ? cpuFrame.captureTime : dupl.GetLastAcquireTime();
 
             auto GetAndCompressEnd = std::chrono::steady_clock::now();
             GetAndCompressTotal += std::chrono::duration_cast<std::chrono::microseconds>(GetAndCompressEnd - GetAndCompressStart);
 
             auto MapStart = std::chrono::steady_clock::now();
 
-            thisBuffer[0] = 2;
+            FrameCodec::FrameHeader* header = BeginFrame(thisBuffer, m_Format, FrameCodec::PayloadEncoding::Planar);
+            header->captureTime = captureTime;
+            header->bandCount = static_cast<uint16_t>(m_Bands->GetCount());
 
             auto YMapStart = std::chrono::steady_clock::now();
-            D3D11_MAPPED_SUBRESOURCE yMappedResource;
-            D3D11_MAPPED_SUBRESOURCE uvMappedResource;
-            dupl.GetContext()->Map(yPlane, 0, D3D11_MAP_READ, 0 , &yMappedResource);
-            uint8_t* yDst = thisBuffer + 1;
-            uint8_t* ySrc = reinterpret_cast<uint8_t*>(yMappedResource.pData);
+            D3D11_MAPPED_SUBRESOURCE yMappedResource = {};
+            D3D11_MAPPED_SUBRESOURCE uvMappedResource = {};
+            if (!CPU_YUV_ENABLED) dupl.GetContext()->Map(yPlane, 0, D3D11_MAP_READ, 0 , &yMappedResource);
             auto YMapEnd = std::chrono::steady_clock::now();
             YMapTotal += std::chrono::duration_cast<std::chrono::microseconds>(YMapEnd - YMapStart);
 
-            auto YMemCpyStart = std::chrono::steady_clock::now();
+            auto UVMapStart = std::chrono::steady_clock::now();
+            if (!CPU_YUV_ENABLED) dupl.GetContext()->Map(uvPlane, 0, D3D11_MAP_READ, 0, &uvMappedResource);
+            auto UVMapEnd = std::chrono::steady_clock::now();
+            UVMapTotal += std::chrono::duration_cast<std::chrono::microseconds>(UVMapEnd - UVMapStart);
 
-            auto y_copy_future = std::async(std::launch::async, [=, this]() {
-                const size_t yRowSize = static_cast<size_t>(m_Width);
-                for (unsigned int i = 0; i < m_Height; i++) {
-                    memcpy(yDst + i * yRowSize, ySrc + i * yMappedResource.RowPitch, yRowSize);
+            // The previous frame's writes must be reaped before this one touches the queue
+            auto WriteStart = std::chrono::steady_clock::now();
+            if (WriteFuture.valid()) {
+                if (!WriteFuture.get()) {
+                    std::cerr << "AsyncWrite failed." << std::endl;
+                    return;
                 }
-            });
-            /*
-            for (unsigned int i = 0; i < m_Height; i++) {
-                memcpy(yDst, ySrc, m_Width);
-                yDst += m_Width;
-                ySrc += mappedResource.RowPitch;
             }
-            */
-
-            //auto YMemCpyEnd = std::chrono::steady_clock::now();
-            //YMemCpyTotal += std::chrono::duration_cast<std::chrono::microseconds>(YMemCpyEnd - YMemCpyStart);
+            WriteTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - WriteStart);
 
-            auto UVMapStart = std::chrono::steady_clock::now();
-            dupl.GetContext()->Map(uvPlane, 0, D3D11_MAP_READ, 0, &uvMappedResource);
-            uint8_t* uvDst = thisBuffer + 1 + m_YPlaneSize;
-            uint8_t* uvSrc = reinterpret_cast<uint8_t*>(uvMappedResource.pData);
-            auto UVMapEnd = std::chrono::steady_clock::now();
-            UVMapTotal += std::chrono::duration_cast<std::chrono::microseconds>(UVMapEnd - UVMapStart);
+            // Band by band: while band i is on the wire, band i + 1 is being copied
+            auto YMemCpyStart = std::chrono::steady_clock::now();
+            const uint8_t* ySrc = reinterpret_cast<const uint8_t*>(yMappedResource.pData);
+            const uint8_t* uvSrc = reinterpret_cast<const uint8_t*>(uvMappedResource.pData);
+            uint8_t* payload = thisBuffer + FrameCodec::FRAME_PAYLOAD_OFFSET;
+            const bool adaptive = m_Format == FrameCodec::PixelFormat::YUVAdaptive;
+            bool posted = true;
+
+            for (unsigned int i = 0; i < m_Bands->GetCount(); ++i) {
+                const FrameCodec::Band& band = (*m_Bands)[i];
+                uint8_t* yDst = payload + band.offset;
+                uint8_t* uvDst = yDst + band.ySize;
+                size_t size = band.size;
+
+                if (adaptive) {
+                    size = band.ySize + m_YuvEncoder->EncodeAdaptiveRows(cpuFrame.pixels, cpuFrame.pitch, band.firstRow, band.rows, yDst, m_Width, uvDst);
+                } else if (CPU_YUV_ENABLED) {
+                    m_YuvEncoder->EncodeRows(cpuFrame.pixels, cpuFrame.pitch, band.firstRow, band.rows, yDst, m_Width, uvDst, m_Bands->GetUVPitch());
+                } else {
+                    auto y_copy_future = std::async(std::launch::async, [=, this]() {
+                        const size_t yRowSize = static_cast<size_t>(m_Width);
+                        for (unsigned int row = 0; row < band.rows; row++) {
+                            memcpy(yDst + row * yRowSize, ySrc + (band.firstRow + row) * yMappedResource.RowPitch, yRowSize);
+                        }
+                    });
+
+                    const size_t uvRowSize = m_Bands->GetUVPitch();
+                    for (unsigned int row = 0; row < band.uvRows; row++) {
+                        memcpy(uvDst + row * uvRowSize, uvSrc + (band.uvRow + row) * uvMappedResource.RowPitch, uvRowSize);
+                    }
+                    y_copy_future.get();
+                }
 
-            auto uv_copy_future = std::async(std::launch::async, [=, this]() {
-                const size_t uvRowSize = static_cast<size_t>(m_Width * 2);
-                for (unsigned int i = 0; i < m_Height / 2; i++) {
-                    memcpy(uvDst + i * uvRowSize, uvSrc + i * uvMappedResource.RowPitch, uvRowSize);
+                if (i == 0) {
+                    // The header leaves with the first band; a checksum is only possible when that is the whole frame, and
+                    // not for adaptive chroma, which leaves the end of the band's room unsent
+                    header->encodeTime = FrameCodec::FrameClockNow();
+                    FrameCodec::SealFrameHeader(header, m_LengthPerFrame, FRAME_CHECKSUM_ENABLED && m_Bands->GetCount() == 1 && !adaptive);
+                    if (!WaitForReceiver(thisBuffer)) {
+                        posted = false;
+                        break;
+                    }
                 }
-            });
 
-            y_copy_future.get();
-            uv_copy_future.get();
+                if (!PostBand(thisBuffer, band, size, static_cast<uint16_t>(i), i + 1 == m_Bands->GetCount())) {
+                    posted = false;
+                    break;
+                }
+            }
             auto YMemCpyEnd = std::chrono::steady_clock::now();
             YMemCpyTotal += std::chrono::duration_cast<std::chrono::microseconds>(YMemCpyEnd - YMemCpyStart);
-            //auto UVMemCpyEnd = std::chrono::steady_clock::now();
-            //UVMemCpyTotal += std::chrono::duration_cast<std::chrono::microseconds>(UVMemCpyEnd - UVMemCpyStart);
 
-            dupl.GetContext()->Unmap(yPlane, 0);
-            //yPlane->Release();
-            //yPlane = nullptr;
-            
-            /*
-            for (unsigned int i = 0; i < m_Height / 2; i++) {
-                memcpy(uvDst, uvSrc, m_Width * 2);
-                uvDst += m_Width * 2;
-                uvSrc += mappedResource.RowPitch;
+            if (CPU_YUV_ENABLED) {
+                source.Release();
+            } else {
+                dupl.GetContext()->Unmap(yPlane, 0);
+                dupl.GetContext()->Unmap(uvPlane, 0);
             }
-            */
-            dupl.GetContext()->Unmap(uvPlane, 0);
-            //uvPlane->Release();
-            //uvPlane = nullptr;
             auto MapEnd = std::chrono::steady_clock::now();
             MapTotal += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - MapStart);
-
-            //UVMemCpyTotal += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - UVMemCpyStart);
             DPRINT("Map");
 
-            auto WriteStart = std::chrono::steady_clock::now();
-
-            if (WriteFuture.valid()) {
-                if (!WriteFuture.get()) {
-                    std::cerr << "AsyncWrite failed." << std::endl;
-                    return;
-                }
+            if (!posted) {
+                std::cerr << "AsyncWrite failed." << std::endl;
+                return;
             }
 
-            WriteFuture = std::async(std::launch::async, &TestClient::AsyncWrite, this, thisBuffer);
-            auto WriteEnd = std::chrono::steady_clock::now();
-            WriteTotal += std::chrono::duration_cast<std::chrono::microseconds>(WriteEnd - WriteStart);
+            // Completions are reaped while the next frame is captured
+            WriteFuture = std::async(std::launch::async, &TestClient::WaitForBands, this, m_Bands->GetCount());
+            lastWrite = std::chrono::steady_clock::now();
+            index = !index;
 
             frames++;
 
             auto now = std::chrono::system_clock::now();
-            if (false && std::chrono::duration_cast<std::chrono::seconds>(now - lastProbe).count() >= 1) {
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - lastProbe).count() >= 1) {
                 std::cout << "\r                                                                                                       \r";
                 std::cout << "FPS: " << frames
                           << " | Get: " << GetAndCompressTotal.count() / frames
@@ -1200,6 +2250,7 @@ public:
                           << " | UVMap: " << UVMapTotal.count() / frames << "us"
                           << " | UVMemCpy: " << UVMemCpyTotal.count() / frames << "us"
                           << " | Write: " << WriteTotal.count() / frames << "us"
+                          << " | Suppressed: " << SuppressedFrames << " (" << FormatBytes(SuppressedBytes) << ")"
                           << std::flush;
                 frames = 0;
                 FlagWaitTotal = std::chrono::microseconds(0);
@@ -1215,130 +2266,376 @@ public:
             }            
         }
 
+        // Only a mode change ends the loop; its frame is the next thing on the queue
+        if (WriteFuture.valid() && !WriteFuture.get()) {
+            std::cerr << "AsyncWrite failed." << std::endl;
+            m_PendingMode.reset();
+        }
+        if (m_PendingMode) return;
+
         Shutdown();
 
         g_shouldQuit.store(true);
     }
 
+    // Network stage of Loop(): takes the newest frame of whichever output is due first and encodes it against what
+    // the server last received of that output, so frames dropped in a mailbox never break its delta chain
+    void SendLoop(std::atomic<bool>& failed) {
+        bool index = 0;
+        uint8_t* buffers[] = { reinterpret_cast<uint8_t*>(m_Buf), reinterpret_cast<uint8_t*>(m_Buf) + m_SlotSize };
+        // Scaling follows the link for a single output; several outputs are already paced by the scheduler
+        const bool scaling = ADAPTIVE_SCALE_ENABLED && m_Outputs.size() == 1;
+        FrameCodec::ScaleLevel level = FrameCodec::ScaleLevel::Full;
+        unsigned short width = m_Width;
+        unsigned short height = m_Height;
+        FrameCodec::TraceRecorder::Instance().SetThreadName("send");
+
+        int next;
+        while ((next = m_Scheduler->WaitNext()) >= 0) {
+            OutputPipeline& output = *m_Outputs[next];
+            if (!output.mailbox.Take()) continue; // Already sent along with an earlier mark
+            const CapturedFrame& frame = output.captured[output.mailbox.GetReadSlot()];
+            const FrameCodec::OutputDesc& desc = m_OutputSet.outputs[next];
+            uint8_t* thisBuffer = buffers[index];
+            unsigned long length = 0;
+
+            auto EncodeStart = std::chrono::steady_clock::now();
+            FrameCodec::TraceBegin("Encode", "encode");
+            if (frame.keepAlive) {
+                BeginKeepAlive(thisBuffer, m_Format, RawEncoding(m_Format),
+                               scaling ? width : desc.width, scaling ? height : desc.height, static_cast<uint16_t>(next));
+            } else {
+                // A new size starts both ends from a black frame again; the server resets when the header's size changes
+                if (scaling && m_Scaler->GetLevel() != level) {
+                    level = m_Scaler->GetLevel();
+                    width = level == FrameCodec::ScaleLevel::Full ? m_Width : FrameCodec::ScaledDimension(m_Width, level);
+                    height = level == FrameCodec::ScaleLevel::Full ? m_Height : FrameCodec::ScaledDimension(m_Height, level);
+                    output.encoder = std::make_unique<FrameCodec::DeltaEncoder>(width, height);
+                    output.encoder->SetTileCache(m_TileCacheSize);
+                    output.encoder->EnableLossless(m_Format == FrameCodec::PixelFormat::BGRALossless);
+                }
+                const uint8_t* pixels = frame.pixels.data();
+                if (level != FrameCodec::ScaleLevel::Full) {
+                    m_Downscalers[static_cast<unsigned int>(level)]->Scale(pixels, static_cast<size_t>(m_Width) * 4, m_Scaled.data(), static_cast<size_t>(width) * 4);
+                    pixels = m_Scaled.data();
+                }
+
+                // Scroll moves and dirty tiles against what the server already shows
+                FrameCodec::FrameHeader* header = BeginFrame(thisBuffer, m_Format, RawEncoding(m_Format),
+                                                             scaling ? width : desc.width, scaling ? height : desc.height, static_cast<uint16_t>(next));
+                header->captureTime = frame.captureTime;
+                header->regionLeft = frame.regionLeft;
+                header->regionTop = frame.regionTop;
+                length = static_cast<unsigned long>(output.encoder->Encode(pixels, thisBuffer + FrameCodec::FRAME_PAYLOAD_OFFSET));
+                header->encodeTime = FrameCodec::FrameClockNow();
+                FrameCodec::SealFrameHeader(header, length, FRAME_CHECKSUM_ENABLED);
+            }
+            auto EncodeEnd = std::chrono::steady_clock::now();
+            FrameCodec::TraceEnd("Encode", "encode");
+
+            FrameCodec::TraceBegin("Write", "write");
+            bool written = AsyncWrite(thisBuffer, length);
+            FrameCodec::TraceEnd("Write", "write");
+            auto WriteEnd = std::chrono::steady_clock::now();
+            if (scaling && !frame.keepAlive) m_Scaler->Update(length, std::chrono::duration_cast<std::chrono::nanoseconds>(WriteEnd - EncodeStart).count());
+            m_Metrics.sent.Add();
+            m_Metrics.bytesSent.Add(length);
+            m_Metrics.encode.RecordMicroseconds(EncodeEnd - EncodeStart);
+            m_Metrics.write.RecordMicroseconds(WriteEnd - EncodeEnd);
+            {
+                std::lock_guard<std::mutex> lock(m_SendStatsMutex);
+                m_SendStats.frames++;
+                m_SendStats.level = level;
+                m_SendStats.encode += std::chrono::duration_cast<std::chrono::microseconds>(EncodeEnd - EncodeStart);
+                m_SendStats.write += std::chrono::duration_cast<std::chrono::microseconds>(WriteEnd - EncodeEnd);
+                if (next == 0) m_SendStats.cache = output.encoder->GetTileCacheStats();
+            }
+            if (!written) {
+                std::cerr << "AsyncWrite failed." << std::endl;
+                failed.store(true);
+                return;
+            }
+            index = !index;
+        }
+    }
+
+    // Capture stage of one output: reads back the next frame into the output's mailbox without ever waiting on the
+    // server. A frame the network stage hasn't taken yet is replaced by the newer one and counted as dropped.
+    void CaptureFrame(unsigned int index) {
+        OutputPipeline& output = *m_Outputs[index];
+        CaptureTimes& times = output.times;
+        DesktopDuplication::Duplication& dupl = *output.dupl;
+        const FrameCodec::OutputDesc& desc = m_OutputSet.outputs[index];
+
+        auto GetAndCompressStart = std::chrono::steady_clock::now();
+        if (index == 0) TrackWindow();
+
+        FrameCodec::SourceFrame acquired;
+        FrameCodec::TraceBegin("Acquire", "capture");
+        const FrameCodec::AcquireResult result = output.source->Acquire(1000 / desc.refreshRate, acquired);
+        FrameCodec::TraceEnd("Acquire", "capture");
+        DPRINT("GetTexture");
+
+        if (result != FrameCodec::AcquireResult::Frame) {
+            if (result == FrameCodec::AcquireResult::Unchanged) {
+                m_Metrics.unchanged.Add();
+                output.suppressedFrames++;
+                output.suppressedBytes += output.captured[0].pixels.size(); // Readback, copy and tile diff skipped
+            }
+            // A pending frame already tells the server something; never replace it with a keep-alive
+            if (std::chrono::steady_clock::now() - output.lastPublish < KEEPALIVE_INTERVAL || output.mailbox.HasFresh()) return;
+
+            output.captured[output.mailbox.GetWriteSlot()].keepAlive = true;
+            output.mailbox.Publish();
+            m_Metrics.keepAlives.Add();
+            m_Scheduler->MarkReady(index, FrameCodec::FrameClockNow());
+            output.lastPublish = std::chrono::steady_clock::now();
+            return;
+        }
+        const uint64_t captureTime = acquired.captureTime;
+
+        // Acquire() already mapped the staged frame, so Get includes the map
+        auto GetAndCompressEnd = std::chrono::steady_clock::now();
+        times.get += std::chrono::duration_cast<std::chrono::microseconds>(GetAndCompressEnd - GetAndCompressStart);
+
+        auto MapStart = std::chrono::steady_clock::now();
+        CapturedFrame& frame = output.captured[output.mailbox.GetWriteSlot()];
+
+        auto MemCpyStart = std::chrono::steady_clock::now();
+        FrameCodec::TraceBegin("Copy", "copy");
+        FrameCodec::PackRegion(acquired.pixels, acquired.pitch, { 0, 0, desc.width, desc.height }, frame.pixels.data());
+        output.source->Release();
+        FrameCodec::TraceEnd("Copy", "copy");
+        if (index == 0 && !m_RecordPath.empty()) Record(frame.pixels.data(), desc, captureTime);
+
+        frame.captureTime = captureTime;
+        frame.regionLeft = dupl.GetRegion().left;
+        frame.regionTop = dupl.GetRegion().top;
+        frame.keepAlive = false;
+        output.mailbox.Publish();
+        m_Scheduler->MarkReady(index, captureTime);
+        output.lastPublish = std::chrono::steady_clock::now();
+
+        DPRINT("Map");
+        auto MapEnd = std::chrono::steady_clock::now();
+        times.map += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - MapStart);
+        times.memCpy += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - MemCpyStart);
+        m_Metrics.captured.Add();
+        m_Metrics.capture.RecordMicroseconds(MapEnd - GetAndCompressStart);
+
+        output.frames++;
+    }
+
+    // Hands a packed frame of output 0 to the capture file's writer thread. A file holds one size, so a mode
+    // change ends the recording.
+    void Record(const uint8_t* pixels, const FrameCodec::OutputDesc& desc, uint64_t captureTime) {
+        if (!m_Recorder) {
+            m_Recorder = std::make_unique<FrameCodec::CaptureWriter>(desc.width, desc.height, desc.refreshRate, FrameCodec::CaptureEncoding::Delta);
+            if (!m_Recorder->Open(m_RecordPath)) {
+                m_Recorder.reset();
+                m_RecordPath.clear();
+                return;
+            }
+        }
+        if (m_Recorder->GetWidth() != desc.width || m_Recorder->GetHeight() != desc.height) {
+            std::cout << "\nThe mode changed; recording stopped." << std::endl;
+            StopRecording();
+            return;
+        }
+        m_Recorder->Append(pixels, static_cast<size_t>(desc.width) * 4, captureTime);
+    }
+
+    void StopRecording() {
+        if (!m_Recorder) return;
+        m_Recorder->Close();
+        std::cout << "Recorded " << m_Recorder->GetWritten() << " frames (" << FormatBytes(m_Recorder->GetBytes()) << ") to " << m_RecordPath
+                  << ", " << m_Recorder->GetDropped() << " dropped while the disk caught up" << std::endl;
+        m_Recorder.reset();
+        m_RecordPath.clear();
+    }
+
+    // Capture stages, output 0 on this thread and every other output on one of its own, feeding SendLoop()
     void Loop() {
         std::cout << "Sending frames to the server." << std::endl;
-        DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
-        ND2_SGE sge = { 0 };
 
         auto lastProbe = std::chrono::system_clock::now();
-        auto GetAndCompressTotal = std::chrono::microseconds::zero();
-        auto MapTotal = std::chrono::microseconds::zero();
-        auto WriteTotal = std::chrono::microseconds::zero();
-        auto FlagWaitTotal = std::chrono::microseconds::zero();
+        CaptureTimes& times = m_Outputs[0]->times;
 
-        auto DevMapTotal = std::chrono::microseconds::zero();
-        auto MemCpyTotal = std::chrono::microseconds::zero();
-        int frames = 0;
+        std::atomic<bool> sendFailed = false;
+        std::atomic<bool> stopCapture = false;
+        for (auto& output : m_Outputs) {
+            output->mailbox.Reopen();
+            output->lastPublish = std::chrono::steady_clock::now();
+        }
+        m_Scheduler->Reopen();
+        std::thread sender(&TestClient::SendLoop, this, std::ref(sendFailed));
+        FrameCodec::TraceRecorder::Instance().SetThreadName("capture 0");
+
+        std::vector<std::thread> captures;
+        for (unsigned int i = 1; i < m_Outputs.size(); ++i) {
+            captures.emplace_back([this, i, &stopCapture]() {
+                FrameCodec::TraceRecorder::Instance().SetThreadName("capture");
+                SyncThreadDesktop(); // Recreating a lost duplication needs the input desktop
+                while (!stopCapture.load()) CaptureFrame(i);
+            });
+        }
 
-        bool index = 0;
-        uint8_t* buffers[] = { reinterpret_cast<uint8_t*>(m_Buf), reinterpret_cast<uint8_t*>(m_Buf) + (m_LengthPerFrame + 1) };
+        while (!sendFailed.load() && !ModeChangePending()) {
+            CaptureFrame(0);
 
-        std::future<bool> WriteFuture;
+            auto now = std::chrono::system_clock::now();
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - lastProbe).count() >= 1) {
+                SendStats sent;
+                {
+                    std::lock_guard<std::mutex> lock(m_SendStatsMutex);
+                    sent = m_SendStats;
+                    m_SendStats.frames = 0;
+                    m_SendStats.encode = std::chrono::microseconds(0);
+                    m_SendStats.write = std::chrono::microseconds(0);
+                }
+                const unsigned long long sentFrames = std::max(sent.frames, 1ULL);
+                const unsigned long long frames = m_Outputs[0]->frames.exchange(0);
+                const unsigned long long capturedFrames = std::max(frames, 1ULL);
 
-        ID3D11Texture2D* frameTexture = m_FrameTexture.Get();
+                std::cout << "\r                                                                                                                \r";
+                std::cout << "FPS: " << frames
+                          << " | Sent: " << sent.frames
+                          << " | Get: " << times.get.count() / capturedFrames
+                          << "us | Map: " << times.map.count() / capturedFrames << "us"
+                          << " | MemCpy: " << times.memCpy.count() / capturedFrames << "us"
+                          << " | Encode: " << sent.encode.count() / sentFrames << "us"
+                          << " | Write: " << sent.write.count() / sentFrames << "us"
+                          << " | Dropped: " << m_Outputs[0]->mailbox.GetDropped()
+                          << " | Scale: " << FrameCodec::ScaleLevelName(sent.level)
+                          << " | CacheHit: " << static_cast<int>(sent.cache.HitRate() * 100) << "%"
+                          << " | Saved: " << FormatBytes(sent.cache.savedBytes)
+                          << " | Suppressed: " << m_Outputs[0]->suppressedFrames << " (" << FormatBytes(m_Outputs[0]->suppressedBytes) << ")";
+                for (unsigned int i = 1; i < m_Outputs.size(); ++i) {
+                    std::cout << " | Output " << i << ": " << m_Outputs[i]->frames.exchange(0) << " fps, "
+                              << m_Outputs[i]->mailbox.GetDropped() << " dropped, " << m_Scheduler->GetLate(i) << " late";
+                }
+                std::cout << std::flush;
+                times = {};
 
-        while (true) {
-            index = !index;
-            uint8_t* thisBuffer = buffers[index];
+                unsigned long long dropped = 0;
+                for (const auto& output : m_Outputs) dropped += output->mailbox.GetDropped();
+                m_Metrics.dropped.Set(static_cast<int64_t>(dropped));
+                m_Metrics.scale.Set(static_cast<int64_t>(sent.level));
 
-            auto GetAndCompressStart = std::chrono::steady_clock::now();
+                lastProbe = now;
+            }
+        }
 
-            bool success = dupl.GetStagedTexture(frameTexture, 1000 / m_RefreshRate);
-            DPRINT("GetTexture");
+        stopCapture.store(true);
+        for (std::thread& capture : captures) capture.join();
+        // The sender still delivers frames left in the mailboxes before it stops
+        m_Scheduler->Close();
+        sender.join();
+        if (sendFailed.load()) m_PendingMode.reset();
+        if (m_PendingMode) return;
 
-            sge.Buffer = thisBuffer;
-            sge.BufferLength = 1;
-            sge.MemoryRegionToken = m_pMr->GetLocalToken();
-            
-            if (!success) continue; // no need to notify
+        Shutdown();
 
-            auto GetAndCompressEnd = std::chrono::steady_clock::now();
-            GetAndCompressTotal += std::chrono::duration_cast<std::chrono::microseconds>(GetAndCompressEnd - GetAndCompressStart);
-            
-            auto MapStart = std::chrono::steady_clock::now();
+        g_shouldQuit.store(true);
+    }
 
-            thisBuffer[0] = 2;
-
-            auto DevMapStart = std::chrono::steady_clock::now();
-            D3D11_MAPPED_SUBRESOURCE mappedResource;
-            dupl.GetContext()->Map(frameTexture, 0, D3D11_MAP_READ, 0 , &mappedResource);
-            uint8_t* dst = thisBuffer + 1;
-            uint8_t* src = reinterpret_cast<uint8_t*>(mappedResource.pData);
-            auto DevMapEnd = std::chrono::steady_clock::now();
-            DevMapTotal += std::chrono::duration_cast<std::chrono::microseconds>(DevMapEnd - DevMapStart);
-
-            auto MemCpyStart = std::chrono::steady_clock::now();
-            const size_t rowSize = static_cast<size_t>(m_Width * 4);
-
-            const size_t avx_width = rowSize / 32;
-            const size_t remainder_width = rowSize % 32;
-
-            for (unsigned int i = 0; i < m_Height; ++i) {
-                uint8_t* p_dst_row = dst + i * rowSize;
-                uint8_t* p_src_row = src + i * mappedResource.RowPitch;
-                
-                // Process the bulk of the row in 32-byte chunks
-                for (size_t j = 0; j < avx_width; ++j) {
-                    // Load 32 bytes from the source row
-                    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_src_row));
-                    // Store 32 bytes to the destination row
-                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_dst_row), chunk);
-                    p_src_row += 32;
-                    p_dst_row += 32;
-                }
-                
-                // Handle any remaining bytes that are not a multiple of 32
-                if (remainder_width > 0) {
-                    memcpy(p_dst_row, p_src_row, remainder_width);
+    // Never waits on the server: every captured frame goes to a free slot and is published as the newest one
+    void PullLoop(bool compress) {
+        std::cout << "Publishing frames for the server to pull." << std::endl;
+        DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
+
+        auto lastProbe = std::chrono::system_clock::now();
+        auto GetTotal = std::chrono::microseconds::zero();
+        auto CopyTotal = std::chrono::microseconds::zero();
+        int frames = 0;
+
+        unsigned long long SuppressedFrames = 0;
+        unsigned long long SuppressedBytes = 0;
+
+        const FrameCodec::PixelFormat format = m_Format;
+        FrameCodec::PullPublisher publisher(reinterpret_cast<FrameCodec::PullControl*>(reinterpret_cast<uint8_t*>(m_Buf) + FrameCodec::PullControlOffset(m_SlotSize)));
+        m_Sequence = 1; // 0 marks a slot that is being rewritten
+
+        ID3D11Texture2D* yPlane = m_YPlaneTexture.Get();
+        ID3D11Texture2D* uvPlane = m_UVPlaneTexture.Get();
+        ID3D11Texture2D* frameTexture = m_FrameTexture.Get();
+
+        while (!ModeChangePending() && !g_shouldQuit.load()) {
+            auto GetStart = std::chrono::steady_clock::now();
+            TrackWindow();
+            bool success = compress ? dupl.GetStagedTexture(yPlane, uvPlane, 1000 / m_RefreshRate)
+                                    : dupl.GetStagedTexture(frameTexture, 1000 / m_RefreshRate);
+
+            // No keep-alives: the server keeps polling and simply finds nothing newer
+            if (!success) {
+                if (dupl.WasFrameUnchanged()) {
+                    SuppressedFrames++;
+                    SuppressedBytes += m_LengthPerFrame;
                 }
+                continue;
             }
+            const uint64_t captureTime = dupl.GetLastAcquireTime();
+            GetTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - GetStart);
+
+            auto CopyStart = std::chrono::steady_clock::now();
+            const uint32_t slot = publisher.BeginSlot();
+            uint8_t* thisBuffer = reinterpret_cast<uint8_t*>(m_Buf) + FrameCodec::PullSlotOffset(slot, m_SlotSize);
+            FrameCodec::FrameHeader* header = BeginFrame(thisBuffer, format, FrameCodec::PayloadEncoding::Planar);
+            header->captureTime = captureTime;
+            header->regionLeft = dupl.GetRegion().left;
+            header->regionTop = dupl.GetRegion().top;
+            uint8_t* payload = thisBuffer + FrameCodec::FRAME_PAYLOAD_OFFSET;
+
+            if (compress) {
+                D3D11_MAPPED_SUBRESOURCE yMappedResource;
+                D3D11_MAPPED_SUBRESOURCE uvMappedResource;
+                dupl.GetContext()->Map(yPlane, 0, D3D11_MAP_READ, 0, &yMappedResource);
+                dupl.GetContext()->Map(uvPlane, 0, D3D11_MAP_READ, 0, &uvMappedResource);
+
+                const uint8_t* ySrc = reinterpret_cast<const uint8_t*>(yMappedResource.pData);
+                const uint8_t* uvSrc = reinterpret_cast<const uint8_t*>(uvMappedResource.pData);
+                const size_t yRowSize = static_cast<size_t>(m_Width);
+                const FrameCodec::ChromaLayout chroma = FrameCodec::GetChromaLayout(m_Format);
+                const size_t uvRowSize = static_cast<size_t>(FrameCodec::ChromaWidth(chroma, m_Width)) * 2;
+                for (unsigned int row = 0; row < m_Height; row++) {
+                    memcpy(payload + row * yRowSize, ySrc + row * yMappedResource.RowPitch, yRowSize);
+                }
+                for (unsigned int row = 0; row < FrameCodec::ChromaHeight(chroma, m_Height); row++) {
+                    memcpy(payload + m_YPlaneSize + row * uvRowSize, uvSrc + row * uvMappedResource.RowPitch, uvRowSize);
+                }
 
-            dupl.GetContext()->Unmap(frameTexture, 0);
-            //frameTexture->Release();
+                dupl.GetContext()->Unmap(yPlane, 0);
+                dupl.GetContext()->Unmap(uvPlane, 0);
+            } else {
+                D3D11_MAPPED_SUBRESOURCE mappedResource;
+                dupl.GetContext()->Map(frameTexture, 0, D3D11_MAP_READ, 0, &mappedResource);
 
-            DPRINT("Map");
-            auto MapEnd = std::chrono::steady_clock::now();
-            MapTotal += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - MapStart);
-            MemCpyTotal += std::chrono::duration_cast<std::chrono::microseconds>(MapEnd - MemCpyStart);
+                const uint8_t* src = reinterpret_cast<const uint8_t*>(mappedResource.pData);
+                FrameCodec::PackRegion(src, mappedResource.RowPitch, { 0, 0, m_Width, m_Height }, payload);
 
-            auto WriteStart = std::chrono::steady_clock::now();
-            // Start AsyncWrite()
-            if (WriteFuture.valid()) {
-                if (!WriteFuture.get()) {
-                    std::cerr << "AsyncWrite failed." << std::endl;
-                    return;
-                }
+                dupl.GetContext()->Unmap(frameTexture, 0);
             }
-            DPRINT("Send");
-            WriteFuture = std::async(std::launch::async, &TestClient::AsyncWrite, this, thisBuffer);
-            auto WriteEnd = std::chrono::steady_clock::now();
-            WriteTotal += std::chrono::duration_cast<std::chrono::microseconds>(WriteEnd - WriteStart);
+
+            header->encodeTime = FrameCodec::FrameClockNow();
+            header->sendTime = header->encodeTime; // Published, from here on the server may read it
+            FrameCodec::SealFrameHeader(header, m_LengthPerFrame, FRAME_CHECKSUM_ENABLED);
+            publisher.Publish(slot, header->sequence);
+            CopyTotal += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - CopyStart);
 
             frames++;
 
             auto now = std::chrono::system_clock::now();
-            if (false && std::chrono::duration_cast<std::chrono::seconds>(now - lastProbe).count() >= 1) {
-                std::cout << "\r                                                                                                                \r";
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - lastProbe).count() >= 1) {
+                std::cout << "\r                                                                                                       \r";
                 std::cout << "FPS: " << frames
-                          << " | Get: " << GetAndCompressTotal.count() / frames
-                          << "us | Map: " << MapTotal.count() / frames << "us"
-                          << " | DevMap: " << DevMapTotal.count() / frames << "us"
-                          << " | MemCpy: " << MemCpyTotal.count() / frames << "us"
-                          << " | Write: " << WriteTotal.count() / frames << "us"
+                          << " | Get: " << GetTotal.count() / frames
+                          << "us | Copy: " << CopyTotal.count() / frames << "us"
+                          << " | Published: " << header->sequence
+                          << " | Suppressed: " << SuppressedFrames << " (" << FormatBytes(SuppressedBytes) << ")"
                           << std::flush;
                 frames = 0;
-                FlagWaitTotal = std::chrono::microseconds(0);
-                GetAndCompressTotal = std::chrono::microseconds(0);
-                MapTotal = std::chrono::microseconds(0);
-                WriteTotal = std::chrono::microseconds(0);
-
-                DevMapTotal = std::chrono::microseconds(0);
-                MemCpyTotal = std::chrono::microseconds(0);
+                GetTotal = std::chrono::microseconds(0);
+                CopyTotal = std::chrono::microseconds(0);
 
                 lastProbe = now;
             }
@@ -1349,22 +2646,180 @@ public:
         g_shouldQuit.store(true);
     }
 
-    void Run(const char* localAddr, const char* serverAddr, bool compress) {
+    // Moves the crop along with a tracked window before each capture. A new size needs a new mode: push sessions
+    // switch to it through ModeChangePending(), pull sessions keep cropping at the size they started with.
+    void TrackWindow() {
+        if (!m_TrackedWindow) return;
+        DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
+
+        FrameCodec::CaptureRegion bounds;
+        if (!dupl.GetWindowRegion(m_TrackedWindow, bounds)) return; // Minimized or closed: the last crop stays
+        m_Region = bounds;
+        dupl.SetRegion({ m_Region.left, m_Region.top, m_Width, m_Height });
+    }
+
+    // Checked by the capture loops between frames: a new display mode on this machine, or a new request from the
+    // viewer. Either one ends the loop, leaving m_PendingMode for Run() to switch to.
+    bool ModeChangePending() {
+        if (m_Pull || m_Outputs.size() > 1) return false; // Several outputs keep the mode they started with
+        DesktopDuplication::Duplication& dupl = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance();
+
+        FrameCodec::SessionMode mode = GetMode();
+        bool changed = false;
+        if (dupl.GetModeGeneration() != m_ModeGeneration) {
+            m_ModeGeneration = dupl.GetModeGeneration();
+            changed = dupl.GetMode(mode.width, mode.height, mode.refreshRate);
+        }
+        // Streaming a region the mode is the region's size, which changes with the output's or a tracked window's
+        if (m_Region.width) {
+            unsigned short outputWidth, outputHeight, refreshRate;
+            if (dupl.GetMode(outputWidth, outputHeight, refreshRate)) {
+                const FrameCodec::CaptureRegion region = FrameCodec::ClampRegion(m_Region, outputWidth, outputHeight);
+                if (region.width && (region.width != mode.width || region.height != mode.height)) {
+                    mode.width = region.width;
+                    mode.height = region.height;
+                    changed = true;
+                }
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_RequestMutex);
+            if (m_Request.serial != m_HandledRequest) {
+                m_HandledRequest = m_Request.serial;
+                if (FrameCodec::IsPlanarYuv(static_cast<FrameCodec::PixelFormat>(m_Request.mode.format)) && m_Region.width) {
+                    std::cout << std::endl << "Compressed frames need the whole output." << std::endl;
+                } else {
+                    mode.format = m_Request.mode.format;
+                    mode.tileCacheSize = m_Request.mode.tileCacheSize;
+                    mode.bandCount = m_Request.mode.bandCount;
+                    changed = true;
+                }
+            }
+        }
+        if (!changed || mode == GetMode()) return false;
+        if (!FrameCodec::IsValidSessionMode(mode)) {
+            std::cerr << std::endl << "Ignoring an invalid mode: " << mode.width << "x" << mode.height << " @ " << mode.refreshRate << "Hz" << std::endl;
+            return false;
+        }
+
+        m_PendingMode = mode;
+        return true;
+    }
+
+    // Announces `mode` with a header-only frame in the old mode, then lays out the buffer for it. The handshake
+    // posts two receives for the server's one PeerInfo, so one is always left at the start of the buffer; the
+    // new PeerInfo lands there, nothing is resized before it has, and a fresh one is posted for the next change.
+    bool ApplyModeChange(const FrameCodec::SessionMode& mode) {
+        auto start = std::chrono::steady_clock::now();
+        uint8_t* data = reinterpret_cast<uint8_t*>(m_Buf);
+
+        // Compressed: the server has one receive posted per band, and this frame only takes the first
+        const unsigned int serverReceives = m_Compress ? m_Bands->GetCount() : 1;
+        const FrameCodec::PixelFormat format = m_Format;
+        const FrameCodec::PayloadEncoding encoding = m_Compress ? FrameCodec::PayloadEncoding::Planar : RawEncoding(m_Format);
+
+        FrameCodec::FrameHeader* header = BeginFrame(data, format, encoding);
+        header->flags = FrameCodec::FRAME_FLAG_MODE_CHANGE;
+        header->captureTime = header->encodeTime = FrameCodec::FrameClockNow();
+        memcpy(data + FrameCodec::FRAME_PAYLOAD_OFFSET, &mode, sizeof(mode));
+        FrameCodec::SealFrameHeader(header, sizeof(mode), FRAME_CHECKSUM_ENABLED);
+        if (!AsyncWrite(data, sizeof(mode))) return false;
+
+        for (unsigned int i = 1; i < serverReceives; ++i) {
+            FrameCodec::FrameSignal* signal = m_Signals + i;
+            signal->flag = 1;
+            signal->band = static_cast<uint16_t>(i);
+            signal->writeDoneTime = 0;
+            ND2_SGE sge = { signal, sizeof(FrameCodec::FrameSignal), m_pMr->GetLocalToken() };
+            if (FAILED(Send(&sge, 1, 0, SEND_CTXT)) || !WaitForCompletionAndCheckContext(SEND_CTXT)) {
+                std::cerr << "Send of an empty band signal failed." << std::endl;
+                return false;
+            }
+        }
+
+        if (!WaitForCompletionAndCheckContext(RECV_CTXT)) {
+            std::cerr << "WaitForCompletion for server's PeerInfo failed." << std::endl;
+            return false;
+        }
+        remoteInfo = *reinterpret_cast<PeerInfo*>(m_Buf);
+
+        SetMode(mode);
+        ConfigureMode();
+        if (m_Region.width) {
+            DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance().SetRegion({ m_Region.left, m_Region.top, m_Width, m_Height });
+        }
+
+        const size_t capacity = m_Arena.Reserve(m_BufferSize);
+        if (capacity && FAILED(ResizeDataBuffer(static_cast<DWORD>(capacity), BUFFER_MR_FLAGS, BUFFER_MW_FLAGS))) {
+            std::cerr << "Failed to grow the frame buffer to " << capacity << " bytes." << std::endl;
+            return false;
+        }
+        memset(m_Buf, 0, m_Arena.GetCapacity());
+        m_Signals = reinterpret_cast<FrameCodec::FrameSignal*>(reinterpret_cast<uint8_t*>(m_Buf) + m_SlotSize * 2);
+        CreateTextures();
+
+        ND2_SGE sge = { m_Buf, sizeof(PeerInfo), m_pMr->GetLocalToken() };
+        if (FAILED(PostReceive(&sge, 1, RECV_CTXT))) {
+            std::cerr << "PostReceive for server's PeerInfo failed." << std::endl;
+            return false;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << std::endl << "Switched to " << m_Width << "x" << m_Height << " @ " << m_RefreshRate << "Hz "
+                  << FormatName(m_Format) << " in " << elapsed.count() / 1000.0 << "ms, "
+                  << (capacity ? "buffer grown to " : "buffer reused at ") << m_Arena.GetCapacity() << " bytes" << std::endl;
+        return true;
+    }
+
+    // `region` (width 0: the whole output) or the window titled `windowTitle` limits capture to part of one output
+    void Run(const char* localAddr, const char* serverAddr, FrameCodec::PixelFormat format, FrameCodec::ColorSpace colorSpace, unsigned short tileCacheSize,
+             unsigned short bandCount, bool pull, const FrameCodec::CaptureRegion& region = {}, const std::wstring& windowTitle = L"",
+             const std::string& recordPath = "") {
         //SetupConsole();
-        FindAndSendMode(const_cast<char*>(localAddr), compress);
+        m_Format = format;
+        m_Compress = FrameCodec::IsPlanarYuv(format);
+        m_ColorSpace = colorSpace;
+        m_TileCacheSize = tileCacheSize;
+        m_BandCount = bandCount;
+        m_Pull = pull;
+        m_Region = region;
+        m_WindowTitle = windowTitle;
+        m_RecordPath = recordPath;
+        if (!FindAndSendMode(const_cast<char*>(localAddr))) return;
         #ifndef NOCONTROL
         inputSession.Start(const_cast<char*>(localAddr), serverAddr);
         #endif
         #ifndef NOAUDIO
         audioSession.Start(const_cast<char*>(localAddr), serverAddr);
         #endif
-        Setup(const_cast<char*>(localAddr), compress);
+        #ifndef NOCURSOR
+        cursorSession.Start(const_cast<char*>(localAddr), serverAddr);
+        DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance().SetPointerCallback([this](const FrameCodec::CursorState& state) {
+            cursorSession.Post(state);
+        });
+        #endif
+        Setup(const_cast<char*>(localAddr));
         OpenConnector(localAddr);
         ExchangePeerInfo();
-        if (compress) CompressLoop();
-        else Loop();
+        m_ModeGeneration = DesktopDuplication::Singleton<DesktopDuplication::Duplication>::Instance().GetModeGeneration();
+        while (true) {
+            if (m_Pull) PullLoop(m_Compress);
+            else if (m_Compress) CompressLoop();
+            else Loop();
+
+            if (!m_PendingMode) break;
+            const FrameCodec::SessionMode mode = *m_PendingMode;
+            m_PendingMode.reset();
+            if (!ApplyModeChange(mode)) {
+                Shutdown();
+                g_shouldQuit.store(true);
+                break;
+            }
+        }
+        StopRecording();
         inputSession.Stop();
         audioSession.Stop();
+        cursorSession.Stop();
     }
 
     private:
@@ -1377,20 +2832,115 @@ public:
 
     InputNDSessionClient inputSession;
     AudioNDSessionClient audioSession;
+    CursorNDSessionClient cursorSession;
 
     ComPtr<ID3D11Texture2D> m_YPlaneTexture;
     ComPtr<ID3D11Texture2D> m_UVPlaneTexture;
     ComPtr<ID3D11Texture2D> m_FrameTexture;
 
+    // Raw mode: captured frames, tightly packed, handed from Loop() to SendLoop() newest-first
+    struct CapturedFrame {
+        std::vector<uint8_t> pixels;
+        uint64_t captureTime = 0;
+        uint16_t regionLeft = 0;
+        uint16_t regionTop = 0;
+        bool keepAlive = false;
+    };
+
+    struct CaptureTimes {
+        std::chrono::microseconds get = std::chrono::microseconds(0);
+        std::chrono::microseconds map = std::chrono::microseconds(0);
+        std::chrono::microseconds memCpy = std::chrono::microseconds(0);
+    };
+
+    // One per captured output, each with its own duplication, readback texture, mailbox and delta chain
+    struct OutputPipeline {
+        DesktopDuplication::Duplication* dupl = nullptr;            // The Singleton for output 0
+        std::unique_ptr<DesktopDuplication::Duplication> ownedDupl; // Every other output's
+        ComPtr<ID3D11Texture2D> frameTexture;
+        std::unique_ptr<FrameCodec::FrameSource> source; // Maps frameTexture while a frame is acquired
+        std::array<CapturedFrame, FrameCodec::FrameMailbox::SLOTS> captured;
+        FrameCodec::FrameMailbox mailbox;
+        std::unique_ptr<FrameCodec::DeltaEncoder> encoder; // Owned by SendLoop() once it runs
+        std::chrono::steady_clock::time_point lastPublish;
+        std::atomic<unsigned long long> frames = 0; // Captured since the last report
+        unsigned long long suppressedFrames = 0;
+        unsigned long long suppressedBytes = 0;
+        CaptureTimes times; // Reported for output 0 only
+    };
+    std::vector<std::unique_ptr<OutputPipeline>> m_Outputs;
+    FrameCodec::OutputSet m_OutputSet = {};
+    std::unique_ptr<FrameCodec::OutputScheduler> m_Scheduler; // Which output SendLoop() sends next
+
+    struct SendStats {
+        unsigned long long frames = 0;
+        std::chrono::microseconds encode = std::chrono::microseconds(0);
+        std::chrono::microseconds write = std::chrono::microseconds(0);
+        FrameCodec::TileCacheStats cache;
+        FrameCodec::ScaleLevel level = FrameCodec::ScaleLevel::Full;
+    };
+    std::mutex m_SendStatsMutex;
+    SendStats m_SendStats;
+
+    // What the metrics exporter publishes; updated next to the console stats, without their lock
+    struct ClientMetrics {
+        FrameCodec::Counter captured{ "client.frames_captured" };
+        FrameCodec::Counter unchanged{ "client.frames_unchanged" };
+        FrameCodec::Counter keepAlives{ "client.keepalives" };
+        FrameCodec::Counter sent{ "client.frames_sent" };
+        FrameCodec::Counter bytesSent{ "client.bytes_sent" };
+        FrameCodec::Gauge dropped{ "client.mailbox_dropped" };
+        FrameCodec::Gauge scale{ "client.scale_level" };
+        FrameCodec::Histogram capture{ "client.capture_us" };
+        FrameCodec::Histogram encode{ "client.encode_us" };
+        FrameCodec::Histogram write{ "client.write_us" };
+    };
+    ClientMetrics m_Metrics;
+
+    // Send-side scaling, raw mode only; owned by SendLoop() once it runs
+    std::unique_ptr<FrameCodec::AdaptiveScaler> m_Scaler;
+    std::array<std::unique_ptr<FrameCodec::Downscaler>, FrameCodec::SCALE_LEVEL_COUNT> m_Downscalers; // None at Full
+    std::vector<uint8_t> m_Scaled;
+    std::unique_ptr<FrameCodec::YuvEncoder> m_YuvEncoder; // Compressed mode with CPU_YUV440 only
+    unsigned short m_TileCacheSize = FrameCodec::DEFAULT_TILE_CACHE_SIZE;
+    unsigned short m_BandCount = FrameCodec::DEFAULT_BAND_COUNT;
+    std::unique_ptr<FrameCodec::PlanarBands> m_Bands;
+    FrameCodec::FrameSignal* m_Signals = nullptr; // Behind both frame slots, one per band
+    bool m_Pull = false;
+    uint64_t m_Sequence = 0;
+
+    // Part of output 0 to stream; width 0 streams all of it. With a tracked window, its latest visible bounds.
+    FrameCodec::CaptureRegion m_Region = {};
+    std::wstring m_WindowTitle;
+
+    // Output 0's frames go to a capture file while m_RecordPath is set; the writer is created with the first frame
+    std::string m_RecordPath;
+    std::unique_ptr<FrameCodec::CaptureWriter> m_Recorder;
+    HWND m_TrackedWindow = nullptr;
+
     unsigned short m_Width = 0;
     unsigned short m_Height = 0;
     unsigned short m_RefreshRate = 0;
 
     unsigned long m_LengthPerFrame = 0;
+    unsigned long m_SlotSize = 0;
     unsigned long m_BufferSize = 0;
 
     unsigned long m_YPlaneSize = 0;
     unsigned long m_UVPlaneSize = 0;
+
+    // Mode changes: the buffer is laid out again in the same registration whenever the new mode fits
+    static constexpr ULONG BUFFER_MR_FLAGS = ND_MR_FLAG_ALLOW_LOCAL_WRITE | ND_MR_FLAG_ALLOW_REMOTE_WRITE;
+    static constexpr ULONG BUFFER_MW_FLAGS = ND_OP_FLAG_ALLOW_WRITE | ND_OP_FLAG_ALLOW_READ;
+    FrameCodec::PixelFormat m_Format = FrameCodec::PixelFormat::BGRA32;
+    bool m_Compress = false; // m_Format is planar YUV
+    FrameCodec::ColorSpace m_ColorSpace = FrameCodec::ColorSpace::BT601Full;
+    FrameCodec::BufferArena m_Arena;
+    std::optional<FrameCodec::SessionMode> m_PendingMode; // Set by ModeChangePending(), applied by Run()
+    unsigned int m_ModeGeneration = 0; // Duplication's mode generation the current mode was taken from
+    std::mutex m_RequestMutex;
+    FrameCodec::ModeRequest m_Request = {}; // Latest request read off the server's flag line
+    uint32_t m_HandledRequest = 0;
 };
 
 int main(int argc, char* argv[]) {
@@ -1404,12 +2954,28 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Trailing key=value options, in any order
+    std::string recordPath;
+    std::string metricsPath;
+    std::string timelinePath;
+    std::string colorName;
+    while (argc > 3) {
+        const char* option = argv[argc - 1];
+        if (_strnicmp(option, "record=", 7) == 0) recordPath = option + 7;
+        else if (_strnicmp(option, "metrics=", 8) == 0) metricsPath = option + 8;
+        else if (_strnicmp(option, "timeline=", 9) == 0) timelinePath = option + 9;
+        else if (_strnicmp(option, "color=", 6) == 0) colorName = option + 6;
+        else break;
+        if (*(strchr(option, '=') + 1) == '\0') { ShowUsage(); return 1; }
+        --argc;
+    }
+
     bool isServer = false;
     if (strcmp(argv[1], "-s") == 0) {
-        if (argc != 3) { ShowUsage(); return 1; }
+        if ((argc != 3 && argc != 4) || !recordPath.empty() || !colorName.empty()) { ShowUsage(); return 1; }
         isServer = true;
     } else if (strcmp(argv[1], "-c") == 0) {
-        if (argc != 5) { ShowUsage(); return 1; }
+        if (argc < 5 || argc > 9) { ShowUsage(); return 1; }
         isServer = false;
     } else {
         ShowUsage();
@@ -1428,23 +2994,125 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Runs without it if the segment can't be created; publishes the final values when main() returns
+    FrameCodec::MetricsExporter metrics(isServer ? "ndrc-server" : "ndrc-client", metricsPath);
+    metrics.Start();
+    if (!timelinePath.empty() && !FrameCodec::TraceRecorder::Instance().Start(timelinePath)) {
+        NdCleanup();
+        WSACleanup();
+        return 1;
+    }
+
     if (isServer) {
         TestServer server;
-        server.Run(argv[2]);
+        server.Run(argv[2], argc == 4 ? argv[3] : nullptr);
     } else {
         TestClient client;
-        bool compress = false;
+        FrameCodec::PixelFormat format = FrameCodec::PixelFormat::BGRA32;
 
         if (_stricmp(argv[4], "r") == 0) {
-            compress = false;
+            format = FrameCodec::PixelFormat::BGRA32;
+        } else if (_stricmp(argv[4], "rl") == 0) {
+            format = FrameCodec::PixelFormat::BGRALossless;
         } else if (_stricmp(argv[4], "c") == 0) {
-            compress = true;
+            format = FrameCodec::PixelFormat::YUV440;
+        } else if (_stricmp(argv[4], "c420") == 0) {
+            format = FrameCodec::PixelFormat::YUV420;
+        } else if (_stricmp(argv[4], "c422") == 0) {
+            format = FrameCodec::PixelFormat::YUV422;
+        } else if (_stricmp(argv[4], "ca") == 0) {
+            format = FrameCodec::PixelFormat::YUVAdaptive;
         } else {
-            std::cerr << "Invalid compression flag. Use 'r' for raw or 'c' for compressed." << std::endl;
+            std::cerr << "Invalid compression flag. Use 'r' or 'rl' for raw or raw lossless, or 'c', 'c420', 'c422' or 'ca' for compressed 4:4:0, 4:2:0, 4:2:2 or adaptive." << std::endl;
+            return 1;
+        }
+        const bool compress = FrameCodec::IsPlanarYuv(format);
+
+        FrameCodec::ColorSpace colorSpace = FrameCodec::ColorSpace::BT601Full;
+        if (!colorName.empty() && !FrameCodec::ParseColorSpace(colorName.c_str(), colorSpace)) {
+            std::cerr << "Invalid color space. Use bt601, bt601-limited, bt709 or bt709-limited." << std::endl;
             return 1;
         }
 
-        client.Run(argv[2], argv[3], compress);
+        unsigned short tileCacheSize = FrameCodec::DEFAULT_TILE_CACHE_SIZE;
+        if (argc >= 6) {
+            char* end = nullptr;
+            unsigned long value = strtoul(argv[5], &end, 10);
+            if (*end != '\0' || value > 0xFFFF) {
+                std::cerr << "Invalid tile cache size. Use 0-65535 tiles." << std::endl;
+                return 1;
+            }
+            tileCacheSize = static_cast<unsigned short>(value);
+        }
+
+        unsigned short bandCount = FrameCodec::DEFAULT_BAND_COUNT;
+        if (argc >= 7) {
+            char* end = nullptr;
+            unsigned long value = strtoul(argv[6], &end, 10);
+            if (*end != '\0' || value < 1 || value > FrameCodec::MAX_BANDS) {
+                std::cerr << "Invalid band count. Use 1-" << FrameCodec::MAX_BANDS << "." << std::endl;
+                return 1;
+            }
+            bandCount = static_cast<unsigned short>(value);
+        }
+
+        bool pull = false;
+        if (argc >= 8) {
+            if (_stricmp(argv[7], "pull") == 0) {
+                pull = true;
+            } else if (_stricmp(argv[7], "push") != 0) {
+                std::cerr << "Invalid transport. Use 'push' or 'pull'." << std::endl;
+                return 1;
+            }
+        }
+
+        FrameCodec::CaptureRegion region = {};
+        std::wstring windowTitle;
+        if (argc == 9) {
+            unsigned int x, y, width, height;
+            char extra;
+            if (_strnicmp(argv[8], "window=", 7) == 0 && argv[8][7] != '\0') {
+                const int length = MultiByteToWideChar(CP_ACP, 0, argv[8] + 7, -1, nullptr, 0);
+                windowTitle.resize(length);
+                MultiByteToWideChar(CP_ACP, 0, argv[8] + 7, -1, windowTitle.data(), length);
+                windowTitle.pop_back(); // The terminator
+            } else if (sscanf_s(argv[8], "%u,%u,%u,%u%c", &x, &y, &width, &height, &extra, 1) == 4 &&
+                       x <= 0xFFFF && y <= 0xFFFF && width >= 2 && width <= 0xFFFF && height >= 2 && height <= 0xFFFF) {
+                region = { static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(width), static_cast<uint16_t>(height) };
+            } else {
+                std::cerr << "Invalid region. Use <x>,<y>,<width>,<height> or window=<title>." << std::endl;
+                return 1;
+            }
+            if (compress) {
+                std::cerr << "A region or window is only streamed raw." << std::endl;
+                return 1;
+            }
+        }
+
+        // Tiles are classified and packed on the CPU, and the pull loop only copies the GPU's planes
+        if (format == FrameCodec::PixelFormat::YUVAdaptive && (!CPU_YUV_ENABLED || pull)) {
+            std::cerr << "Adaptive chroma needs a CPU_YUV440 build and push." << std::endl;
+            return 1;
+        }
+
+        // Lossless tiles only come as deltas against the frame the server already shows
+        if (format == FrameCodec::PixelFormat::BGRALossless && pull) {
+            std::cerr << "Lossless tiles need push." << std::endl;
+            return 1;
+        }
+
+        if (!recordPath.empty() && (compress || pull)) {
+            std::cerr << "Only raw push sessions can be recorded." << std::endl;
+            return 1;
+        }
+
+        client.Run(argv[2], argv[3], format, colorSpace, tileCacheSize, bandCount, pull, region, windowTitle, recordPath);
+    }
+
+    if (!timelinePath.empty()) {
+        FrameCodec::TraceRecorder& recorder = FrameCodec::TraceRecorder::Instance();
+        recorder.Stop();
+        std::cout << "Wrote " << recorder.GetWritten() << " trace events to " << timelinePath << " (" << recorder.GetDropped() << " dropped)" << std::endl;
     }
 
     NdCleanup();
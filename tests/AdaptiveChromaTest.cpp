@@ -0,0 +1,260 @@
+#include "BandLayout.hpp"
+#include "ColorConvert.hpp"
+#include "TileChroma.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// YUVAdaptive, the per-tile chroma mode, on frames drawn to look like its targets: coloured text, vertical UI rules,
+// grey text and photo-like noise. The classifier must keep coloured edges at full chroma or 4:4:0 and send the rest
+// as 4:2:0; every SIMD level and thread count must give the scalar bytes; decoding must match the full-chroma planes
+// resampled tile by tile in plain C++, whole or band by band; and a corrupt chroma section must be refused.
+
+constexpr FrameCodec::SimdLevel LEVELS[] = {
+    FrameCodec::SimdLevel::Scalar, FrameCodec::SimdLevel::SSE41, FrameCodec::SimdLevel::AVX2, FrameCodec::SimdLevel::AVX512
+};
+
+constexpr FrameCodec::PixelFormat ADAPTIVE = FrameCodec::PixelFormat::YUVAdaptive;
+
+enum class Content {
+    ColouredText, // Saturated strokes both ways on white, like syntax highlighting
+    Rules,        // One-pixel coloured vertical lines, like table and panel borders
+    GreyText,     // Black strokes on white: no chroma at all
+    Photo,        // Smooth colour fields under grain
+    Mixed,        // A third of each of the above, as a desktop might be
+};
+
+const char* ContentName(Content content) {
+    switch (content) {
+        case Content::ColouredText: return "coloured text";
+        case Content::Rules: return "vertical rules";
+        case Content::GreyText: return "grey text";
+        case Content::Photo: return "photo";
+        default: return "mixed";
+    }
+}
+
+void Fill(std::vector<uint8_t>& bgra, size_t pitch, unsigned int x, unsigned int y, unsigned int width, unsigned int height, uint32_t colour) {
+    for (unsigned int row = y; row < y + height; ++row) {
+        for (unsigned int col = x; col < x + width; ++col) memcpy(bgra.data() + row * pitch + col * 4, &colour, 4);
+    }
+}
+
+// Columns [left, right) of the frame in `content`
+void Draw(std::vector<uint8_t>& bgra, size_t pitch, unsigned int left, unsigned int right, unsigned int height, Content content, std::mt19937& rng) {
+    constexpr uint32_t COLOURS[] = { 0xFFD02020, 0xFF2050E0, 0xFF10A040, 0xFFA020C0, 0xFFE08000 };
+    const unsigned int width = right - left;
+    if (content == Content::Photo) {
+        for (unsigned int row = 0; row < height; ++row) {
+            for (unsigned int col = left; col < right; ++col) {
+                uint8_t* pixel = bgra.data() + row * pitch + col * 4;
+                const int grain = static_cast<int>(rng() % 48) - 24;
+                pixel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(col * 255 / (left + width)) + grain, 0, 255));
+                pixel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(row * 255 / height) + grain / 2, 0, 255));
+                pixel[2] = static_cast<uint8_t>(std::clamp(static_cast<int>((col + row) * 255 / (left + width + height)) - grain, 0, 255));
+                pixel[3] = 255;
+            }
+        }
+        return;
+    }
+
+    Fill(bgra, pitch, left, 0, width, height, 0xFFFFFFFF);
+    if (content == Content::Rules) {
+        for (unsigned int col = left + 5; col < right; col += 23) Fill(bgra, pitch, col, 0, 1, height, COLOURS[col % std::size(COLOURS)]);
+        return;
+    }
+
+    // Lines of glyph-sized strokes, a gap between words
+    for (unsigned int line = 2; line + 14 <= height; line += 18) {
+        for (unsigned int col = left + 4; col + 8 <= right; col += 9) {
+            if (rng() % 6 == 0) continue;
+            const uint32_t colour = content == Content::GreyText ? 0xFF000000 : COLOURS[rng() % std::size(COLOURS)];
+            Fill(bgra, pitch, col + rng() % 6, line, 1 + rng() % 2, 10, colour);
+            Fill(bgra, pitch, col, line + rng() % 10, 6, 1, colour);
+        }
+    }
+}
+
+std::vector<uint8_t> Frame(unsigned int width, unsigned int height, Content content, uint32_t seed) {
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> bgra(pitch * height);
+    std::mt19937 rng(seed);
+    if (content != Content::Mixed) {
+        Draw(bgra, pitch, 0, width, height, content, rng);
+    } else {
+        Draw(bgra, pitch, 0, width / 3, height, Content::ColouredText, rng);
+        Draw(bgra, pitch, width / 3, width * 2 / 3, height, Content::Photo, rng);
+        Draw(bgra, pitch, width * 2 / 3, width, height, Content::GreyText, rng);
+    }
+    return bgra;
+}
+
+// A whole frame as one band: the Y plane, then the chroma section
+struct Encoded {
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> chroma;
+};
+
+Encoded Encode(const std::vector<uint8_t>& bgra, unsigned int width, unsigned int height, unsigned int threads, FrameCodec::SimdLevel level) {
+    Encoded out;
+    out.y.resize(static_cast<size_t>(width) * height);
+    out.chroma.resize(FrameCodec::AdaptiveChromaMaxSize(width, height));
+    FrameCodec::YuvEncoder encoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, threads, level);
+    out.chroma.resize(encoder.EncodeAdaptiveRows(bgra.data(), static_cast<size_t>(width) * 4, 0, height, out.y.data(), width, out.chroma.data()));
+    return out;
+}
+
+// What the viewer must show: the full-chroma planes, each tile averaged over its mode's blocks (clamped to the tile,
+// rounding as the packers do), through the plain 4:4:4 decoder
+std::vector<uint8_t> Expected(const std::vector<uint8_t>& bgra, unsigned int width, unsigned int height, const uint8_t* modes) {
+    const size_t uvPitch = static_cast<size_t>(width) * 2;
+    std::vector<uint8_t> y(static_cast<size_t>(width) * height), uv(uvPitch * height), resampled(uv.size());
+    FrameCodec::YuvEncoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, 1)
+        .Encode(bgra.data(), static_cast<size_t>(width) * 4, y.data(), width, uv.data(), uvPitch);
+
+    const unsigned int tilesX = FrameCodec::ChromaTilesX(width);
+    for (unsigned int row = 0; row < height; ++row) {
+        for (unsigned int col = 0; col < width; ++col) {
+            const unsigned int tileX = col / FrameCodec::CHROMA_TILE_SIZE, tileY = row / FrameCodec::CHROMA_TILE_SIZE;
+            const unsigned int right = std::min(width, (tileX + 1) * FrameCodec::CHROMA_TILE_SIZE) - 1;
+            const unsigned int bottom = std::min(height, (tileY + 1) * FrameCodec::CHROMA_TILE_SIZE) - 1;
+            const FrameCodec::TileChroma mode = static_cast<FrameCodec::TileChroma>(modes[tileY * tilesX + tileX]);
+            for (unsigned int c = 0; c < 2; ++c) {
+                const unsigned int r0 = mode == FrameCodec::TileChroma::Full ? row : row & ~1u, r1 = mode == FrameCodec::TileChroma::Full ? row : std::min(r0 + 1, bottom);
+                const unsigned int c0 = mode == FrameCodec::TileChroma::Quarter ? col & ~1u : col, c1 = mode == FrameCodec::TileChroma::Quarter ? std::min(c0 + 1, right) : col;
+                auto at = [&](unsigned int r, unsigned int x) { return static_cast<unsigned int>(uv[r * uvPitch + x * 2 + c]); };
+                uint8_t& out = resampled[row * uvPitch + col * 2 + c];
+                if (mode == FrameCodec::TileChroma::Full) out = static_cast<uint8_t>(at(row, col));
+                else if (mode == FrameCodec::TileChroma::Half) out = static_cast<uint8_t>((at(r0, col) + at(r1, col) + 1) >> 1);
+                else out = static_cast<uint8_t>((at(r0, c0) + at(r0, c1) + at(r1, c0) + at(r1, c1) + 2) >> 2);
+            }
+        }
+    }
+
+    std::vector<uint8_t> decoded(static_cast<size_t>(width) * height * 4);
+    FrameCodec::YuvDecoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, 1)
+        .Decode(y.data(), width, resampled.data(), uvPitch, decoded.data(), static_cast<size_t>(width) * 4);
+    return decoded;
+}
+
+bool Check(Content content, unsigned int width, unsigned int height) {
+    const std::vector<uint8_t> bgra = Frame(width, height, content, width * 31 + height);
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    const std::string what = std::string(ContentName(content)) + " " + std::to_string(width) + "x" + std::to_string(height);
+    bool ok = true;
+
+    const Encoded scalar = Encode(bgra, width, height, 1, FrameCodec::SimdLevel::Scalar);
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 3u, FrameCodec::YuvEncoder::MAX_THREADS }) {
+            const Encoded encoded = Encode(bgra, width, height, threads, level);
+            if (encoded.y != scalar.y || encoded.chroma != scalar.chroma) {
+                std::cerr << "FAILED: " << what << ", " << FrameCodec::SimdLevelName(level) << " on " << threads << " threads encodes differently from the scalar kernels" << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    // Decoded at every level against the resampled reference
+    const std::vector<uint8_t> expected = Expected(bgra, width, height, scalar.chroma.data());
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 3u, FrameCodec::YuvDecoder::MAX_THREADS }) {
+            std::vector<uint8_t> decoded(pitch * height);
+            FrameCodec::YuvDecoder decoder(width, height, ADAPTIVE, FrameCodec::ColorSpace::BT601Full, threads, level);
+            if (!decoder.DecodeAdaptiveRows(scalar.y.data(), width, scalar.chroma.data(), scalar.chroma.size(), 0, height, decoded.data(), pitch) ||
+                decoded != expected) {
+                std::cerr << "FAILED: " << what << ", " << FrameCodec::SimdLevelName(level) << " on " << threads << " threads decodes differently from the reference" << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    // Band by band through a PlanarBands payload, as the compress loops send and upload it
+    const FrameCodec::PlanarBands bands(static_cast<unsigned short>(width), static_cast<unsigned short>(height), 4, ADAPTIVE);
+    std::vector<uint8_t> payload(bands.GetPayloadSize());
+    std::vector<uint8_t> decoded(pitch * height);
+    FrameCodec::YuvEncoder encoder(width, height, ADAPTIVE);
+    FrameCodec::YuvDecoder decoder(width, height, ADAPTIVE);
+    for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+        const FrameCodec::Band& band = bands[i];
+        uint8_t* y = payload.data() + band.offset;
+        const size_t used = encoder.EncodeAdaptiveRows(bgra.data(), pitch, band.firstRow, band.rows, y, width, y + band.ySize);
+        if (used > band.size - band.ySize || !decoder.DecodeAdaptiveRows(y, width, y + band.ySize, band.size - band.ySize, band.firstRow, band.rows, decoded.data(), pitch)) {
+            std::cerr << "FAILED: " << what << ", band " << i << " overflows or doesn't decode" << std::endl;
+            ok = false;
+        }
+    }
+    if (decoded != expected) {
+        std::cerr << "FAILED: " << what << ", decoding band by band differs from the whole frame" << std::endl;
+        ok = false;
+    }
+
+    // A corrupt mode, or a map promising more pairs than arrived, is refused
+    Encoded corrupt = scalar;
+    corrupt.chroma[0] = FrameCodec::TILE_CHROMA_COUNT;
+    if (decoder.DecodeAdaptiveRows(corrupt.y.data(), width, corrupt.chroma.data(), corrupt.chroma.size(), 0, height, decoded.data(), pitch) ||
+        decoder.DecodeAdaptiveRows(scalar.y.data(), width, scalar.chroma.data(), scalar.chroma.size() - 1, 0, height, decoded.data(), pitch)) {
+        std::cerr << "FAILED: " << what << ", a corrupt chroma section decoded" << std::endl;
+        ok = false;
+    }
+
+    // Where the tiles went, and the chroma bytes against 4:4:0's (one byte per pixel) and full chroma's
+    const unsigned int tiles = FrameCodec::ChromaTilesX(width) * FrameCodec::ChromaTilesY(height);
+    unsigned int counts[FrameCodec::TILE_CHROMA_COUNT] = {};
+    for (unsigned int i = 0; i < tiles; ++i) counts[scalar.chroma[i]]++;
+    const double pixels = static_cast<double>(width) * height;
+    std::cout << "Adaptive " << what << ": " << counts[0] << " full, " << counts[1] << " 4:4:0, " << counts[2] << " 4:2:0 tiles; chroma "
+              << scalar.chroma.size() << " bytes, " << 100.0 * scalar.chroma.size() / pixels << "% of 4:4:0, "
+              << 50.0 * scalar.chroma.size() / pixels << "% of full" << (ok ? " OK" : " FAILED") << std::endl;
+
+    // The classifier's job on content made to need one mode
+    const double full = static_cast<double>(counts[0]) / tiles, half = static_cast<double>(counts[1]) / tiles, quarter = static_cast<double>(counts[2]) / tiles;
+    bool classified = true;
+    switch (content) {
+        case Content::ColouredText: classified = full > 0.5; break;
+        case Content::Rules: classified = half > 0.5 && full == 0.0; break;
+        case Content::GreyText: classified = quarter == 1.0; break;
+        case Content::Photo: classified = quarter > 0.95; break;
+        default: classified = full > 0.1 && quarter > 0.5; break;
+    }
+    if (!classified) {
+        std::cerr << "FAILED: " << what << " classified as " << full << " full, " << half << " 4:4:0, " << quarter << " 4:2:0" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+    std::cout << "Detected: " << FrameCodec::SimdLevelName(FrameCodec::DetectSimdLevel()) << std::endl;
+
+    // 1080p leaves half a tile row at the bottom; the odd sizes leave narrow edge tiles on the scalar classifier
+    const unsigned int sizes[][2] = { { 1920, 1080 }, { 803, 601 }, { 17, 9 }, { 1, 1 } };
+    for (Content content : { Content::ColouredText, Content::Rules, Content::GreyText, Content::Photo, Content::Mixed }) {
+        ok = Check(content, sizes[0][0], sizes[0][1]) && ok;
+    }
+    for (size_t i = 1; i < std::size(sizes); ++i) {
+        // Too small for the classification targets to mean anything; only the bytes are checked
+        for (Content content : { Content::Mixed, Content::Photo }) {
+            const std::vector<uint8_t> bgra = Frame(sizes[i][0], sizes[i][1], content, 7);
+            const Encoded scalar = Encode(bgra, sizes[i][0], sizes[i][1], 1, FrameCodec::SimdLevel::Scalar);
+            const Encoded best = Encode(bgra, sizes[i][0], sizes[i][1], 0, FrameCodec::DetectSimdLevel());
+            std::vector<uint8_t> decoded(static_cast<size_t>(sizes[i][0]) * sizes[i][1] * 4);
+            FrameCodec::YuvDecoder decoder(sizes[i][0], sizes[i][1], ADAPTIVE);
+            const bool same = best.y == scalar.y && best.chroma == scalar.chroma &&
+                              decoder.DecodeAdaptiveRows(best.y.data(), sizes[i][0], best.chroma.data(), best.chroma.size(), 0, sizes[i][1],
+                                                         decoded.data(), static_cast<size_t>(sizes[i][0]) * 4) &&
+                              decoded == Expected(bgra, sizes[i][0], sizes[i][1], scalar.chroma.data());
+            std::cout << "Adaptive " << ContentName(content) << " " << sizes[i][0] << "x" << sizes[i][1] << (same ? " OK" : " FAILED") << std::endl;
+            ok = same && ok;
+        }
+    }
+
+    std::cout << (ok ? "adaptive chroma: OK" : "adaptive chroma: FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "CaptureFile.hpp"
+#include "FrameHash.hpp"
+#include "SyntheticSource.hpp"
+#include "TestCheck.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Synthetic sessions recorded into capture files, raw and delta-coded, and read back: every appended frame must come
+// back bit-exact with its capture time, past a delta keyframe, looping or not, and a file cut short as if the
+// recording process died must still play up to the cut from its records.
+namespace {
+    constexpr uint16_t WIDTH = 320;
+    constexpr uint16_t HEIGHT = 180;
+    constexpr uint16_t REFRESH_RATE = 60;
+    constexpr unsigned int FRAMES = FrameCodec::CAPTURE_KEYFRAME_INTERVAL + 30; // Past the first delta keyframe
+
+    struct Recording {
+        std::vector<uint64_t> hashes; // Of every frame Append() took
+        std::vector<uint64_t> captureTimes;
+        uint64_t written = 0;
+        uint64_t dropped = 0;
+        uint64_t bytes = 0;
+    };
+
+    Recording Record(const std::filesystem::path& path, FrameCodec::CaptureEncoding encoding) {
+        Recording recording;
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::ScrollingText, 41);
+        // Unpaced, so queue every frame rather than have the writer drop the ones the disk can't keep up with
+        FrameCodec::CaptureWriter writer(WIDTH, HEIGHT, REFRESH_RATE, encoding, FRAMES);
+        if (!writer.Open(path.string())) return recording;
+
+        for (unsigned int n = 0; n < FRAMES; ++n) {
+            FrameCodec::SourceFrame frame;
+            if (source.Acquire(0, frame) != FrameCodec::AcquireResult::Frame) break;
+            if (writer.Append(frame.pixels, frame.pitch, frame.captureTime)) {
+                recording.hashes.push_back(FrameCodec::HashBytes(frame.pixels, frame.pitch * HEIGHT));
+                recording.captureTimes.push_back(frame.captureTime);
+            }
+            source.Release();
+        }
+        writer.Close();
+        recording.written = writer.GetWritten();
+        recording.dropped = writer.GetDropped();
+        recording.bytes = writer.GetBytes();
+        return recording;
+    }
+
+    // Reads `path` once through; the number of frames that matched `hashes`, in order
+    size_t Replay(FrameCodec::CaptureReader& reader, const std::vector<uint64_t>& hashes) {
+        size_t matched = 0;
+        FrameCodec::SourceFrame frame;
+        for (size_t n = 0; n < reader.GetFrameCount() && reader.Acquire(0, frame) == FrameCodec::AcquireResult::Frame; ++n) {
+            if (matched == n && n < hashes.size() && FrameCodec::HashBytes(frame.pixels, frame.pitch * HEIGHT) == hashes[n]) matched++;
+            reader.Release();
+        }
+        return matched;
+    }
+}
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ndrc_capture_test.ndrc";
+
+    for (FrameCodec::CaptureEncoding encoding : { FrameCodec::CaptureEncoding::Raw, FrameCodec::CaptureEncoding::Delta }) {
+        const Recording recording = Record(path, encoding);
+        std::cout << (encoding == FrameCodec::CaptureEncoding::Raw ? "Raw: " : "Delta: ") << recording.written << " written, "
+                  << recording.dropped << " dropped, " << recording.bytes / 1024 << "KB" << std::endl;
+        Check(!recording.hashes.empty(), "the writer takes frames");
+        Check(recording.written == FRAMES && recording.hashes.size() == FRAMES && recording.dropped == 0,
+              "a queue as deep as the session drops nothing");
+
+        {
+            FrameCodec::CaptureReader reader(false, false);
+            Check(reader.Open(path.string()) && !reader.WasIndexRebuilt(), "a closed file opens from its index");
+            Check(reader.GetFrameCount() == recording.hashes.size(), "the index holds every written frame");
+            bool times = reader.GetFrameCount() == recording.captureTimes.size();
+            for (size_t n = 0; n < reader.GetFrameCount() && times; ++n) times = reader.GetEntry(n).captureTime == recording.captureTimes[n];
+            Check(times, "capture times are kept");
+
+            Check(Replay(reader, recording.hashes) == recording.hashes.size(), "every frame comes back bit-exact");
+            FrameCodec::SourceFrame frame;
+            Check(reader.Acquire(0, frame) == FrameCodec::AcquireResult::Failed, "a reader that doesn't loop fails at the end");
+        }
+        {
+            FrameCodec::CaptureReader reader(false, true);
+            Check(reader.Open(path.string()) && Replay(reader, recording.hashes) == recording.hashes.size() &&
+                      Replay(reader, recording.hashes) == recording.hashes.size(),
+                  "a looping reader plays the file again from the start");
+        }
+
+        if (encoding == FrameCodec::CaptureEncoding::Delta) {
+            // As if the recording process died: no index, and the last record only half written
+            std::filesystem::resize_file(path, recording.bytes / 2);
+            FrameCodec::CaptureReader reader(false, false);
+            Check(reader.Open(path.string()) && reader.WasIndexRebuilt(), "a cut file opens from its records");
+            const size_t cut = Replay(reader, recording.hashes);
+            std::cout << "Cut: " << cut << " of " << recording.hashes.size() << " frames recovered" << std::endl;
+            Check(cut > 0 && cut == reader.GetFrameCount() && cut < recording.hashes.size(), "a cut file plays up to the cut");
+        }
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not a capture file, but long enough to hold a header if it were one......................";
+    }
+    FrameCodec::CaptureReader reader;
+    Check(!reader.Open(path.string()), "a file without the magic is refused");
+    std::filesystem::remove(path);
+
+    return TestResult("capture file");
+}
@@ -0,0 +1,57 @@
+#include "CaptureRegion.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ClampRegion() on whole, fitting, odd and off-output regions, and PackRegion() against the reference on regions
+// whose rows leave a tail on every vector loop.
+namespace {
+    constexpr uint16_t OUTPUT_WIDTH = 3840;
+    constexpr uint16_t OUTPUT_HEIGHT = 2160;
+    constexpr size_t PITCH = OUTPUT_WIDTH * 4 + 256; // Staging textures pad their rows
+
+    bool Same(const FrameCodec::CaptureRegion& region, uint16_t left, uint16_t top, uint16_t width, uint16_t height) {
+        return region == FrameCodec::CaptureRegion{ left, top, width, height };
+    }
+}
+
+int main() {
+    Check(Same(FrameCodec::ClampRegion({ 0, 0, 0, 0 }, OUTPUT_WIDTH, OUTPUT_HEIGHT), 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT), "an empty region is the whole output");
+    Check(Same(FrameCodec::ClampRegion({ 0, 0, 0, 0 }, 1365, 767), 0, 0, 1364, 766), "the whole of an odd output rounds down to even");
+    Check(Same(FrameCodec::ClampRegion({ 640, 360, 2560, 1440 }, OUTPUT_WIDTH, OUTPUT_HEIGHT), 640, 360, 2560, 1440), "a region that fits is kept");
+    Check(Same(FrameCodec::ClampRegion({ 3, 7, 801, 599 }, OUTPUT_WIDTH, OUTPUT_HEIGHT), 3, 7, 800, 598), "an odd size rounds down, an odd origin stays");
+    Check(Same(FrameCodec::ClampRegion({ 3500, 2000, 800, 600 }, OUTPUT_WIDTH, OUTPUT_HEIGHT), 3040, 1560, 800, 600),
+          "a region partly off the output keeps its size and moves in");
+    Check(Same(FrameCodec::ClampRegion({ 100, 100, 5000, 3000 }, OUTPUT_WIDTH, OUTPUT_HEIGHT), 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT),
+          "a region larger than the output becomes the output");
+    Check(FrameCodec::ClampRegion({ 10, 10, 1, 600 }, OUTPUT_WIDTH, OUTPUT_HEIGHT).width == 0, "a region less than two pixels wide is empty");
+
+    std::mt19937 rng(39);
+    std::vector<uint8_t> output(PITCH * OUTPUT_HEIGHT);
+    for (uint8_t& byte : output) byte = static_cast<uint8_t>(rng());
+
+    const FrameCodec::CaptureRegion regions[] = {
+        { 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT },
+        { 640, 360, 2560, 1440 },
+        { 3, 7, 800, 598 },
+        { 1, 1, 2, 2 },
+        { 3838, 0, 2, 2160 },
+        { 17, 5, 34, 6 },
+    };
+    for (const FrameCodec::CaptureRegion& region : regions) {
+        const size_t bytes = static_cast<size_t>(region.width) * region.height * 4;
+        std::vector<uint8_t> packed(bytes);
+        std::vector<uint8_t> reference(bytes);
+        FrameCodec::PackRegion(output.data(), PITCH, region, packed.data());
+        FrameCodec::PackRegionReference(output.data(), PITCH, region, reference.data());
+        Check(packed == reference, "PackRegion() matches the reference");
+
+        const uint8_t* corner = output.data() + (region.top + region.height - 1) * PITCH + (region.left + region.width - 1) * 4;
+        Check(memcmp(packed.data() + bytes - 4, corner, 4) == 0, "the last packed pixel is the region's bottom-right one");
+    }
+
+    return TestResult("capture region");
+}
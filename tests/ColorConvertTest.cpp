@@ -0,0 +1,229 @@
+#include "BandLayout.hpp"
+#include "ColorConvert.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// The CPU YUV encoder and decoder at every SIMD level the machine has, in each planar format and colour space. Every
+// level must give the same bytes as the scalar kernels, and those must stay within 1 of the float references of the
+// BGRA2_4xx.hlsl and 4xx_2BGRA.hlsl shaders, over every 24-bit colour (and every Y, U, V triple) and over noise at odd
+// sizes. Encoding and decoding band by band must match the whole frame.
+
+constexpr FrameCodec::SimdLevel LEVELS[] = {
+    FrameCodec::SimdLevel::Scalar, FrameCodec::SimdLevel::SSE41, FrameCodec::SimdLevel::AVX2, FrameCodec::SimdLevel::AVX512
+};
+
+constexpr FrameCodec::PixelFormat FORMATS[] = {
+    FrameCodec::PixelFormat::YUV440, FrameCodec::PixelFormat::YUV420, FrameCodec::PixelFormat::YUV422
+};
+
+constexpr FrameCodec::ColorSpace SPACES[] = {
+    FrameCodec::ColorSpace::BT601Full, FrameCodec::ColorSpace::BT601Limited, FrameCodec::ColorSpace::BT709Full, FrameCodec::ColorSpace::BT709Limited
+};
+
+const char* FormatName(FrameCodec::PixelFormat format) {
+    switch (format) {
+        case FrameCodec::PixelFormat::YUV420: return "YUV420";
+        case FrameCodec::PixelFormat::YUV422: return "YUV422";
+        default: return "YUV440";
+    }
+}
+
+struct Planes {
+    size_t uvPitch;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> uv;
+
+    Planes(unsigned int width, unsigned int height, FrameCodec::PixelFormat format)
+        : uvPitch(static_cast<size_t>(FrameCodec::ChromaWidth(FrameCodec::GetChromaLayout(format), width)) * 2),
+          y(static_cast<size_t>(width) * height), uv(uvPitch * FrameCodec::ChromaHeight(FrameCodec::GetChromaLayout(format), height)) {}
+};
+
+// Largest difference from the reference, or -1 when `planes` differs from `exact`
+int Compare(const Planes& planes, const Planes& reference, const Planes& exact) {
+    if (planes.y != exact.y || planes.uv != exact.uv) return -1;
+    int worst = 0;
+    for (size_t i = 0; i < planes.y.size(); ++i) worst = std::max(worst, std::abs(planes.y[i] - reference.y[i]));
+    for (size_t i = 0; i < planes.uv.size(); ++i) worst = std::max(worst, std::abs(planes.uv[i] - reference.uv[i]));
+    return worst;
+}
+
+bool CheckEncode(const char* what, const std::vector<uint8_t>& bgra, size_t pitch, unsigned int width, unsigned int height,
+                 FrameCodec::PixelFormat format, FrameCodec::ColorSpace space) {
+    Planes reference(width, height, format);
+    FrameCodec::YuvEncoder::EncodeReference(bgra.data(), pitch, width, height, reference.y.data(), width, reference.uv.data(), reference.uvPitch,
+                                            format, space);
+
+    bool ok = true;
+    Planes scalar(width, height, format);
+    FrameCodec::YuvEncoder(width, height, format, space, 1, FrameCodec::SimdLevel::Scalar)
+        .Encode(bgra.data(), pitch, scalar.y.data(), width, scalar.uv.data(), scalar.uvPitch);
+
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 3u, FrameCodec::YuvEncoder::MAX_THREADS }) {
+            Planes planes(width, height, format);
+            FrameCodec::YuvEncoder encoder(width, height, format, space, threads, level);
+            encoder.Encode(bgra.data(), pitch, planes.y.data(), width, planes.uv.data(), planes.uvPitch);
+
+            const int worst = Compare(planes, reference, scalar);
+            if (worst < 0 || worst > 1) {
+                std::cerr << "FAILED: " << what << ", " << FrameCodec::SimdLevelName(level) << " on " << threads << " threads "
+                          << (worst < 0 ? "differs from the scalar kernel" : "is off the reference by " + std::to_string(worst)) << std::endl;
+                ok = false;
+            }
+        }
+    }
+    std::cout << "Encode " << FormatName(format) << " " << FrameCodec::GetYuvMatrix(space).name << " " << what << ": " << width << "x" << height << (ok ? " OK" : " FAILED") << std::endl;
+    return ok;
+}
+
+bool CheckDecode(const char* what, const Planes& planes, unsigned int width, unsigned int height, FrameCodec::PixelFormat format,
+                 FrameCodec::ColorSpace space) {
+    const size_t pitch = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> reference(pitch * height);
+    FrameCodec::YuvDecoder::DecodeReference(planes.y.data(), width, planes.uv.data(), planes.uvPitch, width, height, reference.data(), pitch,
+                                            format, space);
+
+    bool ok = true;
+    std::vector<uint8_t> scalar(pitch * height);
+    FrameCodec::YuvDecoder(width, height, format, space, 1, FrameCodec::SimdLevel::Scalar)
+        .Decode(planes.y.data(), width, planes.uv.data(), planes.uvPitch, scalar.data(), pitch);
+    int worst = 0;
+    for (size_t i = 0; i < scalar.size(); ++i) worst = std::max(worst, std::abs(scalar[i] - reference[i]));
+    if (worst > 1) {
+        std::cerr << "FAILED: " << what << ", the scalar decoder is off the reference by " << worst << std::endl;
+        ok = false;
+    }
+
+    for (FrameCodec::SimdLevel level : LEVELS) {
+        if (level > FrameCodec::DetectSimdLevel()) break;
+        for (unsigned int threads : { 1u, 3u, FrameCodec::YuvDecoder::MAX_THREADS }) {
+            std::vector<uint8_t> bgra(pitch * height);
+            FrameCodec::YuvDecoder decoder(width, height, format, space, threads, level);
+            decoder.Decode(planes.y.data(), width, planes.uv.data(), planes.uvPitch, bgra.data(), pitch);
+            if (bgra != scalar) {
+                std::cerr << "FAILED: " << what << ", " << FrameCodec::SimdLevelName(level) << " on " << threads << " threads differs from the scalar decoder" << std::endl;
+                ok = false;
+            }
+        }
+    }
+    std::cout << "Decode " << FormatName(format) << " " << FrameCodec::GetYuvMatrix(space).name << " " << what << ": " << width << "x" << height << (ok ? " OK" : " FAILED") << std::endl;
+    return ok;
+}
+
+// A PlanarBands payload filled band by band, as the client's compress loop does, against the whole-frame planes
+bool CheckBands(const std::vector<uint8_t>& bgra, size_t pitch, unsigned short width, unsigned short height, FrameCodec::PixelFormat format) {
+    Planes whole(width, height, format);
+    FrameCodec::YuvEncoder encoder(width, height, format);
+    encoder.Encode(bgra.data(), pitch, whole.y.data(), width, whole.uv.data(), whole.uvPitch);
+
+    const FrameCodec::PlanarBands bands(width, height, 4, format);
+    std::vector<uint8_t> payload(bands.GetPayloadSize());
+    for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+        const FrameCodec::Band& band = bands[i];
+        uint8_t* y = payload.data() + band.offset;
+        encoder.EncodeRows(bgra.data(), pitch, band.firstRow, band.rows, y, width, y + band.ySize, bands.GetUVPitch());
+    }
+
+    for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+        const FrameCodec::Band& band = bands[i];
+        const uint8_t* y = payload.data() + band.offset;
+        const size_t uvBytes = band.size - band.ySize;
+        if (memcmp(y, whole.y.data() + static_cast<size_t>(band.firstRow) * width, band.ySize) != 0 ||
+            memcmp(y + band.ySize, whole.uv.data() + band.uvRow * whole.uvPitch, uvBytes) != 0) {
+            std::cerr << "FAILED: band " << i << " differs from the whole frame" << std::endl;
+            return false;
+        }
+    }
+    // And back, band by band into one frame, as the viewer would as bands land
+    std::vector<uint8_t> decoded(static_cast<size_t>(width) * height * 4);
+    std::vector<uint8_t> wholeDecoded(decoded.size());
+    FrameCodec::YuvDecoder decoder(width, height, format);
+    decoder.Decode(whole.y.data(), width, whole.uv.data(), whole.uvPitch, wholeDecoded.data(), static_cast<size_t>(width) * 4);
+    for (unsigned int i = 0; i < bands.GetCount(); ++i) {
+        const FrameCodec::Band& band = bands[i];
+        const uint8_t* y = payload.data() + band.offset;
+        decoder.DecodeRows(y, width, y + band.ySize, bands.GetUVPitch(), band.firstRow, band.rows, decoded.data(), static_cast<size_t>(width) * 4);
+    }
+    if (decoded != wholeDecoded) {
+        std::cerr << "FAILED: decoding band by band differs from the whole frame" << std::endl;
+        return false;
+    }
+    std::cout << "Bands " << FormatName(format) << ": " << bands.GetCount() << " bands of " << width << "x" << height << " OK" << std::endl;
+    return true;
+}
+
+int main() {
+    bool ok = true;
+    std::cout << "Detected: " << FrameCodec::SimdLevelName(FrameCodec::DetectSimdLevel()) << std::endl;
+
+    // Every 24-bit colour once, 4096x4096
+    {
+        constexpr unsigned int SIDE = 4096;
+        std::vector<uint8_t> bgra(static_cast<size_t>(SIDE) * SIDE * 4);
+        for (uint32_t colour = 0; colour < SIDE * SIDE; ++colour) {
+            bgra[colour * 4] = static_cast<uint8_t>(colour);
+            bgra[colour * 4 + 1] = static_cast<uint8_t>(colour >> 8);
+            bgra[colour * 4 + 2] = static_cast<uint8_t>(colour >> 16);
+            bgra[colour * 4 + 3] = 255;
+        }
+        // The matrix and the chroma layout are independent, so the other colour spaces only run in 4:4:0
+        for (FrameCodec::PixelFormat format : FORMATS) ok = CheckEncode("All colours", bgra, SIDE * 4, SIDE, SIDE, format, SPACES[0]) && ok;
+        for (size_t i = 1; i < std::size(SPACES); ++i) ok = CheckEncode("All colours", bgra, SIDE * 4, SIDE, SIDE, FORMATS[0], SPACES[i]) && ok;
+    }
+
+    // Noise at sizes that leave a scalar tail on every kernel, some with odd heights and padded pitches
+    std::mt19937 rng(440);
+    const unsigned int sizes[][2] = { { 1366, 768 }, { 801, 599 }, { 17, 9 }, { 1, 2 }, { 63, 1 } };
+    for (const auto& size : sizes) {
+        const size_t pitch = size[0] * 4 + 64;
+        std::vector<uint8_t> bgra(pitch * size[1]);
+        for (uint8_t& byte : bgra) byte = static_cast<uint8_t>(rng());
+        for (FrameCodec::PixelFormat format : FORMATS) {
+            for (FrameCodec::ColorSpace space : SPACES) ok = CheckEncode("Noise", bgra, pitch, size[0], size[1], format, space) && ok;
+        }
+    }
+
+    // Every Y, U, V triple once on the even rows, counted along each row pair; the odd rows repeat it with Y inverted
+    {
+        constexpr unsigned int WIDTH = 4096, HEIGHT = 8192;
+        Planes planes(WIDTH, HEIGHT, FrameCodec::PixelFormat::YUV440);
+        for (unsigned int pair = 0; pair < HEIGHT / 2; ++pair) {
+            for (unsigned int x = 0; x < WIDTH; ++x) {
+                const uint32_t triple = pair * WIDTH + x;
+                planes.y[(pair * 2) * WIDTH + x] = static_cast<uint8_t>(triple);
+                planes.y[(pair * 2 + 1) * WIDTH + x] = static_cast<uint8_t>(~triple);
+                planes.uv[pair * WIDTH * 2 + x * 2] = static_cast<uint8_t>(triple >> 8);
+                planes.uv[pair * WIDTH * 2 + x * 2 + 1] = static_cast<uint8_t>(triple >> 16);
+            }
+        }
+        for (FrameCodec::ColorSpace space : SPACES) ok = CheckDecode("All triples", planes, WIDTH, HEIGHT, FrameCodec::PixelFormat::YUV440, space) && ok;
+    }
+
+    // Noise planes at odd sizes; an odd height's last row reads no UV row, and an odd width's last column a pair of its own
+    for (FrameCodec::PixelFormat format : FORMATS) {
+        for (const auto& size : sizes) {
+            Planes planes(size[0], size[1], format);
+            for (uint8_t& byte : planes.y) byte = static_cast<uint8_t>(rng());
+            for (uint8_t& byte : planes.uv) byte = static_cast<uint8_t>(rng());
+            for (FrameCodec::ColorSpace space : SPACES) ok = CheckDecode("Noise", planes, size[0], size[1], format, space) && ok;
+        }
+    }
+
+    {
+        const size_t pitch = 1920 * 4;
+        std::vector<uint8_t> bgra(pitch * 1080);
+        for (uint8_t& byte : bgra) byte = static_cast<uint8_t>(rng());
+        for (FrameCodec::PixelFormat format : FORMATS) ok = CheckBands(bgra, pitch, 1920, 1080, format) && ok;
+    }
+
+    std::cout << (ok ? "color convert: OK" : "color convert: FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include "AdaptiveScaler.hpp"
+#include "Downscale.hpp"
+#include "TestCheck.hpp"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Scaled sizes and their lookup, the compiled-in downscale kernel against the scalar reference at every level and
+// filter (noise at sizes that leave a tail on the vector loops, and a flat frame that must stay flat), and the level
+// the AdaptiveScaler settles on when a simulated link loses and regains bandwidth.
+namespace {
+    void CheckKernel(unsigned short width, unsigned short height, FrameCodec::ScaleLevel level, FrameCodec::ScaleFilter filter, std::mt19937& rng) {
+        const unsigned int dstWidth = FrameCodec::ScaledDimension(width, level);
+        const unsigned int dstHeight = FrameCodec::ScaledDimension(height, level);
+        const size_t srcPitch = static_cast<size_t>(width) * 4 + 64;
+        const size_t dstPitch = static_cast<size_t>(dstWidth) * 4;
+
+        std::vector<uint8_t> frame(srcPitch * height);
+        for (uint8_t& byte : frame) byte = static_cast<uint8_t>(rng());
+        FrameCodec::Downscaler scaler(width, height, dstWidth, dstHeight, filter);
+        std::vector<uint8_t> scaled(dstPitch * dstHeight);
+        std::vector<uint8_t> reference(dstPitch * dstHeight);
+        scaler.Scale(frame.data(), srcPitch, scaled.data(), dstPitch);
+        scaler.ScaleReference(frame.data(), srcPitch, reference.data(), dstPitch);
+        Check(scaled == reference, "the kernel matches the scalar reference on noise");
+
+        // The weights sum to one, so a flat frame comes out exactly as it went in
+        for (size_t i = 0; i < frame.size(); i += 4) {
+            frame[i] = 30;
+            frame[i + 1] = 144;
+            frame[i + 2] = 222;
+            frame[i + 3] = 255;
+        }
+        scaler.Scale(frame.data(), srcPitch, scaled.data(), dstPitch);
+        bool flat = true;
+        for (size_t i = 0; i < scaled.size(); i += 4) flat = flat && scaled[i] == 30 && scaled[i + 1] == 144 && scaled[i + 2] == 222 && scaled[i + 3] == 255;
+        Check(flat, "a flat frame stays flat");
+    }
+}
+
+int main() {
+    Check(FrameCodec::ScaledDimension(1920, FrameCodec::ScaleLevel::Full) == 1920, "full size is the mode's size");
+    Check(FrameCodec::ScaledDimension(1920, FrameCodec::ScaleLevel::ThreeQuarter) == 1440, "three quarters");
+    Check(FrameCodec::ScaledDimension(1366, FrameCodec::ScaleLevel::ThreeQuarter) == 1024, "three quarters, rounded down to even");
+    Check(FrameCodec::ScaledDimension(801, FrameCodec::ScaleLevel::Half) == 400, "half, rounded down to even");
+    Check(FrameCodec::ScaledDimension(3, FrameCodec::ScaleLevel::Half) == 2, "never below two");
+
+    for (unsigned int i = 0; i < FrameCodec::SCALE_LEVEL_COUNT; ++i) {
+        const FrameCodec::ScaleLevel level = static_cast<FrameCodec::ScaleLevel>(i);
+        FrameCodec::ScaleLevel found = FrameCodec::ScaleLevel::Full;
+        const bool known = FrameCodec::FindScaleLevel(2560, 1440, FrameCodec::ScaledDimension(2560, level), FrameCodec::ScaledDimension(1440, level), found);
+        Check(known && found == level, "every level's size is found again");
+    }
+    FrameCodec::ScaleLevel found;
+    Check(!FrameCodec::FindScaleLevel(2560, 1440, 2000, 1440, found), "a size of no level is refused");
+
+    std::mt19937 rng(42);
+    const unsigned short sizes[][2] = { { 1920, 1080 }, { 1366, 768 }, { 801, 599 }, { 17, 9 }, { 6, 4 } };
+    for (const auto& size : sizes) {
+        for (FrameCodec::ScaleLevel level : { FrameCodec::ScaleLevel::ThreeQuarter, FrameCodec::ScaleLevel::Half }) {
+            for (FrameCodec::ScaleFilter filter : { FrameCodec::ScaleFilter::Box, FrameCodec::ScaleFilter::Bilinear }) CheckKernel(size[0], size[1], level, filter, rng);
+        }
+    }
+
+    // Raw frames cost roughly bytes / bandwidth on the wire; the link degrades in two steps and then recovers
+    {
+        const unsigned short width = 2560;
+        const unsigned short height = 1440;
+        const double dirtyShare = 0.35; // Of each frame's tiles that change
+        FrameCodec::AdaptiveScaler scaler(60);
+        const unsigned int ends[] = { 300, 900, 1200, 1800 };
+        const double rates[] = { 25.0, 2.0, 1.0, 25.0 }; // Gb/s
+        const FrameCodec::ScaleLevel settled[] = { FrameCodec::ScaleLevel::Full, FrameCodec::ScaleLevel::ThreeQuarter, FrameCodec::ScaleLevel::Half,
+                                                   FrameCodec::ScaleLevel::Full };
+        unsigned int frame = 0;
+        for (unsigned int phase = 0; phase < 4; ++phase) {
+            for (; frame < ends[phase]; ++frame) {
+                const FrameCodec::ScaleLevel level = scaler.GetLevel();
+                const double bytes = FrameCodec::ScaledDimension(width, level) * static_cast<double>(FrameCodec::ScaledDimension(height, level)) * 4 * dirtyShare;
+                const double costNs = bytes * 8.0 / rates[phase] + 1.5e6; // Wire time plus a fixed encode and flag round trip
+                scaler.Update(static_cast<uint64_t>(bytes), static_cast<uint64_t>(costNs));
+            }
+            Check(scaler.GetLevel() == settled[phase], "the scale follows the link: full, 3/4, 1/2, then full again");
+        }
+        Check(scaler.GetSwitches() == 4, "each change of the link switches once, without flapping");
+    }
+
+    return TestResult("downscale");
+}
@@ -0,0 +1,91 @@
+#include "FrameHeader.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// BeginFrameHeader, SealFrameHeader and ParseFrameHeader on a buffer laid out as a send slot
+namespace {
+    constexpr size_t PAYLOAD_SIZE = 4096;
+
+    // A cache-line aligned slot with a sealed frame and a patterned payload in it
+    struct Slot {
+        std::vector<uint8_t> storage = std::vector<uint8_t>(FrameCodec::FrameSlotSize(PAYLOAD_SIZE) + FrameCodec::FRAME_CACHE_LINE);
+        uint8_t* base = nullptr;
+        FrameCodec::FrameHeader* header = nullptr;
+
+        explicit Slot(bool checksum) {
+            const size_t misalignment = reinterpret_cast<uintptr_t>(storage.data()) % FrameCodec::FRAME_CACHE_LINE;
+            base = storage.data() + (misalignment ? FrameCodec::FRAME_CACHE_LINE - misalignment : 0);
+            header = FrameCodec::BeginFrameHeader(base + FrameCodec::FRAME_HEADER_OFFSET, 42, FrameCodec::PixelFormat::BGRA32,
+                                                  FrameCodec::PayloadEncoding::TileDelta, 1920, 1080);
+            uint8_t* payload = base + FrameCodec::FRAME_PAYLOAD_OFFSET;
+            for (size_t i = 0; i < PAYLOAD_SIZE; ++i) payload[i] = static_cast<uint8_t>(i * 7);
+            FrameCodec::SealFrameHeader(header, PAYLOAD_SIZE, checksum);
+        }
+
+        uint8_t* Header() { return base + FrameCodec::FRAME_HEADER_OFFSET; }
+        size_t Length() const { return FrameCodec::FrameSlotSize(PAYLOAD_SIZE) - FrameCodec::FRAME_HEADER_OFFSET; }
+    };
+
+    FrameCodec::FrameHeaderStatus Parse(Slot& slot, size_t length) {
+        FrameCodec::FrameHeaderStatus status = FrameCodec::FrameHeaderStatus::Ok;
+        const FrameCodec::FrameHeader* header = FrameCodec::ParseFrameHeader(slot.Header(), length, status);
+        Check((header != nullptr) == (status == FrameCodec::FrameHeaderStatus::Ok), "nullptr exactly when the status is not Ok");
+        return status;
+    }
+}
+
+int main() {
+    for (bool checksum : { false, true }) {
+        Slot slot(checksum);
+        FrameCodec::FrameHeaderStatus status;
+        const FrameCodec::FrameHeader* header = FrameCodec::ParseFrameHeader(slot.Header(), slot.Length(), status);
+        Check(header == slot.header && status == FrameCodec::FrameHeaderStatus::Ok, "a sealed frame parses");
+        Check(header && header->sequence == 42 && header->width == 1920 && header->height == 1080 && header->payloadSize == PAYLOAD_SIZE &&
+              header->format == FrameCodec::PixelFormat::BGRA32 && header->encoding == FrameCodec::PayloadEncoding::TileDelta,
+              "the fields come back as set");
+        Check(header && ((header->flags & FrameCodec::FRAME_FLAG_CHECKSUM) != 0) == checksum, "the checksum flag follows the seal");
+        Check(header && FrameCodec::GetFramePayload(header) == slot.base + FrameCodec::FRAME_PAYLOAD_OFFSET, "the payload sits behind the header");
+    }
+
+    {
+        Slot slot(false);
+        slot.header->magic ^= 1;
+        Check(Parse(slot, slot.Length()) == FrameCodec::FrameHeaderStatus::BadMagic, "bad magic is refused");
+    }
+    {
+        Slot slot(false);
+        slot.header->version = FrameCodec::FRAME_HEADER_VERSION - 1;
+        Check(Parse(slot, slot.Length()) == FrameCodec::FrameHeaderStatus::UnsupportedVersion, "an older version is refused");
+    }
+    {
+        Slot slot(false);
+        slot.header->version = FrameCodec::FRAME_HEADER_VERSION + 1;
+        Check(Parse(slot, slot.Length()) == FrameCodec::FrameHeaderStatus::Ok, "a newer version that kept the layout is taken");
+    }
+    {
+        Slot slot(false);
+        FrameCodec::FrameHeaderStatus status;
+        const FrameCodec::FrameHeader* header = FrameCodec::ParseFrameHeader(slot.Header() + 8, slot.Length() - 8, status);
+        Check(!header && status == FrameCodec::FrameHeaderStatus::Misaligned, "a misaligned header is refused");
+    }
+    {
+        Slot slot(false);
+        Check(Parse(slot, sizeof(FrameCodec::FrameHeader) - 1) == FrameCodec::FrameHeaderStatus::TooShort, "a buffer shorter than the header is refused");
+        Check(Parse(slot, sizeof(FrameCodec::FrameHeader) + PAYLOAD_SIZE - 1) == FrameCodec::FrameHeaderStatus::BadPayloadSize,
+              "a payload larger than the buffer is refused");
+        Check(Parse(slot, sizeof(FrameCodec::FrameHeader) + PAYLOAD_SIZE) == FrameCodec::FrameHeaderStatus::Ok, "a payload that just fits is taken");
+    }
+    {
+        Slot slot(true);
+        slot.base[FrameCodec::FRAME_PAYLOAD_OFFSET + 100] ^= 0x10;
+        Check(Parse(slot, slot.Length()) == FrameCodec::FrameHeaderStatus::ChecksumMismatch, "a damaged payload fails its checksum");
+        Slot unchecked(false);
+        unchecked.base[FrameCodec::FRAME_PAYLOAD_OFFSET + 100] ^= 0x10;
+        Check(Parse(unchecked, unchecked.Length()) == FrameCodec::FrameHeaderStatus::Ok, "without the flag the payload is not hashed");
+    }
+
+    return TestResult("frame header");
+}
@@ -0,0 +1,95 @@
+#include "FrameMailbox.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// FrameMailbox on one thread, then under a producer publishing as fast as it can while the consumer takes frames at
+// different paces. Every slot is filled with its sequence number, so a torn frame (the producer writing into the
+// slot being read) shows up as mixed values.
+namespace {
+    struct Pace {
+        const char* name;
+        size_t words;                        // Slot size in 64-bit words
+        std::chrono::microseconds consumerWork;
+        bool producerYields;                 // Forces interleaving when both threads share a core
+        uint64_t frames;
+    };
+
+    void Stress(const Pace& pace) {
+        std::array<std::vector<uint64_t>, FrameCodec::FrameMailbox::SLOTS> slots;
+        for (auto& slot : slots) slot.assign(pace.words, 0);
+
+        FrameCodec::FrameMailbox mailbox;
+        uint64_t torn = 0;
+        uint64_t reordered = 0;
+        uint64_t taken = 0;
+
+        std::thread consumer([&] {
+            uint64_t last = 0;
+            while (mailbox.WaitAndTake()) {
+                const std::vector<uint64_t>& slot = slots[mailbox.GetReadSlot()];
+                const uint64_t sequence = slot[0];
+                if (std::any_of(slot.begin(), slot.end(), [sequence](uint64_t v) { return v != sequence; })) torn++;
+                if (sequence <= last) reordered++;
+                last = sequence;
+                taken++;
+
+                if (pace.consumerWork.count() > 0) std::this_thread::sleep_for(pace.consumerWork);
+            }
+        });
+
+        for (uint64_t sequence = 1; sequence <= pace.frames; ++sequence) {
+            std::vector<uint64_t>& slot = slots[mailbox.GetWriteSlot()];
+            std::fill(slot.begin(), slot.end(), sequence);
+            mailbox.Publish();
+            if (pace.producerYields) std::this_thread::yield();
+        }
+        mailbox.Close();
+        consumer.join();
+
+        std::cout << pace.name << ": " << taken << " taken, " << mailbox.GetDropped() << " dropped, " << torn << " torn, " << reordered << " reordered" << std::endl;
+        Check(torn == 0, "no frame is torn");
+        Check(reordered == 0, "frames are taken in order");
+        Check(mailbox.GetPublished() == pace.frames && taken + mailbox.GetDropped() == pace.frames, "every frame is taken or counted as dropped");
+    }
+}
+
+int main() {
+    {
+        FrameCodec::FrameMailbox mailbox;
+        Check(!mailbox.Take(), "nothing to take before a publish");
+        const unsigned int read = mailbox.GetReadSlot();
+
+        const unsigned int first = mailbox.GetWriteSlot();
+        mailbox.Publish();
+        Check(mailbox.HasFresh(), "a publish leaves a fresh frame");
+        Check(mailbox.GetWriteSlot() != first && mailbox.GetWriteSlot() != read, "the producer moves on to a free slot");
+        const unsigned int second = mailbox.GetWriteSlot();
+        mailbox.Publish();
+        Check(mailbox.GetDropped() == 1, "publishing over an untaken frame drops it");
+
+        Check(mailbox.Take() && mailbox.GetReadSlot() == second, "the consumer gets the newest frame");
+        Check(!mailbox.HasFresh() && !mailbox.Take(), "a frame is taken once");
+
+        mailbox.Close();
+        Check(mailbox.IsClosed() && !mailbox.WaitAndTake(), "a closed mailbox wakes the consumer with nothing");
+        mailbox.Reopen();
+        Check(!mailbox.IsClosed() && !mailbox.Take(), "a reopened mailbox is open and empty");
+        Check(mailbox.GetPublished() == 2 && mailbox.GetDropped() == 1, "the counters carry on over a reopen");
+    }
+
+    const Pace paces[] = {
+        { "tiny slots, free-running", 8, std::chrono::microseconds(0), false, 200000 },
+        { "tiny slots, interleaved", 8, std::chrono::microseconds(0), true, 50000 },
+        { "64KB slots, interleaved", 8192, std::chrono::microseconds(0), true, 10000 },
+        { "64KB slots, slow consumer (200us)", 8192, std::chrono::microseconds(200), false, 20000 },
+    };
+    for (const Pace& pace : paces) Stress(pace);
+
+    return TestResult("frame mailbox");
+}
@@ -0,0 +1,151 @@
+#include "CaptureRegion.hpp"
+#include "ReplaySource.hpp"
+#include "SyntheticSource.hpp"
+#include "TileDelta.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// The capture-side stages driven from FrameSources instead of a desktop: every synthetic content through the pack,
+// delta encode and decode must leave the viewer with the source's pixels, the same seed must give the same frames,
+// and a recording must play back through ReplaySource as it was written, looping or not.
+namespace {
+    constexpr uint16_t WIDTH = 1280;
+    constexpr uint16_t HEIGHT = 720;
+    constexpr uint16_t REFRESH_RATE = 60;
+    constexpr unsigned int ACQUIRES = 30;
+    constexpr unsigned int RECORDED_FRAMES = 10;
+    constexpr size_t FRAME_BYTES = static_cast<size_t>(WIDTH) * HEIGHT * 4;
+
+    struct Counts {
+        unsigned int frames = 0;
+        unsigned int unchanged = 0;
+        unsigned int timeouts = 0;
+        unsigned long long pointerMoves = 0;
+        bool failed = false;
+        bool match = true;
+    };
+
+    Counts Stream(FrameCodec::SyntheticContent content) {
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, content);
+        Counts counts;
+        source.SetPointerCallback([&](const FrameCodec::CursorState&) { counts.pointerMoves++; });
+
+        const FrameCodec::CaptureRegion whole = { 0, 0, WIDTH, HEIGHT };
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        std::vector<uint8_t> packed(FRAME_BYTES);
+        std::vector<uint8_t> delta(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+        for (unsigned int n = 0; n < ACQUIRES; ++n) {
+            FrameCodec::SourceFrame frame;
+            switch (source.Acquire(0, frame)) {
+                case FrameCodec::AcquireResult::Frame: break;
+                case FrameCodec::AcquireResult::Unchanged: counts.unchanged++; continue;
+                case FrameCodec::AcquireResult::Timeout: counts.timeouts++; continue;
+                case FrameCodec::AcquireResult::Failed: counts.failed = true; continue;
+            }
+            FrameCodec::PackRegion(frame.pixels, frame.pitch, whole, packed.data());
+            source.Release();
+            counts.frames++;
+
+            const size_t length = encoder.Encode(packed.data(), delta.data());
+            if (!decoder.Decode(delta.data(), length)) counts.match = false;
+            for (unsigned int y = 0; y < HEIGHT && counts.match; ++y) {
+                counts.match = memcmp(decoder.GetFrame() + y * decoder.GetPitch(), packed.data() + y * WIDTH * 4, WIDTH * 4) == 0;
+            }
+        }
+        return counts;
+    }
+}
+
+int main() {
+    for (unsigned int i = 0; i < FrameCodec::SYNTHETIC_CONTENT_COUNT; ++i) {
+        const FrameCodec::SyntheticContent content = static_cast<FrameCodec::SyntheticContent>(i);
+        const Counts counts = Stream(content);
+        std::cout << FrameCodec::SyntheticContentName(content) << ": " << counts.frames << " frames, " << counts.unchanged << " unchanged, "
+                  << counts.timeouts << " timeouts, " << counts.pointerMoves << " pointer moves" << std::endl;
+        Check(!counts.failed && counts.frames > 0, "every content delivers frames");
+        Check(counts.match, "the viewer ends up with the source's pixels");
+
+        switch (content) {
+            case FrameCodec::SyntheticContent::StaticDesktop:
+                Check(counts.frames == 1 && counts.pointerMoves == 0, "a static desktop delivers one frame");
+                break;
+            case FrameCodec::SyntheticContent::CursorOnly:
+                Check(counts.frames == 1 && counts.unchanged == ACQUIRES - 1 && counts.pointerMoves == ACQUIRES - 1,
+                      "a moving pointer reports itself without new frames");
+                break;
+            default:
+                Check(counts.frames == ACQUIRES, "moving content delivers a frame per acquire");
+                break;
+        }
+    }
+
+    // Same content and seed, same frames
+    {
+        FrameCodec::SyntheticSource first(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::VideoNoise, 7);
+        FrameCodec::SyntheticSource second(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::VideoNoise, 7);
+        bool same = true;
+        for (unsigned int n = 0; n < 5; ++n) {
+            FrameCodec::SourceFrame a, b;
+            same = same && first.Acquire(0, a) == FrameCodec::AcquireResult::Frame && second.Acquire(0, b) == FrameCodec::AcquireResult::Frame &&
+                   a.pitch == b.pitch && memcmp(a.pixels, b.pixels, a.pitch * HEIGHT) == 0;
+            first.Release();
+            second.Release();
+        }
+        Check(same, "a seed gives the same frames every run");
+    }
+
+    // Record scrolling text, then play the recording back
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "frame_source_test.raw";
+    std::vector<std::vector<uint8_t>> recorded;
+    {
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, FrameCodec::SyntheticContent::ScrollingText, 40);
+        std::ofstream out(path, std::ios::binary);
+        for (unsigned int n = 0; n < RECORDED_FRAMES; ++n) {
+            FrameCodec::SourceFrame frame;
+            if (source.Acquire(0, frame) != FrameCodec::AcquireResult::Frame) {
+                std::cout << "FAILED: scrolling text delivers a frame to record" << std::endl;
+                return 1;
+            }
+            recorded.emplace_back(frame.pixels, frame.pixels + FRAME_BYTES);
+            out.write(reinterpret_cast<const char*>(frame.pixels), static_cast<std::streamsize>(FRAME_BYTES));
+            source.Release();
+        }
+    }
+    {
+        FrameCodec::ReplaySource replay(WIDTH, HEIGHT, REFRESH_RATE, false, true);
+        Check(replay.Open(path.string()) && replay.GetFrameCount() == RECORDED_FRAMES, "the recording opens with every frame");
+        bool replayed = true;
+        for (unsigned int n = 0; n < RECORDED_FRAMES * 2 && replayed; ++n) { // Twice through, so the loop is covered
+            FrameCodec::SourceFrame frame;
+            replayed = replay.Acquire(0, frame) == FrameCodec::AcquireResult::Frame &&
+                       memcmp(frame.pixels, recorded[n % RECORDED_FRAMES].data(), FRAME_BYTES) == 0;
+            replay.Release();
+        }
+        Check(replayed, "a looping replay plays the recording back frame for frame, twice");
+    }
+    {
+        FrameCodec::ReplaySource replay(WIDTH, HEIGHT, REFRESH_RATE, false, false);
+        bool delivered = replay.Open(path.string());
+        for (unsigned int n = 0; n < RECORDED_FRAMES && delivered; ++n) {
+            FrameCodec::SourceFrame frame;
+            delivered = replay.Acquire(0, frame) == FrameCodec::AcquireResult::Frame;
+            replay.Release();
+        }
+        FrameCodec::SourceFrame frame;
+        Check(delivered && replay.Acquire(0, frame) == FrameCodec::AcquireResult::Failed, "a replay that doesn't loop fails at the end");
+    }
+    std::filesystem::resize_file(path, FRAME_BYTES / 2);
+    {
+        FrameCodec::ReplaySource replay(WIDTH, HEIGHT, REFRESH_RATE);
+        Check(!replay.Open(path.string()), "a recording holding no whole frame is refused");
+    }
+    std::filesystem::remove(path);
+
+    return TestResult("frame source");
+}
@@ -0,0 +1,196 @@
+#include "RowPool.hpp"
+#include "SyntheticSource.hpp"
+#include "TileCodec.hpp"
+#include "TileDelta.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// The lossless tile codec: tiles with every op in them at the shapes a frame's edges leave, decoded exact, with
+// truncated, padded and damaged streams refused or kept inside the tile; lossless payloads with a repeated tile, an
+// overrunning stream or a short end refused; RowPool::RunUnits() handing every tile to exactly one share; and
+// synthetic sessions through lossless tile deltas, exact and byte-identical at every thread count.
+namespace {
+    constexpr uint16_t WIDTH = 640;
+    constexpr uint16_t HEIGHT = 360;
+    constexpr uint16_t REFRESH_RATE = 60;
+    constexpr unsigned int FRAMES = 10;
+    constexpr unsigned int THREAD_COUNTS[] = { 1, 2, 4, 8 };
+
+    // Tiles with every op in them, at the shapes a frame's edges leave
+    bool CheckTiles() {
+        std::mt19937 rng(7);
+        const unsigned int shapes[][2] = { { 64, 64 }, { 1, 1 }, { 1, 64 }, { 64, 1 }, { 17, 63 }, { 63, 17 } };
+        bool ok = true;
+
+        for (const auto& shape : shapes) {
+            const unsigned int width = shape[0];
+            const unsigned int rows = shape[1];
+            const size_t pitch = static_cast<size_t>(width + 5) * 4; // Rows apart, as in a frame
+            std::vector<uint8_t> tile(pitch * rows);
+            std::vector<uint8_t> stream(FrameCodec::MaxLosslessTileSize(width, rows));
+            std::vector<uint8_t> decoded(pitch * rows);
+
+            for (unsigned int pattern = 0; pattern < 5; ++pattern) {
+                for (unsigned int y = 0; y < rows; ++y) {
+                    uint32_t* row = reinterpret_cast<uint32_t*>(tile.data() + y * pitch);
+                    for (unsigned int x = 0; x < width; ++x) {
+                        switch (pattern) {
+                            case 0: row[x] = 0xFF202020; break;                                          // Flat
+                            case 1: row[x] = rng(); break;                                               // Noise: stored
+                            case 2: row[x] = (rng() % 8 == 0) ? 0xFF000000 | rng() % 3 : 0xFFFFFFFF; break; // Text: a few colours
+                            case 3: row[x] = 0xFF000000 | (x * 4) << 8 | y; break;                         // Gradient: repeats up
+                            default: row[x] = (x / 3 + y / 2) % 2 ? 0xFF3060A0 : rng(); break;            // Runs between literals
+                        }
+                    }
+                }
+
+                const size_t length = FrameCodec::EncodeLosslessTile(tile.data(), pitch, width, rows, stream.data());
+                std::fill(decoded.begin(), decoded.end(), 0);
+                bool exact = length <= stream.size() && FrameCodec::DecodeLosslessTile(stream.data(), length, width, rows, decoded.data(), pitch);
+                for (unsigned int y = 0; exact && y < rows; ++y) exact = memcmp(tile.data() + y * pitch, decoded.data() + y * pitch, width * 4) == 0;
+
+                // Short by a byte, a byte too many and an unknown mode must all be refused
+                bool rejected = !FrameCodec::DecodeLosslessTile(stream.data(), length - 1, width, rows, decoded.data(), pitch);
+                std::vector<uint8_t> longer(stream.begin(), stream.begin() + length);
+                longer.push_back(0);
+                rejected = rejected && !FrameCodec::DecodeLosslessTile(longer.data(), longer.size(), width, rows, decoded.data(), pitch);
+                longer[0] = 7;
+                rejected = rejected && !FrameCodec::DecodeLosslessTile(longer.data(), length, width, rows, decoded.data(), pitch);
+
+                // Random damage may decode to other pixels, but must stay inside the tile
+                for (unsigned int trial = 0; trial < 64 && length > 1; ++trial) {
+                    std::vector<uint8_t> damaged(stream.begin(), stream.begin() + length);
+                    damaged[1 + rng() % (length - 1)] ^= static_cast<uint8_t>(1 + rng() % 255);
+                    FrameCodec::DecodeLosslessTile(damaged.data(), damaged.size(), width, rows, decoded.data(), pitch);
+                }
+
+                if (!exact || !rejected) {
+                    std::cout << width << "x" << rows << " pattern " << pattern << ": " << (exact ? "" : "MISMATCH ") << (rejected ? "" : "CORRUPT STREAM TAKEN") << std::endl;
+                    ok = false;
+                }
+            }
+        }
+        std::cout << "tiles | every op at 6 shapes, truncated and padded streams: " << (ok ? "OK" : "FAILED") << std::endl;
+        return ok;
+    }
+
+    // A lossless payload with a tile twice, a stream length that overruns and one cut short: all refused
+    bool CheckPayloads() {
+        constexpr uint16_t width = 200;
+        constexpr uint16_t height = 130;
+        std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 4);
+        std::mt19937 rng(11);
+        for (size_t i = 0; i < frame.size(); i += 4) {
+            const uint32_t pixel = (i / 4) % 37 < 30 ? 0xFFF0F0F0 : rng();
+            memcpy(frame.data() + i, &pixel, 4);
+        }
+
+        FrameCodec::DeltaEncoder encoder(width, height);
+        encoder.EnableLossless(true, 2);
+        encoder.EnableScrollDetection(false);
+        std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(width, height, true));
+        const size_t length = encoder.Encode(frame.data(), payload.data());
+
+        FrameCodec::DeltaHeader header;
+        memcpy(&header, payload.data(), sizeof(header));
+        uint8_t* entries = payload.data() + sizeof(header) + header.copyCount * sizeof(FrameCodec::CopyRect);
+        uint8_t* sizes = entries + header.tileCount * sizeof(FrameCodec::TileEntry);
+
+        auto Decodes = [&](const std::vector<uint8_t>& bytes, size_t size) {
+            FrameCodec::DeltaDecoder decoder(width, height);
+            decoder.EnableLossless(true, 2);
+            return decoder.Decode(bytes.data(), size) && memcmp(decoder.GetFrame(), frame.data(), frame.size()) == 0;
+        };
+
+        bool ok = header.tileCount >= 2 && Decodes(payload, length);
+
+        std::vector<uint8_t> twice = payload;
+        memcpy(twice.data() + (entries - payload.data()) + sizeof(FrameCodec::TileEntry), entries, sizeof(FrameCodec::TileEntry));
+        ok = ok && !Decodes(twice, length);
+
+        std::vector<uint8_t> overrun = payload;
+        const uint32_t huge = 0x10000;
+        memcpy(overrun.data() + (sizes - payload.data()), &huge, sizeof(huge));
+        ok = ok && !Decodes(overrun, length);
+
+        ok = ok && !Decodes(payload, length - 1);
+
+        std::cout << "payloads | repeated tile, overrunning stream, short payload: " << (ok ? "OK" : "FAILED") << std::endl;
+        return ok;
+    }
+
+    struct Session {
+        size_t bytes = 0;
+        std::vector<uint8_t> payloads; // Every payload, so thread counts can be compared
+        bool exact = true;
+    };
+
+    // A synthetic session through a lossless DeltaEncoder and DeltaDecoder pair, as a raw push session sends it
+    Session RunSession(FrameCodec::SyntheticContent content, unsigned int threads) {
+        Session session;
+        FrameCodec::SyntheticSource source(WIDTH, HEIGHT, REFRESH_RATE, content, 43);
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        encoder.SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+        decoder.SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+        encoder.EnableLossless(true, threads);
+        decoder.EnableLossless(true, threads);
+        std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT, true));
+
+        for (unsigned int n = 0; n < FRAMES; ++n) {
+            FrameCodec::SourceFrame frame;
+            if (source.Acquire(0, frame) != FrameCodec::AcquireResult::Frame) continue;
+            // Synthetic frames are tightly packed
+            const size_t length = encoder.Encode(frame.pixels, payload.data());
+            session.exact = decoder.Decode(payload.data(), length) && memcmp(decoder.GetFrame(), frame.pixels, static_cast<size_t>(WIDTH) * HEIGHT * 4) == 0 && session.exact;
+            source.Release();
+            session.bytes += length;
+            session.payloads.insert(session.payloads.end(), payload.begin(), payload.begin() + length);
+        }
+        return session;
+    }
+}
+
+int main() {
+    Check(CheckTiles(), "every tile decodes exact and bad streams are refused");
+    Check(CheckPayloads(), "bad lossless payloads are refused");
+
+    // Every unit lands in exactly one share, whether the count fills the pool, leaves it short, or is too small to split
+    for (unsigned int threads : THREAD_COUNTS) {
+        FrameCodec::RowPool pool(threads);
+        for (unsigned int units : { 0u, 1u, 15u, 16u, 17u, 33u, 129u, 510u }) {
+            std::vector<std::atomic<unsigned int>> seen(units);
+            std::atomic<unsigned int> smallest = units;
+            pool.RunUnits(units, FrameCodec::LOSSLESS_MIN_SHARE, [&](unsigned int begin, unsigned int end) {
+                for (unsigned int i = begin; i < end; ++i) seen[i]++;
+                unsigned int current = smallest.load();
+                while (end - begin < current && !smallest.compare_exchange_weak(current, end - begin)) {}
+            });
+            Check(std::all_of(seen.begin(), seen.end(), [](const std::atomic<unsigned int>& count) { return count.load() == 1; }),
+                  "RunUnits() hands every unit to exactly one share");
+            Check(units < 2 * FrameCodec::LOSSLESS_MIN_SHARE || smallest.load() >= FrameCodec::LOSSLESS_MIN_SHARE,
+                  "RunUnits() never cuts a share below its minimum");
+        }
+    }
+
+    // CursorOnly is left out: the pointer is not in the frames, so it codes as StaticDesktop does
+    for (FrameCodec::SyntheticContent content : { FrameCodec::SyntheticContent::StaticDesktop, FrameCodec::SyntheticContent::ScrollingText,
+                                                  FrameCodec::SyntheticContent::VideoNoise }) {
+        Session first;
+        for (unsigned int threads : THREAD_COUNTS) {
+            const Session session = RunSession(content, threads);
+            if (threads == THREAD_COUNTS[0]) first = session;
+            std::cout << FrameCodec::SyntheticContentName(content) << ", " << threads << " thread(s): " << session.bytes << " bytes" << std::endl;
+            Check(session.bytes > 0 && session.exact, "a lossless session comes back exact");
+            Check(session.payloads == first.payloads, "the thread count changes no byte of the payloads");
+        }
+    }
+
+    return TestResult("lossless tiles");
+}
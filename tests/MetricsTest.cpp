@@ -0,0 +1,131 @@
+#include "Metrics.hpp"
+#include "TestCheck.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// The metrics registry updated from several threads the way the capture, send and receive loops do, while a monitor
+// reads the exporter's shared-memory segment: no update may be lost, every read of the segment must be consistent
+// with totals that never go back, and the exporter's JSON file must end with the exact values.
+namespace {
+    constexpr unsigned int THREADS = 4;
+    constexpr uint64_t UPDATES = 200000; // Per thread
+    constexpr uint64_t RECORD_RANGE = 1000; // Histogram values cycle through [0, RECORD_RANGE)
+
+    const FrameCodec::SharedMetric* Find(const std::vector<FrameCodec::SharedMetric>& metrics, const char* name) {
+        for (const FrameCodec::SharedMetric& metric : metrics) {
+            if (strcmp(metric.name, name) == 0) return &metric;
+        }
+        return nullptr;
+    }
+}
+
+int main() {
+    const FrameCodec::Counter counter("test.updates");
+    const FrameCodec::Histogram histogram("test.latency_us");
+    const FrameCodec::Gauge gauge("test.threads");
+
+    FrameCodec::MetricsRegistry& registry = FrameCodec::MetricsRegistry::Instance();
+    Check(registry.Register("test.updates", FrameCodec::MetricType::Counter) == registry.Register("test.updates", FrameCodec::MetricType::Counter),
+          "registering a name again gives the same metric");
+    Check(registry.Register("test.updates", FrameCodec::MetricType::Gauge) == FrameCodec::METRIC_NONE, "registering a name as another type gives none");
+
+    const std::string segment = "ndrc-metrics-test-" + std::to_string(getpid());
+    const std::filesystem::path jsonPath = std::filesystem::temp_directory_path() / (segment + ".json");
+    FrameCodec::MetricsExporter exporter(segment, jsonPath.string(), std::chrono::milliseconds(10));
+    FrameCodec::SharedMetricsReader reader;
+    if (!exporter.Start() || !reader.Open(segment)) {
+        std::cout << "FAILED: the metrics segment can't be exported and opened" << std::endl;
+        return 1;
+    }
+
+    // A monitor reading the segment the whole time: every copy must be consistent, and totals never go back
+    std::atomic<bool> stop = false;
+    uint64_t reads = 0;
+    uint64_t regressions = 0;
+    std::thread monitor([&]() {
+        uint64_t lastUpdates = 0;
+        uint64_t lastSequence = 0;
+        FrameCodec::SharedMetricsHeader header;
+        std::vector<FrameCodec::SharedMetric> metrics;
+        while (!stop.load()) {
+            if (reader.Read(header, metrics)) {
+                reads++;
+                if (header.sequence < lastSequence || header.sequence & 1) regressions++;
+                lastSequence = header.sequence;
+                if (const FrameCodec::SharedMetric* updates = Find(metrics, "test.updates")) {
+                    if (static_cast<uint64_t>(updates->value) < lastUpdates) regressions++;
+                    lastUpdates = static_cast<uint64_t>(updates->value);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+
+    gauge.Set(THREADS);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&]() {
+            for (uint64_t i = 0; i < UPDATES; ++i) {
+                counter.Add();
+                histogram.Record(i % RECORD_RANGE);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    // Long enough for the exporter to publish while the monitor still reads
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    stop.store(true);
+    monitor.join();
+    exporter.Stop(); // Publishes the final values
+
+    std::cout << "Monitor: " << reads << " consistent reads, " << regressions << " went backwards" << std::endl;
+    Check(reads > 0 && regressions == 0, "the segment always reads back consistent, and never goes backwards");
+
+    // The workers are gone; their shards still hold every update
+    const uint64_t expected = UPDATES * THREADS;
+    uint64_t expectedSum = 0;
+    for (uint64_t i = 0; i < UPDATES; ++i) expectedSum += i % RECORD_RANGE;
+    expectedSum *= THREADS;
+
+    bool found = false;
+    for (const FrameCodec::MetricSnapshot& metric : registry.Snapshot()) {
+        if (metric.name == "test.updates") Check(static_cast<uint64_t>(metric.value) == expected, "the counter holds every update");
+        if (metric.name == "test.threads") Check(static_cast<uint64_t>(metric.value) == THREADS, "the gauge holds its last value");
+        if (metric.name == "test.latency_us") {
+            found = true;
+            Check(metric.count == expected && metric.sum == expectedSum, "the histogram holds every value");
+            // Uniform over [0, 1000): the median lands in [256, 512), the 99th in [512, 1024)
+            Check(metric.Percentile(50) == 511 && metric.Percentile(99) == 1023, "percentiles fall in the expected buckets");
+        }
+    }
+    Check(found, "the snapshot holds the histogram");
+
+    // Stop() unlinked the segment, so the final values are read from the JSON file
+    std::ifstream json(jsonPath);
+    std::stringstream text;
+    text << json.rdbuf();
+    Check(text.str().find("\"test.updates\": " + std::to_string(expected)) != std::string::npos &&
+              text.str().find("\"test.threads\": " + std::to_string(THREADS)) != std::string::npos,
+          "the JSON file holds the final values");
+    json.close();
+    std::filesystem::remove(jsonPath);
+
+    return TestResult("metrics");
+}
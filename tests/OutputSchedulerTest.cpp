@@ -0,0 +1,148 @@
+#include "OutputScheduler.hpp"
+#include "FrameHeader.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// OutputScheduler's earliest-deadline pick step by step, then several outputs at their own refresh rates sharing one
+// link in discrete time: with room on the link none may starve, and without it each still gets a share. Last the
+// real thing with capture threads and a sender waiting on the scheduler.
+namespace {
+    constexpr uint64_t MS = 1000000;
+    constexpr uint64_t RUN = 10000 * MS;
+
+    struct Source {
+        uint16_t refreshRate;
+        uint64_t cost; // Link time per frame
+    };
+
+    // Each source captures on its own clock into a latest-wins mailbox; the link sends one frame at a time for as
+    // long as that output's frames take. Returns how many frames of each output were captured and delivered.
+    std::pair<std::vector<uint64_t>, std::vector<uint64_t>> Simulate(const std::vector<Source>& sources) {
+        const size_t count = sources.size();
+        FrameCodec::OutputScheduler scheduler(static_cast<unsigned int>(count));
+        for (unsigned int i = 0; i < count; ++i) scheduler.SetRefreshRate(i, sources[i].refreshRate);
+
+        std::vector<uint64_t> captured(count);
+        std::vector<uint64_t> nextCapture(count);
+        for (size_t i = 0; i < count; ++i) nextCapture[i] = 1 + i * MS; // Out of phase, and never 0, which means "nothing ready"
+
+        uint64_t now = 1;
+        uint64_t busyUntil = 1;
+        while (now < RUN) {
+            for (size_t i = 0; i < count; ++i) {
+                while (nextCapture[i] <= now) {
+                    scheduler.MarkReady(static_cast<unsigned int>(i), nextCapture[i]);
+                    captured[i]++;
+                    nextCapture[i] += 1000000000ULL / sources[i].refreshRate;
+                }
+            }
+            if (now >= busyUntil) {
+                const int next = scheduler.TakeNext(now);
+                if (next >= 0) busyUntil = now + sources[next].cost;
+            }
+
+            uint64_t nextEvent = *std::min_element(nextCapture.begin(), nextCapture.end());
+            if (busyUntil > now) nextEvent = std::min(nextEvent, busyUntil);
+            now = nextEvent;
+        }
+
+        std::vector<uint64_t> delivered(count);
+        for (unsigned int i = 0; i < count; ++i) delivered[i] = scheduler.GetSent(i);
+        return { captured, delivered };
+    }
+
+    // Every output got at least `share` of what it captured
+    bool Served(const std::vector<Source>& sources, double share) {
+        const auto [captured, delivered] = Simulate(sources);
+        for (size_t i = 0; i < sources.size(); ++i) {
+            std::cout << "  output " << i << " @ " << sources[i].refreshRate << "Hz: " << delivered[i] << " of " << captured[i] << " sent" << std::endl;
+            if (delivered[i] < captured[i] * share) return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    {
+        FrameCodec::OutputScheduler scheduler(2);
+        scheduler.SetRefreshRate(0, 144);
+        scheduler.SetRefreshRate(1, 30);
+        Check(scheduler.TakeNext(1) == -1, "nothing ready, nothing taken");
+
+        // Output 1 waited longer, but output 0's frame is due first
+        scheduler.MarkReady(1, 1 * MS);
+        scheduler.MarkReady(0, 2 * MS);
+        Check(scheduler.TakeNext(3 * MS) == 0, "the earliest deadline goes first");
+        Check(scheduler.TakeNext(3 * MS) == 1, "then the other output");
+        Check(scheduler.TakeNext(3 * MS) == -1, "each ready frame is taken once");
+
+        // Marking again before the take keeps the older time, so the deadline at 1ms + 1/30s has passed at 40ms
+        scheduler.MarkReady(1, 1 * MS);
+        scheduler.MarkReady(1, 30 * MS);
+        Check(scheduler.TakeNext(40 * MS) == 1 && scheduler.GetLate(1) == 1, "a frame taken after its deadline is late");
+        Check(scheduler.GetSent(0) == 1 && scheduler.GetSent(1) == 2 && scheduler.GetLate(0) == 0, "sent and late are counted per output");
+
+        scheduler.MarkReady(0, 50 * MS);
+        scheduler.Close();
+        Check(scheduler.WaitNext() == 0, "a closed scheduler still hands out what is ready");
+        Check(scheduler.WaitNext() == -1, "then wakes the sender with nothing");
+        scheduler.MarkReady(1, 60 * MS);
+        scheduler.Reopen();
+        Check(scheduler.TakeNext(61 * MS) == -1, "a reopened scheduler has nothing ready");
+    }
+
+    // Link time per frame as a mostly static desktop's tile deltas would take it; 85% of the link in total
+    const std::vector<Source> underloaded = { { 144, 3 * MS }, { 60, 5 * MS }, { 30, 4 * MS } };
+    // Half as much again: the link can't keep up with all three
+    std::vector<Source> overloaded = underloaded;
+    for (Source& source : overloaded) source.cost = source.cost * 3 / 2;
+
+    std::cout << "Underloaded link" << std::endl;
+    Check(Served(underloaded, 0.9), "no output starves while the link has room");
+    std::cout << "Overloaded link" << std::endl;
+    Check(Served(overloaded, 0.25), "every output gets a share of an overloaded link");
+
+    {
+        FrameCodec::OutputScheduler scheduler(static_cast<unsigned int>(underloaded.size()));
+        for (unsigned int i = 0; i < underloaded.size(); ++i) scheduler.SetRefreshRate(i, underloaded[i].refreshRate);
+
+        std::vector<uint64_t> sent(underloaded.size(), 0);
+        std::thread sender([&]() {
+            int next;
+            while ((next = scheduler.WaitNext()) >= 0) sent[next]++;
+        });
+
+        std::atomic<bool> stop = false;
+        std::vector<std::thread> captures;
+        for (unsigned int i = 0; i < underloaded.size(); ++i) {
+            captures.emplace_back([&, i]() {
+                const auto interval = std::chrono::nanoseconds(1000000000LL / underloaded[i].refreshRate);
+                auto next = std::chrono::steady_clock::now();
+                while (!stop.load()) {
+                    next += interval;
+                    std::this_thread::sleep_until(next);
+                    scheduler.MarkReady(i, FrameCodec::FrameClockNow());
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        stop.store(true);
+        for (std::thread& capture : captures) capture.join();
+        scheduler.Close();
+        sender.join();
+
+        for (unsigned int i = 0; i < underloaded.size(); ++i) {
+            Check(sent[i] > 0 && sent[i] == scheduler.GetSent(i), "threaded: every output is sent and counted");
+        }
+    }
+
+    return TestResult("output scheduler");
+}
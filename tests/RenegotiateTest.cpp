@@ -0,0 +1,185 @@
+#include "BandLayout.hpp"
+#include "BufferArena.hpp"
+#include "ColorSpace.hpp"
+#include "FrameHeader.hpp"
+#include "SessionMode.hpp"
+#include "TileDelta.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Session modes: what IsValidSessionMode() refuses, how BufferArena grows, and a sequence of mode changes replayed
+// the way both ends apply them mid-session. The mode-change frame is encoded and parsed, each side's buffer is laid
+// out through its BufferArena, the codec state is rebuilt, and a random frame must round trip through the new mode.
+// Registration itself needs an adapter, so a fresh allocation stands in for it.
+namespace {
+    constexpr uint16_t RAW = static_cast<uint16_t>(FrameCodec::PixelFormat::BGRA32);
+    constexpr uint16_t LOSSLESS = static_cast<uint16_t>(FrameCodec::PixelFormat::BGRALossless);
+    constexpr uint16_t YUV440 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV440);
+    constexpr uint16_t YUV420 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV420);
+    constexpr uint16_t YUV422 = static_cast<uint16_t>(FrameCodec::PixelFormat::YUV422);
+    constexpr uint16_t BT601 = static_cast<uint16_t>(FrameCodec::ColorSpace::BT601Full);
+    constexpr uint16_t BT709 = static_cast<uint16_t>(FrameCodec::ColorSpace::BT709Limited);
+
+    struct Side {
+        FrameCodec::BufferArena arena;
+        std::vector<uint8_t> storage;
+        uint8_t* base = nullptr;
+
+        void Layout(size_t bytes) {
+            const size_t capacity = arena.Reserve(bytes);
+            if (capacity) {
+                storage.assign(capacity + FrameCodec::FRAME_CACHE_LINE, 0);
+                const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+                base = storage.data() + (FrameCodec::FRAME_CACHE_LINE - address % FrameCodec::FRAME_CACHE_LINE) % FrameCodec::FRAME_CACHE_LINE;
+            } else {
+                memset(base, 0, arena.GetCapacity());
+            }
+        }
+    };
+
+    // The sender's announcement, written into its slot and read back the way the receiver does
+    bool SendModeChange(Side& sender, Side& receiver, const FrameCodec::SessionMode& mode, uint64_t sequence) {
+        FrameCodec::FrameHeader* header = FrameCodec::BeginFrameHeader(sender.base + FrameCodec::FRAME_HEADER_OFFSET, sequence,
+                                                                       FrameCodec::PixelFormat::BGRA32, FrameCodec::PayloadEncoding::TileDelta, mode.width, mode.height);
+        header->flags = FrameCodec::FRAME_FLAG_MODE_CHANGE;
+        memcpy(sender.base + FrameCodec::FRAME_PAYLOAD_OFFSET, &mode, sizeof(mode));
+        FrameCodec::SealFrameHeader(header, sizeof(mode), true);
+        memcpy(receiver.base, sender.base, FrameCodec::FRAME_PAYLOAD_OFFSET + sizeof(mode));
+
+        FrameCodec::FrameHeaderStatus status;
+        const FrameCodec::FrameHeader* parsed = FrameCodec::ParseFrameHeader(receiver.base + FrameCodec::FRAME_HEADER_OFFSET,
+                                                                             FrameCodec::FRAME_HEADER_OFFSET + sizeof(mode), status);
+        if (!parsed || !(parsed->flags & FrameCodec::FRAME_FLAG_MODE_CHANGE) || parsed->payloadSize != sizeof(mode)) return false;
+
+        FrameCodec::SessionMode received;
+        memcpy(&received, FrameCodec::GetFramePayload(parsed), sizeof(received));
+        return FrameCodec::IsValidSessionMode(received) && received == mode;
+    }
+
+    // One frame through the new layout: a tile delta from black, or the YUV planes band by band
+    bool RoundTrip(Side& sender, Side& receiver, const FrameCodec::SessionMode& mode, std::mt19937& rng) {
+        const size_t slot = FrameCodec::FrameSlotSize(FrameCodec::MaxFramePayload(mode));
+        if (slot > receiver.arena.GetCapacity() || slot * 2 > sender.arena.GetCapacity()) return false;
+
+        uint8_t* sent = sender.base + FrameCodec::FRAME_PAYLOAD_OFFSET;
+        uint8_t* received = receiver.base + FrameCodec::FRAME_PAYLOAD_OFFSET;
+        const FrameCodec::PixelFormat format = static_cast<FrameCodec::PixelFormat>(mode.format);
+        if (FrameCodec::IsPlanarYuv(format)) {
+            const FrameCodec::PlanarBands bands(mode.width, mode.height, mode.bandCount, format);
+            if (bands.GetPayloadSize() != FrameCodec::MaxFramePayload(mode)) return false;
+            for (size_t i = 0; i < bands.GetPayloadSize(); ++i) sent[i] = static_cast<uint8_t>(rng());
+            for (unsigned int i = 0; i < bands.GetCount(); ++i) memcpy(received + bands[i].offset, sent + bands[i].offset, bands[i].size);
+            return memcmp(sent, received, bands.GetPayloadSize()) == 0;
+        }
+
+        FrameCodec::DeltaEncoder encoder(mode.width, mode.height);
+        encoder.SetTileCache(mode.tileCacheSize);
+        encoder.EnableLossless(format == FrameCodec::PixelFormat::BGRALossless);
+        FrameCodec::DeltaDecoder decoder(mode.width, mode.height);
+        decoder.SetTileCache(mode.tileCacheSize);
+        decoder.EnableLossless(format == FrameCodec::PixelFormat::BGRALossless);
+
+        // A few dirty blocks on black, like the first frame after a switch
+        std::vector<uint8_t> frame(static_cast<size_t>(mode.width) * mode.height * 4, 0);
+        for (unsigned int block = 0; block < 16; ++block) {
+            const unsigned int x0 = rng() % mode.width;
+            const unsigned int y0 = rng() % mode.height;
+            for (unsigned int y = y0; y < std::min<unsigned int>(y0 + 64, mode.height); ++y) {
+                for (unsigned int x = x0; x < std::min<unsigned int>(x0 + 64, mode.width); ++x) {
+                    memset(&frame[(static_cast<size_t>(y) * mode.width + x) * 4], static_cast<int>(rng() & 0xFF), 4);
+                }
+            }
+        }
+        const size_t length = encoder.Encode(frame.data(), sent);
+        if (length > FrameCodec::MaxFramePayload(mode)) return false;
+        memcpy(received, sent, length);
+        if (!decoder.Decode(received, length)) return false;
+        return memcmp(decoder.GetFrame(), frame.data(), frame.size()) == 0;
+    }
+}
+
+int main() {
+    {
+        const FrameCodec::SessionMode good = { 1920, 1080, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 };
+        Check(FrameCodec::IsValidSessionMode(good), "a plain mode is valid");
+        FrameCodec::SessionMode mode = good;
+        mode.width = 0;
+        Check(!FrameCodec::IsValidSessionMode(mode), "an empty size is refused");
+        mode = good;
+        mode.refreshRate = 0;
+        Check(!FrameCodec::IsValidSessionMode(mode), "a zero refresh rate is refused");
+        mode = good;
+        mode.format = 99;
+        Check(!FrameCodec::IsValidSessionMode(mode), "an unknown format is refused");
+        mode = good;
+        mode.colorSpace = FrameCodec::COLOR_SPACE_COUNT;
+        Check(!FrameCodec::IsValidSessionMode(mode), "an unknown colour space is refused");
+        mode = good;
+        mode.pull = 2;
+        Check(!FrameCodec::IsValidSessionMode(mode), "an unknown pull flag is refused");
+        mode = good;
+        mode.bandCount = 0;
+        Check(!FrameCodec::IsValidSessionMode(mode), "planar frames without bands are refused");
+        mode.bandCount = FrameCodec::MAX_BANDS + 1;
+        Check(!FrameCodec::IsValidSessionMode(mode), "more bands than MAX_BANDS are refused");
+        mode = good;
+        mode.format = LOSSLESS;
+        Check(FrameCodec::IsValidSessionMode(mode), "lossless tiles are valid when pushed");
+        mode.pull = 1;
+        Check(!FrameCodec::IsValidSessionMode(mode), "lossless tiles can't be pulled");
+    }
+
+    {
+        FrameCodec::BufferArena arena;
+        const size_t first = arena.Reserve(100000);
+        Check(first >= 100000 && first % FrameCodec::BufferArena::GRANULARITY == 0, "the first registration fits, rounded up to the granularity");
+        Check(arena.Reserve(50000) == 0 && arena.GetUsed() == 50000, "a smaller layout reuses the registration");
+        const size_t grown = arena.Reserve(first + 1);
+        Check(grown >= first / 2 * 3 && grown % FrameCodec::BufferArena::GRANULARITY == 0, "a bigger layout grows with headroom");
+        Check(arena.Reserve(first) == 0 && arena.Reserve(first + 1) == 0, "switching back and forth re-registers once");
+        Check(arena.GetRegistrations() == 2 && arena.GetReuses() == 3, "registrations and reuses are counted");
+    }
+
+    const FrameCodec::SessionMode modes[] = {
+        { 1920, 1080, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 144, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 144, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT601 },
+        { 2560, 1440, 144, YUV420, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT709 },
+        { 2560, 1440, 144, LOSSLESS, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1280, 720, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 2560, 1440, 60, YUV422, FrameCodec::DEFAULT_TILE_CACHE_SIZE, 8, 0, BT601 },
+        { 3840, 2160, 60, RAW, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 3840, 2160, 60, YUV420, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+        { 1920, 1080, 60, YUV440, FrameCodec::DEFAULT_TILE_CACHE_SIZE, FrameCodec::DEFAULT_BAND_COUNT, 0, BT601 },
+    };
+
+    Side sender;
+    Side receiver;
+    std::mt19937 rng(37);
+    uint64_t sequence = 0;
+    for (const FrameCodec::SessionMode& mode : modes) {
+        Check(FrameCodec::IsValidSessionMode(mode), "every mode in the sequence is valid");
+
+        // The first mode is the handshake's; every later one is announced by the sender's last frame in the old mode
+        if (sequence > 0) Check(SendModeChange(sender, receiver, mode, sequence), "the mode-change frame carries the new mode");
+        sequence++;
+
+        sender.Layout(FrameCodec::SenderBufferSize(mode));
+        receiver.Layout(FrameCodec::ReceiverBufferSize(mode));
+        Check(RoundTrip(sender, receiver, mode, rng), "a frame round trips through the new mode");
+        if (sequence == 3) Check(sender.arena.GetRegistrations() == 1 && receiver.arena.GetRegistrations() == 1, "going back to the first mode reuses its registration");
+    }
+    // Back to the first mode after the 4K ones: it fits what is registered already
+    const unsigned long long registrations = sender.arena.GetRegistrations();
+    sender.Layout(FrameCodec::SenderBufferSize(modes[0]));
+    Check(sender.arena.GetRegistrations() == registrations, "a smaller mode never registers again");
+
+    return TestResult("renegotiate");
+}
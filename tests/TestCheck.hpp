@@ -0,0 +1,23 @@
+#ifndef TESTCHECK_HPP
+#define TESTCHECK_HPP
+
+#pragma once
+
+#include <iostream>
+
+// Shared by the tests under ctest. Check() reports a failed expectation and carries on, so one run lists every
+// failure; TestResult() prints "<name>: OK" or "<name>: FAILED" and is what main() returns.
+inline bool g_Failed = false;
+
+inline void Check(bool condition, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED: " << what << std::endl;
+    g_Failed = true;
+}
+
+inline int TestResult(const char* name) {
+    std::cout << name << (g_Failed ? ": FAILED" : ": OK") << std::endl;
+    return g_Failed ? 1 : 0;
+}
+
+#endif
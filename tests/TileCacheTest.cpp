@@ -0,0 +1,164 @@
+#include "TileCache.hpp"
+#include "TileDelta.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// The tile cache: the sender's index hitting, promoting and evicting least recently used first into the freed slot;
+// two screens alternating coming out of the receiver's cache; a long random session over a small cache, plain and
+// lossless, leaving the receiver with the source's pixels every frame, which only holds while its slots mirror the
+// sender's index; and hits or stores into slots the receiver doesn't have refused.
+namespace {
+    constexpr uint16_t WIDTH = 300; // 5x3 tiles, edge tiles 44 wide and 52 high
+    constexpr uint16_t HEIGHT = 180;
+    constexpr size_t FRAME_BYTES = static_cast<size_t>(WIDTH) * HEIGHT * 4;
+    constexpr uint32_t SMALL_CACHE = 12;
+    constexpr unsigned int PATTERNS = 40;
+    constexpr unsigned int SESSION_FRAMES = 600;
+
+    // Every tile of the frame takes one of a few patterns, so tiles keep coming back
+    void Compose(const std::vector<std::vector<uint32_t>>& patterns, const std::vector<unsigned int>& layout, uint8_t* frame) {
+        const unsigned int tilesX = FrameCodec::TilesX(WIDTH);
+        uint32_t* pixels = reinterpret_cast<uint32_t*>(frame);
+        for (unsigned int y = 0; y < HEIGHT; ++y) {
+            for (unsigned int x = 0; x < WIDTH; ++x) {
+                const unsigned int tile = (y / FrameCodec::TILE_SIZE) * tilesX + x / FrameCodec::TILE_SIZE;
+                pixels[y * WIDTH + x] = patterns[layout[tile]][(y % FrameCodec::TILE_SIZE) * FrameCodec::TILE_SIZE + x % FrameCodec::TILE_SIZE];
+            }
+        }
+    }
+
+    struct Session {
+        FrameCodec::TileCacheStats stats;
+        bool exact = true;
+    };
+
+    Session RandomSession(bool lossless) {
+        std::mt19937 rng(11);
+        std::vector<std::vector<uint32_t>> patterns(PATTERNS, std::vector<uint32_t>(FrameCodec::TILE_SIZE * FrameCodec::TILE_SIZE));
+        for (auto& pattern : patterns) {
+            const uint32_t base = rng();
+            for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = (i % 5 == 0) ? static_cast<uint32_t>(rng()) : base;
+        }
+
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        encoder.EnableScrollDetection(false);
+        encoder.SetTileCache(SMALL_CACHE);
+        decoder.SetTileCache(SMALL_CACHE);
+        encoder.EnableLossless(lossless, 1);
+        decoder.EnableLossless(lossless, 1);
+
+        const unsigned int tileCount = FrameCodec::TilesX(WIDTH) * FrameCodec::TilesY(HEIGHT);
+        std::vector<unsigned int> layout(tileCount);
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT, lossless));
+        std::uniform_int_distribution<unsigned int> pick(0, PATTERNS - 1);
+        std::uniform_int_distribution<unsigned int> changes(1, 4);
+        Session session;
+
+        for (unsigned int n = 0; n < SESSION_FRAMES && session.exact; ++n) {
+            // Mostly a few tiles at a time, drawn from a handful of recent patterns, with whole-screen switches
+            const unsigned int count = (n % 50 == 0) ? tileCount : changes(rng);
+            for (unsigned int i = 0; i < count; ++i) layout[rng() % tileCount] = (n % 7 == 0) ? pick(rng) : (n / 60 * 3 + rng() % 6) % PATTERNS;
+            Compose(patterns, layout, frame.data());
+
+            const size_t length = encoder.Encode(frame.data(), payload.data());
+            session.exact = decoder.Decode(payload.data(), length) && memcmp(decoder.GetFrame(), frame.data(), FRAME_BYTES) == 0;
+        }
+        session.stats = encoder.GetTileCacheStats();
+        return session;
+    }
+
+    bool Decodes(FrameCodec::DeltaDecoder& decoder, FrameCodec::TileEntry entry, size_t pixelBytes) {
+        const FrameCodec::DeltaHeader header = { 0, 0, 1 };
+        std::vector<uint8_t> payload(sizeof(header) + sizeof(entry) + pixelBytes);
+        memcpy(payload.data(), &header, sizeof(header));
+        memcpy(payload.data() + sizeof(header), &entry, sizeof(entry));
+        return decoder.Decode(payload.data(), payload.size());
+    }
+}
+
+int main() {
+    // Index: slots in order until full, then the least recently used one goes
+    {
+        FrameCodec::TileCacheIndex index(4);
+        Check(index.Insert(101) == 0 && index.Insert(102) == 1 && index.Insert(103) == 2 && index.Insert(104) == 3,
+              "slots are handed out in order until the index is full");
+        Check(index.Find(101) == 0 && index.Find(103) == 2, "a stored hash is found in its slot");
+        Check(index.Find(999) == FrameCodec::TILE_CACHE_NONE, "an unknown hash misses");
+
+        // Use order, oldest first: 102, 104, 101, 103
+        Check(index.Insert(105) == 1 && index.Find(102) == FrameCodec::TILE_CACHE_NONE, "a full index evicts the least recently used hash into its slot");
+        Check(index.Insert(106) == 3 && index.Find(104) == FrameCodec::TILE_CACHE_NONE, "the next eviction takes the next oldest");
+        Check(index.Find(101) == 0, "a hit is promoted");
+        Check(index.Insert(107) == 2 && index.Find(103) == FrameCodec::TILE_CACHE_NONE, "a promoted hash outlives one used later but not since");
+        Check(index.Find(101) == 0 && index.Find(105) == 1 && index.Find(106) == 3 && index.Find(107) == 2, "the survivors keep their slots");
+
+        FrameCodec::TileCacheIndex none(0);
+        Check(none.Insert(101) == FrameCodec::TILE_CACHE_NONE && none.Find(101) == FrameCodec::TILE_CACHE_NONE, "an empty index stores nothing");
+    }
+
+    // Storage: an edge-shaped tile stored from one pitch and loaded into another
+    {
+        FrameCodec::TileCache cache(2);
+        std::vector<uint8_t> source(200 * 52), loaded(180 * 52, 0);
+        for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<uint8_t>(i * 31);
+        cache.Store(1, source.data(), 200, 44 * 4, 52);
+        cache.Load(1, loaded.data(), 180, 44 * 4, 52);
+        bool same = true;
+        for (unsigned int y = 0; y < 52; ++y) same = same && memcmp(loaded.data() + y * 180, source.data() + y * 200, 44 * 4) == 0;
+        Check(same && cache.Matches(1, source.data(), 200, 44 * 4, 52), "a stored tile loads back and matches its source");
+        source[3 * 200 + 5] ^= 1;
+        Check(!cache.Matches(1, source.data(), 200, 44 * 4, 52), "a changed pixel no longer matches");
+    }
+
+    // Two screens alternating: after the first round everything comes from the cache
+    {
+        std::mt19937 rng(5);
+        std::vector<uint8_t> screens[2] = { std::vector<uint8_t>(FRAME_BYTES), std::vector<uint8_t>(FRAME_BYTES) };
+        for (auto& screen : screens) for (uint8_t& byte : screen) byte = static_cast<uint8_t>(rng());
+
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        encoder.SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+        decoder.SetTileCache(FrameCodec::DEFAULT_TILE_CACHE_SIZE);
+        std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+        bool exact = true;
+        size_t lastLength = 0;
+        for (unsigned int n = 0; n < 6; ++n) {
+            const std::vector<uint8_t>& screen = screens[n % 2];
+            lastLength = encoder.Encode(screen.data(), payload.data());
+            exact = exact && decoder.Decode(payload.data(), lastLength) && memcmp(decoder.GetFrame(), screen.data(), FRAME_BYTES) == 0;
+        }
+        const unsigned int tileCount = FrameCodec::TilesX(WIDTH) * FrameCodec::TilesY(HEIGHT);
+        const FrameCodec::TileCacheStats& stats = encoder.GetTileCacheStats();
+        Check(exact, "alternating screens decode exact");
+        Check(stats.hits == 4 * tileCount && stats.misses == 2 * tileCount, "alternating screens hit for every tile after the first round");
+        Check(lastLength == sizeof(FrameCodec::DeltaHeader) + tileCount * sizeof(FrameCodec::TileEntry), "a frame of hits carries no pixels");
+    }
+
+    // A long random session over a cache far smaller than the patterns in play
+    for (bool lossless : { false, true }) {
+        const Session session = RandomSession(lossless);
+        std::cout << (lossless ? "lossless" : "plain") << " session: " << session.stats.hits << " hits, " << session.stats.misses << " misses" << std::endl;
+        Check(session.exact, "the receiver has the source's pixels after every frame of a random session");
+        Check(session.stats.hits > 0 && session.stats.misses > SMALL_CACHE, "a random session both hits and evicts");
+    }
+
+    // Slots the receiver doesn't have
+    {
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        decoder.SetTileCache(8);
+        const size_t tileBytes = FrameCodec::TILE_SIZE * FrameCodec::TILE_SIZE * 4;
+        Check(Decodes(decoder, { 0, 7 }, tileBytes) && Decodes(decoder, { FrameCodec::TILE_CACHE_HIT, 7 }, 0), "the last slot stores and hits");
+        Check(!Decodes(decoder, { FrameCodec::TILE_CACHE_HIT, 8 }, 0), "a hit past the cache is refused");
+        Check(!Decodes(decoder, { FrameCodec::TILE_CACHE_HIT | 1, FrameCodec::TILE_CACHE_NONE }, 0), "a hit with no slot is refused");
+        Check(!Decodes(decoder, { 0, 8 }, tileBytes), "a store past the cache is refused");
+    }
+
+    return TestResult("tile cache");
+}
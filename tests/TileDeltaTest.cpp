@@ -0,0 +1,185 @@
+#include "TileDelta.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Tile deltas with scroll detection: a page scrolled down and sideways goes out as copy rects plus the uncovered
+// tiles and comes back exact, for less than the tiles alone; ApplyCopyRect() moves overlapping rects as a memmove
+// would; and payloads with too many or out-of-frame copy rects, tile indices past the frame, slots with no cache, or
+// short sections are refused.
+namespace {
+    constexpr uint16_t WIDTH = 700; // Edge tiles are 60 wide and 36 high
+    constexpr uint16_t HEIGHT = 420;
+    constexpr unsigned int TOOLBAR = 48;
+    constexpr unsigned int FRAMES = 20;
+    constexpr size_t FRAME_BYTES = static_cast<size_t>(WIDTH) * HEIGHT * 4;
+
+    // A document bigger than the screen in both axes under a static toolbar, viewed from (scrollX, scrollY)
+    class Page {
+        public:
+        Page() : m_Document(static_cast<size_t>(DOC_WIDTH) * DOC_HEIGHT) {
+            std::mt19937 rng(99);
+            std::uniform_int_distribution<int> glyph(0, 3);
+            for (unsigned int y = 0; y < DOC_HEIGHT; ++y) {
+                const bool textLine = (y % 20) < 14;
+                for (unsigned int x = 0; x < DOC_WIDTH; ++x) {
+                    uint32_t color = 0xFFFFFFFF;
+                    if (textLine && (x % 8) < 6 && glyph(rng) == 0) color = 0xFF101010 + ((x * 7 + y * 13) & 0x3F);
+                    m_Document[static_cast<size_t>(y) * DOC_WIDTH + x] = color;
+                }
+            }
+        }
+
+        void Render(unsigned int scrollX, unsigned int scrollY, uint8_t* frame) const {
+            uint32_t* pixels = reinterpret_cast<uint32_t*>(frame);
+            for (unsigned int y = 0; y < HEIGHT; ++y) {
+                uint32_t* row = pixels + static_cast<size_t>(y) * WIDTH;
+                if (y < TOOLBAR) {
+                    std::fill(row, row + WIDTH, 0xFF3C3C3C);
+                    continue;
+                }
+                memcpy(row, m_Document.data() + static_cast<size_t>(scrollY + y - TOOLBAR) * DOC_WIDTH + scrollX, WIDTH * 4);
+            }
+        }
+
+        static constexpr unsigned int DOC_WIDTH = WIDTH * 3;
+        static constexpr unsigned int DOC_HEIGHT = HEIGHT * 3;
+
+        private:
+        std::vector<uint32_t> m_Document;
+    };
+
+    struct Session {
+        unsigned long long bytes = 0;
+        unsigned long long rects = 0;
+        bool exact = true;
+    };
+
+    // Scrolls the page by (stepX, stepY) a frame, after a first frame that primes both sides
+    Session Scroll(const Page& page, unsigned int stepX, unsigned int stepY, bool detect) {
+        FrameCodec::DeltaEncoder encoder(WIDTH, HEIGHT);
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        encoder.EnableScrollDetection(detect);
+
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        std::vector<uint8_t> payload(FrameCodec::MaxDeltaSize(WIDTH, HEIGHT));
+        Session session;
+
+        for (unsigned int n = 0; n <= FRAMES; ++n) {
+            page.Render(n * stepX, n * stepY, frame.data());
+            const size_t length = encoder.Encode(frame.data(), payload.data());
+            if (n > 0) session.bytes += length;
+
+            session.exact = session.exact && decoder.Decode(payload.data(), length) && decoder.GetPitch() == WIDTH * 4u &&
+                            memcmp(decoder.GetFrame(), frame.data(), FRAME_BYTES) == 0;
+        }
+        session.rects = encoder.GetCopiedRects();
+        return session;
+    }
+
+    // Header, copy rects and entries as given, then `pixelBytes` bytes of pixels
+    std::vector<uint8_t> Payload(uint16_t copyCount, uint32_t tileCount, const std::vector<FrameCodec::CopyRect>& rects,
+                                 const std::vector<FrameCodec::TileEntry>& entries, size_t pixelBytes) {
+        const FrameCodec::DeltaHeader header = { copyCount, 0, tileCount };
+        std::vector<uint8_t> payload(sizeof(header) + rects.size() * sizeof(FrameCodec::CopyRect) +
+                                     entries.size() * sizeof(FrameCodec::TileEntry) + pixelBytes, 0x80);
+        uint8_t* p = payload.data();
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        if (!rects.empty()) memcpy(p, rects.data(), rects.size() * sizeof(FrameCodec::CopyRect));
+        p += rects.size() * sizeof(FrameCodec::CopyRect);
+        if (!entries.empty()) memcpy(p, entries.data(), entries.size() * sizeof(FrameCodec::TileEntry));
+        return payload;
+    }
+
+    bool Decodes(const std::vector<uint8_t>& payload) {
+        FrameCodec::DeltaDecoder decoder(WIDTH, HEIGHT);
+        return decoder.Decode(payload.data(), payload.size());
+    }
+}
+
+int main() {
+    const Page page;
+    const unsigned int steps[] = { 3, 40 };
+
+    for (unsigned int step : steps) {
+        const Session down = Scroll(page, 0, step, true);
+        const Session downPlain = Scroll(page, 0, step, false);
+        const Session right = Scroll(page, step, 0, true);
+        const Session rightPlain = Scroll(page, step, 0, false);
+        std::cout << "step " << step << "px: down " << down.bytes << " bytes in " << down.rects << " rects (" << downPlain.bytes
+                  << " without), right " << right.bytes << " bytes in " << right.rects << " rects (" << rightPlain.bytes << " without)" << std::endl;
+
+        Check(down.exact && downPlain.exact, "a page scrolled down decodes exact, with and without scroll detection");
+        Check(right.exact && rightPlain.exact, "a page scrolled sideways decodes exact, with and without scroll detection");
+        Check(down.rects > 0 && downPlain.rects == 0, "scrolling down is sent as copy rects");
+        Check(right.rects > 0 && rightPlain.rects == 0, "scrolling sideways is sent as copy rects");
+        Check(down.bytes < downPlain.bytes, "copy rects make scrolling down cheaper than the tiles");
+        Check(right.bytes < rightPlain.bytes, "copy rects make scrolling sideways cheaper than the tiles");
+    }
+
+    // Overlapping moves in all four directions, against a copy through a separate buffer
+    {
+        std::mt19937 rng(3);
+        std::vector<uint8_t> frame(FRAME_BYTES);
+        for (uint8_t& byte : frame) byte = static_cast<uint8_t>(rng());
+
+        const FrameCodec::CopyRect rects[] = {
+            { 10, 20, 10, 25, 200, 150 }, { 10, 25, 10, 20, 200, 150 },
+            { 20, 10, 27, 10, 150, 200 }, { 27, 10, 20, 10, 150, 200 },
+        };
+        bool moved = true;
+        for (const FrameCodec::CopyRect& rect : rects) {
+            std::vector<uint8_t> expected = frame;
+            std::vector<uint8_t> block(static_cast<size_t>(rect.width) * rect.height * 4);
+            for (unsigned int y = 0; y < rect.height; ++y) {
+                memcpy(block.data() + static_cast<size_t>(y) * rect.width * 4, frame.data() + ((rect.srcY + y) * WIDTH + rect.srcX) * 4, rect.width * 4);
+            }
+            for (unsigned int y = 0; y < rect.height; ++y) {
+                memcpy(expected.data() + ((rect.dstY + y) * WIDTH + rect.dstX) * 4, block.data() + static_cast<size_t>(y) * rect.width * 4, rect.width * 4);
+            }
+            FrameCodec::ApplyCopyRect(frame.data(), WIDTH * 4, rect);
+            moved = moved && frame == expected;
+        }
+        Check(moved, "overlapping copy rects move as a memmove would");
+    }
+
+    // Malformed payloads
+    {
+        const uint32_t tileCount = FrameCodec::TilesX(WIDTH) * FrameCodec::TilesY(HEIGHT);
+        const uint32_t lastTile = tileCount - 1; // 60x36 pixels
+        const size_t lastTileBytes = 60 * 36 * 4;
+
+        Check(Decodes(Payload(0, 0, {}, {}, 0)), "an empty payload decodes");
+        Check(Decodes(Payload(1, 1, { { 0, 0, 640, 384, 60, 36 } }, { { lastTile, FrameCodec::TILE_CACHE_NONE } }, lastTileBytes)),
+              "a rect into the last tile and that tile decode");
+
+        std::vector<uint8_t> shortHeader = Payload(0, 0, {}, {}, 0);
+        shortHeader.resize(sizeof(FrameCodec::DeltaHeader) - 1);
+        Check(!Decodes(shortHeader), "a payload shorter than its header is refused");
+
+        std::vector<FrameCodec::CopyRect> tooMany(FrameCodec::MAX_COPY_RECTS + 1, FrameCodec::CopyRect { 0, 0, 0, 0, 1, 1 });
+        Check(!Decodes(Payload(static_cast<uint16_t>(tooMany.size()), 0, tooMany, {}, 0)), "more copy rects than allowed are refused");
+        Check(!Decodes(Payload(0, tileCount + 1, {}, std::vector<FrameCodec::TileEntry>(tileCount + 1, FrameCodec::TileEntry { 0, FrameCodec::TILE_CACHE_NONE }), 0)),
+              "more tiles than the frame has are refused");
+        Check(!Decodes(Payload(2, 0, { { 0, 0, 0, 0, 1, 1 } }, {}, 0)), "a copy rect section cut short is refused");
+
+        const FrameCodec::CopyRect outside[] = {
+            { WIDTH - 10, 0, 0, 0, 11, 1 }, { 0, 0, WIDTH - 10, 0, 11, 1 },
+            { 0, HEIGHT - 10, 0, 0, 1, 11 }, { 0, 0, 0, HEIGHT - 10, 1, 11 },
+        };
+        for (const FrameCodec::CopyRect& rect : outside) Check(!Decodes(Payload(1, 0, { rect }, {}, 0)), "a copy rect reaching outside the frame is refused");
+
+        Check(!Decodes(Payload(0, 1, {}, { { tileCount, FrameCodec::TILE_CACHE_NONE } }, 64 * 64 * 4)), "a tile index past the frame is refused");
+        Check(!Decodes(Payload(0, 1, {}, { { lastTile, FrameCodec::TILE_CACHE_NONE } }, lastTileBytes - 1)), "a tile cut short is refused");
+        Check(!Decodes(Payload(0, 2, {}, { { 0, FrameCodec::TILE_CACHE_NONE } }, 0)), "an entry section cut short is refused");
+        Check(!Decodes(Payload(0, 1, {}, { { 0, 0 } }, 64 * 64 * 4)), "a tile stored into a slot with no cache is refused");
+        Check(!Decodes(Payload(0, 1, {}, { { FrameCodec::TILE_CACHE_HIT, 0 } }, 0)), "a cache hit with no cache is refused");
+    }
+
+    return TestResult("tile delta");
+}
@@ -0,0 +1,136 @@
+#include "TraceRecorder.hpp"
+#include "TestCheck.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pipeline-like threads (capture, copy, write, completion waits) recording nested stages into the trace recorder,
+// and the written file checked: well-formed, every thread named, timestamps in order per thread, begins matched by
+// ends, and no event lost unless counted as dropped.
+namespace {
+    constexpr unsigned int THREADS = 4;
+    constexpr const char* THREAD_NAMES[THREADS] = { "capture", "copy", "write", "cq" };
+    constexpr uint64_t EVENTS_PER_ITERATION = 5;
+
+    // A paced thread blocks between frames like a stage waiting on a completion, which is when the flusher gets to run
+    constexpr auto PACE = std::chrono::microseconds(100);
+
+    // Each iteration records frame begin/end, a nested stage begin/end and an instant
+    void Run(uint64_t iterations, bool paced) {
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < THREADS; ++t) {
+            workers.emplace_back([t, iterations, paced]() {
+                FrameCodec::TraceRecorder::Instance().SetThreadName(THREAD_NAMES[t]);
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    FrameCodec::TraceScope frame("Frame", THREAD_NAMES[t]);
+                    {
+                        FrameCodec::TraceScope stage("Stage", THREAD_NAMES[t]);
+                        if (paced) std::this_thread::sleep_for(PACE);
+                    }
+                    FrameCodec::TraceInstant("Mark", THREAD_NAMES[t]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    struct FileCheck {
+        bool wellFormed = false;
+        uint64_t events = 0;
+        unsigned int names = 0;
+        unsigned int outOfOrder = 0;
+        unsigned int unbalanced = 0; // Threads whose begins and ends don't pair up
+    };
+
+    FileCheck ReadBack(const std::filesystem::path& path) {
+        FileCheck check;
+        std::ifstream in(path);
+        std::string line;
+        std::string last;
+        std::map<unsigned int, double> lastTs;
+        std::map<unsigned int, int> depth;
+        std::map<unsigned int, bool> broken;
+
+        if (!std::getline(in, line) || line != "{\"traceEvents\":[") return check;
+        while (std::getline(in, line)) {
+            last = line;
+            if (line.rfind("{\"name\":", 0) != 0) continue;
+            if (line.find("\"ph\":\"M\"") != std::string::npos) {
+                check.names++;
+                continue;
+            }
+
+            const size_t ph = line.find("\"ph\":\"");
+            const size_t ts = line.find("\"ts\":");
+            const size_t tid = line.find("\"tid\":");
+            if (ph == std::string::npos || ts == std::string::npos || tid == std::string::npos) return check;
+            const char phase = line[ph + 6];
+            const double time = strtod(line.c_str() + ts + 5, nullptr);
+            const unsigned int thread = static_cast<unsigned int>(strtoul(line.c_str() + tid + 6, nullptr, 10));
+
+            if (lastTs.count(thread) && time < lastTs[thread]) check.outOfOrder++;
+            lastTs[thread] = time;
+            if (phase == 'B') depth[thread]++;
+            if (phase == 'E' && --depth[thread] < 0) broken[thread] = true;
+            check.events++;
+        }
+
+        for (const auto& [thread, open] : depth) {
+            if (open != 0 || broken[thread]) check.unbalanced++;
+        }
+        check.wellFormed = last == "],\"displayTimeUnit\":\"ms\"}";
+        return check;
+    }
+}
+
+int main() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ndrc_trace_test.json";
+    FrameCodec::TraceRecorder& recorder = FrameCodec::TraceRecorder::Instance();
+
+    // Nothing is recorded while stopped
+    FrameCodec::TraceInstant("Off", "test");
+    Check(recorder.GetWritten() == 0 && recorder.GetDropped() == 0, "a stopped recorder records nothing");
+
+    // Paced threads: the default rings hold less than a thread records, so the flusher must keep up
+    constexpr uint64_t PACED_ITERATIONS = 2000;
+    if (!recorder.Start(path.string())) {
+        std::cout << "FAILED: the trace file can't be opened" << std::endl;
+        return 1;
+    }
+    Run(PACED_ITERATIONS, true);
+    recorder.Stop();
+
+    const FileCheck paced = ReadBack(path);
+    std::cout << "Paced: " << paced.events << " of " << PACED_ITERATIONS * EVENTS_PER_ITERATION * THREADS << " events, " << recorder.GetDropped() << " dropped" << std::endl;
+    Check(paced.wellFormed, "paced: the file is well formed");
+    Check(paced.names == THREADS, "paced: every thread is named");
+    Check(paced.outOfOrder == 0, "paced: timestamps are in order per thread");
+    Check(paced.unbalanced == 0, "paced: every begin has its end");
+    Check(recorder.GetDropped() == 0 && paced.events == PACED_ITERATIONS * EVENTS_PER_ITERATION * THREADS, "paced: no event is lost");
+
+    // Bursts into small rings: events are dropped, but every one is either written or counted
+    constexpr uint64_t BURST_ITERATIONS = 200000;
+    if (!recorder.Start(path.string(), 1 << 10)) {
+        std::cout << "FAILED: the trace file can't be opened" << std::endl;
+        return 1;
+    }
+    Run(BURST_ITERATIONS, false);
+    recorder.Stop();
+
+    const FileCheck burst = ReadBack(path);
+    std::cout << "Burst: " << burst.events << " written, " << recorder.GetDropped() << " dropped of " << BURST_ITERATIONS * EVENTS_PER_ITERATION * THREADS << std::endl;
+    Check(burst.wellFormed, "burst: the file is well formed");
+    Check(burst.outOfOrder == 0, "burst: timestamps are in order per thread");
+    Check(burst.events == recorder.GetWritten(), "burst: the written count matches the file");
+    Check(burst.events + recorder.GetDropped() == BURST_ITERATIONS * EVENTS_PER_ITERATION * THREADS, "burst: every event is written or counted as dropped");
+    std::filesystem::remove(path);
+
+    return TestResult("trace recorder");
+}